@@ -66,6 +66,12 @@ void INSCovariancePrediction(float dT);
 //! Correct the state and covariance estimate based on the sensors that were updated
 void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[3], float BaroAlt, uint16_t SensorsUsed);
 
+//! Queue sensors that were updated to be corrected with by INSCorrectionStep
+void INSDeferCorrection(const float mag_data[3], const float Pos[3], const float Vel[3], float BaroAlt, uint16_t SensorsUsed);
+
+//! Correct with one group of the queued sensors, returns the sensors still queued
+uint16_t INSCorrectionStep();
+
 //! Get the current state estimate
 void INSGetState(float *pos, float *vel, float *attitude, float *gyro_bias, float *accel_bias);
 
@@ -86,6 +92,7 @@ void INSSetGyroVar(const float gyro_var[3]);
 void INSSetMagNorth(const float B[3]);
 void INSSetMagVar(const float scaled_mag_var[3]);
 void INSSetBaroVar(float baro_var);
+void INSSetGPSDelay(float delay);
 void INSPosVelReset(const float pos[3], const float vel[3]);
 
 void INSGetVariance(float *p);
@@ -59,10 +59,17 @@ typedef enum {UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE, U
 UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream, UAVTalkAckCb ackCallback, UAVTalkReqCb reqCallback, UAVTalkFileCb fileCallback);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkSendObjectSnapshot(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint32_t timestamp, const void *data);
 int32_t UAVTalkSendNack(UAVTalkConnection connectionHandle, uint32_t objId, uint16_t instId);
-void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbytes,
+int32_t UAVTalkSetAggregation(UAVTalkConnection connectionHandle, uint16_t mtu);
+int32_t UAVTalkAggregateObject(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkFlushAggregate(UAVTalkConnection connectionHandle);
+int32_t UAVTalkSetDeltaEncoding(UAVTalkConnection connectionHandle, uint8_t slots);
+void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, const uint8_t *rxbytes,
 		int numbytes);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connection, uint8_t rxbyte);
+UAVTalkRxState UAVTalkProcessInputFrame(UAVTalkConnection connectionHandle,
+		const uint8_t *rxbytes, int numbytes, int *consumed);
 int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
 int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats);
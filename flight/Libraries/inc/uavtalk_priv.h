@@ -65,6 +65,44 @@ struct fileresp_data {
 	uint8_t flags;
 } __attribute__((packed));
 
+/* An aggregate (UAVTALK_TYPE_MULTI) frame has a minimal header with a zero
+ * object ID, followed by one record per object update: the object ID, the
+ * length of the rest of the record, then the instance ID (multi-instance
+ * objects only) and the object data.  The length lets a receiver step over
+ * objects it does not know.
+ */
+//! Header of each record in an aggregate frame
+typedef struct {
+	uint32_t objId;
+	uint8_t length;
+} __attribute__((packed)) uavtalk_multi_record;
+#define UAVTALK_MULTI_RECORD_HEADER_LENGTH sizeof(uavtalk_multi_record)
+
+/* A delta (UAVTALK_TYPE_DELTA) frame carries an object update as changes to
+ * the copy of the instance last sent on the connection.  After the usual
+ * header come the CRC-32 of that copy (little endian), a bitmap with one bit
+ * per UAVTALK_DELTA_BLOCK bytes of object data (bit 0 of the first byte is
+ * the first block, and the last block may be short), then the data of each
+ * block whose bit is set.  A receiver whose copy has a different CRC must
+ * drop the update and request the object, which is then sent whole.
+ */
+#define UAVTALK_DELTA_BLOCK             4
+#define UAVTALK_DELTA_CHECK_LENGTH      4
+#define UAVTALK_DELTA_MAP_LENGTH(len)   (((len) + UAVTALK_DELTA_BLOCK * 8 - 1) / (UAVTALK_DELTA_BLOCK * 8))
+//! Smaller objects are always sent whole
+#define UAVTALK_DELTA_MIN_LENGTH        16
+//! Score a kept copy loses each time an object without one is sent
+#define UAVTALK_DELTA_MISS_COST         8
+#define UAVTALK_DELTA_MAX_SCORE         1024
+
+//! Copy of an object instance as last sent, for taking deltas against
+typedef struct {
+	uint32_t objId;		/**< 0 if the slot is free */
+	uint16_t instId;
+	uint16_t score;		/**< Bytes recently saved; low scorers are replaced */
+	uint8_t data[UAVOBJECTS_LARGEST];
+} uavtalk_delta_slot;
+
 typedef uint8_t uavtalk_checksum;
 #define UAVTALK_CHECKSUM_LENGTH         sizeof(uavtalk_checksum)
 #define UAVTALK_MAX_PAYLOAD_LENGTH      (UAVOBJECTS_LARGEST + 1)
@@ -96,6 +134,16 @@ typedef struct {
 	uint32_t txSize;
 	uint8_t *txBuffer;
 
+	uint8_t *aggBuffer;	/**< Aggregate frame being built, allocated on first use */
+	uint16_t aggMtu;	/**< Largest aggregate frame to send, 0 if not aggregating */
+	uint16_t aggLength;	/**< Bytes used in aggBuffer, including the header */
+	uint16_t aggObjects;
+	uint16_t aggObjectBytes;
+
+	uavtalk_delta_slot *deltaSlots;	/**< Kept when deltas are disabled */
+	uint8_t numDeltaSlots;	/**< 0 if not sending deltas */
+	uint8_t allocDeltaSlots;
+
 	UAVTalkOutputCb outCb;
 	UAVTalkAckCb ackCb;
 	UAVTalkReqCb reqCb;
@@ -115,6 +163,8 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK   (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK       (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK      (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_MULTI     (UAVTALK_TYPE_VER | 0x05)
+#define UAVTALK_TYPE_DELTA     (UAVTALK_TYPE_VER | 0x06)
 #define UAVTALK_TYPE_FILEREQ   (UAVTALK_TYPE_VER | 0x08)
 #define UAVTALK_TYPE_FILEDATA  (UAVTALK_TYPE_VER | 0x09)
 #define UAVTALK_TYPE_OBJ_TS    (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
@@ -0,0 +1,266 @@
+/**
+ ******************************************************************************
+ * @addtogroup Math
+ * @{
+ * @addtogroup INSGPS
+ * @{
+ *
+ * @file       insgps14state_covariance.h
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Sparse covariance prediction for the 14 state INS
+ *
+ * Generated by python/ins/covariance_codegen.py from the sparsity of F and
+ * G in LinearizeFG().  Do not edit by hand.
+ *
+ * 893 multiplies, against 6720 for the dense version.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef INSGPS14STATE_COVARIANCE_H
+#define INSGPS14STATE_COVARIANCE_H
+
+/**
+ * Pnew = (I+F*T)*P*(I+F*T)' + T^2*G*Q*G', in place.  Elements of F and G
+ * outside the pattern of LinearizeFG() are never read, and the bias random
+ * walks are taken to enter G with a gain of one.
+ */
+void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
+			  float Q[NUMW], float dT, float P[NUMX][NUMX])
+{
+	const float T = dT;
+	const float Tsq = dT * dT;
+	float A[NUMX][NUMX];
+
+	// A = (I + F*T) * P
+	A[0][0] = P[0][0] + T*(P[3][0]);
+	A[0][1] = P[0][1] + T*(P[3][1]);
+	A[0][2] = P[0][2] + T*(P[3][2]);
+	A[0][3] = P[0][3] + T*(P[3][3]);
+	A[0][4] = P[0][4] + T*(P[3][4]);
+	A[0][5] = P[0][5] + T*(P[3][5]);
+	A[0][6] = P[0][6] + T*(P[3][6]);
+	A[0][7] = P[0][7] + T*(P[3][7]);
+	A[0][8] = P[0][8] + T*(P[3][8]);
+	A[0][9] = P[0][9] + T*(P[3][9]);
+	A[0][10] = P[0][10] + T*(P[3][10]);
+	A[0][11] = P[0][11] + T*(P[3][11]);
+	A[0][12] = P[0][12] + T*(P[3][12]);
+	A[0][13] = P[0][13] + T*(P[3][13]);
+	A[1][1] = P[1][1] + T*(P[4][1]);
+	A[1][2] = P[1][2] + T*(P[4][2]);
+	A[1][3] = P[1][3] + T*(P[4][3]);
+	A[1][4] = P[1][4] + T*(P[4][4]);
+	A[1][5] = P[1][5] + T*(P[4][5]);
+	A[1][6] = P[1][6] + T*(P[4][6]);
+	A[1][7] = P[1][7] + T*(P[4][7]);
+	A[1][8] = P[1][8] + T*(P[4][8]);
+	A[1][9] = P[1][9] + T*(P[4][9]);
+	A[1][10] = P[1][10] + T*(P[4][10]);
+	A[1][11] = P[1][11] + T*(P[4][11]);
+	A[1][12] = P[1][12] + T*(P[4][12]);
+	A[1][13] = P[1][13] + T*(P[4][13]);
+	A[2][2] = P[2][2] + T*(P[5][2]);
+	A[2][3] = P[2][3] + T*(P[5][3]);
+	A[2][4] = P[2][4] + T*(P[5][4]);
+	A[2][5] = P[2][5] + T*(P[5][5]);
+	A[2][6] = P[2][6] + T*(P[5][6]);
+	A[2][7] = P[2][7] + T*(P[5][7]);
+	A[2][8] = P[2][8] + T*(P[5][8]);
+	A[2][9] = P[2][9] + T*(P[5][9]);
+	A[2][10] = P[2][10] + T*(P[5][10]);
+	A[2][11] = P[2][11] + T*(P[5][11]);
+	A[2][12] = P[2][12] + T*(P[5][12]);
+	A[2][13] = P[2][13] + T*(P[5][13]);
+	A[3][3] = P[3][3] + T*(F[3][6]*P[6][3] + F[3][7]*P[7][3] + F[3][8]*P[8][3] + F[3][9]*P[9][3] + F[3][13]*P[13][3]);
+	A[3][4] = P[3][4] + T*(F[3][6]*P[6][4] + F[3][7]*P[7][4] + F[3][8]*P[8][4] + F[3][9]*P[9][4] + F[3][13]*P[13][4]);
+	A[3][5] = P[3][5] + T*(F[3][6]*P[6][5] + F[3][7]*P[7][5] + F[3][8]*P[8][5] + F[3][9]*P[9][5] + F[3][13]*P[13][5]);
+	A[3][6] = P[3][6] + T*(F[3][6]*P[6][6] + F[3][7]*P[7][6] + F[3][8]*P[8][6] + F[3][9]*P[9][6] + F[3][13]*P[13][6]);
+	A[3][7] = P[3][7] + T*(F[3][6]*P[6][7] + F[3][7]*P[7][7] + F[3][8]*P[8][7] + F[3][9]*P[9][7] + F[3][13]*P[13][7]);
+	A[3][8] = P[3][8] + T*(F[3][6]*P[6][8] + F[3][7]*P[7][8] + F[3][8]*P[8][8] + F[3][9]*P[9][8] + F[3][13]*P[13][8]);
+	A[3][9] = P[3][9] + T*(F[3][6]*P[6][9] + F[3][7]*P[7][9] + F[3][8]*P[8][9] + F[3][9]*P[9][9] + F[3][13]*P[13][9]);
+	A[3][10] = P[3][10] + T*(F[3][6]*P[6][10] + F[3][7]*P[7][10] + F[3][8]*P[8][10] + F[3][9]*P[9][10] + F[3][13]*P[13][10]);
+	A[3][11] = P[3][11] + T*(F[3][6]*P[6][11] + F[3][7]*P[7][11] + F[3][8]*P[8][11] + F[3][9]*P[9][11] + F[3][13]*P[13][11]);
+	A[3][12] = P[3][12] + T*(F[3][6]*P[6][12] + F[3][7]*P[7][12] + F[3][8]*P[8][12] + F[3][9]*P[9][12] + F[3][13]*P[13][12]);
+	A[3][13] = P[3][13] + T*(F[3][6]*P[6][13] + F[3][7]*P[7][13] + F[3][8]*P[8][13] + F[3][9]*P[9][13] + F[3][13]*P[13][13]);
+	A[4][4] = P[4][4] + T*(F[4][6]*P[6][4] + F[4][7]*P[7][4] + F[4][8]*P[8][4] + F[4][9]*P[9][4] + F[4][13]*P[13][4]);
+	A[4][5] = P[4][5] + T*(F[4][6]*P[6][5] + F[4][7]*P[7][5] + F[4][8]*P[8][5] + F[4][9]*P[9][5] + F[4][13]*P[13][5]);
+	A[4][6] = P[4][6] + T*(F[4][6]*P[6][6] + F[4][7]*P[7][6] + F[4][8]*P[8][6] + F[4][9]*P[9][6] + F[4][13]*P[13][6]);
+	A[4][7] = P[4][7] + T*(F[4][6]*P[6][7] + F[4][7]*P[7][7] + F[4][8]*P[8][7] + F[4][9]*P[9][7] + F[4][13]*P[13][7]);
+	A[4][8] = P[4][8] + T*(F[4][6]*P[6][8] + F[4][7]*P[7][8] + F[4][8]*P[8][8] + F[4][9]*P[9][8] + F[4][13]*P[13][8]);
+	A[4][9] = P[4][9] + T*(F[4][6]*P[6][9] + F[4][7]*P[7][9] + F[4][8]*P[8][9] + F[4][9]*P[9][9] + F[4][13]*P[13][9]);
+	A[4][10] = P[4][10] + T*(F[4][6]*P[6][10] + F[4][7]*P[7][10] + F[4][8]*P[8][10] + F[4][9]*P[9][10] + F[4][13]*P[13][10]);
+	A[4][11] = P[4][11] + T*(F[4][6]*P[6][11] + F[4][7]*P[7][11] + F[4][8]*P[8][11] + F[4][9]*P[9][11] + F[4][13]*P[13][11]);
+	A[4][12] = P[4][12] + T*(F[4][6]*P[6][12] + F[4][7]*P[7][12] + F[4][8]*P[8][12] + F[4][9]*P[9][12] + F[4][13]*P[13][12]);
+	A[4][13] = P[4][13] + T*(F[4][6]*P[6][13] + F[4][7]*P[7][13] + F[4][8]*P[8][13] + F[4][9]*P[9][13] + F[4][13]*P[13][13]);
+	A[5][5] = P[5][5] + T*(F[5][6]*P[6][5] + F[5][7]*P[7][5] + F[5][8]*P[8][5] + F[5][9]*P[9][5] + F[5][13]*P[13][5]);
+	A[5][6] = P[5][6] + T*(F[5][6]*P[6][6] + F[5][7]*P[7][6] + F[5][8]*P[8][6] + F[5][9]*P[9][6] + F[5][13]*P[13][6]);
+	A[5][7] = P[5][7] + T*(F[5][6]*P[6][7] + F[5][7]*P[7][7] + F[5][8]*P[8][7] + F[5][9]*P[9][7] + F[5][13]*P[13][7]);
+	A[5][8] = P[5][8] + T*(F[5][6]*P[6][8] + F[5][7]*P[7][8] + F[5][8]*P[8][8] + F[5][9]*P[9][8] + F[5][13]*P[13][8]);
+	A[5][9] = P[5][9] + T*(F[5][6]*P[6][9] + F[5][7]*P[7][9] + F[5][8]*P[8][9] + F[5][9]*P[9][9] + F[5][13]*P[13][9]);
+	A[5][10] = P[5][10] + T*(F[5][6]*P[6][10] + F[5][7]*P[7][10] + F[5][8]*P[8][10] + F[5][9]*P[9][10] + F[5][13]*P[13][10]);
+	A[5][11] = P[5][11] + T*(F[5][6]*P[6][11] + F[5][7]*P[7][11] + F[5][8]*P[8][11] + F[5][9]*P[9][11] + F[5][13]*P[13][11]);
+	A[5][12] = P[5][12] + T*(F[5][6]*P[6][12] + F[5][7]*P[7][12] + F[5][8]*P[8][12] + F[5][9]*P[9][12] + F[5][13]*P[13][12]);
+	A[5][13] = P[5][13] + T*(F[5][6]*P[6][13] + F[5][7]*P[7][13] + F[5][8]*P[8][13] + F[5][9]*P[9][13] + F[5][13]*P[13][13]);
+	A[6][6] = P[6][6] + T*(F[6][7]*P[7][6] + F[6][8]*P[8][6] + F[6][9]*P[9][6] + F[6][10]*P[10][6] + F[6][11]*P[11][6] + F[6][12]*P[12][6]);
+	A[6][7] = P[6][7] + T*(F[6][7]*P[7][7] + F[6][8]*P[8][7] + F[6][9]*P[9][7] + F[6][10]*P[10][7] + F[6][11]*P[11][7] + F[6][12]*P[12][7]);
+	A[6][8] = P[6][8] + T*(F[6][7]*P[7][8] + F[6][8]*P[8][8] + F[6][9]*P[9][8] + F[6][10]*P[10][8] + F[6][11]*P[11][8] + F[6][12]*P[12][8]);
+	A[6][9] = P[6][9] + T*(F[6][7]*P[7][9] + F[6][8]*P[8][9] + F[6][9]*P[9][9] + F[6][10]*P[10][9] + F[6][11]*P[11][9] + F[6][12]*P[12][9]);
+	A[6][10] = P[6][10] + T*(F[6][7]*P[7][10] + F[6][8]*P[8][10] + F[6][9]*P[9][10] + F[6][10]*P[10][10] + F[6][11]*P[11][10] + F[6][12]*P[12][10]);
+	A[6][11] = P[6][11] + T*(F[6][7]*P[7][11] + F[6][8]*P[8][11] + F[6][9]*P[9][11] + F[6][10]*P[10][11] + F[6][11]*P[11][11] + F[6][12]*P[12][11]);
+	A[6][12] = P[6][12] + T*(F[6][7]*P[7][12] + F[6][8]*P[8][12] + F[6][9]*P[9][12] + F[6][10]*P[10][12] + F[6][11]*P[11][12] + F[6][12]*P[12][12]);
+	A[6][13] = P[6][13] + T*(F[6][7]*P[7][13] + F[6][8]*P[8][13] + F[6][9]*P[9][13] + F[6][10]*P[10][13] + F[6][11]*P[11][13] + F[6][12]*P[12][13]);
+	A[7][6] = P[7][6] + T*(F[7][6]*P[6][6] + F[7][8]*P[8][6] + F[7][9]*P[9][6] + F[7][10]*P[10][6] + F[7][11]*P[11][6] + F[7][12]*P[12][6]);
+	A[7][7] = P[7][7] + T*(F[7][6]*P[6][7] + F[7][8]*P[8][7] + F[7][9]*P[9][7] + F[7][10]*P[10][7] + F[7][11]*P[11][7] + F[7][12]*P[12][7]);
+	A[7][8] = P[7][8] + T*(F[7][6]*P[6][8] + F[7][8]*P[8][8] + F[7][9]*P[9][8] + F[7][10]*P[10][8] + F[7][11]*P[11][8] + F[7][12]*P[12][8]);
+	A[7][9] = P[7][9] + T*(F[7][6]*P[6][9] + F[7][8]*P[8][9] + F[7][9]*P[9][9] + F[7][10]*P[10][9] + F[7][11]*P[11][9] + F[7][12]*P[12][9]);
+	A[7][10] = P[7][10] + T*(F[7][6]*P[6][10] + F[7][8]*P[8][10] + F[7][9]*P[9][10] + F[7][10]*P[10][10] + F[7][11]*P[11][10] + F[7][12]*P[12][10]);
+	A[7][11] = P[7][11] + T*(F[7][6]*P[6][11] + F[7][8]*P[8][11] + F[7][9]*P[9][11] + F[7][10]*P[10][11] + F[7][11]*P[11][11] + F[7][12]*P[12][11]);
+	A[7][12] = P[7][12] + T*(F[7][6]*P[6][12] + F[7][8]*P[8][12] + F[7][9]*P[9][12] + F[7][10]*P[10][12] + F[7][11]*P[11][12] + F[7][12]*P[12][12]);
+	A[7][13] = P[7][13] + T*(F[7][6]*P[6][13] + F[7][8]*P[8][13] + F[7][9]*P[9][13] + F[7][10]*P[10][13] + F[7][11]*P[11][13] + F[7][12]*P[12][13]);
+	A[8][6] = P[8][6] + T*(F[8][6]*P[6][6] + F[8][7]*P[7][6] + F[8][9]*P[9][6] + F[8][10]*P[10][6] + F[8][11]*P[11][6] + F[8][12]*P[12][6]);
+	A[8][7] = P[8][7] + T*(F[8][6]*P[6][7] + F[8][7]*P[7][7] + F[8][9]*P[9][7] + F[8][10]*P[10][7] + F[8][11]*P[11][7] + F[8][12]*P[12][7]);
+	A[8][8] = P[8][8] + T*(F[8][6]*P[6][8] + F[8][7]*P[7][8] + F[8][9]*P[9][8] + F[8][10]*P[10][8] + F[8][11]*P[11][8] + F[8][12]*P[12][8]);
+	A[8][9] = P[8][9] + T*(F[8][6]*P[6][9] + F[8][7]*P[7][9] + F[8][9]*P[9][9] + F[8][10]*P[10][9] + F[8][11]*P[11][9] + F[8][12]*P[12][9]);
+	A[8][10] = P[8][10] + T*(F[8][6]*P[6][10] + F[8][7]*P[7][10] + F[8][9]*P[9][10] + F[8][10]*P[10][10] + F[8][11]*P[11][10] + F[8][12]*P[12][10]);
+	A[8][11] = P[8][11] + T*(F[8][6]*P[6][11] + F[8][7]*P[7][11] + F[8][9]*P[9][11] + F[8][10]*P[10][11] + F[8][11]*P[11][11] + F[8][12]*P[12][11]);
+	A[8][12] = P[8][12] + T*(F[8][6]*P[6][12] + F[8][7]*P[7][12] + F[8][9]*P[9][12] + F[8][10]*P[10][12] + F[8][11]*P[11][12] + F[8][12]*P[12][12]);
+	A[8][13] = P[8][13] + T*(F[8][6]*P[6][13] + F[8][7]*P[7][13] + F[8][9]*P[9][13] + F[8][10]*P[10][13] + F[8][11]*P[11][13] + F[8][12]*P[12][13]);
+	A[9][6] = P[9][6] + T*(F[9][6]*P[6][6] + F[9][7]*P[7][6] + F[9][8]*P[8][6] + F[9][10]*P[10][6] + F[9][11]*P[11][6] + F[9][12]*P[12][6]);
+	A[9][7] = P[9][7] + T*(F[9][6]*P[6][7] + F[9][7]*P[7][7] + F[9][8]*P[8][7] + F[9][10]*P[10][7] + F[9][11]*P[11][7] + F[9][12]*P[12][7]);
+	A[9][8] = P[9][8] + T*(F[9][6]*P[6][8] + F[9][7]*P[7][8] + F[9][8]*P[8][8] + F[9][10]*P[10][8] + F[9][11]*P[11][8] + F[9][12]*P[12][8]);
+	A[9][9] = P[9][9] + T*(F[9][6]*P[6][9] + F[9][7]*P[7][9] + F[9][8]*P[8][9] + F[9][10]*P[10][9] + F[9][11]*P[11][9] + F[9][12]*P[12][9]);
+	A[9][10] = P[9][10] + T*(F[9][6]*P[6][10] + F[9][7]*P[7][10] + F[9][8]*P[8][10] + F[9][10]*P[10][10] + F[9][11]*P[11][10] + F[9][12]*P[12][10]);
+	A[9][11] = P[9][11] + T*(F[9][6]*P[6][11] + F[9][7]*P[7][11] + F[9][8]*P[8][11] + F[9][10]*P[10][11] + F[9][11]*P[11][11] + F[9][12]*P[12][11]);
+	A[9][12] = P[9][12] + T*(F[9][6]*P[6][12] + F[9][7]*P[7][12] + F[9][8]*P[8][12] + F[9][10]*P[10][12] + F[9][11]*P[11][12] + F[9][12]*P[12][12]);
+	A[9][13] = P[9][13] + T*(F[9][6]*P[6][13] + F[9][7]*P[7][13] + F[9][8]*P[8][13] + F[9][10]*P[10][13] + F[9][11]*P[11][13] + F[9][12]*P[12][13]);
+
+	// Pnew = A * (I + F*T)' + T^2 * G*Q*G', upper triangle mirrored
+	P[0][0] = A[0][0] + T*(A[0][3]);
+	P[0][1] = P[1][0] = A[0][1] + T*(A[0][4]);
+	P[0][2] = P[2][0] = A[0][2] + T*(A[0][5]);
+	P[0][3] = P[3][0] = A[0][3] + T*(F[3][6]*A[0][6] + F[3][7]*A[0][7] + F[3][8]*A[0][8] + F[3][9]*A[0][9] + F[3][13]*A[0][13]);
+	P[0][4] = P[4][0] = A[0][4] + T*(F[4][6]*A[0][6] + F[4][7]*A[0][7] + F[4][8]*A[0][8] + F[4][9]*A[0][9] + F[4][13]*A[0][13]);
+	P[0][5] = P[5][0] = A[0][5] + T*(F[5][6]*A[0][6] + F[5][7]*A[0][7] + F[5][8]*A[0][8] + F[5][9]*A[0][9] + F[5][13]*A[0][13]);
+	P[0][6] = P[6][0] = A[0][6] + T*(F[6][7]*A[0][7] + F[6][8]*A[0][8] + F[6][9]*A[0][9] + F[6][10]*A[0][10] + F[6][11]*A[0][11] + F[6][12]*A[0][12]);
+	P[0][7] = P[7][0] = A[0][7] + T*(F[7][6]*A[0][6] + F[7][8]*A[0][8] + F[7][9]*A[0][9] + F[7][10]*A[0][10] + F[7][11]*A[0][11] + F[7][12]*A[0][12]);
+	P[0][8] = P[8][0] = A[0][8] + T*(F[8][6]*A[0][6] + F[8][7]*A[0][7] + F[8][9]*A[0][9] + F[8][10]*A[0][10] + F[8][11]*A[0][11] + F[8][12]*A[0][12]);
+	P[0][9] = P[9][0] = A[0][9] + T*(F[9][6]*A[0][6] + F[9][7]*A[0][7] + F[9][8]*A[0][8] + F[9][10]*A[0][10] + F[9][11]*A[0][11] + F[9][12]*A[0][12]);
+	P[0][10] = P[10][0] = A[0][10];
+	P[0][11] = P[11][0] = A[0][11];
+	P[0][12] = P[12][0] = A[0][12];
+	P[0][13] = P[13][0] = A[0][13];
+	P[1][1] = A[1][1] + T*(A[1][4]);
+	P[1][2] = P[2][1] = A[1][2] + T*(A[1][5]);
+	P[1][3] = P[3][1] = A[1][3] + T*(F[3][6]*A[1][6] + F[3][7]*A[1][7] + F[3][8]*A[1][8] + F[3][9]*A[1][9] + F[3][13]*A[1][13]);
+	P[1][4] = P[4][1] = A[1][4] + T*(F[4][6]*A[1][6] + F[4][7]*A[1][7] + F[4][8]*A[1][8] + F[4][9]*A[1][9] + F[4][13]*A[1][13]);
+	P[1][5] = P[5][1] = A[1][5] + T*(F[5][6]*A[1][6] + F[5][7]*A[1][7] + F[5][8]*A[1][8] + F[5][9]*A[1][9] + F[5][13]*A[1][13]);
+	P[1][6] = P[6][1] = A[1][6] + T*(F[6][7]*A[1][7] + F[6][8]*A[1][8] + F[6][9]*A[1][9] + F[6][10]*A[1][10] + F[6][11]*A[1][11] + F[6][12]*A[1][12]);
+	P[1][7] = P[7][1] = A[1][7] + T*(F[7][6]*A[1][6] + F[7][8]*A[1][8] + F[7][9]*A[1][9] + F[7][10]*A[1][10] + F[7][11]*A[1][11] + F[7][12]*A[1][12]);
+	P[1][8] = P[8][1] = A[1][8] + T*(F[8][6]*A[1][6] + F[8][7]*A[1][7] + F[8][9]*A[1][9] + F[8][10]*A[1][10] + F[8][11]*A[1][11] + F[8][12]*A[1][12]);
+	P[1][9] = P[9][1] = A[1][9] + T*(F[9][6]*A[1][6] + F[9][7]*A[1][7] + F[9][8]*A[1][8] + F[9][10]*A[1][10] + F[9][11]*A[1][11] + F[9][12]*A[1][12]);
+	P[1][10] = P[10][1] = A[1][10];
+	P[1][11] = P[11][1] = A[1][11];
+	P[1][12] = P[12][1] = A[1][12];
+	P[1][13] = P[13][1] = A[1][13];
+	P[2][2] = A[2][2] + T*(A[2][5]);
+	P[2][3] = P[3][2] = A[2][3] + T*(F[3][6]*A[2][6] + F[3][7]*A[2][7] + F[3][8]*A[2][8] + F[3][9]*A[2][9] + F[3][13]*A[2][13]);
+	P[2][4] = P[4][2] = A[2][4] + T*(F[4][6]*A[2][6] + F[4][7]*A[2][7] + F[4][8]*A[2][8] + F[4][9]*A[2][9] + F[4][13]*A[2][13]);
+	P[2][5] = P[5][2] = A[2][5] + T*(F[5][6]*A[2][6] + F[5][7]*A[2][7] + F[5][8]*A[2][8] + F[5][9]*A[2][9] + F[5][13]*A[2][13]);
+	P[2][6] = P[6][2] = A[2][6] + T*(F[6][7]*A[2][7] + F[6][8]*A[2][8] + F[6][9]*A[2][9] + F[6][10]*A[2][10] + F[6][11]*A[2][11] + F[6][12]*A[2][12]);
+	P[2][7] = P[7][2] = A[2][7] + T*(F[7][6]*A[2][6] + F[7][8]*A[2][8] + F[7][9]*A[2][9] + F[7][10]*A[2][10] + F[7][11]*A[2][11] + F[7][12]*A[2][12]);
+	P[2][8] = P[8][2] = A[2][8] + T*(F[8][6]*A[2][6] + F[8][7]*A[2][7] + F[8][9]*A[2][9] + F[8][10]*A[2][10] + F[8][11]*A[2][11] + F[8][12]*A[2][12]);
+	P[2][9] = P[9][2] = A[2][9] + T*(F[9][6]*A[2][6] + F[9][7]*A[2][7] + F[9][8]*A[2][8] + F[9][10]*A[2][10] + F[9][11]*A[2][11] + F[9][12]*A[2][12]);
+	P[2][10] = P[10][2] = A[2][10];
+	P[2][11] = P[11][2] = A[2][11];
+	P[2][12] = P[12][2] = A[2][12];
+	P[2][13] = P[13][2] = A[2][13];
+	P[3][3] = A[3][3] + T*(F[3][6]*A[3][6] + F[3][7]*A[3][7] + F[3][8]*A[3][8] + F[3][9]*A[3][9] + F[3][13]*A[3][13]) + Tsq*(Q[3]*G[3][3]*G[3][3] + Q[4]*G[3][4]*G[3][4] + Q[5]*G[3][5]*G[3][5]);
+	P[3][4] = P[4][3] = A[3][4] + T*(F[4][6]*A[3][6] + F[4][7]*A[3][7] + F[4][8]*A[3][8] + F[4][9]*A[3][9] + F[4][13]*A[3][13]) + Tsq*(Q[3]*G[3][3]*G[4][3] + Q[4]*G[3][4]*G[4][4] + Q[5]*G[3][5]*G[4][5]);
+	P[3][5] = P[5][3] = A[3][5] + T*(F[5][6]*A[3][6] + F[5][7]*A[3][7] + F[5][8]*A[3][8] + F[5][9]*A[3][9] + F[5][13]*A[3][13]) + Tsq*(Q[3]*G[3][3]*G[5][3] + Q[4]*G[3][4]*G[5][4] + Q[5]*G[3][5]*G[5][5]);
+	P[3][6] = P[6][3] = A[3][6] + T*(F[6][7]*A[3][7] + F[6][8]*A[3][8] + F[6][9]*A[3][9] + F[6][10]*A[3][10] + F[6][11]*A[3][11] + F[6][12]*A[3][12]);
+	P[3][7] = P[7][3] = A[3][7] + T*(F[7][6]*A[3][6] + F[7][8]*A[3][8] + F[7][9]*A[3][9] + F[7][10]*A[3][10] + F[7][11]*A[3][11] + F[7][12]*A[3][12]);
+	P[3][8] = P[8][3] = A[3][8] + T*(F[8][6]*A[3][6] + F[8][7]*A[3][7] + F[8][9]*A[3][9] + F[8][10]*A[3][10] + F[8][11]*A[3][11] + F[8][12]*A[3][12]);
+	P[3][9] = P[9][3] = A[3][9] + T*(F[9][6]*A[3][6] + F[9][7]*A[3][7] + F[9][8]*A[3][8] + F[9][10]*A[3][10] + F[9][11]*A[3][11] + F[9][12]*A[3][12]);
+	P[3][10] = P[10][3] = A[3][10];
+	P[3][11] = P[11][3] = A[3][11];
+	P[3][12] = P[12][3] = A[3][12];
+	P[3][13] = P[13][3] = A[3][13];
+	P[4][4] = A[4][4] + T*(F[4][6]*A[4][6] + F[4][7]*A[4][7] + F[4][8]*A[4][8] + F[4][9]*A[4][9] + F[4][13]*A[4][13]) + Tsq*(Q[3]*G[4][3]*G[4][3] + Q[4]*G[4][4]*G[4][4] + Q[5]*G[4][5]*G[4][5]);
+	P[4][5] = P[5][4] = A[4][5] + T*(F[5][6]*A[4][6] + F[5][7]*A[4][7] + F[5][8]*A[4][8] + F[5][9]*A[4][9] + F[5][13]*A[4][13]) + Tsq*(Q[3]*G[4][3]*G[5][3] + Q[4]*G[4][4]*G[5][4] + Q[5]*G[4][5]*G[5][5]);
+	P[4][6] = P[6][4] = A[4][6] + T*(F[6][7]*A[4][7] + F[6][8]*A[4][8] + F[6][9]*A[4][9] + F[6][10]*A[4][10] + F[6][11]*A[4][11] + F[6][12]*A[4][12]);
+	P[4][7] = P[7][4] = A[4][7] + T*(F[7][6]*A[4][6] + F[7][8]*A[4][8] + F[7][9]*A[4][9] + F[7][10]*A[4][10] + F[7][11]*A[4][11] + F[7][12]*A[4][12]);
+	P[4][8] = P[8][4] = A[4][8] + T*(F[8][6]*A[4][6] + F[8][7]*A[4][7] + F[8][9]*A[4][9] + F[8][10]*A[4][10] + F[8][11]*A[4][11] + F[8][12]*A[4][12]);
+	P[4][9] = P[9][4] = A[4][9] + T*(F[9][6]*A[4][6] + F[9][7]*A[4][7] + F[9][8]*A[4][8] + F[9][10]*A[4][10] + F[9][11]*A[4][11] + F[9][12]*A[4][12]);
+	P[4][10] = P[10][4] = A[4][10];
+	P[4][11] = P[11][4] = A[4][11];
+	P[4][12] = P[12][4] = A[4][12];
+	P[4][13] = P[13][4] = A[4][13];
+	P[5][5] = A[5][5] + T*(F[5][6]*A[5][6] + F[5][7]*A[5][7] + F[5][8]*A[5][8] + F[5][9]*A[5][9] + F[5][13]*A[5][13]) + Tsq*(Q[3]*G[5][3]*G[5][3] + Q[4]*G[5][4]*G[5][4] + Q[5]*G[5][5]*G[5][5]);
+	P[5][6] = P[6][5] = A[5][6] + T*(F[6][7]*A[5][7] + F[6][8]*A[5][8] + F[6][9]*A[5][9] + F[6][10]*A[5][10] + F[6][11]*A[5][11] + F[6][12]*A[5][12]);
+	P[5][7] = P[7][5] = A[5][7] + T*(F[7][6]*A[5][6] + F[7][8]*A[5][8] + F[7][9]*A[5][9] + F[7][10]*A[5][10] + F[7][11]*A[5][11] + F[7][12]*A[5][12]);
+	P[5][8] = P[8][5] = A[5][8] + T*(F[8][6]*A[5][6] + F[8][7]*A[5][7] + F[8][9]*A[5][9] + F[8][10]*A[5][10] + F[8][11]*A[5][11] + F[8][12]*A[5][12]);
+	P[5][9] = P[9][5] = A[5][9] + T*(F[9][6]*A[5][6] + F[9][7]*A[5][7] + F[9][8]*A[5][8] + F[9][10]*A[5][10] + F[9][11]*A[5][11] + F[9][12]*A[5][12]);
+	P[5][10] = P[10][5] = A[5][10];
+	P[5][11] = P[11][5] = A[5][11];
+	P[5][12] = P[12][5] = A[5][12];
+	P[5][13] = P[13][5] = A[5][13];
+	P[6][6] = A[6][6] + T*(F[6][7]*A[6][7] + F[6][8]*A[6][8] + F[6][9]*A[6][9] + F[6][10]*A[6][10] + F[6][11]*A[6][11] + F[6][12]*A[6][12]) + Tsq*(Q[0]*G[6][0]*G[6][0] + Q[1]*G[6][1]*G[6][1] + Q[2]*G[6][2]*G[6][2]);
+	P[6][7] = P[7][6] = A[6][7] + T*(F[7][6]*A[6][6] + F[7][8]*A[6][8] + F[7][9]*A[6][9] + F[7][10]*A[6][10] + F[7][11]*A[6][11] + F[7][12]*A[6][12]) + Tsq*(Q[0]*G[6][0]*G[7][0] + Q[1]*G[6][1]*G[7][1] + Q[2]*G[6][2]*G[7][2]);
+	P[6][8] = P[8][6] = A[6][8] + T*(F[8][6]*A[6][6] + F[8][7]*A[6][7] + F[8][9]*A[6][9] + F[8][10]*A[6][10] + F[8][11]*A[6][11] + F[8][12]*A[6][12]) + Tsq*(Q[0]*G[6][0]*G[8][0] + Q[1]*G[6][1]*G[8][1] + Q[2]*G[6][2]*G[8][2]);
+	P[6][9] = P[9][6] = A[6][9] + T*(F[9][6]*A[6][6] + F[9][7]*A[6][7] + F[9][8]*A[6][8] + F[9][10]*A[6][10] + F[9][11]*A[6][11] + F[9][12]*A[6][12]) + Tsq*(Q[0]*G[6][0]*G[9][0] + Q[1]*G[6][1]*G[9][1] + Q[2]*G[6][2]*G[9][2]);
+	P[6][10] = P[10][6] = A[6][10];
+	P[6][11] = P[11][6] = A[6][11];
+	P[6][12] = P[12][6] = A[6][12];
+	P[6][13] = P[13][6] = A[6][13];
+	P[7][7] = A[7][7] + T*(F[7][6]*A[7][6] + F[7][8]*A[7][8] + F[7][9]*A[7][9] + F[7][10]*A[7][10] + F[7][11]*A[7][11] + F[7][12]*A[7][12]) + Tsq*(Q[0]*G[7][0]*G[7][0] + Q[1]*G[7][1]*G[7][1] + Q[2]*G[7][2]*G[7][2]);
+	P[7][8] = P[8][7] = A[7][8] + T*(F[8][6]*A[7][6] + F[8][7]*A[7][7] + F[8][9]*A[7][9] + F[8][10]*A[7][10] + F[8][11]*A[7][11] + F[8][12]*A[7][12]) + Tsq*(Q[0]*G[7][0]*G[8][0] + Q[1]*G[7][1]*G[8][1] + Q[2]*G[7][2]*G[8][2]);
+	P[7][9] = P[9][7] = A[7][9] + T*(F[9][6]*A[7][6] + F[9][7]*A[7][7] + F[9][8]*A[7][8] + F[9][10]*A[7][10] + F[9][11]*A[7][11] + F[9][12]*A[7][12]) + Tsq*(Q[0]*G[7][0]*G[9][0] + Q[1]*G[7][1]*G[9][1] + Q[2]*G[7][2]*G[9][2]);
+	P[7][10] = P[10][7] = A[7][10];
+	P[7][11] = P[11][7] = A[7][11];
+	P[7][12] = P[12][7] = A[7][12];
+	P[7][13] = P[13][7] = A[7][13];
+	P[8][8] = A[8][8] + T*(F[8][6]*A[8][6] + F[8][7]*A[8][7] + F[8][9]*A[8][9] + F[8][10]*A[8][10] + F[8][11]*A[8][11] + F[8][12]*A[8][12]) + Tsq*(Q[0]*G[8][0]*G[8][0] + Q[1]*G[8][1]*G[8][1] + Q[2]*G[8][2]*G[8][2]);
+	P[8][9] = P[9][8] = A[8][9] + T*(F[9][6]*A[8][6] + F[9][7]*A[8][7] + F[9][8]*A[8][8] + F[9][10]*A[8][10] + F[9][11]*A[8][11] + F[9][12]*A[8][12]) + Tsq*(Q[0]*G[8][0]*G[9][0] + Q[1]*G[8][1]*G[9][1] + Q[2]*G[8][2]*G[9][2]);
+	P[8][10] = P[10][8] = A[8][10];
+	P[8][11] = P[11][8] = A[8][11];
+	P[8][12] = P[12][8] = A[8][12];
+	P[8][13] = P[13][8] = A[8][13];
+	P[9][9] = A[9][9] + T*(F[9][6]*A[9][6] + F[9][7]*A[9][7] + F[9][8]*A[9][8] + F[9][10]*A[9][10] + F[9][11]*A[9][11] + F[9][12]*A[9][12]) + Tsq*(Q[0]*G[9][0]*G[9][0] + Q[1]*G[9][1]*G[9][1] + Q[2]*G[9][2]*G[9][2]);
+	P[9][10] = P[10][9] = A[9][10];
+	P[9][11] = P[11][9] = A[9][11];
+	P[9][12] = P[12][9] = A[9][12];
+	P[9][13] = P[13][9] = A[9][13];
+	P[10][10] = P[10][10] + Tsq*(Q[6]);
+	P[10][11] = P[11][10] = P[10][11];
+	P[10][12] = P[12][10] = P[10][12];
+	P[10][13] = P[13][10] = P[10][13];
+	P[11][11] = P[11][11] + Tsq*(Q[7]);
+	P[11][12] = P[12][11] = P[11][12];
+	P[11][13] = P[13][11] = P[11][13];
+	P[12][12] = P[12][12] + Tsq*(Q[8]);
+	P[12][13] = P[13][12] = P[12][13];
+	P[13][13] = P[13][13] + Tsq*(Q[9]);
+}
+
+#endif /* INSGPS14STATE_COVARIANCE_H */
+
+/**
+ * @}
+ * @}
+ */
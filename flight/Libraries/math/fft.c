@@ -0,0 +1,312 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath math support libraries
+ * @{
+ *
+ * @file       fft.c
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Real valued fast Fourier transform
+ *
+ * A real sequence of N points is transformed as a complex sequence of N/2
+ * points (even samples real, odd samples imaginary) and then split into the
+ * spectrum of the real sequence.  The complex transform is an in-place
+ * decimation in time, with the first two stages fused into a radix-4 pass
+ * that needs no multiplies and radix-2 stages after that.
+ *
+ * The output is packed like CMSIS arm_rfft_fast_f32: buf[0] is the DC term,
+ * buf[1] the (real) Nyquist term and buf[2k], buf[2k+1] the real and
+ * imaginary parts of bin k for 0 < k < N/2.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "pios.h"
+#include "physical_constants.h"
+#include "fft.h"
+
+struct rfft_state {
+	uint16_t size;
+	uint16_t max_size;
+	uint16_t stride;	// max_size / size
+
+	/* cos and sin of 2*pi*k/max_size for 0 <= k < max_size/2, interleaved */
+	float twiddle[];
+};
+
+static bool rfft_valid_size(uint16_t size)
+{
+	return size >= RFFT_MIN_SIZE && size <= RFFT_MAX_SIZE &&
+		(size & (size - 1)) == 0;
+}
+
+/**
+ * Allocate a transform and precompute its twiddle factors.  The twiddles of
+ * a size serve every smaller size too, so the transform can later be shrunk
+ * with rfft_set_size() without allocating (memory can't be given back).
+ * @param[in] size number of real points, a power of two
+ * @returns the transform or NULL if the size is unsupported or out of memory
+ */
+rfft_t rfft_create(uint16_t size)
+{
+	if (!rfft_valid_size(size))
+		return NULL;
+
+	struct rfft_state *fft = PIOS_malloc_no_dma(sizeof(*fft) +
+			sizeof(float) * size);
+	if (!fft)
+		return NULL;
+
+	fft->size = size;
+	fft->max_size = size;
+	fft->stride = 1;
+
+	for (int k = 0; k < size / 2; k++) {
+		float theta = 2 * PI * k / size;
+
+		fft->twiddle[2 * k] = cosf(theta);
+		fft->twiddle[2 * k + 1] = sinf(theta);
+	}
+
+	return fft;
+}
+
+/**
+ * Change the number of real points the transform takes
+ * @param[in] size a power of two no larger than the size it was created with
+ * @returns 0 on success, -1 if the size is unsupported
+ */
+int32_t rfft_set_size(rfft_t fft, uint16_t size)
+{
+	if (!rfft_valid_size(size) || size > fft->max_size)
+		return -1;
+
+	fft->size = size;
+	fft->stride = fft->max_size / size;
+
+	return 0;
+}
+
+/**
+ * Number of real points the transform takes
+ */
+uint16_t rfft_size(rfft_t fft)
+{
+	return fft->size;
+}
+
+/**
+ * Apply a Hann window in place, tapering the ends of the block to zero so a
+ * tone that does not fit the block a whole number of times leaks into few
+ * neighbouring bins.
+ * @param[in,out] buf size real samples
+ */
+void rfft_window_hann(rfft_t fft, float *buf)
+{
+	const uint16_t n = fft->size;
+	const uint16_t stride = fft->stride;
+
+	/* The window is 0.5 - 0.5 cos(2*pi*k/n), symmetric about n/2, and the
+	 * cosine is already in the twiddle table */
+	buf[0] = 0;
+
+	for (int k = 1; k < n / 2; k++) {
+		float w = 0.5f - 0.5f * fft->twiddle[2 * k * stride];
+
+		buf[k] *= w;
+		buf[n - k] *= w;
+	}
+}
+
+/**
+ * In-place complex transform of n = size/2 interleaved points
+ */
+static void rfft_complex(rfft_t fft, float *z)
+{
+	const int n = fft->size / 2;
+
+	/* Bit reversed reordering */
+	for (int i = 1, j = 0; i < n; i++) {
+		int bit = n >> 1;
+
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+
+		j |= bit;
+
+		if (i < j) {
+			float re = z[2 * i], im = z[2 * i + 1];
+
+			z[2 * i] = z[2 * j];
+			z[2 * i + 1] = z[2 * j + 1];
+			z[2 * j] = re;
+			z[2 * j + 1] = im;
+		}
+	}
+
+	/* First two stages as radix-4 butterflies; the twiddles are 1 and -i */
+	for (int i = 0; i < 2 * n; i += 8) {
+		float ar = z[i] + z[i + 2], ai = z[i + 1] + z[i + 3];
+		float br = z[i] - z[i + 2], bi = z[i + 1] - z[i + 3];
+		float cr = z[i + 4] + z[i + 6], ci = z[i + 5] + z[i + 7];
+		float dr = z[i + 4] - z[i + 6], di = z[i + 5] - z[i + 7];
+
+		z[i] = ar + cr;
+		z[i + 1] = ai + ci;
+		z[i + 2] = br + di;
+		z[i + 3] = bi - dr;
+		z[i + 4] = ar - cr;
+		z[i + 5] = ai - ci;
+		z[i + 6] = br - di;
+		z[i + 7] = bi + dr;
+	}
+
+	/* Remaining radix-2 stages */
+	for (int len = 8; len <= n; len <<= 1) {
+		const int half = len / 2;
+		const int step = fft->max_size / len;
+
+		for (int i = 0; i < n; i += len) {
+			for (int j = 0; j < half; j++) {
+				/* W = exp(-2*pi*i*j/len) */
+				float wr = fft->twiddle[2 * j * step];
+				float wi = -fft->twiddle[2 * j * step + 1];
+
+				float *a = &z[2 * (i + j)];
+				float *b = &z[2 * (i + j + half)];
+
+				float tr = wr * b[0] - wi * b[1];
+				float ti = wr * b[1] + wi * b[0];
+
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+}
+
+/**
+ * Forward transform in place
+ * @param[in,out] buf size real samples in, packed spectrum out
+ */
+void rfft_run(rfft_t fft, float *buf)
+{
+	const int n = fft->size / 2;
+	const int stride = fft->stride;
+
+	rfft_complex(fft, buf);
+
+	/* Split the transform of the even and odd samples into the spectrum
+	 * of the real sequence, working inwards from both ends */
+	float dc = buf[0], nyquist = buf[1];
+
+	buf[0] = dc + nyquist;
+	buf[1] = dc - nyquist;
+
+	for (int k = 1; k <= n / 2; k++) {
+		float *a = &buf[2 * k];
+		float *b = &buf[2 * (n - k)];
+
+		/* Even part, (Z[k] + conj Z[n-k]) / 2 */
+		float er = 0.5f * (a[0] + b[0]);
+		float ei = 0.5f * (a[1] - b[1]);
+
+		/* Odd part, -i (Z[k] - conj Z[n-k]) / 2 */
+		float ur = 0.5f * (a[1] + b[1]);
+		float ui = -0.5f * (a[0] - b[0]);
+
+		/* Turned by W = exp(-2*pi*i*k/size) */
+		float c = fft->twiddle[2 * k * stride];
+		float s = fft->twiddle[2 * k * stride + 1];
+
+		float tr = c * ur + s * ui;
+		float ti = c * ui - s * ur;
+
+		a[0] = er + tr;
+		a[1] = ei + ti;
+		b[0] = er - tr;
+		b[1] = ti - ei;
+	}
+}
+
+/**
+ * Replace a packed spectrum with its magnitude, in place.
+ *
+ * Magnitudes are scaled for a Hann windowed block so a steady tone centred
+ * on a bin reads as its amplitude.  The Nyquist term is dropped, leaving
+ * size/2 bins spaced by the sample rate over size.
+ * @param[in,out] buf packed spectrum in, size/2 magnitudes out
+ */
+void rfft_magnitude(rfft_t fft, float *buf)
+{
+	const float scale = 4.0f / fft->size;
+
+	buf[0] = fabsf(buf[0]) * scale;
+
+	for (int k = 1; k < fft->size / 2; k++) {
+		float re = buf[2 * k], im = buf[2 * k + 1];
+
+		buf[k] = sqrtf(re * re + im * im) * scale;
+	}
+}
+
+/**
+ * Find the strongest bin and refine it by fitting a parabola through it and
+ * its neighbours.
+ * @param[in] mag magnitude spectrum
+ * @param[in] bins length of mag
+ * @param[in] first lowest bin to consider, to skip what is left of DC
+ * @returns fractional bin of the peak, or 0 if there is no peak
+ */
+float rfft_peak_bin(const float *mag, uint16_t bins, uint16_t first)
+{
+	if (first < 1)
+		first = 1;
+
+	int peak = 0;
+	float peak_mag = 0;
+
+	for (int k = first; k < bins - 1; k++) {
+		if (mag[k] > peak_mag) {
+			peak_mag = mag[k];
+			peak = k;
+		}
+	}
+
+	if (peak == 0)
+		return 0;
+
+	float a = mag[peak - 1], b = mag[peak], c = mag[peak + 1];
+	float denom = a - 2 * b + c;
+
+	if (denom >= 0)
+		return peak;
+
+	return peak + 0.5f * (a - c) / denom;
+}
+
+/**
+ * @}
+ * @}
+ */
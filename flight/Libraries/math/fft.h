@@ -0,0 +1,54 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath math support libraries
+ * @{
+ *
+ * @file       fft.h
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Real valued fast Fourier transform
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+//! Smallest and largest supported transform lengths
+#define RFFT_MIN_SIZE 8
+#define RFFT_MAX_SIZE 4096
+
+typedef struct rfft_state *rfft_t;
+
+rfft_t rfft_create(uint16_t size);
+int32_t rfft_set_size(rfft_t fft, uint16_t size);
+uint16_t rfft_size(rfft_t fft);
+void rfft_window_hann(rfft_t fft, float *buf);
+void rfft_run(rfft_t fft, float *buf);
+void rfft_magnitude(rfft_t fft, float *buf);
+float rfft_peak_bin(const float *mag, uint16_t bins, uint16_t first);
+
+#endif /* FFT_H */
+
+/**
+ * @}
+ * @}
+ */
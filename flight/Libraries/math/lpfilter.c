@@ -35,6 +35,22 @@
 #include "lpfilter.h"
 
 #define MAX_FILTER_WIDTH		16
+#define MAX_BIQUADS			4
+
+/* Three axis filters run through a kernel with the state of all axes side
+ * by side, one stage at a time.  The axes are independent, so their
+ * multiply-adds can overlap in the FPU pipeline; with a SIMD unit the axes
+ * are padded to a fourth lane so each stage is a single vector operation.
+ * Below third order there is too little work per sample to pay for the
+ * padding and the indirect call, and the generic path is faster. */
+#define AXES3_WIDTH			3
+#define AXES3_MIN_ORDER			3
+
+#if defined(__SSE__) || defined(__ARM_NEON)
+#define AXES3_LANES			4
+#else
+#define AXES3_LANES			3
+#endif
 
 static const float lpfilter_butterworth_factors[16] = {
 	// 2nd order
@@ -73,24 +89,56 @@ struct lpfilter_first_order {
 	float *prev;
 };
 
+struct lpfilter_axes3 {
+	void (*run)(struct lpfilter_axes3 *f, float *sample);
+
+	float alpha;
+	float b0[MAX_BIQUADS], a1[MAX_BIQUADS], a2[MAX_BIQUADS];
+
+	// Transposed direct form II state, lanes innermost
+	float prev[AXES3_LANES];
+	float z1[MAX_BIQUADS][AXES3_LANES];
+	float z2[MAX_BIQUADS][AXES3_LANES];
+};
+
 struct lpfilter_state {
 
 	struct lpfilter_first_order *first_order;
-	struct lpfilter_biquad *biquad[4];
+	struct lpfilter_biquad *biquad[MAX_BIQUADS];
+	struct lpfilter_axes3 *axes3;
 	uint8_t order;
 	uint8_t width;
 
 };
 
-void lpfilter_construct_single_biquad(struct lpfilter_biquad *b, float cutoff, float dT, float q, uint8_t width)
+static int lpfilter_butterworth_addr(int o)
+{
+	// Calculate the address of coefficients in the look-up table.
+	// There's probably a proper mathematical way for this. Let's just count
+	// everything.
+	int addr = 0;
+	for(int i = 2; i < o; i++)
+	{
+		addr += i >> 1;
+	}
+
+	return addr;
+}
+
+static void lpfilter_biquad_coeffs(float cutoff, float dT, float q, float *b0, float *a1, float *a2)
 {
 	float f = 1.0f / tanf((float)M_PI*cutoff*dT);
 
 	// Skipping calculation of b1 and b2, since this only going to do Butterworth.
 	// These terms are optimized away in the actual filtering calculation.
-	b->b0 = 1.0f / (1.0f + q*f + f*f);
-	b->a1 = 2.0f * (f*f - 1.0f) * b->b0;
-	b->a2 = -(1.0f - q*f + f*f) * b->b0;
+	*b0 = 1.0f / (1.0f + q*f + f*f);
+	*a1 = 2.0f * (f*f - 1.0f) * *b0;
+	*a2 = -(1.0f - q*f + f*f) * *b0;
+}
+
+void lpfilter_construct_single_biquad(struct lpfilter_biquad *b, float cutoff, float dT, float q, uint8_t width)
+{
+	lpfilter_biquad_coeffs(cutoff, dT, q, &b->b0, &b->a1, &b->a2);
 
 	b->s = PIOS_malloc_no_dma(sizeof(struct lpfilter_biquad_state)*width);
 	if(!b->s)
@@ -104,14 +152,7 @@ void lpfilter_construct_biquads(lpfilter_state_t filt, float cutoff, float dT, i
 	// Amount of biquad filters needed.
 	int len = o >> 1;
 
-	// Calculate the address of coefficients in the look-up table.
-	// There's probably a proper mathematical way for this. Let's just count
-	// everything.
-	int addr = 0;
-	for(int i = 2; i < o; i++)
-	{
-		addr += i >> 1;
-	}
+	int addr = lpfilter_butterworth_addr(o);
 
 	// Create all necessary biquads and allocate, too, if not yet done so.
 	for(int i = 0; i < len; i++)
@@ -125,6 +166,86 @@ void lpfilter_construct_biquads(lpfilter_state_t filt, float cutoff, float dT, i
 	}
 }
 
+/**
+ * Run a three axis filter of a fixed order.  Inlined into one kernel per
+ * order, so the stage loop is unrolled and the lane loop is a straight run
+ * of independent operations the compiler can vectorize.
+ */
+static inline __attribute__((always_inline)) void lpfilter_run_axes3(struct lpfilter_axes3 *f, float *sample, const int order)
+{
+	float x[AXES3_LANES];
+
+	for(int j = 0; j < AXES3_LANES; j++)
+		x[j] = j < AXES3_WIDTH ? sample[j] : 0;
+
+	if(order & 0x1) {
+		for(int j = 0; j < AXES3_LANES; j++) {
+			f->prev[j] = f->alpha * f->prev[j] + (1 - f->alpha) * x[j];
+			x[j] = f->prev[j];
+		}
+	}
+
+	for(int i = 0; i < (order >> 1); i++)
+	{
+		const float b0 = f->b0[i], a1 = f->a1[i], a2 = f->a2[i];
+
+		for(int j = 0; j < AXES3_LANES; j++)
+		{
+			float y = b0 * x[j] + f->z1[i][j];
+
+			f->z1[i][j] = 2.0f * b0 * x[j] + a1 * y + f->z2[i][j];
+			f->z2[i][j] = b0 * x[j] + a2 * y;
+
+			x[j] = y;
+		}
+	}
+
+	for(int j = 0; j < AXES3_WIDTH; j++)
+		sample[j] = x[j];
+}
+
+#define LPFILTER_AXES3_KERNEL(o) \
+	static void lpfilter_run_axes3_order ## o(struct lpfilter_axes3 *f, float *sample) \
+	{ \
+		lpfilter_run_axes3(f, sample, o); \
+	}
+
+LPFILTER_AXES3_KERNEL(3)
+LPFILTER_AXES3_KERNEL(4)
+LPFILTER_AXES3_KERNEL(5)
+LPFILTER_AXES3_KERNEL(6)
+LPFILTER_AXES3_KERNEL(7)
+LPFILTER_AXES3_KERNEL(8)
+
+static void (* const lpfilter_axes3_kernels[8 - AXES3_MIN_ORDER + 1])(struct lpfilter_axes3 *f, float *sample) = {
+	lpfilter_run_axes3_order3, lpfilter_run_axes3_order4,
+	lpfilter_run_axes3_order5, lpfilter_run_axes3_order6,
+	lpfilter_run_axes3_order7, lpfilter_run_axes3_order8
+};
+
+void lpfilter_construct_axes3(lpfilter_state_t filt, float cutoff, float dT, int o)
+{
+	if(!filt->axes3) {
+		filt->axes3 = PIOS_malloc_no_dma(sizeof(struct lpfilter_axes3));
+		if(!filt->axes3)
+			PIOS_Assert(0);
+	}
+
+	struct lpfilter_axes3 *f = filt->axes3;
+	memset(f, 0, sizeof(*f));
+
+	int addr = lpfilter_butterworth_addr(o);
+
+	f->run = lpfilter_axes3_kernels[o - AXES3_MIN_ORDER];
+	f->alpha = expf(-2.0f * (float)(M_PI) * cutoff * dT);
+
+	for(int i = 0; i < (o >> 1); i++)
+	{
+		lpfilter_biquad_coeffs(cutoff, dT, lpfilter_butterworth_factors[addr+i],
+			&f->b0[i], &f->a1[i], &f->a2[i]);
+	}
+}
+
 void lpfilter_create(lpfilter_state_t *filter_ptr, float cutoff, float dT, uint8_t order, uint8_t width)
 {
 	if(!filter_ptr) {
@@ -153,6 +274,17 @@ void lpfilter_create(lpfilter_state_t *filter_ptr, float cutoff, float dT, uint8
 		return;
 	} else if(order > 8) order = 8;
 
+	if(width == AXES3_WIDTH && order >= AXES3_MIN_ORDER) {
+		filter->order = order;
+		filter->width = width;
+		lpfilter_construct_axes3(filter, cutoff, dT, order);
+		return;
+	}
+
+	// Kernel state stays allocated, but is out of use at this order
+	if(filter->axes3)
+		filter->axes3->run = NULL;
+
 	if(order & 0x1) {
 		// Filter is odd, allocate the first order filter.
 		if(!filter->first_order) {
@@ -189,6 +321,27 @@ float lpfilter_run_single(lpfilter_state_t filter, uint8_t axis, float sample)
 	if(!order)
 		return sample;
 
+	if(filter->axes3 && filter->axes3->run) {
+		struct lpfilter_axes3 *f = filter->axes3;
+
+		if(order & 0x1) {
+			f->prev[axis] = f->alpha * f->prev[axis] + (1 - f->alpha) * sample;
+			sample = f->prev[axis];
+		}
+
+		for(int i = 0; i < (order >> 1); i++)
+		{
+			float y = f->b0[i] * sample + f->z1[i][axis];
+
+			f->z1[i][axis] = 2.0f * f->b0[i] * sample + f->a1[i] * y + f->z2[i][axis];
+			f->z2[i][axis] = f->b0[i] * sample + f->a2[i] * y;
+
+			sample = y;
+		}
+
+		return sample;
+	}
+
 	if(order & 0x1) {
 		// Odd order filter
 		filter->first_order->prev[axis] *= filter->first_order->alpha;
@@ -225,6 +378,11 @@ void lpfilter_run(lpfilter_state_t filter, float *sample)
 	// Order at zero means bypass.
 	if(order == 0) return;
 
+	if(filter->axes3 && filter->axes3->run) {
+		filter->axes3->run(filter->axes3, sample);
+		return;
+	}
+
 	if(order & 0x1) {
 		// Odd order filter
 		for(int i = 0; i < filter->width; i++)
@@ -0,0 +1,461 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath math support libraries
+ * @{
+ *
+ * @file       notchfilter.c
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Notch filters that follow the strongest tones in a signal
+ *
+ * Each axis keeps a sliding DFT of its recent samples, updated one sample
+ * at a time, over the band the notches may move in.  The strongest peaks
+ * of the (Hann windowed) spectrum steer a bank of biquad notches that are
+ * run on every sample.
+ *
+ * Above NOTCHFILTER_ANALYSIS_RATE the samples are averaged down before they
+ * reach the DFT, and the work of analysing one averaged sample is cut into
+ * steps that are spread over the loops until the next one.  At an 8kHz gyro
+ * a loop does at most one step: one axis of DFT bins or one peak search,
+ * on top of running the notches.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "pios.h"
+#include "physical_constants.h"
+#include "misc_math.h"
+#include "lpfilter.h"
+#include "notchfilter.h"
+
+//! Length of the sliding DFT
+#define NOTCHFILTER_SDFT_SIZE 64
+#define NOTCHFILTER_SDFT_BINS (NOTCHFILTER_SDFT_SIZE / 2 + 1)
+
+//! Rate the spectrum is analysed at, or below when the loop is slower (Hz)
+#define NOTCHFILTER_ANALYSIS_RATE 1000
+
+//! Pole radius of the sliding DFT, keeps rounding errors from building up
+#define NOTCHFILTER_SDFT_DAMPING 0.999f
+
+//! Share of each new spectrum in the averaged one
+#define NOTCHFILTER_POWER_SMOOTHING 0.05f
+
+//! How much stronger than the band average a peak must be to move a notch
+#define NOTCHFILTER_PEAK_RATIO 3.0f
+
+//! How much stronger than the band average a tone must stay to keep a notch
+#define NOTCHFILTER_RELEASE_RATIO 1.5f
+
+//! Analyses in a row below the release ratio before a notch lets go
+#define NOTCHFILTER_RELEASE_COUNT 100
+
+//! Share of the distance to a new peak a notch moves each analysis
+#define NOTCHFILTER_SMOOTHING 0.1f
+
+//! Order of the low pass ahead of averaging down to the analysis rate
+#define NOTCHFILTER_ANTIALIAS_ORDER 4
+
+//! Highest tone followed when averaging down, as a share of the analysis
+//! Nyquist frequency; what the low pass lets through above folds back below
+#define NOTCHFILTER_ANTIALIAS_LIMIT 0.8f
+
+//! One DFT update per axis and then one peak search per axis
+#define NOTCHFILTER_STEPS (2 * NOTCHFILTER_AXES)
+
+struct notchfilter_biquad {
+	float b0, b1, a2;	// b2 = b0 and a1 = b1 for a notch
+	float x1, x2, y1, y2;
+};
+
+struct notchfilter_axis {
+	float ring[NOTCHFILTER_SDFT_SIZE];
+	float re[NOTCHFILTER_SDFT_BINS];
+	float im[NOTCHFILTER_SDFT_BINS];
+	float power[NOTCHFILTER_SDFT_BINS];	// Averaged over many spectra
+
+	float accum;		// Sum of the samples being averaged
+	float last;		// Previous average
+	float x_in, x_out;	// Sample entering and leaving the DFT
+
+	bool active[NOTCHFILTER_MAX_NOTCHES];
+	uint8_t quiet[NOTCHFILTER_MAX_NOTCHES];	// Analyses below release
+	float center[NOTCHFILTER_MAX_NOTCHES];
+	struct notchfilter_biquad notch[NOTCHFILTER_MAX_NOTCHES];
+};
+
+struct notchfilter_state {
+	float dT;
+	float q;
+	float bin_hz;		// Width of a DFT bin
+	float damping_n;	// NOTCHFILTER_SDFT_DAMPING ^ NOTCHFILTER_SDFT_SIZE
+
+	uint8_t count;
+	uint8_t decimation;
+	uint8_t decimation_count;
+	uint8_t steps_per_run;
+	uint8_t step;
+	uint8_t ring_pos;
+	uint8_t first_bin, last_bin;
+
+	float twiddle_re[NOTCHFILTER_SDFT_BINS];
+	float twiddle_im[NOTCHFILTER_SDFT_BINS];
+
+	lpfilter_state_t antialias;	// Kept when reconfigured, NULL if unused
+	bool antialias_on;
+
+	struct notchfilter_axis axis[NOTCHFILTER_AXES];
+};
+
+/**
+ * Create or reconfigure a notch filter bank.  Memory is only allocated the
+ * first time it is enabled and kept from then on.
+ * @param[in,out] filter_ptr the filter, NULL to create one
+ * @param[in] dT sample period (s)
+ * @param[in] count notches per axis, 0 bypasses the filter
+ * @param[in] min_hz lowest frequency a notch may follow
+ * @param[in] max_hz highest frequency a notch may follow
+ * @param[in] q quality of the notches, the center frequency over the width
+ */
+void notchfilter_create(notchfilter_state_t *filter_ptr, float dT, uint8_t count,
+		float min_hz, float max_hz, float q)
+{
+	PIOS_Assert(filter_ptr);
+
+	if (count == 0) {
+		if (*filter_ptr)
+			(*filter_ptr)->count = 0;
+
+		return;
+	}
+
+	if (!*filter_ptr) {
+		*filter_ptr = PIOS_malloc_no_dma(sizeof(struct notchfilter_state));
+		PIOS_Assert(*filter_ptr);
+
+		(*filter_ptr)->antialias = NULL;
+	}
+
+	notchfilter_state_t filter = *filter_ptr;
+	lpfilter_state_t antialias = filter->antialias;
+
+	memset(filter, 0, sizeof(*filter));
+
+	filter->antialias = antialias;
+
+	if (count > NOTCHFILTER_MAX_NOTCHES)
+		count = NOTCHFILTER_MAX_NOTCHES;
+
+	int decimation = roundf(1.0f / (dT * NOTCHFILTER_ANALYSIS_RATE));
+	decimation = MAX(decimation, 1);
+
+	filter->dT = dT;
+	filter->q = MAX(q, 0.5f);
+	filter->decimation = decimation;
+	filter->steps_per_run = (NOTCHFILTER_STEPS + decimation - 1) / decimation;
+	filter->bin_hz = 1.0f / (dT * decimation * NOTCHFILTER_SDFT_SIZE);
+	filter->damping_n = powf(NOTCHFILTER_SDFT_DAMPING, NOTCHFILTER_SDFT_SIZE);
+
+	/* Averaging alone is a poor low pass (a 700Hz tone averaged down from
+	 * 8kHz to 1kHz still shows at a third of its size, at 300Hz), so
+	 * when averaging the analysis is fed through a real one first, and
+	 * only tones it passes well are followed. */
+	if (decimation > 1) {
+		max_hz = MIN(max_hz, NOTCHFILTER_ANTIALIAS_LIMIT * 0.5f /
+				(dT * decimation));
+
+		lpfilter_create(&filter->antialias, max_hz, dT,
+				NOTCHFILTER_ANTIALIAS_ORDER, NOTCHFILTER_AXES);
+		filter->antialias_on = true;
+	}
+
+	// The Hann window needs a bin either side, and the peak search one more
+	int first_bin = ceilf(min_hz / filter->bin_hz);
+	int last_bin = floorf(max_hz / filter->bin_hz);
+
+	filter->first_bin = MAX(first_bin, 2);
+	filter->last_bin = MIN(last_bin, NOTCHFILTER_SDFT_BINS - 3);
+
+	// Nowhere to search
+	if (filter->last_bin <= filter->first_bin)
+		return;
+
+	for (int k = 0; k < NOTCHFILTER_SDFT_BINS; k++) {
+		float theta = 2 * PI * k / NOTCHFILTER_SDFT_SIZE;
+
+		filter->twiddle_re[k] = NOTCHFILTER_SDFT_DAMPING * cosf(theta);
+		filter->twiddle_im[k] = NOTCHFILTER_SDFT_DAMPING * sinf(theta);
+	}
+
+	filter->count = count;
+}
+
+/**
+ * Center a notch on a frequency
+ */
+static void notchfilter_set_notch(notchfilter_state_t filter,
+		struct notchfilter_biquad *b, float hz)
+{
+	float omega = 2 * PI * hz * filter->dT;
+	float alpha = sinf(omega) / (2 * filter->q);
+	float a0_inv = 1 / (1 + alpha);
+
+	b->b0 = a0_inv;
+	b->b1 = -2 * cosf(omega) * a0_inv;
+	b->a2 = (1 - alpha) * a0_inv;
+}
+
+/**
+ * Slide the DFT of one axis on by the last averaged sample
+ */
+static void notchfilter_update_dft(notchfilter_state_t filter,
+		struct notchfilter_axis *ax)
+{
+	const float delta = ax->x_in - filter->damping_n * ax->x_out;
+
+	for (int k = filter->first_bin - 2; k <= filter->last_bin + 2; k++) {
+		float re = ax->re[k] + delta;
+		float im = ax->im[k];
+
+		ax->re[k] = re * filter->twiddle_re[k] - im * filter->twiddle_im[k];
+		ax->im[k] = re * filter->twiddle_im[k] + im * filter->twiddle_re[k];
+	}
+}
+
+/**
+ * Find the strongest peaks of one axis and move its notches towards them
+ */
+static void notchfilter_track_peaks(notchfilter_state_t filter,
+		struct notchfilter_axis *ax)
+{
+	float mag[NOTCHFILTER_SDFT_BINS];
+	float sum = 0;
+
+	const int first = filter->first_bin, last = filter->last_bin;
+
+	/* Hann window applied in the frequency domain.  A single spectrum of
+	 * noise has peaks all over, so they are looked for in the average. */
+	for (int k = first - 1; k <= last + 1; k++) {
+		float re = 0.5f * ax->re[k] - 0.25f * (ax->re[k - 1] + ax->re[k + 1]);
+		float im = 0.5f * ax->im[k] - 0.25f * (ax->im[k - 1] + ax->im[k + 1]);
+
+		ax->power[k] += NOTCHFILTER_POWER_SMOOTHING *
+			(re * re + im * im - ax->power[k]);
+
+		mag[k] = sqrtf(ax->power[k]);
+	}
+
+	for (int k = first; k <= last; k++)
+		sum += mag[k];
+
+	const float threshold = NOTCHFILTER_PEAK_RATIO * sum / (last - first + 1);
+
+	// Strongest local maxima, strongest first
+	int peaks[NOTCHFILTER_MAX_NOTCHES];
+	int found = 0;
+
+	for (int n = 0; n < filter->count; n++) {
+		int best = 0;
+
+		for (int k = first; k <= last; k++) {
+			if (mag[k] <= threshold || mag[k] < mag[k - 1] ||
+					mag[k] <= mag[k + 1])
+				continue;
+
+			bool taken = false;
+			for (int i = 0; i < found; i++)
+				taken |= (peaks[i] == k);
+
+			if (!taken && (best == 0 || mag[k] > mag[best]))
+				best = k;
+		}
+
+		if (best == 0)
+			break;
+
+		peaks[found++] = best;
+	}
+
+	bool assigned[NOTCHFILTER_MAX_NOTCHES] = { false };
+
+	for (int i = 0; i < found; i++) {
+		int k = peaks[i];
+
+		// Parabola through the peak and its neighbours
+		float a = mag[k - 1], b = mag[k], c = mag[k + 1];
+		float denom = a - 2 * b + c;
+		float offset = denom < 0 ? 0.5f * (a - c) / denom : 0;
+		float hz = (k + offset) * filter->bin_hz;
+
+		// Move the nearest notch already following a tone close by,
+		// or else start a free one
+		int nearest = -1, spare = -1;
+
+		for (int n = 0; n < filter->count; n++) {
+			if (assigned[n])
+				continue;
+
+			if (!ax->active[n]) {
+				if (spare < 0)
+					spare = n;
+			} else if (nearest < 0 || fabsf(ax->center[n] - hz) <
+					fabsf(ax->center[nearest] - hz)) {
+				nearest = n;
+			}
+		}
+
+		if (nearest >= 0 && spare >= 0 &&
+				fabsf(ax->center[nearest] - hz) > 2 * filter->bin_hz)
+			nearest = -1;
+
+		int n = nearest >= 0 ? nearest : spare;
+		if (n < 0)
+			continue;
+
+		assigned[n] = true;
+		ax->quiet[n] = 0;
+
+		if (ax->active[n]) {
+			ax->center[n] += NOTCHFILTER_SMOOTHING * (hz - ax->center[n]);
+		} else {
+			ax->center[n] = hz;
+			ax->active[n] = true;
+		}
+
+		notchfilter_set_notch(filter, &ax->notch[n], ax->center[n]);
+	}
+
+	/* A notch left without a peak lets go once its tone has stayed faint
+	 * for a while; if it is only briefly weaker, it stays where it is. */
+	const float release = NOTCHFILTER_RELEASE_RATIO * sum / (last - first + 1);
+
+	for (int n = 0; n < filter->count; n++) {
+		if (!ax->active[n] || assigned[n])
+			continue;
+
+		int k = roundf(ax->center[n] / filter->bin_hz);
+		k = MAX(MIN(k, last), first);
+
+		if (mag[k] > release) {
+			ax->quiet[n] = 0;
+		} else if (++ax->quiet[n] >= NOTCHFILTER_RELEASE_COUNT) {
+			ax->active[n] = false;
+			ax->quiet[n] = 0;
+			ax->center[n] = 0;
+			memset(&ax->notch[n], 0, sizeof(ax->notch[n]));
+		}
+	}
+}
+
+/**
+ * Filter a sample of every axis in place, and analyse it to follow the tones
+ * @param[in] filter the filter, or NULL to pass the samples through
+ * @param[in,out] sample NOTCHFILTER_AXES samples
+ */
+void notchfilter_run(notchfilter_state_t filter, float *sample)
+{
+	if (!filter || !filter->count)
+		return;
+
+	if (filter->antialias_on) {
+		float analysed[NOTCHFILTER_AXES];
+
+		memcpy(analysed, sample, sizeof(analysed));
+		lpfilter_run(filter->antialias, analysed);
+
+		for (int i = 0; i < NOTCHFILTER_AXES; i++)
+			filter->axis[i].accum += analysed[i];
+	} else {
+		for (int i = 0; i < NOTCHFILTER_AXES; i++)
+			filter->axis[i].accum += sample[i];
+	}
+
+	/* Average down to the analysis rate, then start the steps analysing
+	 * it.  The DFT is fed the change between averages, so the far larger
+	 * motion of the craft does not leak across the band as false peaks. */
+	if (++filter->decimation_count >= filter->decimation) {
+		const float scale = 1.0f / filter->decimation;
+
+		for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+			struct notchfilter_axis *ax = &filter->axis[i];
+			float average = ax->accum * scale;
+
+			ax->x_in = average - ax->last;
+			ax->last = average;
+			ax->x_out = ax->ring[filter->ring_pos];
+			ax->ring[filter->ring_pos] = ax->x_in;
+			ax->accum = 0;
+		}
+
+		filter->ring_pos = (filter->ring_pos + 1) % NOTCHFILTER_SDFT_SIZE;
+		filter->decimation_count = 0;
+		filter->step = 0;
+	}
+
+	for (int i = 0; i < filter->steps_per_run && filter->step < NOTCHFILTER_STEPS; i++) {
+		int step = filter->step++;
+
+		if (step < NOTCHFILTER_AXES)
+			notchfilter_update_dft(filter, &filter->axis[step]);
+		else
+			notchfilter_track_peaks(filter, &filter->axis[step - NOTCHFILTER_AXES]);
+	}
+
+	for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+		struct notchfilter_axis *ax = &filter->axis[i];
+
+		for (int n = 0; n < filter->count; n++) {
+			if (!ax->active[n])
+				continue;
+
+			struct notchfilter_biquad *b = &ax->notch[n];
+			float x = sample[i];
+			float y = b->b0 * (x + b->x2) + b->b1 * (b->x1 - b->y1) - b->a2 * b->y2;
+
+			b->x2 = b->x1;
+			b->x1 = x;
+			b->y2 = b->y1;
+			b->y1 = y;
+
+			sample[i] = y;
+		}
+	}
+}
+
+/**
+ * Where a notch is
+ * @returns its center frequency (Hz), or 0 if it is not following a tone
+ */
+float notchfilter_get_frequency(notchfilter_state_t filter, uint8_t axis, uint8_t notch)
+{
+	if (!filter || notch >= filter->count || axis >= NOTCHFILTER_AXES ||
+			!filter->axis[axis].active[notch])
+		return 0;
+
+	return filter->axis[axis].center[notch];
+}
+
+/**
+ * @}
+ * @}
+ */
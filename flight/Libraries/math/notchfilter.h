@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath math support libraries
+ * @{
+ *
+ * @file       notchfilter.h
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Notch filters that follow the strongest tones in a signal
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NOTCHFILTER_H
+#define NOTCHFILTER_H
+
+#include <stdint.h>
+
+//! Axes filtered by each filter
+#define NOTCHFILTER_AXES 3
+
+//! Most notches per axis
+#define NOTCHFILTER_MAX_NOTCHES 2
+
+typedef struct notchfilter_state* notchfilter_state_t;
+
+void notchfilter_create(notchfilter_state_t *filter_ptr, float dT, uint8_t count,
+		float min_hz, float max_hz, float q);
+void notchfilter_run(notchfilter_state_t filter, float *sample);
+float notchfilter_get_frequency(notchfilter_state_t filter, uint8_t axis, uint8_t notch);
+
+#endif /* NOTCHFILTER_H */
+
+/**
+ * @}
+ * @}
+ */
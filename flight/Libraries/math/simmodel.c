@@ -0,0 +1,237 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath math support libraries
+ * @{
+ *
+ * @file       simmodel.c
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013-2016
+ * @brief      Simple vehicle models, stepped for a batch of vehicles at once
+ *
+ * These are the quadcopter and airplane models the simulated sensors
+ * fly flightd with.  They are kept free of the rest of the firmware so
+ * host tools can step thousands of them against the real controllers.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "physical_constants.h"
+#include "simmodel.h"
+
+/**
+ * Put every lane level and at rest at the origin
+ * @param[out] batch the batch to initialize
+ * @param[in] lanes number of vehicles, at most SIMMODEL_MAX_LANES
+ */
+void simmodel_init(struct simmodel_batch *batch, int lanes)
+{
+	memset(batch, 0, sizeof(*batch));
+
+	if (lanes > SIMMODEL_MAX_LANES)
+		lanes = SIMMODEL_MAX_LANES;
+
+	batch->lanes = lanes;
+
+	for (int i = 0; i < SIMMODEL_MAX_LANES; i++)
+		batch->q[0][i] = 1;
+}
+
+/**
+ * Lag the actuator into body rates and turn the attitude by them
+ * @param[in] yaw_coupling yaw rate added per degree of roll
+ */
+static void simmodel_step_attitude(struct simmodel_batch *restrict b,
+		float dT, float yaw_coupling)
+{
+	const float alpha = SIMMODEL_ACTUATOR_TAU / (SIMMODEL_ACTUATOR_TAU + dT);
+	const float k = SIMMODEL_RATE_SCALE * (1 - alpha);
+	const float half_dT = dT * DEG2RAD / 2;
+	const int lanes = b->lanes;
+
+	for (int i = 0; i < lanes; i++) {
+		float p = k * b->actuator[0][i] + b->rate[0][i] * alpha;
+		float r = k * b->actuator[1][i] + b->rate[1][i] * alpha;
+		float y = k * b->actuator[2][i] + b->rate[2][i] * alpha +
+			b->attitude[0][i] * yaw_coupling;
+
+		b->rate[0][i] = p;
+		b->rate[1][i] = r;
+		b->rate[2][i] = y;
+
+		float q0 = b->q[0][i], q1 = b->q[1][i];
+		float q2 = b->q[2][i], q3 = b->q[3][i];
+
+		float n0 = q0 + (-q1 * p - q2 * r - q3 * y) * half_dT;
+		float n1 = q1 + (q0 * p - q3 * r + q2 * y) * half_dT;
+		float n2 = q2 + (q3 * p + q0 * r - q1 * y) * half_dT;
+		float n3 = q3 + (-q2 * p + q1 * r + q0 * y) * half_dT;
+
+		float qmag = sqrtf(n0 * n0 + n1 * n1 + n2 * n2 + n3 * n3);
+
+		/* Restart level rather than divide by nothing */
+		bool degenerate = qmag < 0.001f;
+		float inv = 1 / qmag;
+
+		b->q[0][i] = degenerate ? 1 : n0 * inv;
+		b->q[1][i] = degenerate ? 0 : n1 * inv;
+		b->q[2][i] = degenerate ? 0 : n2 * inv;
+		b->q[3][i] = degenerate ? 0 : n3 * inv;
+	}
+}
+
+/**
+ * Integrate velocity and position from the NED acceleration in accel, stop
+ * at the ground and leave what an accelerometer feels in accel.
+ */
+static void simmodel_step_translation(struct simmodel_batch *restrict b,
+		float dT)
+{
+	const int lanes = b->lanes;
+
+	for (int k = 0; k < 3; k++) {
+		for (int i = 0; i < lanes; i++) {
+			b->vel[k][i] += b->accel[k][i] * dT;
+			b->pos[k][i] += b->vel[k][i] * dT;
+		}
+	}
+
+	for (int i = 0; i < lanes; i++) {
+		// Simulate hitting ground
+		float airborne = b->pos[2][i] > 0 ? 0 : 1;
+
+		b->pos[2][i] *= airborne;
+		b->vel[2][i] *= airborne;
+
+		// Sensor feels gravity (when not accelerating in ned frame)
+		b->accel[2][i] = b->accel[2][i] * airborne - GRAVITY;
+	}
+}
+
+/**
+ * Step a batch of quadcopters: thrust along the body z axis against gravity,
+ * with drag relative to the wind.
+ */
+void simmodel_step_quadcopter(struct simmodel_batch *restrict b, float dT)
+{
+	const float MAX_THRUST = GRAVITY * 2;
+	const float K_FRICTION = 1;
+	const int lanes = b->lanes;
+
+	simmodel_step_attitude(b, dT, 0);
+
+	for (int i = 0; i < lanes; i++) {
+		float q0 = b->q[0][i], q1 = b->q[1][i];
+		float q2 = b->q[2][i], q3 = b->q[3][i];
+
+		// Third row of Rbe, the body z axis in NED
+		float r20 = 2 * (q1 * q3 + q0 * q2);
+		float r21 = 2 * (q2 * q3 - q0 * q1);
+		float r22 = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+		// Make thrust negative as down is positive
+		float thrust = b->thrust[i] * MAX_THRUST;
+
+		b->accel[0][i] = -thrust * r20 -
+			K_FRICTION * (b->vel[0][i] - b->wind[0][i]);
+		b->accel[1][i] = -thrust * r21 -
+			K_FRICTION * (b->vel[1][i] - b->wind[1][i]);
+		b->accel[2][i] = -thrust * r22 + GRAVITY -
+			K_FRICTION * (b->vel[2][i] - b->wind[2][i]);
+	}
+
+	simmodel_step_translation(b, dT);
+}
+
+/**
+ * Step a batch of airplanes.
+ *
+ * A simple kinetic model where the throttle increases the energy and drag
+ * decreases it.  Changing altitude moves energy from kinetic to potential,
+ * roll turns the heading and pitch trades thrust.
+ */
+void simmodel_step_airplane(struct simmodel_batch *restrict b, float dT)
+{
+	const float LIFT_SPEED = 8; // (m/s) where achieve lift for zero pitch
+	const float MAX_THRUST = 9.81f * 2;
+	const float K_FRICTION = 0.2f;
+	const float ROLL_HEADING_COUPLING = 0.1f; // (deg/s) heading change per deg of roll
+	const float PITCH_THRUST_COUPLING = 0.2f; // (m/s^2) of forward acceleration per deg of pitch
+	const int lanes = b->lanes;
+
+	simmodel_step_attitude(b, dT, ROLL_HEADING_COUPLING);
+
+	for (int i = 0; i < lanes; i++) {
+		float q0 = b->q[0][i], q1 = b->q[1][i];
+		float q2 = b->q[2][i], q3 = b->q[3][i];
+		float q0s = q0 * q0, q1s = q1 * q1, q2s = q2 * q2, q3s = q3 * q3;
+
+		// Rbe takes a vector from earth to body
+		float r00 = q0s + q1s - q2s - q3s;
+		float r01 = 2 * (q1 * q2 + q0 * q3);
+		float r02 = 2 * (q1 * q3 - q0 * q2);
+		float r10 = 2 * (q1 * q2 - q0 * q3);
+		float r11 = q0s - q1s + q2s - q3s;
+		float r12 = 2 * (q2 * q3 + q0 * q1);
+		float r20 = 2 * (q1 * q3 + q0 * q2);
+		float r21 = 2 * (q2 * q3 - q0 * q1);
+		float r22 = q0s - q1s - q2s + q3s;
+
+		float vn = b->vel[0][i], ve = b->vel[1][i], vd = b->vel[2][i];
+		float an = vn - b->wind[0][i];
+		float ae = ve - b->wind[1][i];
+		float ad = vd - b->wind[2][i];
+
+		float forward = r00 * an + r01 * ae + r02 * ad;
+		float sideways = r10 * an + r11 * ae + r12 * ad;
+		float downward = r20 * an + r21 * ae + r22 * ad;
+
+		b->airspeed[0][i] = forward;
+		b->airspeed[1][i] = sideways;
+		b->airspeed[2][i] = downward;
+
+		/* Forces in the body frame.  Friction is applied in all directions,
+		 * no side slip, and always gravity lift when straight and level. */
+		float fx = b->thrust[i] * MAX_THRUST -
+			b->attitude[1][i] * PITCH_THRUST_COUPLING -
+			forward * K_FRICTION;
+		float fy = -sideways * K_FRICTION * 100;
+		float fz = GRAVITY * (forward - LIFT_SPEED) +
+			downward * K_FRICTION * 100;
+
+		// Negate fz as NED defines down as positive
+		b->accel[0][i] = fx * r00 + fy * r10 - fz * r20 -
+			K_FRICTION * an;
+		b->accel[1][i] = fx * r01 + fy * r11 - fz * r21 -
+			K_FRICTION * ae;
+		b->accel[2][i] = fx * r02 + fy * r12 - fz * r22 + 9.81f -
+			K_FRICTION * ad;
+	}
+
+	simmodel_step_translation(b, dT);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath math support libraries
+ * @{
+ *
+ * @file       simmodel.h
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Simple vehicle models, stepped for a batch of vehicles at once
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SIMMODEL_H
+#define SIMMODEL_H
+
+//! Most vehicles one batch can hold
+#define SIMMODEL_MAX_LANES 64
+
+//! Body rate for full actuator deflection (deg/s)
+#define SIMMODEL_RATE_SCALE 3000.0f
+
+//! Time constant of the actuator lag (s); 0.81 per step at 500Hz
+#define SIMMODEL_ACTUATOR_TAU (0.002f * 0.81f / 0.19f)
+
+/**
+ * State of a batch of vehicles, stored as one array per quantity with one
+ * element ("lane") per vehicle.  Every lane is stepped by the same straight
+ * line code so the compiler can vectorize across vehicles.
+ *
+ * Inputs are set by the caller before each step; state carries over between
+ * steps and outputs are valid after one.  A disarmed vehicle is simulated by
+ * zeroing its actuator and thrust.
+ */
+struct simmodel_batch {
+	int lanes;
+
+	/* Inputs */
+	float actuator[3][SIMMODEL_MAX_LANES];	//!< Roll, pitch, yaw command (-1 to 1)
+	float thrust[SIMMODEL_MAX_LANES];	//!< Throttle (0 to 1)
+	float wind[3][SIMMODEL_MAX_LANES];	//!< NED wind velocity (m/s)
+	float attitude[2][SIMMODEL_MAX_LANES];	//!< Roll and pitch for airplane coupling (deg)
+
+	/* State */
+	float rate[3][SIMMODEL_MAX_LANES];	//!< Body rates, the lagged actuator (deg/s)
+	float q[4][SIMMODEL_MAX_LANES];		//!< Attitude quaternion
+	float vel[3][SIMMODEL_MAX_LANES];	//!< NED velocity (m/s)
+	float pos[3][SIMMODEL_MAX_LANES];	//!< NED position (m)
+
+	/* Outputs */
+	float accel[3][SIMMODEL_MAX_LANES];	//!< NED specific force an accelerometer feels (m/s^2)
+	float airspeed[3][SIMMODEL_MAX_LANES];	//!< Body frame airspeed, airplane only (m/s)
+};
+
+void simmodel_init(struct simmodel_batch *batch, int lanes);
+void simmodel_step_quadcopter(struct simmodel_batch *batch, float dT);
+void simmodel_step_airplane(struct simmodel_batch *batch, float dT);
+
+#endif /* SIMMODEL_H */
+
+/**
+ * @}
+ * @}
+ */
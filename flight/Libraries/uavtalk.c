@@ -44,8 +44,14 @@
 static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle objectId, uint16_t instId, uint8_t type);
 static int32_t sendObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
+static int32_t sendSingleObjectData(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type, const void *data, uint32_t timestamp);
 static int32_t receiveObject(UAVTalkConnectionData *connection);
+static uint32_t receiveData(UAVTalkConnectionData *connection, const uint8_t *rxbytes, uint32_t numbytes);
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId);
+static int32_t aggregateObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static int32_t flushAggregate(UAVTalkConnectionData *connection);
+static uint32_t deltaEncode(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint8_t *data, uint32_t length, bool allowDelta);
+static void deltaForget(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId);
 
 /**
  * Initialize the UAVTalk library
@@ -147,6 +153,31 @@ int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjH
 	return objectTransaction(connection, obj, instId, UAVTALK_TYPE_OBJ_TS);
 }
 
+/**
+ * Send a previously captured copy of an object with a timestamp.
+ * This frames the supplied snapshot instead of packing the live object,
+ * so the packet reflects the object contents at the time of capture.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object the snapshot was taken from
+ * \param[in] instId The instance ID the snapshot was taken from
+ * \param[in] timestamp Capture time in milliseconds
+ * \param[in] data Snapshot of UAVObjGetNumBytes(obj) bytes of object data
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectSnapshot(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint32_t timestamp, const void *data)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	if (instId == UAVOBJ_ALL_INSTANCES || data == NULL) {
+		return -1;
+	}
+
+	return sendSingleObjectData(connection, obj, instId, UAVTALK_TYPE_OBJ_TS,
+			data, timestamp);
+}
+
 /**
  * Execute the requested transaction on an object.
  * \param[in] connection UAVTalkConnection to be used
@@ -375,15 +406,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
 	case UAVTALK_STATE_DATA:
 
-		// update the CRC
-		iproc->cs = PIOS_CRC_updateByte(iproc->cs, rxbyte);
-
-		connection->rxBuffer[iproc->rxCount++] = rxbyte;
-		if (iproc->rxCount < iproc->length)
-			break;
-
-		iproc->state = UAVTALK_STATE_CS;
-		iproc->rxCount = 0;
+		receiveData(connection, &rxbyte, 1);
 		break;
 
 	case UAVTALK_STATE_CS:
@@ -415,26 +438,124 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 }
 
 /**
- * Process an byte from the telemetry stream.
+ * Take as much of the payload as is available, checking it once it is
+ * complete.  Must only be called in UAVTALK_STATE_DATA.
  * \param[in] connection UAVTalkConnection to be used
- * \param[in] rxbyte Received byte
- * \return UAVTalkRxState
+ * \param[in] rxbytes Received bytes
+ * \param[in] numbytes Number of received bytes
+ * \return Number of bytes consumed
+ */
+static uint32_t receiveData(UAVTalkConnectionData *connection, const uint8_t *rxbytes, uint32_t numbytes)
+{
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+
+	uint32_t wanted = iproc->length - iproc->rxCount;
+
+	if (numbytes > wanted) {
+		numbytes = wanted;
+	}
+
+	memcpy(&connection->rxBuffer[iproc->rxCount], rxbytes, numbytes);
+	iproc->rxCount += numbytes;
+
+	if (iproc->rxCount < iproc->length) {
+		return numbytes;
+	}
+
+	// update the CRC over the whole payload at once
+	iproc->cs = PIOS_CRC_updateCRC(iproc->cs, connection->rxBuffer,
+			iproc->length);
+
+	iproc->state = UAVTALK_STATE_CS;
+	iproc->rxCount = 0;
+
+	return numbytes;
+}
+
+/**
+ * Process bytes from the telemetry stream up to the end of the next frame.
+ * The header and checksum go through the state machine a byte at a time,
+ * but payloads and the noise between frames are taken in one go.  Like
+ * UAVTalkProcessInputStreamQuiet(), a completed frame is left for the
+ * caller to receive or relay.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] rxbytes Received bytes
+ * \param[in] numbytes Number of received bytes
+ * \param[out] consumed Number of bytes used, up to the end of a completed frame
+ * \return The parser state after the last byte used
+ */
+UAVTalkRxState UAVTalkProcessInputFrame(UAVTalkConnection connectionHandle,
+		const uint8_t *rxbytes, int numbytes, int *consumed)
+{
+	UAVTalkConnectionData *connection;
+
+	*consumed = 0;
+
+	CHECKCONHANDLE(connectionHandle,connection,return UAVTALK_STATE_ERROR);
+
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+
+	int i = 0;
+
+	while (i < numbytes) {
+		if (iproc->state == UAVTALK_STATE_DATA) {
+			uint32_t taken = receiveData(connection, &rxbytes[i],
+					numbytes - i);
+
+			connection->stats.rxBytes += taken;
+			iproc->rxPacketLength += taken;
+			i += taken;
+
+			continue;
+		}
+
+		if (iproc->state == UAVTALK_STATE_SYNC) {
+			const uint8_t *sync = memchr(&rxbytes[i],
+					UAVTALK_SYNC_VAL, numbytes - i);
+			int skip = sync ? (sync - &rxbytes[i]) : (numbytes - i);
+
+			connection->stats.rxBytes += skip;
+			i += skip;
+
+			if (!sync) {
+				break;
+			}
+		}
+
+		if (UAVTalkProcessInputStreamQuiet(connectionHandle,
+					rxbytes[i++]) == UAVTALK_STATE_COMPLETE) {
+			break;
+		}
+	}
+
+	*consumed = i;
+
+	return iproc->state;
+}
+
+/**
+ * Process bytes from the telemetry stream, receiving each frame completed.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] rxbytes Received bytes
+ * \param[in] numbytes Number of received bytes
  */
-void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbytes,
+void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, const uint8_t *rxbytes,
 		int numbytes)
 {
 	UAVTalkConnectionData *connection;
 
 	CHECKCONHANDLE(connectionHandle,connection,return);
 
-	for (int i = 0; i < numbytes; i++) {
-		UAVTalkRxState state =
-			UAVTalkProcessInputStreamQuiet(connectionHandle,
-					rxbytes[i]);
+	while (numbytes > 0) {
+		int consumed;
 
-		if (state == UAVTALK_STATE_COMPLETE) {
+		if (UAVTalkProcessInputFrame(connectionHandle, rxbytes,
+					numbytes, &consumed) == UAVTALK_STATE_COMPLETE) {
 			receiveObject(connection);
 		}
+
+		rxbytes += consumed;
+		numbytes -= consumed;
 	}
 }
 
@@ -472,6 +593,8 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
 	// Lock
 	PIOS_Recursive_Mutex_Lock(outConnection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
+	flushAggregate(outConnection);
+
 	outConnection->txBuffer[0] = UAVTALK_SYNC_VAL;
 	// Setup type
 	outConnection->txBuffer[1] = inIproc->type;
@@ -588,6 +711,8 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 	 */
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
+	flushAggregate(connection);
+
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
 	connection->txBuffer[1] = UAVTALK_TYPE_FILEDATA;
 	// data length inserted here below
@@ -699,6 +824,15 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 
 		return 0;
 	} else if (type == UAVTALK_TYPE_OBJ_REQ) {
+		/* The other end may be asking because it could not apply a
+		 * delta; make sure the answer goes out whole.
+		 */
+		if (connection->numDeltaSlots) {
+			PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+			deltaForget(connection, objId, instId);
+			PIOS_Recursive_Mutex_Unlock(connection->lock);
+		}
+
 		if (connection->reqCb) {
 			connection->reqCb(connection->cbCtx, objId, instId);
 			return 0;
@@ -722,7 +856,11 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 		// All instances, not allowed for OBJ messages
 		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
 			// Unpack object, if the instance does not exist it will be created!
-			UAVObjUnpack(obj, instId, connection->rxBuffer);
+			if (UAVObjUnpack(obj, instId, connection->rxBuffer) == 0) {
+				// Both ends now hold this copy
+				deltaEncode(connection, objId, instId,
+						connection->rxBuffer, iproc->length, false);
+			}
 		} else {
 			ret = -1;
 		}
@@ -732,6 +870,9 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
 			// Unpack object, if the instance does not exist it will be created!
 			if (UAVObjUnpack(obj, instId, connection->rxBuffer) == 0) {
+				deltaEncode(connection, objId, instId,
+						connection->rxBuffer, iproc->length, false);
+
 				// Transmit ACK
 				sendObject(connection, obj, instId, UAVTALK_TYPE_ACK);
 			} else {
@@ -812,6 +953,23 @@ static int32_t sendObject(UAVTalkConnectionData *connection, UAVObjHandle obj, u
  * \return -1 Failure
  */
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type)
+{
+	return sendSingleObjectData(connection, obj, instId, type, NULL,
+			PIOS_Thread_Systime());
+}
+
+/**
+ * Send an object through the telemetry link, optionally from a snapshot.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] type Transaction type
+ * \param[in] data Object data to send, or NULL to pack the live object
+ * \param[in] timestamp Timestamp to use for timestamped transaction types
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendSingleObjectData(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type, const void *data, uint32_t timestamp)
 {
 	int32_t length;
 	int32_t dataOffset;
@@ -836,6 +994,9 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
+	// Keep frames in order with any updates waiting to be aggregated
+	flushAggregate(connection);
+
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
 	connection->txBuffer[1] = type;
 	// data length inserted here below
@@ -855,28 +1016,45 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 
 	// Add timestamp when the transaction type is appropriate
 	if (type & UAVTALK_TIMESTAMPED) {
-		uint32_t time = PIOS_Thread_Systime();
-		connection->txBuffer[dataOffset] = (uint8_t)(time & 0xFF);
-		connection->txBuffer[dataOffset + 1] = (uint8_t)((time >> 8) & 0xFF);
+		connection->txBuffer[dataOffset] = (uint8_t)(timestamp & 0xFF);
+		connection->txBuffer[dataOffset + 1] = (uint8_t)((timestamp >> 8) & 0xFF);
 		dataOffset += 2;
 	}
 
 	// Copy data (if any)
-	if (length > 0) {
+	if (length > 0 && data) {
+		memcpy(&connection->txBuffer[dataOffset], data, length);
+	} else if (length > 0) {
 		if (UAVObjPack(obj, instId, &connection->txBuffer[dataOffset]) < 0) {
 			PIOS_Recursive_Mutex_Unlock(connection->lock);
 			return -1;
 		}
 	}
 
+	/* Plain updates of the live object may go out as a delta; anything
+	 * else sent whole still becomes the copy the next delta is against.
+	 */
+	uint32_t payloadLength = length;
+
+	if (length > 0) {
+		uint32_t deltaLength = deltaEncode(connection, objId, instId,
+				&connection->txBuffer[dataOffset], length,
+				type == UAVTALK_TYPE_OBJ && !data);
+
+		if (deltaLength) {
+			connection->txBuffer[1] = UAVTALK_TYPE_DELTA;
+			payloadLength = deltaLength;
+		}
+	}
+
 	// Store the packet length
-	connection->txBuffer[2] = (uint8_t)((dataOffset+length) & 0xFF);
-	connection->txBuffer[3] = (uint8_t)(((dataOffset+length) >> 8) & 0xFF);
+	connection->txBuffer[2] = (uint8_t)((dataOffset+payloadLength) & 0xFF);
+	connection->txBuffer[3] = (uint8_t)(((dataOffset+payloadLength) >> 8) & 0xFF);
 
 	// Calculate checksum
-	connection->txBuffer[dataOffset+length] = PIOS_CRC_updateCRC(0, connection->txBuffer, dataOffset+length);
+	connection->txBuffer[dataOffset+payloadLength] = PIOS_CRC_updateCRC(0, connection->txBuffer, dataOffset+payloadLength);
 
-	uint16_t tx_msg_len = dataOffset+length+UAVTALK_CHECKSUM_LENGTH;
+	uint16_t tx_msg_len = dataOffset+payloadLength+UAVTALK_CHECKSUM_LENGTH;
 	int32_t rc = (*connection->outCb)(connection->cbCtx, connection->txBuffer,
 			tx_msg_len);
 
@@ -917,6 +1095,9 @@ static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId,
 	if (!connection->outCb) return -1;
 
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	flushAggregate(connection);
+
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
 	connection->txBuffer[1] = UAVTALK_TYPE_NACK;
 	// data length inserted here below
@@ -956,6 +1137,418 @@ static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId,
 	return 0;
 }
 
+/**
+ * Enable or disable packing object updates into aggregate frames.  Only
+ * enable this when the other end understands UAVTALK_TYPE_MULTI.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] mtu Largest aggregate frame to send, including the header and
+ * checksum, or 0 to send every object in its own frame
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSetAggregation(UAVTalkConnection connectionHandle, uint16_t mtu)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	if (mtu > UAVTALK_MAX_PACKET_LENGTH) {
+		mtu = UAVTALK_MAX_PACKET_LENGTH;
+	}
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	flushAggregate(connection);
+
+	if (mtu && !connection->aggBuffer) {
+		connection->aggBuffer = PIOS_malloc(UAVTALK_MAX_PACKET_LENGTH);
+
+		if (!connection->aggBuffer) {
+			PIOS_Recursive_Mutex_Unlock(connection->lock);
+			return -1;
+		}
+	}
+
+	connection->aggMtu = mtu;
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return 0;
+}
+
+/**
+ * Enable or disable sending object updates as deltas against the copy last
+ * sent.  Copies are kept for up to the given number of object instances,
+ * chosen by how many bytes their deltas save.  Only enable this when the
+ * other end understands UAVTALK_TYPE_DELTA.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] slots Number of object copies to keep, or 0 to always send
+ * objects whole
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSetDeltaEncoding(UAVTalkConnection connectionHandle, uint8_t slots)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	int32_t ret = 0;
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	/* Memory can't be given back, so the slots only ever grow; a smaller
+	 * or disabled table keeps using the first part of what was allocated.
+	 */
+	if (slots > connection->allocDeltaSlots) {
+		uavtalk_delta_slot *deltaSlots = PIOS_malloc(slots * sizeof(uavtalk_delta_slot));
+
+		if (deltaSlots) {
+			connection->deltaSlots = deltaSlots;
+			connection->allocDeltaSlots = slots;
+		} else {
+			slots = 0;
+			ret = -1;
+		}
+	}
+
+	if (slots != connection->numDeltaSlots) {
+		if (slots) {
+			memset(connection->deltaSlots, 0, slots * sizeof(uavtalk_delta_slot));
+		}
+
+		connection->numDeltaSlots = slots;
+	}
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Queue an object update to go out in the next aggregate frame.  The frame
+ * is sent when it is full, when any other frame is sent, or on
+ * UAVTalkFlushAggregate().  Without aggregation this is UAVTalkSendObject()
+ * without an ack.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkAggregateObject(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	if (!connection->aggMtu) {
+		return sendObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+	}
+
+	if (instId == UAVOBJ_ALL_INSTANCES && UAVObjIsSingleInstance(obj)) {
+		instId = 0;
+	}
+
+	int32_t ret = 0;
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	if (instId == UAVOBJ_ALL_INSTANCES) {
+		uint32_t numInst = UAVObjGetNumInstances(obj);
+
+		for (uint32_t n = 0; n < numInst; n++) {
+			if (aggregateObject(connection, obj, n)) {
+				ret = -1;
+			}
+		}
+	} else {
+		ret = aggregateObject(connection, obj, instId);
+	}
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Send any object updates waiting in the aggregate frame.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlushAggregate(UAVTalkConnection connectionHandle)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	int32_t ret = flushAggregate(connection);
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Append one object instance to the aggregate frame, sending the frame
+ * first if the record would not fit.  Must be called with the lock held.
+ */
+static int32_t aggregateObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+	uint32_t length = UAVObjGetNumBytes(obj);
+	uint32_t recordLength = length;
+
+	if (!UAVObjIsSingleInstance(obj)) {
+		recordLength += 2;
+	}
+
+	uint32_t recordSize = UAVTALK_MULTI_RECORD_HEADER_LENGTH + recordLength;
+
+	/* Objects too big to share a frame go out on their own */
+	if (recordLength > 0xff ||
+			(UAVTALK_MIN_HEADER_LENGTH + recordSize + UAVTALK_CHECKSUM_LENGTH) > connection->aggMtu) {
+		return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+	}
+
+	if ((connection->aggLength + recordSize + UAVTALK_CHECKSUM_LENGTH) > connection->aggMtu) {
+		flushAggregate(connection);
+	}
+
+	if (!connection->aggLength) {
+		connection->aggLength = UAVTALK_MIN_HEADER_LENGTH;
+	}
+
+	uint8_t *record = connection->aggBuffer + connection->aggLength;
+	uint32_t objId = UAVObjGetID(obj);
+
+	record[0] = (uint8_t)(objId & 0xFF);
+	record[1] = (uint8_t)((objId >> 8) & 0xFF);
+	record[2] = (uint8_t)((objId >> 16) & 0xFF);
+	record[3] = (uint8_t)((objId >> 24) & 0xFF);
+	record[4] = recordLength;
+	record += UAVTALK_MULTI_RECORD_HEADER_LENGTH;
+
+	if (!UAVObjIsSingleInstance(obj)) {
+		record[0] = (uint8_t)(instId & 0xFF);
+		record[1] = (uint8_t)((instId >> 8) & 0xFF);
+		record += 2;
+	}
+
+	if (length > 0 && UAVObjPack(obj, instId, record) < 0) {
+		/* Leave the record out; a lone header goes nowhere */
+		if (connection->aggLength == UAVTALK_MIN_HEADER_LENGTH) {
+			connection->aggLength = 0;
+		}
+
+		return -1;
+	}
+
+	deltaEncode(connection, objId, instId, record, length, false);
+
+	connection->aggLength += recordSize;
+	connection->aggObjects++;
+	connection->aggObjectBytes += length;
+
+	return 0;
+}
+
+/**
+ * Frame and send the aggregate, if it holds anything.  Must be called with
+ * the lock held.
+ */
+static int32_t flushAggregate(UAVTalkConnectionData *connection)
+{
+	uint16_t length = connection->aggLength;
+
+	if (!length) {
+		return 0;
+	}
+
+	uint8_t *buf = connection->aggBuffer;
+
+	buf[0] = UAVTALK_SYNC_VAL;
+
+	if (connection->aggObjects == 1) {
+		/* A lone record is cheaper as a plain frame: its object ID
+		 * moves into the header and the record header goes away.
+		 */
+		uint8_t *record = buf + UAVTALK_MIN_HEADER_LENGTH;
+
+		memcpy(buf + 4, record, 4);
+		length -= UAVTALK_MULTI_RECORD_HEADER_LENGTH;
+		memmove(record, record + UAVTALK_MULTI_RECORD_HEADER_LENGTH,
+				length - UAVTALK_MIN_HEADER_LENGTH);
+
+		buf[1] = UAVTALK_TYPE_OBJ;
+	} else {
+		buf[1] = UAVTALK_TYPE_MULTI;
+		buf[4] = buf[5] = buf[6] = buf[7] = 0;
+	}
+
+	buf[2] = (uint8_t)(length & 0xFF);
+	buf[3] = (uint8_t)((length >> 8) & 0xFF);
+
+	buf[length] = PIOS_CRC_updateCRC(0, buf, length);
+
+	uint16_t tx_msg_len = length + UAVTALK_CHECKSUM_LENGTH;
+
+	int32_t rc = -1;
+
+	if (connection->outCb) {
+		rc = (*connection->outCb)(connection->cbCtx, buf, tx_msg_len);
+	}
+
+	if (rc == tx_msg_len) {
+		connection->stats.txObjects += connection->aggObjects;
+		connection->stats.txBytes += tx_msg_len;
+		connection->stats.txObjectBytes += connection->aggObjectBytes;
+	}
+
+	connection->aggLength = 0;
+	connection->aggObjects = 0;
+	connection->aggObjectBytes = 0;
+
+	return (rc == tx_msg_len) ? 0 : -1;
+}
+
+/**
+ * Replace a packed object update with a delta against the copy last sent,
+ * if that is smaller, and keep the update as the new copy.  Must be called
+ * with the lock held.
+ *
+ * An object without a copy only gets one once the least useful copy has
+ * been passed over enough times to decay; a copy's score grows with the
+ * bytes its deltas save and halves whenever a delta would not be smaller.
+ * \param[in,out] data The packed object, replaced by the delta payload
+ * \param[in] length Length of the packed object
+ * \param[in] allowDelta False to only bring an existing copy up to date
+ * \return Length of the delta payload, or 0 to send the object whole
+ */
+static uint32_t deltaEncode(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint8_t *data, uint32_t length, bool allowDelta)
+{
+	if (!connection->numDeltaSlots || length < UAVTALK_DELTA_MIN_LENGTH ||
+			length > UAVOBJECTS_LARGEST) {
+		return 0;
+	}
+
+	uavtalk_delta_slot *slot = NULL;
+	uavtalk_delta_slot *victim = NULL;
+
+	for (int i = 0; i < connection->numDeltaSlots; i++) {
+		uavtalk_delta_slot *s = &connection->deltaSlots[i];
+
+		if (s->objId == objId && s->instId == instId) {
+			slot = s;
+			break;
+		}
+
+		if (!victim || s->score < victim->score) {
+			victim = s;
+		}
+	}
+
+	if (!slot) {
+		if (!allowDelta) {
+			return 0;
+		}
+
+		if (victim->score > UAVTALK_DELTA_MISS_COST) {
+			victim->score -= UAVTALK_DELTA_MISS_COST;
+			return 0;
+		}
+
+		/* Take over the slot; the first update goes whole */
+		victim->objId = objId;
+		victim->instId = instId;
+		victim->score = length;
+		memcpy(victim->data, data, length);
+
+		return 0;
+	}
+
+	if (!allowDelta) {
+		memcpy(slot->data, data, length);
+		return 0;
+	}
+
+	uint8_t map[UAVTALK_DELTA_MAP_LENGTH(UAVOBJECTS_LARGEST)] = { 0 };
+	uint32_t mapLength = UAVTALK_DELTA_MAP_LENGTH(length);
+	uint32_t deltaLength = UAVTALK_DELTA_CHECK_LENGTH + mapLength;
+
+	for (uint32_t offs = 0, block = 0; offs < length;
+			offs += UAVTALK_DELTA_BLOCK, block++) {
+		uint32_t n = length - offs;
+
+		if (n > UAVTALK_DELTA_BLOCK) {
+			n = UAVTALK_DELTA_BLOCK;
+		}
+
+		if (memcmp(slot->data + offs, data + offs, n)) {
+			map[block / 8] |= 1 << (block % 8);
+			deltaLength += n;
+		}
+	}
+
+	uint32_t baseCrc = PIOS_CRC32_updateCRC(0, slot->data, length);
+
+	memcpy(slot->data, data, length);
+
+	if (deltaLength >= length) {
+		slot->score /= 2;
+		return 0;
+	}
+
+	slot->score += length - deltaLength;
+
+	if (slot->score > UAVTALK_DELTA_MAX_SCORE) {
+		slot->score = UAVTALK_DELTA_MAX_SCORE;
+	}
+
+	/* The new copy is safe in the slot, so the payload can be rebuilt
+	 * over the packed object.
+	 */
+	data[0] = baseCrc;
+	data[1] = baseCrc >> 8;
+	data[2] = baseCrc >> 16;
+	data[3] = baseCrc >> 24;
+	memcpy(data + UAVTALK_DELTA_CHECK_LENGTH, map, mapLength);
+
+	uint8_t *out = data + UAVTALK_DELTA_CHECK_LENGTH + mapLength;
+
+	for (uint32_t offs = 0, block = 0; offs < length;
+			offs += UAVTALK_DELTA_BLOCK, block++) {
+		if (map[block / 8] & (1 << (block % 8))) {
+			uint32_t n = length - offs;
+
+			if (n > UAVTALK_DELTA_BLOCK) {
+				n = UAVTALK_DELTA_BLOCK;
+			}
+
+			memcpy(out, slot->data + offs, n);
+			out += n;
+		}
+	}
+
+	return deltaLength;
+}
+
+/**
+ * Drop the copies of an object, so that it is next sent whole.  Must be
+ * called with the lock held.
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances
+ */
+static void deltaForget(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId)
+{
+	for (int i = 0; i < connection->numDeltaSlots; i++) {
+		uavtalk_delta_slot *s = &connection->deltaSlots[i];
+
+		if (s->objId == objId &&
+				(instId == UAVOBJ_ALL_INSTANCES || s->instId == instId)) {
+			s->objId = 0;
+			s->score = 0;
+		}
+	}
+}
+
 /**
  * @}
  * @}
@@ -343,6 +343,7 @@ static void AttitudeTask(void *parameters)
 			INSSetAccelVar(insSettings.AccelVar);
 			INSSetGyroVar(insSettings.GyroVar);
 			INSSetBaroVar(insSettings.BaroVar);
+			INSSetGPSDelay(insSettings.GpsDelay / 1000.0f);
 
 			AttitudeSettingsGet(&attitudeSettings);
 				
@@ -1189,6 +1190,7 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		/* This is more optimistic than in the actual flight loop, where
 		 * ublox accuracy data is added.  But that seems OK */
 		INSSetPosVelVar(insSettings.GpsVar[INSSETTINGS_GPSVAR_POS], insSettings.GpsVar[INSSETTINGS_GPSVAR_VEL], insSettings.GpsVar[INSSETTINGS_GPSVAR_VERTPOS]);
+		INSSetGPSDelay(insSettings.GpsDelay / 1000.0f);
 
 		// Initialize the gyro bias from the settings
 		float gyro_bias[3] = {gyrosBias.x * DEG2RAD, gyrosBias.y * DEG2RAD, gyrosBias.z * DEG2RAD};
@@ -1380,8 +1382,16 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	 * TODO: Need to add a general sanity check for all the inputs to make sure their kosher
 	 * although probably should occur within INS itself
 	 */
-	if (sensors)
+	if (insSettings.SpreadCorrections == INSSETTINGS_SPREADCORRECTIONS_TRUE) {
+		// Fuse one group of sensors per step, so a GPS, mag and baro
+		// update arriving together doesn't make for one long step
+		if (sensors)
+			INSDeferCorrection(&magData.x, NED, vel, ( baroData.Altitude + baro_offset ), sensors);
+
+		INSCorrectionStep();
+	} else if (sensors) {
 		INSCorrection(&magData.x, NED, vel, ( baroData.Altitude + baro_offset ), sensors);
+	}
 
 	// Export the state and variance for monitoring the EKF
 	INSStateData state;
@@ -62,8 +62,6 @@ static void updateSettings();
 
 #define TASK_PRIORITY                   PIOS_THREAD_PRIO_LOW
 
-#define BRIDGE_BUF_LEN 10
-
 // ****************
 // Private variables
 
@@ -130,17 +128,20 @@ static void com2UsbBridgeTask(void *parameters)
 	/* Handle usart -> vcp direction */
 	volatile uint32_t tx_errors = 0;
 	while (1) {
-		uint32_t rx_bytes;
+		uint16_t rx_bytes;
 
-		uint8_t com2usb_buf[BRIDGE_BUF_LEN];
+		const uint8_t *com2usb_buf;
 
-		rx_bytes = PIOS_COM_ReceiveBuffer(usart_port, com2usb_buf, BRIDGE_BUF_LEN, 500);
+		/* Forward straight out of the receive buffer */
+		rx_bytes = PIOS_COM_ReceivePeek(usart_port, &com2usb_buf, 500);
 		if (rx_bytes > 0) {
 			/* Bytes available to transfer */
 			if (PIOS_COM_SendBuffer(vcp_port, com2usb_buf, rx_bytes) != rx_bytes) {
 				/* Error on transmit */
 				tx_errors++;
 			}
+
+			PIOS_COM_ReceiveRelease(usart_port, rx_bytes);
 		}
 	}
 }
@@ -152,17 +153,20 @@ static void usb2ComBridgeTask(void * parameters)
 	/* Handle vcp -> usart direction */
 	volatile uint32_t tx_errors = 0;
 	while (1) {
-		uint32_t rx_bytes;
+		uint16_t rx_bytes;
 
-		uint8_t usb2com_buf[BRIDGE_BUF_LEN];
+		const uint8_t *usb2com_buf;
 
-		rx_bytes = PIOS_COM_ReceiveBuffer(vcp_port, usb2com_buf, BRIDGE_BUF_LEN, 500);
+		/* Forward straight out of the receive buffer */
+		rx_bytes = PIOS_COM_ReceivePeek(vcp_port, &usb2com_buf, 500);
 		if (rx_bytes > 0) {
 			/* Bytes available to transfer */
 			if (PIOS_COM_SendBuffer(usart_port, usb2com_buf, rx_bytes) != rx_bytes) {
 				/* Error on transmit */
 				tx_errors++;
 			}
+
+			PIOS_COM_ReceiveRelease(vcp_port, rx_bytes);
 		}
 	}
 }
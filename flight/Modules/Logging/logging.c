@@ -83,8 +83,34 @@ const char DIGITS[16] = "0123456789abcdef";
 
 #define LOGGING_PERIOD_MS 100
 
+/* Size of the ring that object snapshots are staged in between the UAVO
+ * callback and the logging task.  Set to 0 in pios_config.h to frame and
+ * write every update directly from the updating task instead. */
+#ifndef LOGGING_STAGING_BYTES
+#define LOGGING_STAGING_BYTES 2048
+#endif
+
+#define LOGGING_DRAIN_PERIOD_MS 5
+#define LOGGING_BATCH_BYTES 256
+
 // Private types
 
+//! An object snapshot held in the staging ring; data follows the header
+struct log_record {
+	UAVObjHandle obj;	/**< NULL marks a wrap to the start of the ring */
+	uint32_t timestamp;
+	uint16_t inst_id;
+	uint16_t len;
+	uint8_t data[];
+};
+
+#define LOG_RECORD_ALIGN __alignof__(struct log_record)
+#define LOG_RECORD_BYTES(len) \
+	((sizeof(struct log_record) + (len) + LOG_RECORD_ALIGN - 1) & \
+	 ~(LOG_RECORD_ALIGN - 1))
+
+DONT_BUILD_IF(LOGGING_STAGING_BYTES % LOG_RECORD_ALIGN, LoggingStagingAlignment);
+
 // Private variables
 static UAVTalkConnection uavTalkCon;
 static struct pios_thread *loggingTaskHandle;
@@ -104,12 +130,27 @@ static void logAll(UAVObjHandle obj);
 static void logSettings(UAVObjHandle obj);
 static void writeHeader();
 static void updateSettings();
+static bool stage_record(UAVObjHandle obj, uint16_t inst_id, const void *data);
+static void drain_staged_records();
+static int32_t send_data_batched(void *ctx, uint8_t *data, int32_t length);
+static void flush_batch();
 
 // Local variables
 static uintptr_t logging_com_id;
 static uint32_t written_bytes;
 static bool destination_onboard_flash;
 
+/* Staging ring.  Producers are UAVO callbacks, which the object manager
+ * serializes under its lock, and the only consumer is the logging task,
+ * so head and tail each have a single writer. */
+static uint8_t *staging_buf;
+static volatile uint32_t staging_head;
+static volatile uint32_t staging_tail;
+static volatile uint32_t dropped_records;
+
+static uint8_t *batch_buf;
+static uint16_t batch_len;
+
 #ifdef PIOS_INCLUDE_LOG_TO_FLASH
 static const struct streamfs_cfg streamfs_settings = {
 	.fs_magic      = 0x89abceef,
@@ -182,8 +223,20 @@ int32_t LoggingInitialize(void)
 		return -1;
 	}
 
-	// Initialise UAVTalk
-	uavTalkCon = UAVTalkInitialize(NULL, &send_data_nonblock,
+#if LOGGING_STAGING_BYTES > 0
+	staging_buf = PIOS_malloc(LOGGING_STAGING_BYTES);
+	batch_buf = PIOS_malloc(LOGGING_BATCH_BYTES);
+
+	if (!staging_buf || !batch_buf) {
+		// Fall back to writing from the updating task
+		staging_buf = NULL;
+	}
+#endif
+
+	// Initialise UAVTalk.  When staging, all framing happens on the
+	// logging task, so the output can be batched and may block.
+	uavTalkCon = UAVTalkInitialize(NULL,
+			staging_buf ? &send_data_batched : &send_data_nonblock,
 			NULL, NULL, NULL);
 
 	if (!uavTalkCon) {
@@ -233,6 +286,7 @@ static void loggingTask(void *parameters)
 
 	LoggingStatsGet(&loggingData);
 	loggingData.BytesLogged = 0;
+	loggingData.DroppedRecords = 0;
 	
 #ifdef PIOS_INCLUDE_LOG_TO_FLASH
 	if (destination_onboard_flash) {
@@ -256,6 +310,10 @@ static void loggingTask(void *parameters)
 	// Loop forever
 	while (1) 
 	{
+		// Write out anything staged, including the tail end of a
+		// session that has just been stopped.
+		drain_staged_records();
+
 		LoggingStatsGet(&loggingData);
 
 		// Check for change in armed state if logging on armed
@@ -335,6 +393,11 @@ static void loggingTask(void *parameters)
 				UAVObjIterate(&logSettings);
 			}
 
+			flush_batch();
+
+			dropped_records = 0;
+			loggingData.DroppedRecords = 0;
+
 			// Register objects to be logged
 			switch (settings.Profile) {
 				case LOGGINGSETTINGS_PROFILE_BASIC:
@@ -352,7 +415,20 @@ static void loggingTask(void *parameters)
 			LoggingStatsSet(&loggingData);
 			break;
 		case LOGGINGSTATS_OPERATION_LOGGING:
-			{
+			if (staging_buf) {
+				// Drain often enough that the ring absorbs
+				// only short bursts.
+				PIOS_Thread_Sleep(LOGGING_DRAIN_PERIOD_MS);
+
+				if (PIOS_Thread_Period_Elapsed(now, LOGGING_PERIOD_MS)) {
+					uint32_t dropped = dropped_records;
+
+					LoggingStatsBytesLoggedSet(&written_bytes);
+					LoggingStatsDroppedRecordsSet(&dropped);
+
+					now = PIOS_Thread_Systime();
+				}
+			} else {
 				// Sleep between updating stats.
 				PIOS_Thread_Sleep_Until(&now, LOGGING_PERIOD_MS);
 
@@ -478,6 +554,171 @@ static int32_t send_data_nonblock(void *ctx, uint8_t *data, int32_t length)
 	return length;
 }
 
+/**
+ * Collect framed data from UAVTalk and write it out in larger chunks.
+ * Only used from the logging task.
+ * \param[in] data Data buffer to send
+ * \param[in] length Length of buffer
+ * \return -1 on failure
+ * \return number of bytes accepted on success
+ */
+static int32_t send_data_batched(void *ctx, uint8_t *data, int32_t length)
+{
+	(void) ctx;
+
+	if (batch_len + length > LOGGING_BATCH_BYTES) {
+		flush_batch();
+	}
+
+	if (length > LOGGING_BATCH_BYTES) {
+		return send_data(data, length);
+	}
+
+	memcpy(batch_buf + batch_len, data, length);
+	batch_len += length;
+
+	return length;
+}
+
+/**
+ * Write out any data collected by send_data_batched
+ */
+static void flush_batch()
+{
+	if (batch_len) {
+		send_data(batch_buf, batch_len);
+		batch_len = 0;
+	}
+}
+
+/**
+ * Copy an object snapshot into the staging ring.
+ * Called with the object manager lock held.
+ * \param[in] obj Object the data belongs to
+ * \param[in] inst_id Instance the data belongs to
+ * \param[in] data Object data, or NULL to read the instance
+ * \return true if the record was staged, false if there was no room
+ */
+static bool stage_record(UAVObjHandle obj, uint16_t inst_id, const void *data)
+{
+	uint16_t len = UAVObjGetNumBytes(obj);
+	uint32_t rec_bytes = LOG_RECORD_BYTES(len);
+	uint32_t head = staging_head;
+	uint32_t tail = staging_tail;
+	uint32_t pos = head;
+	uint32_t next;
+
+	if (rec_bytes >= LOGGING_STAGING_BYTES) {
+		return false;
+	}
+
+	if (tail <= head) {
+		if (head + rec_bytes <= LOGGING_STAGING_BYTES) {
+			next = head + rec_bytes;
+		} else {
+			// Doesn't fit before the end; go around
+			pos = 0;
+			next = rec_bytes;
+		}
+
+		if (next >= LOGGING_STAGING_BYTES) {
+			next = 0;
+		}
+
+		// Keep head from catching up with tail, which would
+		// look like an empty ring.
+		if (pos == 0 && head != 0 && next >= tail) {
+			return false;
+		}
+
+		if (next == tail) {
+			return false;
+		}
+	} else {
+		if (head + rec_bytes >= tail) {
+			return false;
+		}
+
+		next = head + rec_bytes;
+	}
+
+	struct log_record *rec = (struct log_record *) &staging_buf[pos];
+
+	rec->timestamp = PIOS_Thread_Systime();
+	rec->inst_id = inst_id;
+	rec->len = len;
+
+	if (data) {
+		memcpy(rec->data, data, len);
+	} else if (UAVObjGetInstanceData(obj, inst_id, rec->data) < 0) {
+		return false;
+	}
+
+	rec->obj = obj;
+
+	if (pos != head) {
+		((struct log_record *) &staging_buf[head])->obj = NULL;
+	}
+
+	// Record contents must be visible before the new head
+	__sync_synchronize();
+
+	staging_head = next;
+
+	return true;
+}
+
+/**
+ * Frame and write out everything in the staging ring
+ */
+static void drain_staged_records()
+{
+	if (!staging_buf) {
+		return;
+	}
+
+	uint32_t tail = staging_tail;
+	uint32_t head = staging_head;
+
+	if (tail == head) {
+		return;
+	}
+
+	// Don't read records ahead of the head that published them
+	__sync_synchronize();
+
+	while (tail != head) {
+		struct log_record *rec = (struct log_record *) &staging_buf[tail];
+
+		if (!rec->obj) {
+			tail = 0;
+			continue;
+		}
+
+		UAVTalkSendObjectSnapshot(uavTalkCon, rec->obj, rec->inst_id,
+				rec->timestamp, rec->data);
+
+		tail += LOG_RECORD_BYTES(rec->len);
+
+		if (tail >= LOGGING_STAGING_BYTES) {
+			tail = 0;
+		}
+
+		// Done with the record before handing back its space
+		__sync_synchronize();
+
+		staging_tail = tail;
+
+		if (tail == head) {
+			// Pick up whatever arrived while we were writing
+			head = staging_head;
+			__sync_synchronize();
+		}
+	}
+
+	flush_batch();
+}
+
 /**
  * @brief Callback for adding an object to the logging queue
  * @param ev the event
@@ -485,13 +726,22 @@ static int32_t send_data_nonblock(void *ctx, uint8_t *data, int32_t length)
 static void obj_updated_callback(const UAVObjEvent *ev, void *cb_ctx,
 		void *uavo_data, int uavo_len)
 {
-	(void) cb_ctx; (void) uavo_data; (void) uavo_len;
+	(void) cb_ctx; (void) uavo_len;
 
 	if (loggingData.Operation != LOGGINGSTATS_OPERATION_LOGGING){
 		// We are not logging, so all events are discarded
 		return;
 	}
 
+	if (staging_buf) {
+		// Leave framing and I/O to the logging task
+		if (!stage_record(ev->obj, ev->instId, uavo_data)) {
+			dropped_records++;
+		}
+
+		return;
+	}
+
 	UAVTalkSendObjectTimestamped(uavTalkCon, ev->obj, ev->instId);
 }
 
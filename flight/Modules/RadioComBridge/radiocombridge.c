@@ -96,12 +96,12 @@ static void radioRxTask(void *parameters);
 static int32_t UAVTalkSendHandler(void *ctx, uint8_t * buf, int32_t length);
 static int32_t RadioSendHandler(void *ctx, uint8_t * buf, int32_t length);
 
-static void ProcessLocalStream(UAVTalkConnection inConnectionHandle,
-				   UAVTalkConnection outConnectionHandle,
-				   uint8_t rxbyte);
-static void ProcessRadioStream(UAVTalkConnection inConnectionHandle,
-			       UAVTalkConnection outConnectionHandle,
-			       uint8_t rxbyte);
+static int ProcessLocalStream(UAVTalkConnection inConnectionHandle,
+			      UAVTalkConnection outConnectionHandle,
+			      const uint8_t *rxbytes, int numbytes);
+static int ProcessRadioStream(UAVTalkConnection inConnectionHandle,
+			      UAVTalkConnection outConnectionHandle,
+			      const uint8_t *rxbytes, int numbytes);
 
 // ****************
 // Private variables
@@ -314,20 +314,23 @@ static void radioRxTask( __attribute__ ((unused))
 #endif
 		if (PIOS_COM_RADIOBRIDGE &&
 				PIOS_COM_Available(PIOS_COM_RADIOBRIDGE)) {
-			uint8_t serial_data[32];
+			const uint8_t *serial_data;
 			uint16_t bytes_to_process =
-			    PIOS_COM_ReceiveBuffer(PIOS_COM_RADIOBRIDGE,
-						   serial_data,
-						   sizeof(serial_data),
-						   MAX_PORT_DELAY);
+			    PIOS_COM_ReceivePeek(PIOS_COM_RADIOBRIDGE,
+						 &serial_data,
+						 MAX_PORT_DELAY);
 			if (bytes_to_process > 0) {
-				// Pass the data through the UAVTalk parser.
-				for (uint8_t i = 0;
-				     i < bytes_to_process; i++) {
-					ProcessRadioStream(data->radioUAVTalkCon,
-							   data->telemUAVTalkCon,
-							   serial_data[i]);
+				// Pass the data through the UAVTalk parser
+				// where they sit in the port buffer.
+				for (int i = 0; i < bytes_to_process; ) {
+					i += ProcessRadioStream(data->radioUAVTalkCon,
+								data->telemUAVTalkCon,
+								&serial_data[i],
+								bytes_to_process - i);
 				}
+
+				PIOS_COM_ReceiveRelease(PIOS_COM_RADIOBRIDGE,
+							bytes_to_process);
 			}
 
 			/* periodically inject ComBridgeStats to downstream */
@@ -381,24 +384,26 @@ static void telemetryRxTask( __attribute__ ((unused))
 		}
 
 		if (inputPort) {
-			uint8_t serial_data[32];
+			const uint8_t *serial_data;
 			uint16_t bytes_to_process =
-			    PIOS_COM_ReceiveBuffer(inputPort, serial_data,
-						   sizeof(serial_data),
-						   MAX_PORT_DELAY);
+			    PIOS_COM_ReceivePeek(inputPort, &serial_data,
+						 MAX_PORT_DELAY);
 
 			if (bytes_to_process > 0) {
 				if (inputPort == PIOS_COM_TELEM_USB) {
 					processUsbActivity(true);
 				}
 
-				for (uint8_t i = 0; i < bytes_to_process;
-						i++) {
-					ProcessLocalStream(
+				for (int i = 0; i < bytes_to_process; ) {
+					i += ProcessLocalStream(
 						data->telemUAVTalkCon,
 						data->radioUAVTalkCon,
-						serial_data[i]);
+						&serial_data[i],
+						bytes_to_process - i);
 				}
+
+				PIOS_COM_ReceiveRelease(inputPort,
+							bytes_to_process);
 			}
 		} else {
 			PIOS_Thread_Sleep(5);
@@ -456,19 +461,25 @@ static int32_t RadioSendHandler(void *ctx, uint8_t * buf, int32_t length)
 
 #define MetaObjectId(x) (x+1)
 /**
- * @brief Process a byte of data received on the telemetry stream
+ * @brief Process data received on the telemetry stream, up to the end of
+ * the next packet
  *
  * @param[in] inConnectionHandle  The UAVTalk connection handle on the telemetry port
  * @param[in] outConnectionHandle  The UAVTalk connection handle on the radio port.
- * @param[in] rxbyte  The received byte.
+ * @param[in] rxbytes  The received bytes.
+ * @param[in] numbytes  The number of received bytes.
+ * @return the number of bytes used
  */
-static void ProcessLocalStream(UAVTalkConnection inConnectionHandle,
-				   UAVTalkConnection outConnectionHandle,
-				   uint8_t rxbyte)
+static int ProcessLocalStream(UAVTalkConnection inConnectionHandle,
+			      UAVTalkConnection outConnectionHandle,
+			      const uint8_t *rxbytes, int numbytes)
 {
+	int consumed;
+
 	// Keep reading until we receive a completed packet.
 	UAVTalkRxState state =
-	    UAVTalkProcessInputStreamQuiet(inConnectionHandle, rxbyte);
+	    UAVTalkProcessInputFrame(inConnectionHandle, rxbytes, numbytes,
+				     &consumed);
 
 	if (state == UAVTALK_STATE_COMPLETE) {
 		PIOS_ANNUNC_Toggle(PIOS_LED_RX);
@@ -486,7 +497,7 @@ static void ProcessLocalStream(UAVTalkConnection inConnectionHandle,
 			case MetaObjectId(HWTAULINK_OBJID):
 			case UAVTALKRECEIVER_OBJID:
 			case MetaObjectId(UAVTALKRECEIVER_OBJID):
-				return;
+				return consumed;
 			default:
 				break;
 		}
@@ -497,22 +508,30 @@ static void ProcessLocalStream(UAVTalkConnection inConnectionHandle,
 		// okee-dokee.
 		UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
 	}
+
+	return consumed;
 }
 
 /**
- * @brief Process a byte of data received on the radio data stream.
+ * @brief Process data received on the radio data stream, up to the end of
+ * the next packet.
  *
  * @param[in] inConnectionHandle  The UAVTalk connection handle on the radio port.
  * @param[in] outConnectionHandle  The UAVTalk connection handle on the telemetry port.
- * @param[in] rxbyte  The received byte.
+ * @param[in] rxbytes  The received bytes.
+ * @param[in] numbytes  The number of received bytes.
+ * @return the number of bytes used
  */
-static void ProcessRadioStream(UAVTalkConnection inConnectionHandle,
-			       UAVTalkConnection outConnectionHandle,
-			       uint8_t rxbyte)
+static int ProcessRadioStream(UAVTalkConnection inConnectionHandle,
+			      UAVTalkConnection outConnectionHandle,
+			      const uint8_t *rxbytes, int numbytes)
 {
+	int consumed;
+
 	// Keep reading until we receive a completed packet.
 	UAVTalkRxState state =
-	    UAVTalkProcessInputStreamQuiet(inConnectionHandle, rxbyte);
+	    UAVTalkProcessInputFrame(inConnectionHandle, rxbytes, numbytes,
+				     &consumed);
 
 	if (state == UAVTALK_STATE_COMPLETE) {
 		if (!data->have_port) {
@@ -545,4 +564,6 @@ static void ProcessRadioStream(UAVTalkConnection inConnectionHandle,
 				break;
 		}
 	}
+
+	return consumed;
 }
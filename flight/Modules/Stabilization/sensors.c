@@ -36,6 +36,7 @@
 #include "pios_queue.h"
 #include "misc_math.h"
 #include "lpfilter.h"
+#include "notchfilter.h"
 #include "sensors.h"
 
 #if defined(PIOS_INCLUDE_PX4FLOW)
@@ -50,6 +51,7 @@ extern pios_i2c_t external_i2c_adapter_id;
 #include "baroaltitude.h"
 #include "gyros.h"
 #include "gyrosbias.h"
+#include "gyronotchstatus.h"
 #include "homelocation.h"
 #include "opticalflowsettings.h"
 #include "opticalflow.h"
@@ -65,6 +67,7 @@ extern pios_i2c_t external_i2c_adapter_id;
 #define REQUIRED_GOOD_CYCLES 50
 #define MAX_TIME_BETWEEN_VALID_BARO_DATAS_US (100*1000)
 #define MAX_TIME_BETWEEN_VALID_MAG_DATAS_US (300*1000)
+#define NOTCH_STATUS_PERIOD_MS 100
 
 // Private types
 enum mag_calibration_algo {
@@ -127,6 +130,8 @@ static enum mag_calibration_algo mag_calibration_algo = MAG_CALIBRATION_PRELEMAR
 
 static lpfilter_state_t gyro_filter;
 static lpfilter_state_t accel_filter;
+static notchfilter_state_t gyro_notch;
+static uint8_t gyro_notch_count;
 
 /**
  * API for sensor fusion algorithms:
@@ -144,6 +149,7 @@ int32_t sensors_init(void)
 {
 	if (GyrosInitialize() == -1 \
 		|| GyrosBiasInitialize() == -1 \
+		|| GyroNotchStatusInitialize() == -1 \
 		|| AccelsInitialize() == -1 \
 		|| BaroAltitudeInitialize() == -1 \
 		|| MagnetometerInitialize() == -1 \
@@ -377,8 +383,26 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros)
 	    gyros->z * gyro_scale[2]
 	};
 
+	// Take out motor noise before the lowpass, which it would be delayed by
+	notchfilter_run(gyro_notch, gyros_out);
 	lpfilter_run(gyro_filter, gyros_out);
 
+	static uint32_t last_notch_status;
+
+	if (gyro_notch_count &&
+			PIOS_Thread_Period_Elapsed(last_notch_status, NOTCH_STATUS_PERIOD_MS)) {
+		GyroNotchStatusData notchStatus;
+
+		for (int i = 0; i < NOTCHFILTER_MAX_NOTCHES; i++) {
+			notchStatus.X[i] = notchfilter_get_frequency(gyro_notch, 0, i);
+			notchStatus.Y[i] = notchfilter_get_frequency(gyro_notch, 1, i);
+			notchStatus.Z[i] = notchfilter_get_frequency(gyro_notch, 2, i);
+		}
+
+		GyroNotchStatusSet(&notchStatus);
+		last_notch_status = PIOS_Thread_Systime();
+	}
+
 	GyrosData gyrosData;
 	gyrosData.temperature = gyros->temperature;
 
@@ -757,6 +781,21 @@ static void sensors_settings_update()
 
 	lpfilter_create(&gyro_filter, sensorSettings.LowpassCutoff, gyro_dT, sensorSettings.LowpassOrder, 3);
 	lpfilter_create(&accel_filter, sensorSettings.LowpassCutoff, accel_dT, sensorSettings.LowpassOrder, 3);
+
+	notchfilter_create(&gyro_notch, gyro_dT, sensorSettings.DynamicNotchCount,
+		sensorSettings.DynamicNotchRange[SENSORSETTINGS_DYNAMICNOTCHRANGE_MIN],
+		sensorSettings.DynamicNotchRange[SENSORSETTINGS_DYNAMICNOTCHRANGE_MAX],
+		sensorSettings.DynamicNotchQ);
+
+	// The status isn't updated while the notches are off, so clear it
+	if (gyro_notch_count && !sensorSettings.DynamicNotchCount) {
+		GyroNotchStatusData notchStatus;
+
+		memset(&notchStatus, 0, sizeof(notchStatus));
+		GyroNotchStatusSet(&notchStatus);
+	}
+
+	gyro_notch_count = sensorSettings.DynamicNotchCount;
 }
 /**
   * @}
@@ -63,6 +63,7 @@
 #include "systemsettings.h"
 
 #include "coordinate_conversions.h"
+#include "simmodel.h"
 
 // Private constants
 #define STACK_SIZE_BYTES 1540
@@ -74,6 +75,10 @@
 // Private variables
 static float accel_bias[3];
 
+// Vehicles flown by the quadcopter and airplane models
+static struct simmodel_batch quad_vehicle;
+static struct simmodel_batch plane_vehicle;
+
 static float rand_gauss();
 
 static int sens_rate = 500;
@@ -92,6 +97,11 @@ extern bool use_yasim;
 static void simulateYasim();
 #endif
 
+// Tone added to the gyros, like motor noise
+extern float sim_gyro_tone_hz;
+extern float sim_gyro_tone_amplitude;
+static float gyro_tone_phase;
+
 // Private functions
 static void simsensors_step();
 static void simulateModelQuadcopter();
@@ -201,6 +211,9 @@ int32_t simsensors_init(void)
 	accel_bias[1] = rand_gauss() / 10;
 	accel_bias[2] = rand_gauss() / 10;
 
+	simmodel_init(&quad_vehicle, 1);
+	simmodel_init(&plane_vehicle, 1);
+
 	AttitudeSimulatedInitialize();
 	BaroAltitudeInitialize();
 	/* TODO: Airspeed data should properly go through airspeed module.
@@ -273,34 +286,44 @@ static void simsensors_step()
 	}
 }
 
-static void simsensors_scale_controls(float *rpy, float *thrust_out,
-		float max_thrust)
+/**
+ * Actuator commands and throttle for the model, zeroed when disarmed
+ */
+static void simsensors_get_controls(float *actuator, float *thrust_out)
 {
-	const float ACTUATOR_ALPHA = 0.81f;
-
 	FlightStatusData flightStatus;
 	FlightStatusGet(&flightStatus);
 	ActuatorDesiredData actuatorDesired;
 	ActuatorDesiredGet(&actuatorDesired);
 
-	float thrust = (flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED) ? actuatorDesired.Thrust * max_thrust : 0;
+	bool armed = flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED;
+
+	float thrust = armed ? actuatorDesired.Thrust : 0;
 
 	if (thrust != thrust)
 		thrust = 0;
 
 	*thrust_out = thrust;
 
-	float control_scaling = 3000.0f;
+	actuator[0] = armed ? actuatorDesired.Roll : 0;
+	actuator[1] = armed ? actuatorDesired.Pitch : 0;
+	actuator[2] = armed ? actuatorDesired.Yaw : 0;
+}
 
-	if (flightStatus.Armed != FLIGHTSTATUS_ARMED_ARMED) {
-		control_scaling = 0;
-		thrust = 0;
-	}
+static void simsensors_scale_controls(float *rpy, float *thrust_out,
+		float max_thrust)
+{
+	const float ACTUATOR_ALPHA = 0.81f;
+
+	float actuator[3];
+
+	simsensors_get_controls(actuator, thrust_out);
+	*thrust_out *= max_thrust;
 
 	// In deg/s
-	rpy[0] = control_scaling * actuatorDesired.Roll * (1 - ACTUATOR_ALPHA) + rpy[0] * ACTUATOR_ALPHA;
-	rpy[1] = control_scaling * actuatorDesired.Pitch * (1 - ACTUATOR_ALPHA) + rpy[1] * ACTUATOR_ALPHA;
-	rpy[2] = control_scaling * actuatorDesired.Yaw * (1 - ACTUATOR_ALPHA) + rpy[2] * ACTUATOR_ALPHA;
+	rpy[0] = SIMMODEL_RATE_SCALE * actuator[0] * (1 - ACTUATOR_ALPHA) + rpy[0] * ACTUATOR_ALPHA;
+	rpy[1] = SIMMODEL_RATE_SCALE * actuator[1] * (1 - ACTUATOR_ALPHA) + rpy[1] * ACTUATOR_ALPHA;
+	rpy[2] = SIMMODEL_RATE_SCALE * actuator[2] * (1 - ACTUATOR_ALPHA) + rpy[2] * ACTUATOR_ALPHA;
 }
 
 static void simsensors_gyro_set(float *rpy, float noise_scale,
@@ -310,12 +333,17 @@ static void simsensors_gyro_set(float *rpy, float noise_scale,
 	assert(isfinite(rpy[1]));
 	assert(isfinite(rpy[2]));
 
+	float tone = sim_gyro_tone_amplitude * sinf(gyro_tone_phase);
+
+	gyro_tone_phase = fmodf(gyro_tone_phase +
+			2 * PI * sim_gyro_tone_hz / sens_rate, 2 * PI);
+
 	gyro_data = (struct pios_sensor_gyro_data) {
-		.x = rpy[0] + rand_gauss() * noise_scale +
+		.x = rpy[0] + rand_gauss() * noise_scale + tone +
 			(temperature - 20) * 1 + powf(temperature - 20,2) * 0.11,
-		.y = rpy[1] + rand_gauss() * noise_scale +
+		.y = rpy[1] + rand_gauss() * noise_scale + tone +
 			(temperature - 20) * 1 + powf(temperature - 20,2) * 0.11,
-		.z = rpy[2] + rand_gauss() * noise_scale +
+		.z = rpy[2] + rand_gauss() * noise_scale + tone +
 			(temperature - 20) * 1 + powf(temperature - 20,2) * 0.11,
 		.temperature = temperature,
 	};
@@ -694,72 +722,42 @@ static void simulateYasim()
 
 static void simulateModelQuadcopter()
 {
-	static double pos[3] = {0,0,0};
-	static double vel[3] = {0,0,0};
-	static double ned_accel[3] = {0,0,0};
-	static float q[4] = {1,0,0,0};
-	static float rpy[3] = {0,0,0}; // Low pass filtered actuator
+	struct simmodel_batch *vehicle = &quad_vehicle;
 	static float baro_offset = 0.0f;
 	float Rbe[3][3];
 
-	const float MAX_THRUST = GRAVITY * 2;
-	const float K_FRICTION = 1;
 	const float GPS_PERIOD = 0.1f;
 	const float MAG_PERIOD = 1.0 / 75.0;
 	const float BARO_PERIOD = 1.0 / 20.0;
 	const float GYRO_NOISE_SCALE = 1.0f;
 
 	float dT = 0.002;
-	float thrust;
+	float actuator[3];
 
-	simsensors_scale_controls(rpy, &thrust, MAX_THRUST);
-	simsensors_gyro_set(rpy, GYRO_NOISE_SCALE, 20);
-
-	// Predict the attitude forward in time
-	float qdot[4];
-	qdot[0] = (-q[1] * rpy[0] - q[2] * rpy[1] - q[3] * rpy[2]) * dT * DEG2RAD / 2;
-	qdot[1] = (q[0] * rpy[0] - q[3] * rpy[1] + q[2] * rpy[2]) * dT * DEG2RAD / 2;
-	qdot[2] = (q[3] * rpy[0] + q[0] * rpy[1] - q[1] * rpy[2]) * dT * DEG2RAD / 2;
-	qdot[3] = (-q[2] * rpy[0] + q[1] * rpy[1] + q[0] * rpy[2]) * dT * DEG2RAD / 2;
-
-	simsensors_quat_timestep(q, qdot);
+	simsensors_get_controls(actuator, &vehicle->thrust[0]);
+	vehicle->actuator[0][0] = actuator[0];
+	vehicle->actuator[1][0] = actuator[1];
+	vehicle->actuator[2][0] = actuator[2];
 
 	static float wind[3] = {0,0,0};
 	wind[0] = wind[0] * 0.95 + rand_gauss() / 10.0;
 	wind[1] = wind[1] * 0.95 + rand_gauss() / 10.0;
 	wind[2] = wind[2] * 0.95 + rand_gauss() / 10.0;
+	vehicle->wind[0][0] = wind[0];
+	vehicle->wind[1][0] = wind[1];
+	vehicle->wind[2][0] = wind[2];
 
-	Quaternion2R(q,Rbe);
-	// Make thrust negative as down is positive
-	ned_accel[0] = -thrust * Rbe[2][0];
-	ned_accel[1] = -thrust * Rbe[2][1];
-	// Gravity causes acceleration of 9.81 in the down direction
-	ned_accel[2] = -thrust * Rbe[2][2] + GRAVITY;
-
-	// Apply acceleration based on velocity
-	ned_accel[0] -= K_FRICTION * (vel[0] - wind[0]);
-	ned_accel[1] -= K_FRICTION * (vel[1] - wind[1]);
-	ned_accel[2] -= K_FRICTION * (vel[2] - wind[2]);
-
-	// Predict the velocity forward in time
-	vel[0] = vel[0] + ned_accel[0] * dT;
-	vel[1] = vel[1] + ned_accel[1] * dT;
-	vel[2] = vel[2] + ned_accel[2] * dT;
+	simmodel_step_quadcopter(vehicle, dT);
 
-	// Predict the position forward in time
-	pos[0] = pos[0] + vel[0] * dT;
-	pos[1] = pos[1] + vel[1] * dT;
-	pos[2] = pos[2] + vel[2] * dT;
+	float rpy[3] = { vehicle->rate[0][0], vehicle->rate[1][0], vehicle->rate[2][0] };
+	float q[4] = { vehicle->q[0][0], vehicle->q[1][0], vehicle->q[2][0], vehicle->q[3][0] };
+	float pos[3] = { vehicle->pos[0][0], vehicle->pos[1][0], vehicle->pos[2][0] };
+	float vel[3] = { vehicle->vel[0][0], vehicle->vel[1][0], vehicle->vel[2][0] };
+	double ned_accel[3] = { vehicle->accel[0][0], vehicle->accel[1][0], vehicle->accel[2][0] };
 
-	// Simulate hitting ground
-	if(pos[2] > 0) {
-		pos[2] = 0;
-		vel[2] = 0;
-		ned_accel[2] = 0;
-	}
+	simsensors_gyro_set(rpy, GYRO_NOISE_SCALE, 20);
 
-	// Sensor feels gravity (when not acceleration in ned frame e.g. ned_accel[2] = 0)
-	ned_accel[2] -= GRAVITY;
+	Quaternion2R(q,Rbe);
 
 	simsensors_accels_setfromned(ned_accel, &Rbe, accel_bias, 30);
 
@@ -865,71 +863,53 @@ static void simulateModelQuadcopter()
  */
 static void simulateModelAirplane()
 {
-	static double pos[3] = {0,0,0};
-	static double vel[3] = {0,0,0};
-	static double ned_accel[3] = {0,0,0};
-	static float q[4] = {1,0,0,0};
-	static float rpy[3] = {0,0,0}; // Low pass filtered actuator
+	struct simmodel_batch *vehicle = &plane_vehicle;
 	static float baro_offset = 0.0f;
 	float Rbe[3][3];
 
-	const float LIFT_SPEED = 8; // (m/s) where achieve lift for zero pitch
-	const float MAX_THRUST = 9.81 * 2;
-	const float K_FRICTION = 0.2;
 	const float GPS_PERIOD = 0.1;
 	const float MAG_PERIOD = 1.0 / 75.0;
 	const float BARO_PERIOD = 1.0 / 20.0;
-	const float ROLL_HEADING_COUPLING = 0.1; // (deg/s) heading change per deg of roll
-	const float PITCH_THRUST_COUPLING = 0.2; // (m/s^2) of forward acceleration per deg of pitch
 	const float GYRO_NOISE_SCALE = 1.0f;
 
 	float dT = 0.002;
-	float thrust;
+	float actuator[3];
 
 	/**** 1. Update attitude ****/
 	// Need to get roll angle for easy cross coupling
 	// TODO: Uses the FC's idea of attitude for cross coupling.
 	AttitudeActualData attitudeActual;
 	AttitudeActualGet(&attitudeActual);
-	double roll = attitudeActual.Roll;
-	double pitch = attitudeActual.Pitch;
+	vehicle->attitude[0][0] = attitudeActual.Roll;
+	vehicle->attitude[1][0] = attitudeActual.Pitch;
 
-	simsensors_scale_controls(rpy, &thrust, MAX_THRUST);
-	rpy[2] += roll * ROLL_HEADING_COUPLING;
+	simsensors_get_controls(actuator, &vehicle->thrust[0]);
+	vehicle->actuator[0][0] = actuator[0];
+	vehicle->actuator[1][0] = actuator[1];
+	vehicle->actuator[2][0] = actuator[2];
 
-	simsensors_gyro_set(rpy, GYRO_NOISE_SCALE, 20);
+	/**** 2. Update position based on velocity, in still air ****/
+	simmodel_step_airplane(vehicle, dT);
 
-	// Predict the attitude forward in time
-	float qdot[4];
-	qdot[0] = (-q[1] * rpy[0] - q[2] * rpy[1] - q[3] * rpy[2]) * dT * DEG2RAD / 2;
-	qdot[1] = (q[0] * rpy[0] - q[3] * rpy[1] + q[2] * rpy[2]) * dT * DEG2RAD / 2;
-	qdot[2] = (q[3] * rpy[0] + q[0] * rpy[1] - q[1] * rpy[2]) * dT * DEG2RAD / 2;
-	qdot[3] = (-q[2] * rpy[0] + q[1] * rpy[1] + q[0] * rpy[2]) * dT * DEG2RAD / 2;
+	float rpy[3] = { vehicle->rate[0][0], vehicle->rate[1][0], vehicle->rate[2][0] };
+	float q[4] = { vehicle->q[0][0], vehicle->q[1][0], vehicle->q[2][0], vehicle->q[3][0] };
+	float pos[3] = { vehicle->pos[0][0], vehicle->pos[1][0], vehicle->pos[2][0] };
+	float vel[3] = { vehicle->vel[0][0], vehicle->vel[1][0], vehicle->vel[2][0] };
+	double ned_accel[3] = { vehicle->accel[0][0], vehicle->accel[1][0], vehicle->accel[2][0] };
+	float forwardAirspeed = vehicle->airspeed[0][0];
 
-	simsensors_quat_timestep(q, qdot);
+	assert(isfinite(forwardAirspeed));
+	assert(isfinite(vel[0]));
+	assert(isfinite(vel[1]));
+	assert(isfinite(vel[2]));
+	assert(isfinite(pos[0]));
+	assert(isfinite(pos[1]));
+	assert(isfinite(pos[2]));
 
-	/**** 2. Update position based on velocity ****/
-	static float wind[3] = {0,0,0};
-	wind[0] = wind[0] * 0.95 + rand_gauss() / 10.0;
-	wind[1] = wind[1] * 0.95 + rand_gauss() / 10.0;
-	wind[2] = wind[2] * 0.95 + rand_gauss() / 10.0;
-	wind[0] = 0;
-	wind[1] = 0;
-	wind[2] = 0;
+	simsensors_gyro_set(rpy, GYRO_NOISE_SCALE, 20);
 
-	// Rbe takes a vector from body to earth.  If we take (1,0,0)^T through this and then dot with airspeed
-	// we get forward airspeed
 	Quaternion2R(q,Rbe);
 
-	double airspeed[3] = {vel[0] - wind[0], vel[1] - wind[1], vel[2] - wind[2]};
-	double forwardAirspeed = Rbe[0][0] * airspeed[0] + Rbe[0][1] * airspeed[1] + Rbe[0][2] * airspeed[2];
-	double sidewaysAirspeed = Rbe[1][0] * airspeed[0] + Rbe[1][1] * airspeed[1] + Rbe[1][2] * airspeed[2];
-	double downwardAirspeed = Rbe[2][0] * airspeed[0] + Rbe[2][1] * airspeed[1] + Rbe[2][2] * airspeed[2];
-
-	assert(isfinite(forwardAirspeed));
-	assert(isfinite(sidewaysAirspeed));
-	assert(isfinite(downwardAirspeed));
-
 	AirspeedActualData airspeedObj;
 	airspeedObj.CalibratedAirspeed = forwardAirspeed;
 	// TODO: Factor in temp and pressure when simulated for true airspeed.
@@ -938,54 +918,6 @@ static void simulateModelAirplane()
 	airspeedObj.TrueAirspeed = forwardAirspeed;
 	AirspeedActualSet(&airspeedObj);
 
-	/* Compute aerodynamic forces in body referenced frame.  Later use more sophisticated equations  */
-	/* TODO: This should become more accurate.  Use the force equations to calculate lift from the   */
-	/* various surfaces based on AoA and airspeed.  From that compute torques and forces.  For later */
-	double forces[3]; // X, Y, Z
-	forces[0] = thrust - pitch * PITCH_THRUST_COUPLING - forwardAirspeed * K_FRICTION;         // Friction is applied in all directions in NED
-	forces[1] = 0 - sidewaysAirspeed * K_FRICTION * 100;      // No side slip
-	forces[2] = GRAVITY * (forwardAirspeed - LIFT_SPEED) + downwardAirspeed * K_FRICTION * 100;    // Stupidly simple, always have gravity lift when straight and level
-
-	// Negate force[2] as NED defines down as possitive, aircraft convention is Z up is positive (?)
-	ned_accel[0] = forces[0] * Rbe[0][0] + forces[1] * Rbe[1][0] - forces[2] * Rbe[2][0];
-	ned_accel[1] = forces[0] * Rbe[0][1] + forces[1] * Rbe[1][1] - forces[2] * Rbe[2][1];
-	ned_accel[2] = forces[0] * Rbe[0][2] + forces[1] * Rbe[1][2] - forces[2] * Rbe[2][2];
-	// Gravity causes acceleration of 9.81 in the down direction
-	ned_accel[2] += 9.81;
-
-	// Apply acceleration based on velocity
-	ned_accel[0] -= K_FRICTION * (vel[0] - wind[0]);
-	ned_accel[1] -= K_FRICTION * (vel[1] - wind[1]);
-	ned_accel[2] -= K_FRICTION * (vel[2] - wind[2]);
-
-	// Predict the velocity forward in time
-	vel[0] = vel[0] + ned_accel[0] * dT;
-	vel[1] = vel[1] + ned_accel[1] * dT;
-	vel[2] = vel[2] + ned_accel[2] * dT;
-
-	assert(isfinite(vel[0]));
-	assert(isfinite(vel[1]));
-	assert(isfinite(vel[2]));
-
-	// Predict the position forward in time
-	pos[0] = pos[0] + vel[0] * dT;
-	pos[1] = pos[1] + vel[1] * dT;
-	pos[2] = pos[2] + vel[2] * dT;
-
-	assert(isfinite(pos[0]));
-	assert(isfinite(pos[1]));
-	assert(isfinite(pos[2]));
-
-	// Simulate hitting ground
-	if(pos[2] > 0) {
-		pos[2] = 0;
-		vel[2] = 0;
-		ned_accel[2] = 0;
-	}
-
-	// Sensor feels gravity (when not acceleration in ned frame e.g. ned_accel[2] = 0)
-	ned_accel[2] -= GRAVITY;
-
 	simsensors_accels_setfromned(ned_accel, &Rbe, accel_bias, 30);
 
 	simsensors_baro_drift(&baro_offset);
@@ -827,14 +827,19 @@ static void updateSystemAlarms()
 		AlarmsClear(SYSTEMALARMS_ALARM_EVENTSYSTEM);
 	}
 
+	SystemStatsData sysStats;
+	SystemStatsGet(&sysStats);
+
 	if (objStats.lastCallbackErrorID || objStats.lastQueueErrorID || evStats.lastErrorID) {
-		SystemStatsData sysStats;
-		SystemStatsGet(&sysStats);
 		sysStats.EventSystemWarningID = evStats.lastErrorID;
 		sysStats.ObjectManagerCallbackID = objStats.lastCallbackErrorID;
 		sysStats.ObjectManagerQueueID = objStats.lastQueueErrorID;
-		SystemStatsSet(&sysStats);
 	}
+
+	sysStats.ObjectManagerEventBacklog = objStats.eventBacklogMax;
+	sysStats.ObjectManagerDeferredBacklog = objStats.deferredBacklogMax;
+	sysStats.ObjectManagerDeferredLatency = objStats.deferredLatencyMax;
+	SystemStatsSet(&sysStats);
 #endif
 }
 
@@ -57,6 +57,27 @@
 #define TELEM_STACK_SIZE 624
 #endif
 
+#ifndef TELEM_AGGREGATION_MTU
+/* Largest aggregate frame.  Boards behind radios with smaller packets can
+ * shrink this so a frame is not split across radio packets.
+ */
+#define TELEM_AGGREGATION_MTU 256
+#endif
+
+#ifndef TELEM_DELTA_SLOTS
+/* Objects whose last sent copy is kept to send deltas against.  Each one
+ * costs the size of the largest object in RAM.
+ */
+#define TELEM_DELTA_SLOTS 8
+#endif
+
+#ifndef TELEM_LINK_RESERVE_PERCENT
+/* Share of a limited link kept free of periodic updates, so acked writes,
+ * object requests and on-change updates get through promptly.
+ */
+#define TELEM_LINK_RESERVE_PERCENT 25
+#endif
+
 // Private constants
 #define MAX_QUEUE_SIZE   TELEM_QUEUE_SIZE
 #define STACK_SIZE_BYTES TELEM_STACK_SIZE
@@ -72,8 +93,26 @@
 #define MAX_REQS_PENDING 5
 #define ACK_TIMEOUT_MS 250
 
+/* Rated updates at least this far apart are status, and keep their rate
+ * ahead of faster streams when the link is short.
+ */
+#define STATUS_PERIOD_MS 1000
+/* However short the link, rated updates are not stretched further apart */
+#define MAX_SCALED_PERIOD_MS 10000
+/* Sync, type, length, object ID and CRC around each object */
+#define FRAME_OVERHEAD_BYTES 9
+
 // Private types
 
+/* Classes of periodic and throttled ("rated") updates, in the order they
+ * are given link budget.
+ */
+enum rate_class {
+	RATE_CLASS_STATUS = 0,
+	RATE_CLASS_STREAMS,
+	RATE_CLASS_NUM
+};
+
 // Private variables
 
 struct pending_ack {
@@ -105,6 +144,17 @@ struct telemetry_state {
 	struct pios_semaphore *access_sem;
 	volatile bool request_inhibit, tx_inhibited, rx_inhibited;
 
+	volatile bool settings_updated;
+	bool aggregation_enabled;
+	bool aggregate_pending;
+	bool delta_enabled;
+
+	volatile bool schedule_updated;
+	uint32_t link_rate;	/* bytes/s, 0 if unlimited */
+	float requested_rate[RATE_CLASS_NUM];	/* bytes/s */
+	float rate_scale[RATE_CLASS_NUM];
+	bool rate_rescaled[RATE_CLASS_NUM];
+
 	UAVTalkConnection uavTalkCon;
 };
 
@@ -128,6 +178,11 @@ static void processObjEvent(telem_t telem, UAVObjEvent * ev);
 static void updateTelemetryStats(telem_t telem);
 static void gcsTelemetryStatsUpdated();
 static void updateSettings();
+static void updateAggregation(telem_t telem);
+static void updateDeltaFrames(telem_t telem);
+static uint32_t getLinkRate(uintptr_t port);
+static void updateSchedule(telem_t telem);
+static uint32_t scaledPeriod(telem_t telem, uint32_t periodMs);
 static uintptr_t getComPort();
 static void update_object_instances(uint32_t obj_id, uint32_t inst_id);
 static bool processUsbActivity(bool seen_active);
@@ -139,6 +194,9 @@ static void registerObjectShim(UAVObjHandle obj) {
 	registerObject(&telem_state, obj);
 }
 
+static void accountObjectShim(UAVObjHandle obj);
+static void rescheduleObjectShim(UAVObjHandle obj);
+
 /**
  * Initialise the telemetry module
  * \return -1 if initialisation failed
@@ -158,6 +216,10 @@ int32_t TelemetryStart(void)
 	// Listen to objects of interest
 	GCSTelemetryStatsConnectQueue(telem_state.queue);
 
+	telem_state.settings_updated = true;
+	ModuleSettingsConnectCallbackCtx(UAVObjCbSetFlag,
+			&telem_state.settings_updated);
+
 	struct pios_thread *telemetryTxTaskHandle;
 	struct pios_thread *telemetryRxTaskHandle;
 
@@ -194,6 +256,10 @@ int32_t TelemetryInitialize(void)
 	// Initialize vars
 	telem_state.time_of_last_update = 0;
 
+	for (int i = 0; i < RATE_CLASS_NUM; i++) {
+		telem_state.rate_scale[i] = 1.0f;
+	}
+
 	// Create object queues
 	telem_state.queue = PIOS_Queue_Create(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
 
@@ -269,7 +335,8 @@ static void updateObject(telem_t telem, UAVObjHandle obj, int32_t eventType)
 	switch (updateMode) {
 	case UPDATEMODE_PERIODIC:
 		// Set update period
-		setUpdatePeriod(telem, obj, metadata.telemetryUpdatePeriod);
+		setUpdatePeriod(telem, obj,
+				scaledPeriod(telem, metadata.telemetryUpdatePeriod));
 
 		// Connect queue
 		eventMask = EV_UPDATED_PERIODIC | EV_UPDATED_MANUAL;
@@ -288,7 +355,7 @@ static void updateObject(telem_t telem, UAVObjHandle obj, int32_t eventType)
 
 		eventMask = EV_UPDATED | EV_UPDATED_MANUAL;
 		UAVObjConnectQueueThrottled(obj, telem->queue, eventMask,
-				metadata.telemetryUpdatePeriod);
+				scaledPeriod(telem, metadata.telemetryUpdatePeriod));
 		break;
 	case UPDATEMODE_MANUAL:
 		// Set update period
@@ -508,6 +575,15 @@ static void reqCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
 
 	// Unlock, to ensure new requests can come in OK.
 	PIOS_Mutex_Unlock(telem->reqack_mutex);
+
+	/* Wake the transmit task to answer it now, rather than when its
+	 * queue wait times out */
+	UAVObjEvent ev = {
+		.obj = NULL,
+		.event = EV_UPDATED_MANUAL,
+	};
+
+	PIOS_Queue_Send(telem->queue, &ev, 0);
 }
 
 /**
@@ -556,7 +632,11 @@ static void ackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
 static void processObjEvent(telem_t telem, UAVObjEvent * ev)
 {
 	if (ev->obj == 0) {
-		updateTelemetryStats(telem);
+		/* Either the periodic stats update, or a wakeup for a
+		 * request, which has been answered already */
+		if (ev->event == EV_NONE) {
+			updateTelemetryStats(telem);
+		}
 	} else if (ev->obj == GCSTelemetryStatsHandle()) {
 		gcsTelemetryStatsUpdated(telem);
 	} else {
@@ -578,9 +658,19 @@ static void processObjEvent(telem_t telem, UAVObjEvent * ev)
 				addAckPending(telem, ev->obj, ev->instId);
 			}
 
-			success = UAVTalkSendObject(telem->uavTalkCon,
-					ev->obj, ev->instId,
-					acked);
+			if (!acked && telem->aggregation_enabled) {
+				/* Goes out when the queue runs dry or the
+				 * frame fills up */
+				success = UAVTalkAggregateObject(
+						telem->uavTalkCon,
+						ev->obj, ev->instId);
+
+				telem->aggregate_pending = true;
+			} else {
+				success = UAVTalkSendObject(telem->uavTalkCon,
+						ev->obj, ev->instId,
+						acked);
+			}
 
 			if (success == -1) {
 				telem->tx_errors++;
@@ -594,6 +684,9 @@ static void processObjEvent(telem_t telem, UAVObjEvent * ev)
 			// metadata are for
 			updateObject(telem, UAVObjGetLinkedObj(ev->obj),
 					EV_NONE);
+
+			// Its share of the link may have changed
+			telem->schedule_updated = true;
 		}
 	}
 
@@ -677,8 +770,36 @@ static void telemetryTxTask(void *parameters)
 
 		telem->tx_inhibited = false;
 
-		// Wait for queue message or short timeout
-		retval = PIOS_Queue_Receive(telem->queue, &ev, 10);
+		if (telem->settings_updated) {
+			telem->settings_updated = false;
+
+			updateAggregation(telem);
+			updateDeltaFrames(telem);
+
+			telem->schedule_updated = true;
+		}
+
+		/* Wait for queue message or short timeout.  Updates held
+		 * for aggregation go out as soon as the queue is empty.
+		 */
+		retval = PIOS_Queue_Receive(telem->queue, &ev,
+				telem->aggregate_pending ? 0 : 10);
+
+		if (!retval && telem->aggregate_pending) {
+			telem->aggregate_pending = false;
+
+			if (UAVTalkFlushAggregate(telem->uavTalkCon)) {
+				telem->tx_errors++;
+			}
+		}
+
+		/* Replan once a burst of metadata changes has been
+		 * taken off the queue */
+		if (!retval && telem->schedule_updated) {
+			telem->schedule_updated = false;
+
+			updateSchedule(telem);
+		}
 
 		PIOS_Mutex_Lock(telem->reqack_mutex,
 				PIOS_MUTEX_TIMEOUT_MAX);
@@ -708,18 +829,21 @@ static void telemetryRxTask(void *parameters)
 		uintptr_t inputPort = getComPort();
 
 		if (inputPort && (!telem->request_inhibit)) {
-			// Block until data are available
-			uint8_t serial_data[16];
+			// Block until data are available, then parse them
+			// straight out of the port buffer
+			const uint8_t *serial_data;
 			uint16_t bytes_to_process;
 
 			telem->rx_inhibited = false;
 
-			bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort,
-					serial_data, sizeof(serial_data), 100);
+			bytes_to_process = PIOS_COM_ReceivePeek(inputPort,
+					&serial_data, 100);
 
 			if (bytes_to_process > 0) {
 				UAVTalkProcessInputStream(telem->uavTalkCon,
 						serial_data, bytes_to_process);
+				PIOS_COM_ReceiveRelease(inputPort,
+						bytes_to_process);
 
 #if defined(PIOS_COM_TELEM_USB)
 				if (inputPort == PIOS_COM_TELEM_USB) {
@@ -832,6 +956,23 @@ static void updateTelemetryStats(telem_t telem)
 		telem->tx_retries = 0;
 	}
 
+	flightStats.TxDataRateRequested = 0;
+	for (int i = 0; i < RATE_CLASS_NUM; i++) {
+		flightStats.TxDataRateRequested += telem->requested_rate[i];
+	}
+
+	flightStats.TxDataRateBudget = telem->link_rate *
+		(100 - TELEM_LINK_RESERVE_PERCENT) / 100.0f;
+	flightStats.TxRateScale[FLIGHTTELEMETRYSTATS_TXRATESCALE_STATUS] =
+		telem->rate_scale[RATE_CLASS_STATUS] * 100.0f + 0.5f;
+	flightStats.TxRateScale[FLIGHTTELEMETRYSTATS_TXRATESCALE_STREAMS] =
+		telem->rate_scale[RATE_CLASS_STREAMS] * 100.0f + 0.5f;
+
+	// Follow the link moving between USB and serial
+	if (getLinkRate(getComPort()) != telem->link_rate) {
+		telem->schedule_updated = true;
+	}
+
 	// Check for connection timeout
 	timeNow = PIOS_Thread_Systime();
 	if (utalkStats.rxObjects > 0) {
@@ -899,6 +1040,221 @@ static void updateSettings()
 	}
 }
 
+/**
+ * Enable or disable aggregate frames to follow ModuleSettings.
+ */
+static void updateAggregation(telem_t telem)
+{
+	uint8_t aggregation;
+	ModuleSettingsTelemetryAggregationGet(&aggregation);
+
+	bool enable = aggregation == MODULESETTINGS_TELEMETRYAGGREGATION_ENABLED;
+
+	if (enable == telem->aggregation_enabled) {
+		return;
+	}
+
+	if (UAVTalkSetAggregation(telem->uavTalkCon,
+				enable ? TELEM_AGGREGATION_MTU : 0) == 0) {
+		telem->aggregation_enabled = enable;
+	}
+}
+
+/**
+ * Enable or disable delta frames to follow ModuleSettings.
+ */
+static void updateDeltaFrames(telem_t telem)
+{
+	uint8_t delta;
+	ModuleSettingsTelemetryDeltaFramesGet(&delta);
+
+	bool enable = delta == MODULESETTINGS_TELEMETRYDELTAFRAMES_ENABLED;
+
+	if (enable == telem->delta_enabled) {
+		return;
+	}
+
+	if (UAVTalkSetDeltaEncoding(telem->uavTalkCon,
+				enable ? TELEM_DELTA_SLOTS : 0) == 0) {
+		telem->delta_enabled = enable;
+	}
+}
+
+/**
+ * Bytes per second the telemetry link carries.  Only the serial telemetry
+ * port is limited; USB is always left to run as fast as it can.
+ * \param[in] port The port telemetry is using
+ * \return The rate, or 0 if unlimited
+ */
+static uint32_t getLinkRate(uintptr_t port)
+{
+	if (!port || port != PIOS_COM_TELEM_SER) {
+		return 0;
+	}
+
+	uint32_t bps;
+	ModuleSettingsTelemetryLinkRateGet(&bps);
+
+	if (!bps) {
+		uint8_t speed;
+		ModuleSettingsTelemetrySpeedGet(&speed);
+
+		switch (speed) {
+		case MODULESETTINGS_TELEMETRYSPEED_9600:
+			bps = 9600;
+			break;
+		case MODULESETTINGS_TELEMETRYSPEED_19200:
+			bps = 19200;
+			break;
+		case MODULESETTINGS_TELEMETRYSPEED_38400:
+			bps = 38400;
+			break;
+		case MODULESETTINGS_TELEMETRYSPEED_57600:
+			bps = 57600;
+			break;
+		case MODULESETTINGS_TELEMETRYSPEED_230400:
+			bps = 230400;
+			break;
+		default:
+			/* The bluetooth setups all end up at 115200 */
+			bps = 115200;
+			break;
+		}
+	}
+
+	// A start and stop bit around every byte
+	return bps / 10;
+}
+
+/**
+ * Class and byte rate asked for by an object's rated updates.
+ * \return false if the object has no rated updates
+ */
+static bool getRequestedRate(UAVObjHandle obj, enum rate_class *rate_class,
+		float *rate)
+{
+	if (UAVObjIsMetaobject(obj)) {
+		return false;
+	}
+
+	UAVObjMetadata metadata;
+	UAVObjGetMetadata(obj, &metadata);
+
+	switch (UAVObjGetTelemetryUpdateMode(&metadata)) {
+	case UPDATEMODE_PERIODIC:
+	case UPDATEMODE_THROTTLED:
+		break;
+	default:
+		return false;
+	}
+
+	uint32_t period = metadata.telemetryUpdatePeriod;
+
+	if (!period) {
+		return false;
+	}
+
+	uint32_t bytes = UAVObjGetNumBytes(obj) + FRAME_OVERHEAD_BYTES;
+
+	if (!UAVObjIsSingleInstance(obj)) {
+		bytes += 2;
+	}
+
+	*rate_class = (period >= STATUS_PERIOD_MS) ?
+		RATE_CLASS_STATUS : RATE_CLASS_STREAMS;
+	*rate = bytes * UAVObjGetNumInstances(obj) * 1000.0f / period;
+
+	return true;
+}
+
+static void accountObjectShim(UAVObjHandle obj)
+{
+	enum rate_class rate_class;
+	float rate;
+
+	if (getRequestedRate(obj, &rate_class, &rate)) {
+		telem_state.requested_rate[rate_class] += rate;
+	}
+}
+
+static void rescheduleObjectShim(UAVObjHandle obj)
+{
+	enum rate_class rate_class;
+	float rate;
+
+	/* Leave the rest alone; setting a period restarts its timer */
+	if (getRequestedRate(obj, &rate_class, &rate) &&
+			telem_state.rate_rescaled[rate_class]) {
+		updateObject(&telem_state, obj, EV_NONE);
+	}
+}
+
+/**
+ * Share the link between the rated updates.  Each class in turn gets what
+ * it asks for while budget remains; the first that does not fit has all its
+ * periods stretched evenly to use the rest, and later classes are slowed as
+ * far as they go.
+ */
+static void updateSchedule(telem_t telem)
+{
+	telem->link_rate = getLinkRate(getComPort());
+
+	for (int i = 0; i < RATE_CLASS_NUM; i++) {
+		telem->requested_rate[i] = 0;
+	}
+
+	UAVObjIterate(&accountObjectShim);
+
+	float budget = telem->link_rate *
+		(100 - TELEM_LINK_RESERVE_PERCENT) / 100.0f;
+
+	for (int i = 0; i < RATE_CLASS_NUM; i++) {
+		float requested = telem->requested_rate[i];
+		float scale = 1.0f;
+
+		if (!telem->link_rate || requested <= budget) {
+			budget -= requested;
+		} else {
+			scale = budget / requested;
+			budget = 0;
+		}
+
+		telem->rate_rescaled[i] = scale != telem->rate_scale[i];
+		telem->rate_scale[i] = scale;
+	}
+
+	UAVObjIterate(&rescheduleObjectShim);
+}
+
+/**
+ * Period to use for a rated update, after the link has been shared out.
+ */
+static uint32_t scaledPeriod(telem_t telem, uint32_t periodMs)
+{
+	if (!periodMs) {
+		return 0;
+	}
+
+	enum rate_class rate_class = (periodMs >= STATUS_PERIOD_MS) ?
+		RATE_CLASS_STATUS : RATE_CLASS_STREAMS;
+
+	float scale = telem->rate_scale[rate_class];
+
+	if (scale >= 1.0f) {
+		return periodMs;
+	}
+
+	if (periodMs >= MAX_SCALED_PERIOD_MS) {
+		return periodMs;
+	}
+
+	if (scale * MAX_SCALED_PERIOD_MS <= periodMs) {
+		return MAX_SCALED_PERIOD_MS;
+	}
+
+	return periodMs / scale;
+}
+
 #if defined(PIOS_COM_TELEM_USB)
 /**
  * Updates the USB activity timer, and returns whether we should use USB this
@@ -29,14 +29,20 @@
 
 /**
  * Input objects: @ref Accels, @ref VibrationAnalysisSettings
- * Output object: @ref VibrationAnalysisOutput
+ * Output object: @ref VibrationAnalysisSpectrum, @ref VibrationAnalysisOutput
  *
  * This module executes on a timer trigger. When the module is
  * triggered it will update the data of VibrationAnalysiOutput,
  * with the accumulated accelerometer samples. 
+ *
+ * With the Spectrum output the samples are instead transformed here, a
+ * window at a time, and the averaged magnitude spectrum and its peaks are
+ * sent in VibrationAnalysisSpectrum.  That is half as many values per window
+ * as the samples, divided again by the number of windows averaged.
  */
 
 #include "openpilot.h"
+#include "misc_math.h"
 #include "physical_constants.h"
 #include "pios_thread.h"
 #include "pios_queue.h"
@@ -45,6 +51,9 @@
 #include "modulesettings.h"
 #include "vibrationanalysisoutput.h"
 #include "vibrationanalysissettings.h"
+#include "vibrationanalysisspectrum.h"
+
+#include "fft.h"
 
 
 // Private constants
@@ -67,6 +76,8 @@
 
 #define MAX_WINDOW_SIZE 1024
 
+#define SPECTRUM_FIRST_PEAK_BIN 2    // Skip what the Hann window leaves of the DC bias
+
 // Comment for larger smaller buffers and much better accuracy. The maximum window size will be allocated.
 #define USE_SINGLE_INSTANCE_BUFFERS 1
 
@@ -96,11 +107,25 @@ static struct VibrationAnalysis_data {
 	int16_t *accel_buffer_x;
 	int16_t *accel_buffer_y;
 	int16_t *accel_buffer_z;
+	uint16_t buffers_capacity;
+
+	// Onboard spectrum, allocated for the largest window used so far
+	uint8_t output;
+	uint8_t averages_count;
+	uint16_t chunks_pending;     // Instances of the last spectrum still to send
+	rfft_t fft;
+	float *fft_buffer;
+	float *spectrum;             // window_size/2 bins for each axis
+	uint16_t spectrum_capacity;  // Largest window the above can hold
+	float peak_frequency[3];
 } *vtd;
 
 
 // Private functions
 static void VibrationAnalysisTask(void *parameters);
+static void VibrationAnalysisAccumulateSpectrum(void);
+static void VibrationAnalysisFinishSpectrum(float sample_rate);
+static void VibrationAnalysisSendSpectrum(void);
 
 /*
 *   Releases any memory dinamically allocated
@@ -193,9 +218,44 @@ static int32_t VibrationAnalysisStart(void)
             break;
     }
 
-    // Is the new window size different?
-    // Will happen upon initialization and when the window size changes
-    if (window_size != vtd->window_size) {
+    uint8_t output;
+    VibrationAnalysisSettingsOutputGet(&output);
+
+    uint8_t testing;
+    VibrationAnalysisSettingsTestingStatusGet(&testing);
+
+    // Buffers are sized for the window of the first analysis run, so don't
+    // size them at boot for a window that may never be used
+    if (taskHandle == NULL && testing == VIBRATIONANALYSISSETTINGS_TESTINGSTATUS_OFF) {
+        output = vtd->output;
+        window_size = vtd->window_size;
+    }
+
+    // The spectrum buffers can't be given back to grow, so they stay the
+    // size of the first window used and a larger one takes a reboot.
+    // Put the window in use back into the settings so it shows.
+    if (output == VIBRATIONANALYSISSETTINGS_OUTPUT_SPECTRUM &&
+            vtd->spectrum_capacity && window_size > vtd->spectrum_capacity) {
+        window_size = vtd->spectrum_capacity;
+
+        switch (window_size) {
+            case 16:
+                window_size_enum = VIBRATIONANALYSISSETTINGS_FFTWINDOWSIZE_16;
+                break;
+            case 64:
+                window_size_enum = VIBRATIONANALYSISSETTINGS_FFTWINDOWSIZE_64;
+                break;
+            default:
+                window_size_enum = VIBRATIONANALYSISSETTINGS_FFTWINDOWSIZE_256;
+                break;
+        }
+
+        VibrationAnalysisSettingsFFTWindowSizeSet(&window_size_enum);
+    }
+
+    // Is the new window size or output different?
+    // Will happen upon initialization and when the settings change
+    if (window_size != vtd->window_size || output != vtd->output) {
 
         instances = window_size / VIBRATION_ELEMENTS_COUNT;
 
@@ -220,15 +280,45 @@ static int32_t VibrationAnalysisStart(void)
         }
 #endif
 
-#ifdef PIOS_FREE_IMPLEMENTED        
-        // Delete existing buffers
-        if (vtd->accel_buffer_x != NULL)
-            PIOS_free(vtd->accel_buffer_x);
-        if (vtd->accel_buffer_y != NULL)
-            PIOS_free(vtd->accel_buffer_y);
-        if (vtd->accel_buffer_z != NULL)
-            PIOS_free(vtd->accel_buffer_z);
+        // The spectrum is computed from a whole window of samples
+        uint16_t buffers_size;
+        if (output == VIBRATIONANALYSISSETTINGS_OUTPUT_SPECTRUM) {
+            buffers_size = window_size;
+        } else {
+#ifdef USE_SINGLE_INSTANCE_BUFFERS
+            buffers_size = VIBRATION_ELEMENTS_COUNT;
+#elif defined(PIOS_FREE_IMPLEMENTED)
+            buffers_size = window_size;
+#else
+            buffers_size = MAX_WINDOW_SIZE;
+#endif
+        }
+
+        // Keep buffers that are big enough, the memory can't be given back
+        int16_t *accel_buffer_x = vtd->accel_buffer_x;
+        int16_t *accel_buffer_y = vtd->accel_buffer_y;
+        int16_t *accel_buffer_z = vtd->accel_buffer_z;
+        uint16_t buffers_capacity = vtd->buffers_capacity;
+        rfft_t fft = vtd->fft;
+        float *fft_buffer = vtd->fft_buffer;
+        float *spectrum = vtd->spectrum;
+        uint16_t spectrum_capacity = vtd->spectrum_capacity;
+
+        if (buffers_capacity < buffers_size) {
+#ifdef PIOS_FREE_IMPLEMENTED
+            // Delete existing buffers
+            if (accel_buffer_x != NULL)
+                PIOS_free(accel_buffer_x);
+            if (accel_buffer_y != NULL)
+                PIOS_free(accel_buffer_y);
+            if (accel_buffer_z != NULL)
+                PIOS_free(accel_buffer_z);
 #endif
+            accel_buffer_x = NULL;
+            accel_buffer_y = NULL;
+            accel_buffer_z = NULL;
+            buffers_capacity = 0;
+        }
 
         // Clear buffers
         memset(vtd, 0, sizeof(struct VibrationAnalysis_data));
@@ -237,20 +327,17 @@ static int32_t VibrationAnalysisStart(void)
         // Now place the window size into the buffer
         vtd->window_size = window_size;
         vtd->instances = instances;
-        
-#ifdef USE_SINGLE_INSTANCE_BUFFERS
-        vtd->buffers_size = VIBRATION_ELEMENTS_COUNT; 
-#else
-
-    #ifdef PIOS_FREE_IMPLEMENTED        
-        vtd->buffers_size = window_size;
-    #else
-        vtd->buffers_size = MAX_WINDOW_SIZE; 
-
-    #endif
-
-#endif
-
+        vtd->output = output;
+        vtd->buffers_size = buffers_size;
+
+        vtd->accel_buffer_x = accel_buffer_x;
+        vtd->accel_buffer_y = accel_buffer_y;
+        vtd->accel_buffer_z = accel_buffer_z;
+        vtd->buffers_capacity = buffers_capacity;
+        vtd->fft = fft;
+        vtd->fft_buffer = fft_buffer;
+        vtd->spectrum = spectrum;
+        vtd->spectrum_capacity = spectrum_capacity;
 
         //Create new buffers if needed.
         if (vtd->accel_buffer_x == NULL) {
@@ -282,6 +369,29 @@ static int32_t VibrationAnalysisStart(void)
                 return -1;
             }
         }
+
+        vtd->buffers_capacity = MAX(vtd->buffers_capacity, vtd->buffers_size);
+
+        // The transform, its input and the spectrum are allocated once
+        // and serve any window up to that size
+        if (output == VIBRATIONANALYSISSETTINGS_OUTPUT_SPECTRUM) {
+            if (vtd->fft == NULL) {
+                vtd->fft = rfft_create(window_size);
+                vtd->fft_buffer = (float *) PIOS_malloc(window_size * sizeof(float));
+                vtd->spectrum = (float *) PIOS_malloc(3 * (window_size / 2) * sizeof(float));
+                vtd->spectrum_capacity = window_size;
+            }
+
+            if (vtd->fft == NULL || vtd->fft_buffer == NULL || vtd->spectrum == NULL ||
+                    rfft_set_size(vtd->fft, window_size) != 0) {
+                VibrationAnalysisCleanup();
+
+                module_enabled = false;
+                return -1;
+            }
+
+            memset(vtd->spectrum, 0, 3 * (window_size / 2) * sizeof(float));
+        }
     }
     
     // Start main task
@@ -320,7 +430,8 @@ static int32_t VibrationAnalysisInitialize(void)
 		return -1;
 
 	// Initialize UAVOs
-	if (VibrationAnalysisSettingsInitialize() == -1 || VibrationAnalysisOutputInitialize() == -1) {
+	if (VibrationAnalysisSettingsInitialize() == -1 || VibrationAnalysisOutputInitialize() == -1 ||
+			VibrationAnalysisSpectrumInitialize() == -1) {
         module_enabled = false;
         return -1;
     }
@@ -340,6 +451,7 @@ static void VibrationAnalysisTask(void *parameters)
     uint32_t lastSettingsUpdateTime;
     uint8_t runAnalysisFlag = VIBRATIONANALYSISSETTINGS_TESTINGSTATUS_OFF; // By default, turn analysis off
     uint16_t sampleRate_ms = 100; // Default sample rate of 100ms
+    uint8_t spectrumAverages = 1;
     uint16_t sample_count;
     
     UAVObjEvent ev;
@@ -380,6 +492,9 @@ static void VibrationAnalysisTask(void *parameters)
             // Get sample rate
             VibrationAnalysisSettingsSampleRateGet(&sampleRate_ms);
             sampleRate_ms = sampleRate_ms > 0 ? sampleRate_ms : 1; //Ensure sampleRate never is 0.
+
+            VibrationAnalysisSettingsSpectrumAveragesGet(&spectrumAverages);
+            spectrumAverages = spectrumAverages > 0 ? spectrumAverages : 1;
             
             //Reconfigure any parameter
             VibrationAnalysisStart();
@@ -443,6 +558,24 @@ static void VibrationAnalysisTask(void *parameters)
         // Advance sample and reset when at buffer end
         sample_count++;
 
+        if (vtd->output == VIBRATIONANALYSISSETTINGS_OUTPUT_SPECTRUM) {
+            // Send the last spectrum an instance per sample, well before the next is ready
+            if (vtd->chunks_pending > 0)
+                VibrationAnalysisSendSpectrum();
+
+            if (sample_count == vtd->window_size) {
+                VibrationAnalysisAccumulateSpectrum();
+
+                if (vtd->averages_count >= spectrumAverages)
+                    VibrationAnalysisFinishSpectrum(1000.0f / sampleRate_ms);
+
+                sample_count = 0;
+                runningAcquisition = 0;
+            }
+
+            continue;
+        }
+
         // Process and dump an instance at a time
 #ifdef USE_SINGLE_INSTANCE_BUFFERS
         if (sample_count == vtd->buffers_size) {
@@ -488,6 +621,93 @@ static void VibrationAnalysisTask(void *parameters)
     }
 }
 
+/**
+ * Transform the window of samples on each axis and add its magnitude to the
+ * running sum.
+ */
+static void VibrationAnalysisAccumulateSpectrum(void)
+{
+    const uint16_t bins = vtd->window_size / 2;
+    const int16_t *buffers[3] = { vtd->accel_buffer_x, vtd->accel_buffer_y, vtd->accel_buffer_z };
+
+    for (int axis = 0; axis < 3; axis++) {
+        float *spectrum = &vtd->spectrum[axis * bins];
+
+        for (uint16_t k = 0; k < vtd->window_size; k++)
+            vtd->fft_buffer[k] = buffers[axis][k] * (1.0f / FLOAT_TO_FIXED);
+
+        rfft_window_hann(vtd->fft, vtd->fft_buffer);
+        rfft_run(vtd->fft, vtd->fft_buffer);
+        rfft_magnitude(vtd->fft, vtd->fft_buffer);
+
+        for (uint16_t k = 0; k < bins; k++)
+            spectrum[k] += vtd->fft_buffer[k];
+    }
+
+    vtd->averages_count++;
+}
+
+/**
+ * Turn the running sum into the average, find its peaks and queue it to be sent
+ * @param[in] sample_rate rate the samples were taken at (Hz)
+ */
+static void VibrationAnalysisFinishSpectrum(float sample_rate)
+{
+    const uint16_t bins = vtd->window_size / 2;
+    const float scale = 1.0f / vtd->averages_count;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float *spectrum = &vtd->spectrum[axis * bins];
+
+        for (uint16_t k = 0; k < bins; k++)
+            spectrum[k] *= scale;
+
+        vtd->peak_frequency[axis] = rfft_peak_bin(spectrum, bins, SPECTRUM_FIRST_PEAK_BIN) *
+            sample_rate / vtd->window_size;
+    }
+
+    vtd->averages_count = 0;
+    vtd->chunks_pending = MAX(bins / VIBRATION_ELEMENTS_COUNT, 1);
+}
+
+/**
+ * Send the next instance worth of bins of the averaged spectrum, and start
+ * the next sum once all are out.
+ */
+static void VibrationAnalysisSendSpectrum(void)
+{
+    const uint16_t bins = vtd->window_size / 2;
+    const uint16_t chunks = MAX(bins / VIBRATION_ELEMENTS_COUNT, 1);
+    const uint16_t index = chunks - vtd->chunks_pending;
+
+    VibrationAnalysisSpectrumData spectrumData;
+    spectrumData.scale = FLOAT_TO_FIXED;
+    spectrumData.samples = bins;
+    spectrumData.index = index;
+    spectrumData.PeakFrequency[VIBRATIONANALYSISSPECTRUM_PEAKFREQUENCY_X] = vtd->peak_frequency[0];
+    spectrumData.PeakFrequency[VIBRATIONANALYSISSPECTRUM_PEAKFREQUENCY_Y] = vtd->peak_frequency[1];
+    spectrumData.PeakFrequency[VIBRATIONANALYSISSPECTRUM_PEAKFREQUENCY_Z] = vtd->peak_frequency[2];
+
+    int16_t *fields[3] = { spectrumData.x, spectrumData.y, spectrumData.z };
+
+    for (int axis = 0; axis < 3; axis++) {
+        const float *spectrum = &vtd->spectrum[axis * bins];
+
+        for (uint16_t k = 0; k < VIBRATION_ELEMENTS_COUNT; k++) {
+            uint16_t bin = index * VIBRATION_ELEMENTS_COUNT + k;
+            float value = bin < bins ? spectrum[bin] * FLOAT_TO_FIXED : 0;
+
+            fields[axis][k] = MIN(value, INT16_MAX);
+        }
+    }
+
+    VibrationAnalysisSpectrumInstSet(0, &spectrumData);
+    VibrationAnalysisSpectrumInstUpdated(0);
+
+    if (--vtd->chunks_pending == 0)
+        memset(vtd->spectrum, 0, 3 * bins * sizeof(float));
+}
+
 /**
  * @}
  * @}
@@ -529,6 +529,43 @@ uint16_t PIOS_COM_GetNumReceiveBytesPending(uintptr_t com_id) {
 	return rx_pending;
 }
 
+/**
+ * Make sure the receiver is running on an empty receive buffer, and wait
+ * for it to deliver.
+ * \param[in,out] timeout_ms Time left to wait, reduced by the wait
+ * \returns true if the receive buffer is worth checking again
+ */
+static bool PIOS_COM_WaitForRx(struct pios_com_dev *com_dev, uint32_t *timeout_ms)
+{
+	if (com_dev->driver->rx_start) {
+		/* Notify the lower layer that there is now room in the rx buffer */
+		uint16_t rx_space_avail;
+
+		circ_queue_write_pos(com_dev->rx, NULL,
+				&rx_space_avail);
+		(com_dev->driver->rx_start)(com_dev->lower_id,
+					    rx_space_avail);
+	}
+
+	if (*timeout_ms == 0) {
+		return false;
+	}
+
+#if defined(PIOS_INCLUDE_RTOS)
+	if (PIOS_Semaphore_Take(com_dev->rx_sem, *timeout_ms) == true) {
+		/* Make sure we don't come back here again */
+		*timeout_ms = 0;
+		return true;
+	}
+
+	return false;
+#else
+	PIOS_DELAY_WaitmS(1);
+	(*timeout_ms)--;
+	return true;
+#endif
+}
+
 /**
 * Transfer bytes from port buffers into another buffer
 * \param[in] port COM port
@@ -553,38 +590,65 @@ uint16_t PIOS_COM_ReceiveBuffer(uintptr_t com_id, uint8_t * buf, uint16_t buf_le
 		PIOS_Semaphore_Take(com_dev->rx_sem, 0);
 	}
 
-check_again:
-	bytes_from_fifo = circ_queue_read_data(com_dev->rx, buf, buf_len);
+	do {
+		bytes_from_fifo = circ_queue_read_data(com_dev->rx, buf, buf_len);
+	} while (bytes_from_fifo == 0 && PIOS_COM_WaitForRx(com_dev, &timeout_ms));
 
-	if (bytes_from_fifo == 0) {
-		/* No more bytes in receive buffer */
-		/* Make sure the receiver is running while we wait */
-		if (com_dev->driver->rx_start) {
-			/* Notify the lower layer that there is now room in the rx buffer */
-			uint16_t rx_space_avail;
+	/* Return received byte */
+	return (bytes_from_fifo);
+}
 
-			circ_queue_write_pos(com_dev->rx, NULL,
-					&rx_space_avail);
-			(com_dev->driver->rx_start)(com_dev->lower_id,
-						    rx_space_avail);
-		}
-		if (timeout_ms > 0) {
-#if defined(PIOS_INCLUDE_RTOS)
-			if (PIOS_Semaphore_Take(com_dev->rx_sem, timeout_ms) == true) {
-				/* Make sure we don't come back here again */
-				timeout_ms = 0;
-				goto check_again;
-			}
-#else
-			PIOS_DELAY_WaitmS(1);
-			timeout_ms--;
-			goto check_again;
-#endif
-		}
+/**
+ * Get received bytes where they sit in the port buffer, without copying
+ * them out.  Blocks like PIOS_COM_ReceiveBuffer().  The bytes stay in the
+ * buffer until released with PIOS_COM_ReceiveRelease(), which must be done
+ * before receiving from the port again.
+ * \param[in] com_id COM port
+ * \param[out] buf Set to the first received byte
+ * \param[in] timeout_ms Time to wait for data
+ * \returns Number of bytes at buf; more may follow once they are released
+ */
+uint16_t PIOS_COM_ReceivePeek(uintptr_t com_id, const uint8_t **buf, uint32_t timeout_ms)
+{
+	PIOS_Assert(buf);
+	uint16_t contig;
+
+	struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+	if (!PIOS_COM_validate(com_dev)) {
+		/* Undefined COM port for this board (see pios_board.c) */
+		PIOS_Assert(0);
 	}
+	PIOS_Assert(com_dev->rx);
 
-	/* Return received byte */
-	return (bytes_from_fifo);
+	/* Clear any pending RX wakeup */
+	if (com_dev->rx_sem) {
+		PIOS_Semaphore_Take(com_dev->rx_sem, 0);
+	}
+
+	do {
+		*buf = circ_queue_read_pos(com_dev->rx, &contig, NULL);
+	} while (contig == 0 && PIOS_COM_WaitForRx(com_dev, &timeout_ms));
+
+	return contig;
+}
+
+/**
+ * Free bytes obtained from PIOS_COM_ReceivePeek() in the port buffer.
+ * \param[in] com_id COM port
+ * \param[in] num Number of bytes used, no more than were returned
+ */
+void PIOS_COM_ReceiveRelease(uintptr_t com_id, uint16_t num)
+{
+	struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+	if (!PIOS_COM_validate(com_dev)) {
+		/* Undefined COM port for this board (see pios_board.c) */
+		PIOS_Assert(0);
+	}
+	PIOS_Assert(com_dev->rx);
+
+	circ_queue_read_completed_multi(com_dev->rx, num);
 }
 
 /**
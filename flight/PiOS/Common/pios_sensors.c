@@ -122,7 +122,8 @@ bool PIOS_SENSORS_GetData(enum pios_sensor_type type, void *buf, int ms_to_wait)
 
 		if (time_until > 0) {
 #ifdef FLIGHT_POSIX
-			if (PIOS_Thread_FakeClock_IsActive()) {
+			if (PIOS_Thread_FakeClock_IsActive() &&
+					!PIOS_Thread_FakeClock_IsLockstep()) {
 				while (!PIOS_Thread_Period_Elapsed(now,
 							time_until)) {
 					usleep(1000);
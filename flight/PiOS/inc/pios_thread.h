@@ -95,6 +95,11 @@ void PIOS_Thread_ChangePriority(enum pios_thread_prio_e prio);
 void PIOS_Thread_FakeClock_Tick(void);
 bool PIOS_Thread_FakeClock_IsActive(void);
 void PIOS_Thread_FakeClock_UpdateBarrier(uint32_t increment);
+void PIOS_Thread_FakeClock_Lockstep(float speed);
+void PIOS_Thread_FakeClock_Leave(void);
+bool PIOS_Thread_FakeClock_IsLockstep(void);
+bool PIOS_Thread_FakeClock_Wait(bool (*ready)(void *ctx), void *ctx, uint32_t timeout_ms);
+bool PIOS_Thread_FakeClock_Deliver(uint16_t (*deliver)(void *ctx, const uint8_t *buf, uint16_t len), void *ctx, const uint8_t *buf, uint16_t len);
 #endif
 
 #endif /* PIOS_THREAD_H_ */
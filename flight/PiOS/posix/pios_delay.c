@@ -32,6 +32,10 @@
 #include "pios.h"
 #include "time.h"
 
+#ifdef PIOS_INCLUDE_FAKETICK
+#include "pios_thread.h"
+#endif
+
 #include <time.h>
 
 /**
@@ -152,6 +156,13 @@ int32_t PIOS_DELAY_WaitmS(uint32_t mS)
 
 uint32_t PIOS_DELAY_GetRaw()
 {
+#ifdef PIOS_INCLUDE_FAKETICK
+	/* Threads in lockstep live on the simulated clock */
+	if (PIOS_Thread_FakeClock_IsLockstep()) {
+		return PIOS_Thread_Systime() * 1000;
+	}
+#endif
+
 	uint32_t raw_us = get_monotonic_us_time() - base_time;
 	return raw_us;
 }
@@ -61,6 +61,21 @@ struct flightgear_dev {
 	struct sockaddr_in send_addr;
 };
 
+static uint16_t queue_deliver(void *ctx, const uint8_t *buf, uint16_t len)
+{
+	PIOS_Queue_Send(ctx, buf, 0);
+
+	return len;
+}
+
+static void queue_send(struct pios_queue *queue, const void *item,
+		uint16_t len)
+{
+	if (!PIOS_Thread_FakeClock_Deliver(queue_deliver, queue, item, len)) {
+		PIOS_Queue_Send(queue, item, 0);
+	}
+}
+
 /**
  * RxTask
  */
@@ -75,6 +90,8 @@ static void PIOS_FLIGHTGEAR_RxTask(void *param)
 
 	int num = 0;
 
+	PIOS_Thread_FakeClock_Leave();
+
 	while (true) {
 		char buf[320];
 
@@ -131,8 +148,10 @@ static void PIOS_FLIGHTGEAR_RxTask(void *param)
 			gyro_data.y = gyro_data.y * 0.3 + rates[1] * 0.7;
 			gyro_data.z = gyro_data.z * 0.3 + rates[2] * 0.7;
 
-			PIOS_Queue_Send(fg_dev->accel_queue, &accel_data, 0);
-			PIOS_Queue_Send(fg_dev->gyro_queue, &gyro_data, 0);
+			queue_send(fg_dev->accel_queue, &accel_data,
+					sizeof(accel_data));
+			queue_send(fg_dev->gyro_queue, &gyro_data,
+					sizeof(gyro_data));
 
 			fd_set r;
 
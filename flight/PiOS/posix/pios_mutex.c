@@ -31,6 +31,10 @@
 #include <pios.h>
 #include <pios_mutex.h>
 
+#ifdef PIOS_INCLUDE_FAKETICK
+#include <pios_thread.h>
+#endif
+
 struct pios_mutex {
 	pthread_mutex_t mutex;
 };
@@ -63,10 +67,27 @@ struct pios_mutex *PIOS_Mutex_Create(void)
 	return p;
 }
 
+#ifdef PIOS_INCLUDE_FAKETICK
+static bool mutex_try_lock(void *ctx)
+{
+	struct pios_mutex *mtx = ctx;
+
+	return pthread_mutex_trylock(&mtx->mutex) == 0;
+}
+#endif
+
 bool PIOS_Mutex_Lock(struct pios_mutex *mtx, uint32_t timeout_ms)
 {
 	int ret;
 
+#ifdef PIOS_INCLUDE_FAKETICK
+	/* Blocking would stop the schedule, with the holder waiting its turn */
+	if (PIOS_Thread_FakeClock_IsLockstep()) {
+		return PIOS_Thread_FakeClock_Wait(mutex_try_lock, mtx,
+				timeout_ms);
+	}
+#endif
+
 	if (timeout_ms >= PIOS_MUTEX_TIMEOUT_MAX) {
 		ret = pthread_mutex_lock(&mtx->mutex);
 
@@ -120,7 +120,10 @@ static bool PIOS_Queue_Send_Impl(struct pios_queue *queuep,
 	pthread_mutex_lock(&queuep->mutex);
 
 	while (!circ_queue_write_data(queuep->queue, itemp, 1)) {
-		if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
+		if (timeout_ms == 0) {
+			pthread_mutex_unlock(&queuep->mutex);
+			return false;
+		} else if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
 			if (pthread_cond_timedwait(&queuep->cond,
 					&queuep->mutex, &abstime)) {
 				pthread_mutex_unlock(&queuep->mutex);
@@ -138,11 +141,30 @@ static bool PIOS_Queue_Send_Impl(struct pios_queue *queuep,
 	return true;
 }
 
+struct queue_wait {
+	struct pios_queue *queuep;
+	void *itemp;
+};
+
+static bool queue_try_send(void *ctx)
+{
+	struct queue_wait *wait = ctx;
+
+	return PIOS_Queue_Send_Impl(wait->queuep, wait->itemp, 0);
+}
+
 bool PIOS_Queue_Send(struct pios_queue *queuep,
 		const void *itemp, uint32_t timeout_ms)
 {
 	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
 
+	if (PIOS_Thread_FakeClock_IsLockstep()) {
+		struct queue_wait wait = { queuep, (void *) itemp };
+
+		return PIOS_Thread_FakeClock_Wait(queue_try_send, &wait,
+				timeout_ms);
+	}
+
 	if (PIOS_Thread_FakeClock_IsActive()) {
 		uint32_t start = PIOS_Thread_Systime();
 
@@ -192,7 +214,10 @@ static bool PIOS_Queue_Receive_Impl(struct pios_queue *queuep,
 	pthread_mutex_lock(&queuep->mutex);
 
 	while (!circ_queue_read_data(queuep->queue, itemp, 1)) {
-		if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
+		if (timeout_ms == 0) {
+			pthread_mutex_unlock(&queuep->mutex);
+			return false;
+		} else if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
 			if (pthread_cond_timedwait(&queuep->cond,
 					&queuep->mutex, &abstime)) {
 				pthread_mutex_unlock(&queuep->mutex);
@@ -210,11 +235,25 @@ static bool PIOS_Queue_Receive_Impl(struct pios_queue *queuep,
 	return true;
 }
 
+static bool queue_try_receive(void *ctx)
+{
+	struct queue_wait *wait = ctx;
+
+	return PIOS_Queue_Receive_Impl(wait->queuep, wait->itemp, 0);
+}
+
 bool PIOS_Queue_Receive(struct pios_queue *queuep,
 		void *itemp, uint32_t timeout_ms)
 {
 	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
 
+	if (PIOS_Thread_FakeClock_IsLockstep()) {
+		struct queue_wait wait = { queuep, itemp };
+
+		return PIOS_Thread_FakeClock_Wait(queue_try_receive, &wait,
+				timeout_ms);
+	}
+
 	if (PIOS_Thread_FakeClock_IsActive()) {
 		uint32_t start = PIOS_Thread_Systime();
 
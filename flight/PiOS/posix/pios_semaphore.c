@@ -28,6 +28,10 @@
 
 #include <pios.h>
 
+#ifdef PIOS_INCLUDE_FAKETICK
+#include <pios_thread.h>
+#endif
+
 struct pios_semaphore {
 #define SEMAPHORE_MAGIC 0x616d6553	/* 'Sema' */
 	uint32_t magic;
@@ -69,10 +73,34 @@ struct pios_semaphore *PIOS_Semaphore_Create(void)
 	return s;
 }
 
+#ifdef PIOS_INCLUDE_FAKETICK
+static bool semaphore_try_take(void *ctx)
+{
+	struct pios_semaphore *sema = ctx;
+	bool taken;
+
+	pthread_mutex_lock(&sema->mutex);
+
+	taken = sema->given;
+	sema->given = false;
+
+	pthread_mutex_unlock(&sema->mutex);
+
+	return taken;
+}
+#endif
+
 bool PIOS_Semaphore_Take(struct pios_semaphore *sema, uint32_t timeout_ms)
 {
 	PIOS_Assert(sema->magic == SEMAPHORE_MAGIC);
 
+#ifdef PIOS_INCLUDE_FAKETICK
+	if (PIOS_Thread_FakeClock_IsLockstep()) {
+		return PIOS_Thread_FakeClock_Wait(semaphore_try_take, sema,
+				timeout_ms);
+	}
+#endif
+
         struct timespec abstime;
 
         if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
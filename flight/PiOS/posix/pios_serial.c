@@ -92,10 +92,27 @@ static pios_ser_dev * find_ser_dev_by_id(uintptr_t serial)
 	return (pios_ser_dev *) serial;
 }
 
+static uint16_t rx_deliver(void *ctx, const uint8_t *buf, uint16_t len)
+{
+	pios_ser_dev *ser_dev = ctx;
+	bool rx_need_yield = false;
+
+	/* Like below, whatever doesn't fit is dropped */
+	ser_dev->rx_in_cb(ser_dev->rx_in_context, (uint8_t *) buf, len, NULL,
+			&rx_need_yield);
+
+	return len;
+}
+
 static void rx_do_cb(pios_ser_dev *ser_dev, uint8_t *incoming_buffer,
 		int len) {
 
 	if (ser_dev->rx_in_cb) {
+		if (PIOS_Thread_FakeClock_Deliver(rx_deliver, ser_dev,
+					incoming_buffer, len)) {
+			return;
+		}
+
 		bool rx_need_yield = false;
 
 		ser_dev->rx_in_cb(ser_dev->rx_in_context, incoming_buffer,
@@ -115,6 +132,8 @@ static void PIOS_SERIAL_RxTask(void *ser_dev_n)
 	const int INCOMING_BUFFER_SIZE = 16;
 	uint8_t incoming_buffer[INCOMING_BUFFER_SIZE];
 
+	PIOS_Thread_FakeClock_Leave();
+
 	while (1) {
 		int result = read(ser_dev->readfd, incoming_buffer,
 				INCOMING_BUFFER_SIZE);
@@ -107,7 +107,7 @@ int orig_stdout;
 static void Usage(char *cmdName) {
 	printf( "usage: %s [-f] [-r] [-m orientation] [-p proto] [-s spibase]\n"
 		"\t\t[-d drvname:bus:id] [-l logfile] [-I i2cdev] [-i drvname:bus]\n"
-		"\t\t[-g port] [-c confflash] [-x time] -!\n"
+		"\t\t[-g port] [-c confflash] [-x time] [-L speed] [-n hz:amp] -!\n"
 		"\n"
 #if !(defined(_WIN32) || defined(WIN32) || defined(__MINGW32__))
 		"\t-f\t\t\tEnables floating point exception trapping mode\n"
@@ -116,16 +116,23 @@ static void Usage(char *cmdName) {
 		"\t-r\t\t\tGoes realtime and pins all memory (requires root)\n"
 #endif
 		"\t-!\t\t\tUse a fake clock timebase gated by gcs/simsensors\n"
+		"\t-L speed\t\tRun the modules in lockstep on the fake clock, at\n"
+		"\t\t\tspeed times real time (0 for as fast as possible)\n"
 		"\t-l log\t\t\tWrites simulation data to a log\n"
 		"\t-g port\t\t\tStarts FlightGear driver on port\n"
 #ifdef PIOS_INCLUDE_SIMSENSORS_YASIM
 		"\t-y\t\t\tUse an external simulator (drhil yasim)\n"
 #endif
+#ifdef PIOS_INCLUDE_SIMSENSORS
+		"\t-n hz:amp\t\tAdd a tone of amp deg/s at hz to the simulated\n"
+		"\t\t\tgyros, like motor noise\n"
+#endif
 #if !(defined(_WIN32) || defined(WIN32) || defined(__MINGW32__))
 		"\t-x time\t\t\tExit after time seconds\n"
 #endif
 		"\t-S drvname:serialpath\tStarts a serial driver on serialpath\n"
-		"\t\t\tAvailable drivers: gps msp lighttelemetry telemetry omnip\n\n"
+		"\t\t\tAvailable drivers: gps msp lighttelemetry telemetry\n"
+		"\t\t\t\t\tserialtelemetry omnip\n\n"
 #ifdef PIOS_INCLUDE_SPI
 		"\t-p proto\t\tSpecify a flyingpio rcvr protocol\n"
 		"\t\t\tAvailable protocols: dsm hottsumd hottsumh sbus ppm\n"
@@ -228,6 +235,8 @@ static int handle_serial_device(const char *optarg) {
 		PIOS_COM_LIGHTTELEMETRY = com_id;
 	} else if (!strcmp(drv_name, "telemetry")) {
 		PIOS_COM_TELEM_USB = com_id;
+	} else if (!strcmp(drv_name, "serialtelemetry")) {
+		PIOS_COM_TELEM_SER = com_id;
 #ifdef PIOS_INCLUDE_OMNIP
 	} else if (!strcmp(drv_name, "omnip")) {
 		omnip_dev_t dontcare;
@@ -488,6 +497,11 @@ static char **saved_argv;
 bool use_yasim;
 #endif
 
+#ifdef PIOS_INCLUDE_SIMSENSORS
+float sim_gyro_tone_hz;
+float sim_gyro_tone_amplitude;
+#endif
+
 void PIOS_SYS_Args(int argc, char *argv[]) {
 	saved_argc = argc;
 	saved_argv = argv;
@@ -496,16 +510,28 @@ void PIOS_SYS_Args(int argc, char *argv[]) {
 
 	bool hw_argseen = true;
 
-	while ((opt = getopt(argc, argv, "!yfrx:g:l:s:d:S:I:i:m:c:p:")) != -1) {
+	while ((opt = getopt(argc, argv, "!L:yfrx:g:l:n:s:d:S:I:i:m:c:p:")) != -1) {
 		switch (opt) {
 #ifdef PIOS_INCLUDE_SIMSENSORS_YASIM
 			case 'y':
 				use_yasim = true;
 				break;
+#endif
+#ifdef PIOS_INCLUDE_SIMSENSORS
+			case 'n':
+				if (sscanf(optarg, "%f:%f", &sim_gyro_tone_hz,
+						&sim_gyro_tone_amplitude) != 2) {
+					printf("Invalid gyro tone %s\n", optarg);
+					exit(1);
+				}
+				break;
 #endif
 			case '!':
 				PIOS_Thread_FakeClock_Tick();
 				break;
+			case 'L':
+				PIOS_Thread_FakeClock_Lockstep(atof(optarg));
+				break;
 			case 'c':
 				PIOS_Flash_Posix_SetFName(optarg);
 				break;
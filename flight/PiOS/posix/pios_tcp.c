@@ -89,12 +89,27 @@ static pios_tcp_dev * find_tcp_dev_by_id(uintptr_t tcp)
 	return (pios_tcp_dev *) tcp;
 }
 
+static uint16_t rx_deliver(void *ctx, const uint8_t *buf, uint16_t len)
+{
+	pios_tcp_dev *tcp_dev = ctx;
+	bool rx_need_yield = false;
+
+	return tcp_dev->rx_in_cb(tcp_dev->rx_in_context, (uint8_t *) buf, len,
+			NULL, &rx_need_yield);
+}
+
 static void rx_cb_all(pios_tcp_dev *tcp_dev, uint8_t *incoming_buffer,
 		int len) {
 	int sent = 0;
 
 	bool rx_need_yield = false;
 
+	/* In lockstep, the rest is retried at the following ticks */
+	if (PIOS_Thread_FakeClock_Deliver(rx_deliver, tcp_dev,
+				incoming_buffer, len)) {
+		return;
+	}
+
 	sent = tcp_dev->rx_in_cb(tcp_dev->rx_in_context, incoming_buffer, len,
 			NULL, &rx_need_yield);
 
@@ -127,6 +142,8 @@ static void PIOS_TCP_RxTask(void *tcp_dev_n)
 	uint8_t incoming_buffer[INCOMING_BUFFER_SIZE];
 	int error;
 
+	PIOS_Thread_FakeClock_Leave();
+
 	while (1) {
 	
 		do
@@ -41,6 +41,27 @@ struct pios_thread
 	const char *name;
 };
 
+struct lockstep_thread
+{
+	struct lockstep_thread *next;
+
+	/* Sleeping threads need no turn until the clock reaches wake_at */
+	bool sleeping;
+	uint32_t wake_at;
+
+	pthread_cond_t turn;
+};
+
+static volatile uint32_t fake_clock;
+static pthread_cond_t fake_clock_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t fake_clock_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile uint32_t fake_tick_barrier;
+
+static __thread struct lockstep_thread *lockstep_self;
+
+static struct lockstep_thread *lockstep_add(void);
+static void lockstep_pace_from_now(void);
+
 /**
  * @brief   Creates a handle for the current thread.
  *
@@ -86,6 +107,14 @@ void PIOS_Thread_ChangePriority(enum pios_thread_prio_e prio)
 #endif
 }
 
+static void *lockstep_thread_start(void *p);
+
+struct lockstep_start {
+	void (*fp)(void *);
+	void *argp;
+	struct lockstep_thread *self;
+};
+
 struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, size_t stack_bytes, void *argp, enum pios_thread_prio_e prio)
 {
 	struct pios_thread *thread = malloc(sizeof(*thread));
@@ -111,6 +140,21 @@ struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, si
 
 	void *(*thr_func)(void *) = (void *) fp;
 
+	if (lockstep_self) {
+		/* Threads started on the schedule join it */
+		struct lockstep_start *start = malloc(sizeof(*start));
+
+		start->fp = fp;
+		start->argp = argp;
+
+		pthread_mutex_lock(&fake_clock_mutex);
+		start->self = lockstep_add();
+		pthread_mutex_unlock(&fake_clock_mutex);
+
+		thr_func = lockstep_thread_start;
+		argp = start;
+	}
+
 	int ret = pthread_create(&thread->thread, &attr, thr_func, argp);
 
 	if (ret) {
@@ -135,6 +179,8 @@ void PIOS_Thread_Delete(struct pios_thread *threadp)
 		abort();	// Only support this on "self"
 	}
 
+	PIOS_Thread_FakeClock_Leave();
+
 #if 0
 	/* Need to figure out our own thread structure to clean it up */
 	free(threadp->name);
@@ -144,10 +190,6 @@ void PIOS_Thread_Delete(struct pios_thread *threadp)
 	pthread_exit(0);
 }
 
-static volatile uint32_t fake_clock;
-static pthread_cond_t fake_clock_cond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t fake_clock_mutex = PTHREAD_MUTEX_INITIALIZER;
-
 static inline uint32_t PIOS_Thread_GetClock_Impl()
 {
 	struct timespec monotime;
@@ -158,12 +200,15 @@ static inline uint32_t PIOS_Thread_GetClock_Impl()
 }
 
 #ifdef PIOS_INCLUDE_FAKETICK
-static volatile uint32_t fake_tick_barrier;
-
 void PIOS_Thread_FakeClock_UpdateBarrier(uint32_t increment)
 {
 	pthread_mutex_lock(&fake_clock_mutex);
 
+	if (!fake_tick_barrier) {
+		/* Input has taken over the clock; go at the lockstep speed */
+		lockstep_pace_from_now();
+	}
+
 	fake_tick_barrier = fake_clock + increment;
 	pthread_cond_broadcast(&fake_clock_cond);
 
@@ -204,6 +249,396 @@ void PIOS_Thread_FakeClock_Tick(void)
 }
 #endif
 
+/*
+ * Lockstep simulation.  The threads on the simulated clock take turns, and
+ * only the one whose turn it is runs.  A thread that has to wait checks
+ * whether what it waits for has happened and otherwise passes the turn on;
+ * once every thread has passed in a row nothing more can happen until the
+ * clock moves, so it ticks.  The clock stands still from boot until input
+ * first sets a tick barrier; after that it runs as fast as the modules can
+ * keep up (or at a multiple of real time).
+ *
+ * Threads doing I/O to the outside world leave the schedule, and keep
+ * sleeping in real time.  What they receive is held back and handed on at
+ * the next tick boundary, so the order things run in depends only on the
+ * simulated clock and on the input, not on how the host schedules threads.
+ */
+static struct lockstep_thread *lockstep_turn;
+static int lockstep_threads;
+static int lockstep_passes;	/* Turns passed on since a thread went on */
+static bool lockstep_blocked;
+static float lockstep_speed;	/* Multiple of real time, or 0 for no limit */
+static uint32_t lockstep_start_clock;
+static uint32_t lockstep_start_real;
+
+/* Input from threads off the schedule, waiting for a tick boundary */
+struct lockstep_input
+{
+	struct lockstep_input *next;
+
+	uint16_t (*deliver)(void *ctx, const uint8_t *buf, uint16_t len);
+	void *ctx;
+
+	uint16_t len;
+	uint16_t done;
+	uint8_t buf[];
+};
+
+static struct lockstep_input *lockstep_input_head;
+static struct lockstep_input **lockstep_input_tail = &lockstep_input_head;
+
+/* All of these are called with fake_clock_mutex held */
+static struct lockstep_thread *lockstep_add(void)
+{
+	struct lockstep_thread *t = malloc(sizeof(*t));
+
+	if (!t) {
+		abort();
+	}
+
+	pthread_cond_init(&t->turn, NULL);
+	t->sleeping = false;
+
+	/* New threads go right after the one starting them */
+	if (lockstep_turn) {
+		t->next = lockstep_turn->next;
+		lockstep_turn->next = t;
+	} else {
+		t->next = t;
+		lockstep_turn = t;
+	}
+
+	lockstep_threads++;
+
+	return t;
+}
+
+static void lockstep_wait_turn(void)
+{
+	while (lockstep_turn != lockstep_self) {
+		pthread_cond_wait(&lockstep_self->turn, &fake_clock_mutex);
+	}
+}
+
+static void lockstep_pace_from_now(void)
+{
+	lockstep_start_clock = fake_clock;
+	lockstep_start_real = PIOS_Thread_GetClock_Impl();
+}
+
+static void lockstep_set_blocked(bool blocked)
+{
+	if (blocked == lockstep_blocked) {
+		return;
+	}
+
+	lockstep_blocked = blocked;
+
+	/* Time spent waiting for input isn't made up for afterwards */
+	lockstep_pace_from_now();
+
+#ifdef PIOS_INCLUDE_FAKETICK
+	/* Nobody else on the schedule runs meanwhile; we still have the turn */
+	uint8_t val = blocked;
+
+	pthread_mutex_unlock(&fake_clock_mutex);
+	HwSimulationFakeTickBlockedSet(&val);
+	pthread_mutex_lock(&fake_clock_mutex);
+#endif
+}
+
+static void lockstep_deliver(void)
+{
+	struct lockstep_input *in = lockstep_input_head;
+
+	if (!in) {
+		return;
+	}
+
+	lockstep_input_head = NULL;
+	lockstep_input_tail = &lockstep_input_head;
+
+	pthread_mutex_unlock(&fake_clock_mutex);
+
+	while (in) {
+		in->done += in->deliver(in->ctx, in->buf + in->done,
+				in->len - in->done);
+
+		if (in->done < in->len) {
+			break;
+		}
+
+		struct lockstep_input *next = in->next;
+
+		free(in);
+		in = next;
+	}
+
+	pthread_mutex_lock(&fake_clock_mutex);
+
+	if (in) {
+		/* What didn't fit goes first next time */
+		struct lockstep_input **last = &in->next;
+
+		while (*last) {
+			last = &(*last)->next;
+		}
+
+		*last = lockstep_input_head;
+
+		if (!lockstep_input_head) {
+			lockstep_input_tail = last;
+		}
+
+		lockstep_input_head = in;
+	}
+}
+
+static void lockstep_tick(void)
+{
+	lockstep_deliver();
+
+	if (!fake_tick_barrier) {
+		/* Nothing drives the clock until input first arrives */
+		pthread_mutex_unlock(&fake_clock_mutex);
+		usleep(1000);
+		pthread_mutex_lock(&fake_clock_mutex);
+
+		return;
+	}
+
+	if (fake_tick_barrier == fake_clock) {
+		/* Give input time to arrive, then go round again */
+		lockstep_set_blocked(true);
+
+		pthread_mutex_unlock(&fake_clock_mutex);
+		usleep(1000);
+		pthread_mutex_lock(&fake_clock_mutex);
+
+		return;
+	}
+
+	lockstep_set_blocked(false);
+
+	if (lockstep_speed > 0) {
+		uint32_t due = lockstep_start_real +
+			(fake_clock + 1 - lockstep_start_clock) / lockstep_speed;
+		int32_t ahead = due - PIOS_Thread_GetClock_Impl();
+
+		if (ahead > 0) {
+			pthread_mutex_unlock(&fake_clock_mutex);
+			usleep(ahead * 1000);
+			pthread_mutex_lock(&fake_clock_mutex);
+		}
+	}
+
+	fake_clock++;
+
+	/* For threads off the schedule waiting on the clock */
+	pthread_cond_broadcast(&fake_clock_cond);
+}
+
+static void lockstep_pass(void)
+{
+	struct lockstep_thread *next = lockstep_self;
+
+	do {
+		if (++lockstep_passes >= lockstep_threads) {
+			lockstep_passes = 0;
+			lockstep_tick();
+		}
+
+		next = next->next;
+	} while ((next != lockstep_self) && next->sleeping &&
+			((int32_t) (next->wake_at - fake_clock) > 0));
+
+	lockstep_turn = next;
+	pthread_cond_signal(&lockstep_turn->turn);
+
+	lockstep_wait_turn();
+}
+
+static void *lockstep_thread_start(void *p)
+{
+	struct lockstep_start start = *(struct lockstep_start *) p;
+
+	free(p);
+
+	pthread_mutex_lock(&fake_clock_mutex);
+	lockstep_self = start.self;
+	lockstep_wait_turn();
+	pthread_mutex_unlock(&fake_clock_mutex);
+
+	lockstep_passes = 0;
+
+	start.fp(start.argp);
+
+	PIOS_Thread_FakeClock_Leave();
+
+	return NULL;
+}
+
+/**
+ * @brief Run the threads started from here on in lockstep on a simulated
+ * clock, starting with the calling thread.  The clock doesn't move until the
+ * first tick barrier is set, so that a GCS can connect and configure things
+ * at its own pace without changing what happens afterwards.
+ *
+ * @param[in] speed        multiple of real time to run at, or 0 for as fast
+ *                         as possible
+ */
+void PIOS_Thread_FakeClock_Lockstep(float speed)
+{
+	pthread_mutex_lock(&fake_clock_mutex);
+
+	if (fake_clock == 0) {
+		fake_clock = 1;
+	}
+
+	lockstep_speed = speed;
+	lockstep_pace_from_now();
+
+	lockstep_self = lockstep_add();
+
+	pthread_mutex_unlock(&fake_clock_mutex);
+}
+
+/**
+ * @brief Take the calling thread off the lockstep schedule, e.g. before it
+ * blocks on I/O.  Does nothing if it isn't on it.
+ */
+void PIOS_Thread_FakeClock_Leave(void)
+{
+	struct lockstep_thread *t = lockstep_self;
+
+	if (!t) {
+		return;
+	}
+
+	pthread_mutex_lock(&fake_clock_mutex);
+
+	struct lockstep_thread *prev = t;
+
+	while (prev->next != t) {
+		prev = prev->next;
+	}
+
+	prev->next = t->next;
+	lockstep_threads--;
+	lockstep_passes = 0;
+
+	if (lockstep_threads) {
+		lockstep_turn = t->next;
+		pthread_cond_signal(&lockstep_turn->turn);
+	} else {
+		lockstep_turn = NULL;
+	}
+
+	lockstep_self = NULL;
+
+	pthread_mutex_unlock(&fake_clock_mutex);
+
+	pthread_cond_destroy(&t->turn);
+	free(t);
+}
+
+/**
+ * @brief Whether the calling thread runs on the lockstep schedule.
+ */
+bool PIOS_Thread_FakeClock_IsLockstep(void)
+{
+	return lockstep_self != NULL;
+}
+
+/**
+ * @brief Wait, on the lockstep schedule, until something happens or a
+ * timeout elapses on the simulated clock.
+ *
+ * @param[in] ready        checks without blocking whether the wait is over
+ *                         (and takes what was waited for)
+ * @param[in] ctx          passed to ready
+ * @param[in] timeout_ms   timeout, or PIOS_THREAD_TIMEOUT_MAX
+ *
+ * @returns true if ready said so, false on timeout
+ */
+bool PIOS_Thread_FakeClock_Wait(bool (*ready)(void *ctx), void *ctx,
+		uint32_t timeout_ms)
+{
+	PIOS_Assert(lockstep_self);
+
+	uint32_t start = fake_clock;
+	bool ret;
+
+	while (!(ret = ready(ctx))) {
+		if ((timeout_ms != PIOS_THREAD_TIMEOUT_MAX) &&
+				(fake_clock - start >= timeout_ms)) {
+			break;
+		}
+
+		pthread_mutex_lock(&fake_clock_mutex);
+		lockstep_pass();
+		pthread_mutex_unlock(&fake_clock_mutex);
+	}
+
+	/* This thread goes on; everybody needs another look */
+	lockstep_passes = 0;
+
+	return ret;
+}
+
+/**
+ * @brief Hand input received off the lockstep schedule to the modules at
+ * the next tick boundary, rather than whenever it happens to arrive.
+ *
+ * @param[in] deliver      passes on input, returning how much it took; the
+ *                         rest is offered again at the following tick
+ * @param[in] ctx          passed to deliver
+ * @param[in] buf          the input, which is copied
+ * @param[in] len          its length
+ *
+ * @returns false if nothing runs in lockstep, and the caller should pass
+ * the input on itself
+ */
+bool PIOS_Thread_FakeClock_Deliver(uint16_t (*deliver)(void *ctx,
+			const uint8_t *buf, uint16_t len), void *ctx,
+		const uint8_t *buf, uint16_t len)
+{
+	pthread_mutex_lock(&fake_clock_mutex);
+
+	if (!lockstep_turn) {
+		pthread_mutex_unlock(&fake_clock_mutex);
+
+		return false;
+	}
+
+	struct lockstep_input *in = malloc(sizeof(*in) + len);
+
+	if (!in) {
+		abort();
+	}
+
+	in->next = NULL;
+	in->deliver = deliver;
+	in->ctx = ctx;
+	in->len = len;
+	in->done = 0;
+	memcpy(in->buf, buf, len);
+
+	*lockstep_input_tail = in;
+	lockstep_input_tail = &in->next;
+
+	pthread_mutex_unlock(&fake_clock_mutex);
+
+	return true;
+}
+
+static bool never_ready(void *ctx)
+{
+	(void) ctx;
+
+	return false;
+}
+
 bool PIOS_Thread_FakeClock_IsActive(void)
 {
 	return fake_clock != 0;
@@ -228,13 +663,32 @@ uint32_t PIOS_Thread_Systime(void)
 
 void PIOS_Thread_Sleep(uint32_t time_ms)
 {
+	if (lockstep_self) {
+		if (time_ms) {
+			lockstep_self->wake_at = fake_clock + time_ms;
+			lockstep_self->sleeping = true;
+
+			PIOS_Thread_FakeClock_Wait(never_ready, NULL, time_ms);
+
+			lockstep_self->sleeping = false;
+		} else {
+			/* A yield */
+			pthread_mutex_lock(&fake_clock_mutex);
+			lockstep_pass();
+			pthread_mutex_unlock(&fake_clock_mutex);
+		}
+
+		return;
+	}
+
 	if (time_ms == PIOS_THREAD_TIMEOUT_MAX) {
 		while (true) {
 			usleep(50000000); /* 50s */
 		}
 	}
 
-	if (fake_clock) {
+	/* Threads off the lockstep schedule live in real time */
+	if (fake_clock && !lockstep_turn) {
 		pthread_mutex_lock(&fake_clock_mutex);
 
 		uint32_t expiration = fake_clock + time_ms;
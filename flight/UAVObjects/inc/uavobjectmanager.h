@@ -143,6 +143,9 @@ typedef struct {
 	uint32_t eventCallbackErrors;
 	uint32_t lastCallbackErrorID;
 	uint32_t lastQueueErrorID;
+	uint16_t eventBacklogMax;	/** Most nested events awaiting dispatch */
+	uint16_t deferredBacklogMax;	/** Most deferred callbacks awaiting dispatch */
+	uint32_t deferredLatencyMax;	/** Longest wait for a deferred callback, in us */
 } UAVObjStats;
 
 typedef void (*new_uavo_instance_cb_t)(uint32_t,uint32_t);
@@ -206,6 +209,7 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, struct pios_queue *queue)
 int32_t UAVObjConnectQueueThrottled(UAVObjHandle obj_handle, struct pios_queue *queue, uint8_t eventMask, uint16_t interval);
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask);
 int32_t UAVObjConnectCallbackThrottled(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask, uint16_t interval);
+int32_t UAVObjConnectCallbackDeferred(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask);
 void UAVObjUnblockThrottle(struct ObjectEventEntryThrottled *throttled);
 int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx);
 void UAVObjUpdated(UAVObjHandle obj);
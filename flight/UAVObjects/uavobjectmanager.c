@@ -40,13 +40,34 @@
 #include "pios_heap.h"		/* PIOS_malloc_no_dma */
 #include "pios_mutex.h"
 #include "pios_queue.h"
+#include "pios_semaphore.h"
 #include "pios_thread.h"
 #include "misc_math.h"
+#include "uavobjectsinit.h"	/* UAVOBJECTS_COUNT */
 
 extern uintptr_t pios_uavo_settings_fs_id;
 
 // Constants
 
+/* Events raised from within event callbacks, waiting to be dispatched */
+#ifndef UAVO_EVENT_QUEUE_DEPTH
+#define UAVO_EVENT_QUEUE_DEPTH 8
+#endif
+
+/* Deferred callbacks waiting for the dispatch thread; must be a power of 2 */
+#ifndef UAVO_DEFERRED_QUEUE_DEPTH
+#define UAVO_DEFERRED_QUEUE_DEPTH 16
+#endif
+
+#ifndef UAVO_DISPATCH_STACK_SIZE
+#define UAVO_DISPATCH_STACK_SIZE 1024
+#endif
+
+#define UAVO_DISPATCH_PRIORITY PIOS_THREAD_PRIO_NORMAL
+
+DONT_BUILD_IF(UAVO_DEFERRED_QUEUE_DEPTH & (UAVO_DEFERRED_QUEUE_DEPTH - 1),
+	deferredQueueDepthPow2);
+
 // Private types
 
 // Macros
@@ -67,7 +88,8 @@ struct ObjectEventEntry {
 
 	UAVObjEventCallback       cb;
 	uint8_t                   hasThrottle : 1;
-	uint8_t                   eventMask : 7;
+	uint8_t                   isDeferred : 1;
+	uint8_t                   eventMask : 6;
 	struct ObjectEventEntry * next;
 };
 
@@ -82,11 +104,9 @@ struct ObjectEventEntryThrottled {
 /*
   MetaInstance   == [UAVOBase [UAVObjMetadata]]
   SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-  MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-                                                  \-->[InstanceData1 [next]]
-                                                  _________...________/
-                                                  \-->[InstanceDataN [next]]
+  MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstTable [InstanceData0]]]]
+                                                      |
+                                                      \-->[&InstanceData1, ..., &InstanceDataN]
  */
 
 /*
@@ -105,6 +125,15 @@ struct UAVOBase {
 		bool isSettings    : 1;
 	} flags;
 
+	uint8_t reserved;
+
+	/*
+	 * Incremented before and after every write to this object's data,
+	 * so it is odd while a write is in progress.  Lets readers copy
+	 * the data without taking the mutex; see readObjData().
+	 */
+	volatile uint16_t seq;
+
 } __attribute__((packed));
 
 /* Augmented type for Meta UAVO */
@@ -122,10 +151,16 @@ struct UAVOData {
 	 * inside the payload for this UAVO.
 	 */
 	struct UAVOMeta   metaObj;
-	struct UAVOData * next;
 	uint16_t          instance_size;
 } __attribute__((packed));
 
+/* seq must be naturally aligned, so that it is read and written atomically */
+DONT_BUILD_IF(offsetof(struct UAVOBase, seq) % sizeof(uint16_t),
+	uavoSeqAlign);
+DONT_BUILD_IF((offsetof(struct UAVOData, metaObj) +
+		offsetof(struct UAVOBase, seq)) % sizeof(uint16_t),
+	uavoMetaSeqAlign);
+
 /* Augmented type for Single Instance Data UAVO */
 struct UAVOSingle {
 	struct UAVOData   uavo;
@@ -137,22 +172,28 @@ struct UAVOSingle {
 	 */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-	struct UAVOMultiInst * next;
-	uint8_t                instance[];
-	/*
-	 * Additional space will be malloc'd here to hold the
-	 * the data for this instance.
-	 */
-} __attribute__((packed));
+/*
+ * Data pointers for instances of a multi instance UAVO, in fixed size
+ * chunks chained together.  The heap can't free, so the table is never
+ * reallocated; each new chunk is linked onto the end of the last.
+ */
+#define UAVO_INST_CHUNK 8
+
+struct UAVOInstChunk {
+	struct UAVOInstChunk * next;
+	void                 * inst[UAVO_INST_CHUNK];
+};
 
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
 	struct UAVOData        uavo;
 
 	uint16_t               num_instances;
-	struct UAVOMultiInst   instance0;
+
+	/* Data pointers for instances 1..N, indexed by (instId - 1) */
+	struct UAVOInstChunk * inst_chunks;
+
+	uint8_t                instance0[];
 	/*
 	 * Additional space will be malloc'd here to hold the
 	 * the data for instance 0.
@@ -172,22 +213,39 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void*)(&(( (struct UAVOSingle*)obj )->instance0)))
-#define InstanceDataOffset(inst) ((void*)&(( (struct UAVOMultiInst*)inst )->instance))
 #define InstanceData(instance) (void*)instance
 
+#define INSTANCE_COPY_ALL 0xffffffff
+
 // Private functions
+static uint16_t indexLowerBound(uint32_t id);
+static void beginObjWrite(struct UAVOBase *obj);
+static void endObjWrite(struct UAVOBase *obj);
+static void readObjData(struct UAVOBase *obj, void *dataOut,
+			const void *src, uint32_t size);
+static void deferEvent(const struct ObjectEventEntry *event,
+			const UAVObjEvent *msg);
 static int32_t sendEvent(struct UAVOBase *obj, uint16_t instId,
 			UAVObjEventType event, void *obj_data, int len);
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId);
 static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId);
 static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask,
-			uint16_t interval);
+			uint16_t interval, bool deferred);
+static int32_t startDeferredDispatch(void);
+static void deferredDispatchTask(void *parameters);
 static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb, void *cbCtx);
 
 // Private variables
-static struct UAVOData * uavo_list;
+
+/*
+ * All registered objects, sorted by ID so that lookups are a binary search.
+ * Object IDs are always even and each metaobject ID is its parent's ID + 1,
+ * so one search resolves both.
+ */
+static struct UAVOData * uavo_index[UAVOBJECTS_COUNT];
+static uint16_t uavo_count;
 static struct ObjectEventEntry * events_unused;
 static struct ObjectEventEntry * events_unused_throttled;
 static struct pios_recursive_mutex *mutex;
@@ -210,6 +268,24 @@ static new_uavo_instance_cb_t newUavObjInstanceCB;
 
 static void *cb_stack;
 
+/*
+ * Callbacks connected with UAVObjConnectCallbackDeferred() are queued here
+ * and run from the dispatch thread, rather than from within the setter.
+ * Entries are only added with the mutex held, and only removed by the
+ * dispatch thread, so the thread can drain it without taking the mutex.
+ */
+static struct DeferredEvent {
+	UAVObjEventCallback cb;
+	void *cbCtx;
+	UAVObjEvent msg;
+	uint32_t queued_at;
+} deferred_events[UAVO_DEFERRED_QUEUE_DEPTH];
+
+static volatile uint16_t deferred_head;
+static volatile uint16_t deferred_tail;
+static struct pios_semaphore *deferred_sema;
+static struct pios_thread *deferred_thread;
+
 /**
  * Initialize the object manager
  * \return 0 Success
@@ -218,7 +294,7 @@ static void *cb_stack;
 int32_t UAVObjInitialize()
 {
 	// Initialize variables
-	uavo_list = NULL;
+	uavo_count = 0;
 	events_unused = NULL;
 	events_unused_throttled = NULL;
 
@@ -323,10 +399,10 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 
 	/* Set up the type-specific part of the UAVO */
 	uavo_multi->num_instances = 1;
+	uavo_multi->inst_chunks = NULL;
 
 	/* Clear the instance data carried in the UAVO */
-	uavo_multi->instance0.next = NULL;
-	memset (&(uavo_multi->instance0.instance), 0, num_bytes);
+	memset(uavo_multi->instance0, 0, num_bytes);
 
 	/* Give back the generic UAVO part */
 	return (&(uavo_multi->uavo));
@@ -359,6 +435,10 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	if (UAVObjGetByID(id))
 		goto unlock_exit;
 
+	/* The object index is sized for every object known at build time */
+	if (uavo_count >= UAVOBJECTS_COUNT)
+		goto unlock_exit;
+
 	/* Map the various flags to one of the UAVO types we understand */
 	if (isSingleInstance) {
 		uavo_data = UAVObjAllocSingle (num_bytes);
@@ -379,8 +459,13 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	/* Initialize the embedded meta UAVO */
 	UAVObjInitMetaData (&uavo_data->metaObj);
 
-	/* Add the newly created object to the global list of objects */
-	LL_APPEND(uavo_list, uavo_data);
+	/* Insert the newly created object into the sorted object index */
+	uint16_t pos = indexLowerBound(id);
+
+	memmove(&uavo_index[pos + 1], &uavo_index[pos],
+		(uavo_count - pos) * sizeof(uavo_index[0]));
+	uavo_index[pos] = uavo_data;
+	uavo_count++;
 
 	/* Initialize object fields and metadata to default values */
 	if (initCb)
@@ -411,23 +496,25 @@ UAVObjHandle UAVObjGetByID(uint32_t id)
 {
 	UAVObjHandle found_obj = NULL;
 
+	/* Metaobjects share the index entry of their parent object */
+	uint32_t data_id = id & ~1;
+
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
 	// Look for object
-	struct UAVOData * tmp_obj;
-	LL_FOREACH(uavo_list, tmp_obj) {
-		if (tmp_obj->id == id) {
+	uint16_t pos = indexLowerBound(data_id);
+
+	if ((pos < uavo_count) && (uavo_index[pos]->id == data_id)) {
+		struct UAVOData * tmp_obj = uavo_index[pos];
+
+		if (id == data_id) {
 			found_obj = &tmp_obj->base;
-			goto unlock_exit;
-		}
-		if (MetaObjectId(tmp_obj->id) == id) {
+		} else {
 			found_obj = &(tmp_obj->metaObj.base);
-			goto unlock_exit;
 		}
 	}
 
-unlock_exit:
 	PIOS_Recursive_Mutex_Unlock(mutex);
 	return found_obj;
 }
@@ -635,7 +722,6 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 
 		target = MetaDataPtr((struct UAVOMeta *)obj_handle);
 		len = MetaNumBytes;
-		memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
 	} else {
 		struct UAVOData *obj;
 		InstanceHandle instEntry;
@@ -659,7 +745,9 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 		len = obj->instance_size;
 	}
 
+	beginObjWrite((struct UAVOBase *)obj_handle);
 	memcpy(target, dataIn, len);
+	endObjWrite((struct UAVOBase *)obj_handle);
 
 	// Fire event
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED,
@@ -681,39 +769,8 @@ unlock_exit:
  */
 int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t * dataOut)
 {
-	PIOS_Assert(obj_handle);
-
-	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-
-	int32_t rc = -1;
-
-	if (UAVObjIsMetaobject(obj_handle)) {
-		if (instId != 0) {
-			goto unlock_exit;
-		}
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
-	} else {
-		struct UAVOData *obj;
-		InstanceHandle instEntry;
-
-		// Cast handle to object
-		obj = (struct UAVOData *) obj_handle;
-
-		// Get the instance
-		instEntry = getInstance(obj, instId);
-		if (instEntry == NULL) {
-			goto unlock_exit;
-		}
-		// Pack data
-		memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
-	}
-
-	rc = 0;
-
-unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
-	return rc;
+	return UAVObjGetInstanceDataField(obj_handle, instId, dataOut,
+		0, INSTANCE_COPY_ALL);
 }
 
 #if defined(PIOS_INCLUDE_FASTHEAP)
@@ -824,12 +881,17 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 {
 	PIOS_Assert(obj_handle);
 
+	// Lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	int32_t rc = -1;
+
 	void *target;
 	int len;
 
 	if (UAVObjIsMetaobject(obj_handle)) {
 		if (instId != 0)
-			return -1;
+			goto unlock_exit;
 
 		target = MetaDataPtr((struct UAVOMeta *)obj_handle);
 		len = UAVObjGetNumBytes(obj_handle);
@@ -838,37 +900,44 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 		InstanceHandle instEntry = getInstance( (struct UAVOData *)obj_handle, instId);
 
 		if (instEntry == NULL)
-			return -1;
+			goto unlock_exit;
 
 		target = InstanceData(instEntry);
 		len = UAVObjGetNumBytes(obj_handle);
 	}
 
 	// Load the object from the filesystem
-	int32_t rc;
 #if defined(PIOS_INCLUDE_FASTHEAP)
 	rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id,
 			UAVObjGetID(obj_handle),
 			instId,
 			uavobj_load_trampoline,
 			len);
+
+	if (rc != 0)
+		goto unlock_exit;
+
+	beginObjWrite((struct UAVOBase *)obj_handle);
+	memcpy(target, uavobj_load_trampoline, len);
+	endObjWrite((struct UAVOBase *)obj_handle);
 #else  /* PIOS_INCLUDE_FASTHEAP */
+	beginObjWrite((struct UAVOBase *)obj_handle);
 	rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id,
 			UAVObjGetID(obj_handle),
 			instId,
 			target,
 			len);
-#endif  /* PIOS_INCLUDE_FASTHEAP */
+	endObjWrite((struct UAVOBase *)obj_handle);
 
 	if (rc != 0)
-		return -1;
-
-#if defined(PIOS_INCLUDE_FASTHEAP)
-	memcpy(target, uavobj_load_trampoline, len);
+		goto unlock_exit;
 #endif  /* PIOS_INCLUDE_FASTHEAP */
 
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED, target, len);
-	return 0;
+
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return rc == 0 ? 0 : -1;
 }
 
 /**
@@ -898,7 +967,9 @@ int32_t UAVObjSaveSettings()
 	int32_t rc = -1;
 
 	// Save all settings objects
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		// Check if this is a settings object
 		if (UAVObjIsSettings(&obj->base)) {
 			// Save object
@@ -930,7 +1001,9 @@ int32_t UAVObjLoadSettings()
 	int32_t rc = -1;
 
 	// Load all settings objects
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		// Check if this is a settings object
 		if (UAVObjIsSettings(&obj->base)) {
 			// Load object
@@ -962,7 +1035,9 @@ int32_t UAVObjDeleteSettings()
 	int32_t rc = -1;
 
 	// Save all settings objects
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		// Check if this is a settings object
 		if (UAVObjIsSettings(&obj->base)) {
 			// Save object
@@ -994,7 +1069,9 @@ int32_t UAVObjSaveMetaobjects()
 	int32_t rc = -1;
 
 	// Save all settings objects
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		// Save object
 		if (UAVObjSave(MetaObjectPtr(obj), 0) ==
 			-1) {
@@ -1023,7 +1100,9 @@ int32_t UAVObjLoadMetaobjects()
 	int32_t rc = -1;
 
 	// Load all settings objects
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		// Load object
 		if (UAVObjLoad((UAVObjHandle) MetaObjectPtr(obj), 0) ==
 			-1) {
@@ -1052,7 +1131,9 @@ int32_t UAVObjDeleteMetaobjects()
 	int32_t rc = -1;
 
 	// Load all settings objects
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		// Load object
 		if (UAVObjDeleteById(UAVObjGetID(MetaObjectPtr(obj)), 0)
 			== -1) {
@@ -1111,8 +1192,6 @@ int32_t UAVObjGetDataField(UAVObjHandle obj_handle, void* dataOut, uint32_t offs
 	return UAVObjGetInstanceDataField(obj_handle, 0, dataOut, offset, size);
 }
 
-#define INSTANCE_COPY_ALL 0xffffffff
-
 /**
  * Set the data of a specific object instance
  * \param[in] obj The object handle
@@ -1189,7 +1268,9 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 	}
 
 	// Set data
+	beginObjWrite((struct UAVOBase *)obj_handle);
 	memcpy(target + offset, dataIn, size);
+	endObjWrite((struct UAVOBase *)obj_handle);
 
 	// Fire event
 	sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED,
@@ -1211,41 +1292,8 @@ unlock_exit:
 int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 			void *dataOut)
 {
-	PIOS_Assert(obj_handle);
-
-	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-
-	int32_t rc = -1;
-
-	if (UAVObjIsMetaobject(obj_handle)) {
-		// Get instance information
-		if (instId != 0) {
-			goto unlock_exit;
-		}
-		// Set data
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
-	} else {
-		struct UAVOData *obj;
-		InstanceHandle instEntry;
-
-		// Cast to object info
-		obj = (struct UAVOData *) obj_handle;
-
-		// Get instance information
-		instEntry = getInstance(obj, instId);
-		if (instEntry == NULL) {
-			goto unlock_exit;
-		}
-		// Set data
-		memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
-	}
-
-	rc = 0;
-
-unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
-	return rc;
+	return UAVObjGetInstanceDataField(obj_handle, instId, dataOut,
+		0, INSTANCE_COPY_ALL);
 }
 
 /**
@@ -1259,24 +1307,18 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-
-	int32_t rc = -1;
+	const void *src;
+	uint32_t obj_len;
 
 	if (UAVObjIsMetaobject(obj_handle)) {
 		// Get instance information
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
 
-		// Check for overrun
-		if ((size + offset) > MetaNumBytes) {
-			goto unlock_exit;
-		}
+		obj_len = MetaNumBytes;
 
-		// Set data
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+		src = MetaDataPtr((struct UAVOMeta *)obj_handle);
 	} else {
 		struct UAVOData * obj;
 		InstanceHandle instEntry;
@@ -1284,26 +1326,33 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 		// Cast to object info
 		obj = (struct UAVOData *)obj_handle;
 
-		// Get instance information
+		// Get instance information.  Instance chunks and data are
+		// never moved or freed, and createInstance() publishes them
+		// before the instance count, so no lock is needed.
 		instEntry = getInstance(obj, instId);
+
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
 
-		// Check for overrun
-		if ((size + offset) > obj->instance_size) {
-			goto unlock_exit;
-		}
+		obj_len = obj->instance_size;
 
-		// Set data
-		memcpy(dataOut, InstanceData(instEntry) + offset, size);
+		src = InstanceData(instEntry);
 	}
 
-	rc = 0;
+	if (size == INSTANCE_COPY_ALL) {
+		size = obj_len;
+	}
 
-unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
-	return rc;
+	// Check for overrun
+	if ((size + offset) > obj_len) {
+		return -1;
+	}
+
+	// Get data
+	readObjData((struct UAVOBase *)obj_handle, dataOut, src + offset, size);
+
+	return 0;
 }
 
 /**
@@ -1339,9 +1388,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata * dataOut)
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-
 	// Get metadata
 	if (UAVObjIsMetaobject(obj_handle)) {
 		memcpy(dataOut, &defMetadata, sizeof(UAVObjMetadata));
@@ -1350,8 +1396,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata * dataOut)
 			dataOut);
 	}
 
-	// Unlock
-	PIOS_Recursive_Mutex_Unlock(mutex);
 	return 0;
 }
 
@@ -1516,7 +1560,8 @@ int32_t UAVObjConnectQueueThrottled(UAVObjHandle obj_handle,
 	PIOS_Assert(queue);
 	int32_t res;
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-	res = connectObj(obj_handle, queue, NULL, NULL, eventMask, interval);
+	res = connectObj(obj_handle, queue, NULL, NULL, eventMask, interval,
+			false);
 	PIOS_Recursive_Mutex_Unlock(mutex);
 	return res;
 }
@@ -1596,7 +1641,7 @@ int32_t UAVObjConnectCallbackThrottled(UAVObjHandle obj_handle, UAVObjEventCallb
 	PIOS_Assert(obj_handle);
 	int32_t res;
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-	res = connectObj(obj_handle, 0, cb, cbCtx, eventMask, interval);
+	res = connectObj(obj_handle, 0, cb, cbCtx, eventMask, interval, false);
 	PIOS_Recursive_Mutex_Unlock(mutex);
 	return res;
 }
@@ -1607,6 +1652,31 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
 	return UAVObjConnectCallbackThrottled(obj_handle, cb, cbCtx, eventMask, 0);
 }
 
+/**
+ * Connect an event callback to the object, to be run later from the
+ * object manager's dispatch thread instead of from within the update.
+ * Use this for callbacks that do real work, so that they do not delay the
+ * task which updated the object.  The callback is passed no object data
+ * (obj is NULL and len is 0); it should Get() the object if it needs it.
+ * \param[in] obj The object handle
+ * \param[in] cb The event callback
+ * \param[in] eventMask The event mask, if EV_MASK_ALL_UPDATES then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectCallbackDeferred(UAVObjHandle obj_handle,
+			UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask)
+{
+	PIOS_Assert(obj_handle);
+	int32_t res;
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	res = startDeferredDispatch();
+	if (res == 0) {
+		res = connectObj(obj_handle, 0, cb, cbCtx, eventMask, 0, true);
+	}
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return res;
+}
+
 /**
  * Disconnect an event callback from the object.
  * \param[in] obj The object handle
@@ -1661,7 +1731,9 @@ void UAVObjIterate(void (*iterator) (UAVObjHandle obj))
 
 	// Iterate through the list and invoke iterator for each object
 	struct UAVOData *obj;
-	LL_FOREACH(uavo_list, obj) {
+	for (uint16_t i = 0; i < uavo_count; i++) {
+		obj = uavo_index[i];
+
 		(*iterator) ((UAVObjHandle) obj);
 		(*iterator) ((UAVObjHandle) &obj->metaObj);
 	}
@@ -1722,6 +1794,42 @@ static void invokeCallback(const struct ObjectEventEntry *event,
 #define invokeCallback realInvokeCallback
 #endif
 
+/**
+ * Queue a callback for the dispatch thread.  Must be called with the
+ * mutex held.
+ */
+static void deferEvent(const struct ObjectEventEntry *event,
+		const UAVObjEvent *msg)
+{
+	uint16_t head = deferred_head;
+	uint16_t backlog = head - deferred_tail;
+
+	if (backlog >= UAVO_DEFERRED_QUEUE_DEPTH) {
+		stats.eventCallbackErrors++;
+		stats.lastCallbackErrorID = UAVObjGetID(msg->obj);
+		return;
+	}
+
+	struct DeferredEvent *slot =
+		&deferred_events[head % UAVO_DEFERRED_QUEUE_DEPTH];
+
+	slot->cb = event->cb;
+	slot->cbCtx = event->cbInfo.cbCtx;
+	slot->msg = *msg;
+	slot->msg.throttle = NULL;
+	slot->queued_at = PIOS_DELAY_GetRaw();
+
+	/* Publish the entry only once it is complete */
+	__sync_synchronize();
+	deferred_head = head + 1;
+
+	if (backlog + 1 > stats.deferredBacklogMax) {
+		stats.deferredBacklogMax = backlog + 1;
+	}
+
+	PIOS_Semaphore_Give(deferred_sema);
+}
+
 static int32_t pumpOneEvent(UAVObjEvent *msg, void *obj_data, int len) {
 	// Go through each object and push the event message in the queue (if event is activated for the queue)
 	struct ObjectEventEntry *event;
@@ -1757,7 +1865,9 @@ static int32_t pumpOneEvent(UAVObjEvent *msg, void *obj_data, int len) {
 			}
 
 			// Invoke callback (from event task) if a valid one is registered
-			if (event->cb) {
+			if (event->cb && event->isDeferred) {
+				deferEvent(event, msg);
+			} else if (event->cb) {
 				// invoke callback directly; callbacks must be well behaved
 				invokeCallback(event, msg, obj_data, len);
 			} else if (event->cbInfo.queue) {
@@ -1788,37 +1898,48 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType triggered_event,
 			void *obj_data, int len)
 {
-	static uint8_t num_pending = 0;
-
 	static struct PendEvent {
 		UAVObjEvent msg;
 		void *obj_data;
 		int len;
-	} pending_events[3];
+	} pending_events[UAVO_EVENT_QUEUE_DEPTH];
+
+	static uint8_t pending_first = 0;
+	static uint8_t num_pending = 0;
+
+	static struct UAVOBase *in_progress = NULL;
 
 	/* The logic to spool up callbacks here may be a little confusing.
 	 * basically, this relies on the fact that we are in a re-entrant
-	 * locked section.  If we get in here and the static variable
-	 * in_progress is set, we are entering from a task that itself is
-	 * performing a parent callback.
+	 * locked section.  If we get in here and in_progress is set, we
+	 * are entering from a task that itself is performing a parent
+	 * callback.
 	 *
 	 * In other words, while executing a callback it did a uav object
 	 * update that will trigger in turn more callbacks.
 	 *
-	 * To handle this, we have a small buffer to store the pending
-	 * callbacks.
+	 * To handle this, such events are queued in a small ring and
+	 * dispatched in order by the outermost call once the current
+	 * callback returns.
 	 *
 	 * We also make the point of disallowing a callback from generating
-	 * the exact same callback.  This is relevant to things like
-	 * the session managing object in telemetry.  While it is possible
-	 * to do this safely (by "stopping" the quasi-recursion) it seems
-	 * better to disallow it.
+	 * the exact same callback while other events are still backed up.
+	 * This is relevant to things like the session managing object in
+	 * telemetry.  A callback updating its own object with nothing else
+	 * pending is delivered once more, to queues and callbacks alike,
+	 * so a callback must not update its own object unconditionally.
 	 *
 	 * However, infinite loops are still possible; callback A can
 	 * trigger callback B which triggers callback A.  Don't do that.
 	 */
 
-	if (num_pending >= 3) {
+	if (num_pending && (in_progress == obj)) {
+		return -1;	/* We don't fire events
+				 * of the same type generated by
+				 * an event callback. */
+	}
+
+	if (num_pending >= UAVO_EVENT_QUEUE_DEPTH) {
 		/* Unable to pump event; backlog too long */
 		stats.eventCallbackErrors++;
 		stats.lastCallbackErrorID = UAVObjGetID(obj);
@@ -1826,43 +1947,44 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 		return -1;
 	}
 
-	static struct UAVOBase *in_progress = NULL;
-
-	if (num_pending) {
-		if (in_progress == obj) {
-			return -1;	/* We don't fire events
-					 * of the same type generated by
-					 * an event callback. */
-		}
-	}
+	struct PendEvent *pend = &pending_events[
+		(pending_first + num_pending) % UAVO_EVENT_QUEUE_DEPTH];
 
-	pending_events[num_pending].msg = (UAVObjEvent) {
+	pend->msg = (UAVObjEvent) {
 		.obj    = obj,
 		.event  = triggered_event,
 		.instId = instId
 	};
 
-	pending_events[num_pending].obj_data = obj_data;
-	pending_events[num_pending].len = len;
+	pend->obj_data = obj_data;
+	pend->len = len;
 
 	num_pending++;
 
-	/* Only enter the section of pumping events if we are the "first event" */
-	if (!in_progress) {
-		/* While there are events to pump.. */
-		while (num_pending) {
-			/* Deallocate the top one.. */
-			num_pending--;
-
-			/* Mask off events of the same type resulting from
-			 * the callback... */
-			in_progress = pending_events[num_pending].msg.obj;
-
-			/* And pump the event. */
-			pumpOneEvent(&pending_events[num_pending].msg,
-				pending_events[num_pending].obj_data,
-				pending_events[num_pending].len);
-		}
+	if (num_pending > stats.eventBacklogMax) {
+		stats.eventBacklogMax = num_pending;
+	}
+
+	/* Only the outermost call pumps events; nested calls just queue */
+	if (in_progress) {
+		return 0;
+	}
+
+	/* While there are events to pump.. */
+	while (num_pending) {
+		/* Take the oldest one, as the slot may be reused by
+		 * events that its callbacks generate. */
+		struct PendEvent ev = pending_events[pending_first];
+
+		pending_first = (pending_first + 1) % UAVO_EVENT_QUEUE_DEPTH;
+		num_pending--;
+
+		/* Mask off events of the same type resulting from
+		 * the callback... */
+		in_progress = ev.msg.obj;
+
+		/* And pump the event. */
+		pumpOneEvent(&ev.msg, ev.obj_data, ev.len);
 	}
 
 	in_progress = NULL;
@@ -1870,12 +1992,149 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 	return 0;
 }
 
+/**
+ * Create the thread which runs deferred callbacks, if it is not already
+ * running.  Must be called with the mutex held.
+ */
+static int32_t startDeferredDispatch(void)
+{
+	if (deferred_thread) {
+		return 0;
+	}
+
+	if (!deferred_sema) {
+		deferred_sema = PIOS_Semaphore_Create();
+
+		if (!deferred_sema) {
+			return -1;
+		}
+	}
+
+	deferred_thread = PIOS_Thread_Create(deferredDispatchTask,
+			"UAVODispatch", UAVO_DISPATCH_STACK_SIZE, NULL,
+			UAVO_DISPATCH_PRIORITY);
+
+	if (!deferred_thread) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Run deferred callbacks as they are queued.
+ */
+static void deferredDispatchTask(void *parameters)
+{
+	(void) parameters;
+
+	while (true) {
+		PIOS_Semaphore_Take(deferred_sema, PIOS_SEMAPHORE_TIMEOUT_MAX);
+
+		uint16_t tail = deferred_tail;
+
+		while (tail != deferred_head) {
+			__sync_synchronize();
+
+			struct DeferredEvent ev =
+				deferred_events[tail % UAVO_DEFERRED_QUEUE_DEPTH];
+
+			/* Hand the slot back before running the callback */
+			__sync_synchronize();
+			deferred_tail = ++tail;
+
+			uint32_t latency = PIOS_DELAY_DiffuS(ev.queued_at);
+
+			if (latency > stats.deferredLatencyMax) {
+				stats.deferredLatencyMax = latency;
+			}
+
+			ev.cb(&ev.msg, ev.cbCtx, NULL, 0);
+		}
+	}
+}
+
+/**
+ * Find the position in the object index of the first object whose ID is
+ * not less than id.  Must be called with the mutex held.
+ */
+static uint16_t indexLowerBound(uint32_t id)
+{
+	uint16_t lo = 0;
+	uint16_t hi = uavo_count;
+
+	while (lo < hi) {
+		uint16_t mid = (lo + hi) / 2;
+
+		if (uavo_index[mid]->id < id) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * Mark the start of a write to the object's data.  Must be called with
+ * the mutex held, and paired with endObjWrite() before it is released.
+ */
+static void beginObjWrite(struct UAVOBase *obj)
+{
+	obj->seq++;
+	__sync_synchronize();
+}
+
+/**
+ * Mark the end of a write to the object's data.
+ */
+static void endObjWrite(struct UAVOBase *obj)
+{
+	__sync_synchronize();
+	obj->seq++;
+}
+
+/**
+ * Copy data out of an object without holding the mutex if possible.
+ *
+ * If a write completes during the copy, the copy is retried.  If a write
+ * is in progress, fall back to taking the mutex instead of spinning: on a
+ * single core the writer may be a preempted lower priority task, which
+ * would never finish while we retry.  All writers hold the mutex.
+ */
+static void readObjData(struct UAVOBase *obj, void *dataOut,
+			const void *src, uint32_t size)
+{
+	for (int i = 0; i < 3; i++) {
+		uint16_t seq = obj->seq;
+
+		if (seq & 1) {
+			break;
+		}
+
+		__sync_synchronize();
+
+		memcpy(dataOut, src, size);
+
+		__sync_synchronize();
+
+		if (obj->seq == seq) {
+			return;
+		}
+	}
+
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	memcpy(dataOut, src, size);
+	PIOS_Recursive_Mutex_Unlock(mutex);
+}
+
 /**
  * Create a new object instance, return the instance info or NULL if failure.
  */
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 {
-	struct UAVOMultiInst *instEntry;
+	void *instEntry;
 
 	/* Don't allow more than one instance for single instance objects */
 	if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1900,14 +2159,46 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 		}
 	}
 
+	struct UAVOMulti *uavo_multi = (struct UAVOMulti *) obj;
+
+	/* Find the chunk for this instance, chaining on a new one when
+	 * the last is full */
+	uint16_t chunk_num = (instId - 1) / UAVO_INST_CHUNK;
+	struct UAVOInstChunk *chunk = uavo_multi->inst_chunks;
+	struct UAVOInstChunk *prev = NULL;
+
+	for (; chunk && chunk_num > 0; chunk_num--) {
+		prev = chunk;
+		chunk = chunk->next;
+	}
+
+	if (!chunk) {
+		chunk = PIOS_malloc_no_dma(sizeof(struct UAVOInstChunk));
+		if (!chunk)
+			return NULL;
+
+		memset(chunk, 0, sizeof(struct UAVOInstChunk));
+
+		/* Lockless readers may walk the chain; link it zeroed */
+		__sync_synchronize();
+
+		if (prev)
+			prev->next = chunk;
+		else
+			uavo_multi->inst_chunks = chunk;
+	}
+
 	/* Create the actual instance */
-	instEntry = (struct UAVOMultiInst *) PIOS_malloc_no_dma(sizeof(struct UAVOMultiInst)+obj->instance_size);
+	instEntry = PIOS_malloc_no_dma(obj->instance_size);
 	if (!instEntry)
 		return NULL;
-	memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
-	LL_APPEND(( (struct UAVOMulti*)obj )->instance0.next, instEntry);
+	memset(instEntry, 0, obj->instance_size);
+
+	chunk->inst[(instId - 1) % UAVO_INST_CHUNK] = instEntry;
 
-	( (struct UAVOMulti*)obj )->num_instances++;
+	/* Publish the entry before the count that makes it visible */
+	__sync_synchronize();
+	uavo_multi->num_instances++;
 
 	// Fire event
 	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
@@ -1916,7 +2207,7 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 	if (newUavObjInstanceCB) {
 		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(&obj->base));
 	}
-	return InstanceDataOffset(instEntry);
+	return instEntry;
 }
 
 /**
@@ -1950,17 +2241,18 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
 		if (instId >= uavo_multi->num_instances)
 			return NULL;
 
-		// Look for specified instance ID
-		uint16_t instance = 0;
-		struct UAVOMultiInst *instEntry;
-		LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-			if (instance++ == instId) {
-				/* Found it */
-				return &(instEntry->instance);
-			}
+		if (instId == 0)
+			return uavo_multi->instance0;
+
+		/* Pairs with createInstance(): the entry is in place */
+		__sync_synchronize();
+
+		struct UAVOInstChunk *chunk = uavo_multi->inst_chunks;
+		for (uint16_t n = (instId - 1) / UAVO_INST_CHUNK; n > 0; n--) {
+			chunk = chunk->next;
 		}
-		/* Instance was not found */
-		return NULL;
+
+		return chunk->inst[(instId - 1) % UAVO_INST_CHUNK];
 	}
 }
 
@@ -1975,7 +2267,7 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
  */
 static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask,
-			uint16_t interval)
+			uint16_t interval, bool deferred)
 {
 	if (queue && cb) {
 		return -1;
@@ -1992,6 +2284,7 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 				((!event->cb) && event->cbInfo.queue == queue)) {
 			// Already connected, update event mask and throttling (if possible)
 			event->eventMask = eventMask;
+			event->isDeferred = deferred;
 			if (event->hasThrottle) {
 				if (interval == 0) {
 					event->hasThrottle = 0;
@@ -2051,6 +2344,7 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 
 	event->eventMask = eventMask;
 	event->hasThrottle = 0;
+	event->isDeferred = deferred;
 
 	if (interval) {
 		event->hasThrottle = 1;
@@ -2135,46 +2429,28 @@ int32_t getEventMask(UAVObjHandle obj_handle, struct pios_queue *queue)
  */
 uint8_t UAVObjCount()
 {
-	uint8_t count = 0;
-	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-
-	// Look for object
-	struct UAVOData * tmp_obj;
-	LL_FOREACH(uavo_list, tmp_obj) {
-		++count;
-	}
-
-	// Release lock
-	PIOS_Recursive_Mutex_Unlock(mutex);
-	return count;
+	return uavo_count;
 }
 
 /**
- * UAVObjIDByIndex returns the ID of the object with index index
- * \return the ID of the object
+ * UAVObjIDByIndex returns the ID of the object with index index.
+ * Objects are indexed in ascending order of ID.
+ * \return the ID of the object, or 0 if index is out of range
  */
 uint32_t UAVObjIDByIndex(uint8_t index)
 {
-	uint8_t count = 0;
+	uint32_t id = 0;
+
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
-	// Look for object
-	struct UAVOData * tmp_obj;
-	LL_FOREACH(uavo_list, tmp_obj) {
-		if (count == index)
-		{
-			// Release lock
-			PIOS_Recursive_Mutex_Unlock(mutex);
-			return tmp_obj->id;
-		}
-		++count;
+	if (index < uavo_count) {
+		id = uavo_index[index]->id;
 	}
 
 	// Release lock
 	PIOS_Recursive_Mutex_Unlock(mutex);
-	return 0;
+	return id;
 }
 
 /**
@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the CRC functions
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <string.h>		/* strlen */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+#include "pios_crc.h"
+#include "crc8_test_vectors.h"
+}
+
+static double now_s()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t crc8_bytewise(uint8_t crc, const uint8_t *data, int32_t length)
+{
+  while (length--)
+    crc = PIOS_CRC_updateByte(crc, *data++);
+
+  return crc;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class CRC8 : public testing::Test {
+protected:
+  virtual void SetUp() {
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(CRC8, CheckValue) {
+  const uint8_t *check = (const uint8_t *) CRC8_TEST_CHECK_STRING;
+  int32_t len = strlen(CRC8_TEST_CHECK_STRING);
+
+  EXPECT_EQ(CRC8_TEST_CHECK_VALUE, crc8_bytewise(0, check, len));
+  EXPECT_EQ(CRC8_TEST_CHECK_VALUE, PIOS_CRC_updateCRC(0, check, len));
+}
+
+TEST_F(CRC8, Vectors) {
+  /* Room to start each vector at every offset within a word */
+  static uint8_t buf[CRC8_TEST_MAX_LENGTH + 8];
+
+  for (uint32_t i = 0; i < CRC8_TEST_NUM_VECTORS; i++) {
+    const struct crc8_test_vector *v = &crc8_test_vectors[i];
+
+    for (int offset = 0; offset < 8; offset++) {
+      crc8_test_fill(buf + offset, v->length, v->seed);
+
+      EXPECT_EQ(v->crc_out, crc8_bytewise(v->crc_in, buf + offset, v->length))
+        << "vector " << i << " offset " << offset;
+      EXPECT_EQ(v->crc_out, PIOS_CRC_updateCRC(v->crc_in, buf + offset, v->length))
+        << "vector " << i << " offset " << offset;
+    }
+  }
+}
+
+TEST_F(CRC8, Chained) {
+  static uint8_t buf[CRC8_TEST_MAX_LENGTH];
+  const struct crc8_test_vector *v = &crc8_test_vectors[CRC8_TEST_NUM_VECTORS - 1];
+
+  crc8_test_fill(buf, v->length, v->seed);
+
+  /* Splitting the buffer anywhere must not change the result */
+  for (uint32_t split = 0; split <= 64; split++) {
+    uint8_t crc = PIOS_CRC_updateCRC(v->crc_in, buf, split);
+    crc = PIOS_CRC_updateCRC(crc, buf + split, v->length - split);
+
+    EXPECT_EQ(v->crc_out, crc) << "split " << split;
+  }
+}
+
+TEST_F(CRC8, Throughput) {
+  /* Typical UAVTalk frame sizes, from a bare ack to the largest object */
+  const int32_t sizes[] = { 8, 32, 64, 255 };
+  static uint8_t buf[256];
+
+  crc8_test_fill(buf, sizeof(buf), 1);
+
+  for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    const int rounds = 4 * 1024 * 1024 / sizes[i];
+    volatile uint8_t sink = 0;
+
+    double start = now_s();
+    for (int r = 0; r < rounds; r++)
+      sink += crc8_bytewise(r, buf, sizes[i]);
+    double bytewise = now_s() - start;
+
+    start = now_s();
+    for (int r = 0; r < rounds; r++)
+      sink += PIOS_CRC_updateCRC(r, buf, sizes[i]);
+    double sliced = now_s() - start;
+
+    printf("%3d byte frames: bytewise %.1f MB/s, word at a time %.1f MB/s\n",
+        sizes[i], rounds * sizes[i] / bytewise / 1e6,
+        rounds * sizes[i] / sliced / 1e6);
+  }
+}
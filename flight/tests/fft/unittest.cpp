@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+
+#include "fft.h"
+
+}
+
+#include <math.h>		/* sin, cos */
+
+// Reference spectrum, computed the slow way in double
+static void dft(const float *x, int n, double *re, double *im)
+{
+  for (int k = 0; k <= n / 2; k++) {
+    re[k] = 0;
+    im[k] = 0;
+
+    for (int t = 0; t < n; t++) {
+      re[k] += x[t] * cos(2 * M_PI * k * t / n);
+      im[k] -= x[t] * sin(2 * M_PI * k * t / n);
+    }
+  }
+}
+
+TEST(RFFT, RejectsBadSizes) {
+  EXPECT_EQ(NULL, rfft_create(0));
+  EXPECT_EQ(NULL, rfft_create(4));
+  EXPECT_EQ(NULL, rfft_create(100));
+  EXPECT_EQ(NULL, rfft_create(8192));
+}
+
+TEST(RFFT, MatchesDFT) {
+  for (int n = RFFT_MIN_SIZE; n <= 1024; n *= 2) {
+    rfft_t fft = rfft_create(n);
+    ASSERT_TRUE(fft != NULL);
+    EXPECT_EQ(n, rfft_size(fft));
+
+    float *buf = new float[n];
+    double *re = new double[n / 2 + 1];
+    double *im = new double[n / 2 + 1];
+
+    srand(n);
+    for (int t = 0; t < n; t++)
+      buf[t] = rand() / (float) RAND_MAX - 0.5f;
+
+    dft(buf, n, re, im);
+    rfft_run(fft, buf);
+
+    // Error grows with the log of the size
+    double eps = 1e-5 * n;
+
+    EXPECT_NEAR(re[0], buf[0], eps) << "n=" << n;
+    EXPECT_NEAR(re[n / 2], buf[1], eps) << "n=" << n;
+
+    for (int k = 1; k < n / 2; k++) {
+      EXPECT_NEAR(re[k], buf[2 * k], eps) << "n=" << n << " k=" << k;
+      EXPECT_NEAR(im[k], buf[2 * k + 1], eps) << "n=" << n << " k=" << k;
+    }
+
+    delete[] buf;
+    delete[] re;
+    delete[] im;
+    free(fft);
+  }
+}
+
+TEST(RFFT, ShrinksWithoutAllocating) {
+  const int n = 64;
+  rfft_t big = rfft_create(1024);
+  rfft_t small = rfft_create(n);
+  ASSERT_TRUE(big != NULL);
+  ASSERT_TRUE(small != NULL);
+
+  EXPECT_EQ(-1, rfft_set_size(small, 128));
+  EXPECT_EQ(-1, rfft_set_size(big, 100));
+  EXPECT_EQ(0, rfft_set_size(big, n));
+  EXPECT_EQ(n, rfft_size(big));
+
+  float a[n], b[n];
+  for (int t = 0; t < n; t++)
+    a[t] = b[t] = sinf(t * 0.3f) + 0.1f * t;
+
+  rfft_window_hann(big, a);
+  rfft_window_hann(small, b);
+  rfft_run(big, a);
+  rfft_run(small, b);
+
+  for (int t = 0; t < n; t++)
+    EXPECT_FLOAT_EQ(b[t], a[t]);
+
+  free(big);
+  free(small);
+}
+
+TEST(RFFT, ToneAmplitudeAndPeak) {
+  const int n = 256;
+  const float fs = 500;
+  rfft_t fft = rfft_create(n);
+  ASSERT_TRUE(fft != NULL);
+
+  float buf[n];
+
+  // A tone on bin 20 and a weaker one between bins 70 and 71
+  for (int t = 0; t < n; t++)
+    buf[t] = 2.0f * sinf(2 * M_PI * 20 * t / n) +
+      0.5f * sinf(2 * M_PI * 70.5f * t / n) + 3.0f;
+
+  rfft_window_hann(fft, buf);
+  rfft_run(fft, buf);
+  rfft_magnitude(fft, buf);
+
+  EXPECT_NEAR(2.0f, buf[20], 1e-3f);
+  EXPECT_NEAR(1.0f, buf[19], 1e-3f);	// Hann leaks half into neighbours
+  EXPECT_NEAR(0.0f, buf[10], 1e-3f);
+  EXPECT_NEAR(0.0f, buf[100], 1e-3f);
+
+  float peak = rfft_peak_bin(buf, n / 2, 2);
+  EXPECT_NEAR(20, peak, 1e-3f);
+  EXPECT_NEAR(20 * fs / n, peak * fs / n, 0.01f);
+
+  // Search past the strong tone to find the off-bin one
+  peak = rfft_peak_bin(buf, n / 2, 40);
+  EXPECT_NEAR(70.5f, peak, 0.1f);
+
+  free(fft);
+}
+
+TEST(RFFT, NoPeakInSilence) {
+  float mag[32] = { 0 };
+
+  EXPECT_EQ(0, rfft_peak_bin(mag, 32, 1));
+}
+
+/**
+ * @}
+ * @}
+ */
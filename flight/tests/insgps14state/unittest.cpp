@@ -0,0 +1,483 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+
+#include "insgps.h"
+#include "coordinate_conversions.h"
+#include "simmodel.h"
+
+// Filter internals, to check against
+#define NUMX 14
+#define NUMW 10
+
+extern float F[NUMX][NUMX], G[NUMX][NUMW];
+extern float P[NUMX][NUMX], X[NUMX];
+extern float Q[NUMW];
+
+}
+
+#include <math.h>		/* sqrtf */
+#include <time.h>		/* clock_gettime */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>		/* __rdtsc */
+#define HAVE_CYCLE_COUNTER
+#endif
+
+#define DT 0.002f
+#define STEPS 15000
+
+// Weak vertical field: the mag correction leans on the tilt estimate, and a
+// strong one drags pitch about when the quad is pitched and yawed
+static const float mag_north[3] = { 400, 0, 200 };
+
+// What the sensors report each INS step
+struct sensor_sample {
+  float gyro[3];
+  float accel[3];
+  float mag[3];
+  float pos[3];
+  float vel[3];
+  float baro;
+  uint16_t sensors;
+
+  // What the filter should find
+  float q[4];
+  float true_pos[3];
+  float true_vel[3];
+};
+
+static float gauss()
+{
+  float u1 = (rand() + 1.0f) / ((float) RAND_MAX + 2.0f);
+  float u2 = rand() / (float) RAND_MAX;
+
+  return sqrtf(-2 * logf(u1)) * cosf(2 * M_PI * u2);
+}
+
+/**
+ * Record a flight of the simulated quad: it sits, climbs out and then
+ * weaves about in roll, pitch and yaw.  Sensors are sampled like the
+ * attitude module does, with seeded noise: gyro and accel every step, mag
+ * and baro at 50Hz and GPS at 5Hz, gps_lag steps late.
+ */
+static void record_flight(struct sensor_sample *out, int steps, int gps_lag)
+{
+  struct simmodel_batch *batch = new struct simmodel_batch;
+
+  simmodel_init(batch, 1);
+  srand(42);
+
+  for (int n = 0; n < steps; n++) {
+    float t = n * DT;
+
+    // Rates, so the attitude swings about level
+    if (t > 2) {
+      t -= 2;
+      batch->thrust[0] = t < 3 ? 0.6f : 0.52f;
+      batch->actuator[0][0] = 0.003f * cosf(0.7f * t);
+      batch->actuator[1][0] = 0.003f * cosf(0.5f * t);
+      batch->actuator[2][0] = 0.003f * cosf(0.3f * t);
+    }
+
+    simmodel_step_quadcopter(batch, DT);
+
+    float q[4] = { batch->q[0][0], batch->q[1][0], batch->q[2][0], batch->q[3][0] };
+    float Rbe[3][3];
+    Quaternion2R(q, Rbe);
+
+    float accel_ned[3] = { batch->accel[0][0], batch->accel[1][0], batch->accel[2][0] };
+    float accel[3], mag[3];
+
+    rot_mult(Rbe, accel_ned, accel, false);
+    rot_mult(Rbe, mag_north, mag, false);
+
+    struct sensor_sample *s = &out[n];
+    struct sensor_sample *gps = &out[n > gps_lag ? n - gps_lag : 0];
+
+    for (int i = 0; i < 3; i++) {
+      s->true_pos[i] = batch->pos[i][0];
+      s->true_vel[i] = batch->vel[i][0];
+    }
+
+    for (int i = 0; i < 3; i++) {
+      s->gyro[i] = batch->rate[i][0] * (float) (M_PI / 180) + 0.002f * gauss();
+      s->accel[i] = accel[i] + 0.05f * gauss();
+      s->mag[i] = mag[i] + 3 * gauss();
+      s->pos[i] = gps->true_pos[i] + 0.3f * gauss();
+      s->vel[i] = gps->true_vel[i] + 0.1f * gauss();
+    }
+
+    s->baro = -batch->pos[2][0] + 0.2f * gauss();
+
+    for (int i = 0; i < 4; i++)
+      s->q[i] = q[i];
+
+    s->sensors = 0;
+    if (n % 10 == 0)
+      s->sensors |= MAG_SENSORS | BARO_SENSOR;
+    if (n % 100 == 0)
+      s->sensors |= POS_SENSORS | HORIZ_VEL_SENSORS | VERT_VEL_SENSORS;
+  }
+
+  delete batch;
+}
+
+static void init_ins()
+{
+  const float zeros[3] = { 0, 0, 0 };
+  const float q[4] = { 1, 0, 0, 0 };
+  const float mag_var[3] = { 10, 10, 100 };
+  const float accel_var[3] = { 0.003f, 0.003f, 0.003f };
+  const float gyro_var[3] = { 1e-5f, 1e-5f, 1e-4f };
+
+  INSGPSInit();
+  INSSetMagNorth(mag_north);
+  INSSetMagVar(mag_var);
+  INSSetAccelVar(accel_var);
+  INSSetGyroVar(gyro_var);
+  INSSetBaroVar(0.01f);
+  INSSetPosVelVar(1, 0.1f, 2);
+  INSSetState(zeros, zeros, q, zeros, zeros);
+}
+
+// The general version: Pnew = (I+F*T)*P*(I+F*T)' + T^2*G*Q*G'
+static void dense_prediction(float Pd[NUMX][NUMX], float dT)
+{
+  float Dummy[NUMX][NUMX];
+
+  for (int i = 0; i < NUMX; i++)
+    for (int j = 0; j < NUMX; j++) {
+      Dummy[i][j] = Pd[i][j] / dT;
+      for (int k = 0; k < NUMX; k++)
+        Dummy[i][j] += F[i][k] * Pd[k][j];
+    }
+
+  for (int i = 0; i < NUMX; i++)
+    for (int j = i; j < NUMX; j++) {
+      Pd[i][j] = Dummy[i][j] / dT;
+      for (int k = 0; k < NUMX; k++)
+        Pd[i][j] += Dummy[i][k] * F[j][k];
+      for (int k = 0; k < NUMW; k++)
+        Pd[i][j] += Q[k] * G[i][k] * G[j][k];
+      Pd[j][i] = Pd[i][j] = Pd[i][j] * dT * dT;
+    }
+}
+
+// Largest difference, relative to the standard deviations it couples
+static float covariance_error(float a[NUMX][NUMX], float b[NUMX][NUMX])
+{
+  float worst = 0;
+
+  for (int i = 0; i < NUMX; i++)
+    for (int j = 0; j < NUMX; j++) {
+      float scale = sqrtf(fabsf(b[i][i] * b[j][j]));
+      float err = fabsf(a[i][j] - b[i][j]) / scale;
+
+      if (!(err <= worst))
+        worst = err;
+    }
+
+  return worst;
+}
+
+class INSGPS14 : public testing::Test {
+protected:
+  virtual void SetUp() {
+    flight = new struct sensor_sample[STEPS];
+    record_flight(flight, STEPS, 0);
+  }
+
+  virtual void TearDown() {
+    delete[] flight;
+  }
+
+  void correct(int n) {
+    struct sensor_sample *s = &flight[n];
+
+    INSCorrection(s->mag, s->pos, s->vel, s->baro, s->sensors);
+  }
+
+  /**
+   * Fly the recording, correcting all at once or one sensor group a step
+   * @return RMS position error once settled (m)
+   */
+  float fly(bool spread, float gps_delay = 0) {
+    float sum = 0;
+    int count = 0;
+
+    init_ins();
+    INSSetGPSDelay(gps_delay);
+
+    for (int n = 0; n < STEPS; n++) {
+      struct sensor_sample *s = &flight[n];
+
+      INSStatePrediction(s->gyro, s->accel, DT);
+      INSCovariancePrediction(DT);
+
+      if (spread) {
+        if (s->sensors)
+          INSDeferCorrection(s->mag, s->pos, s->vel, s->baro, s->sensors);
+        INSCorrectionStep();
+      } else {
+        correct(n);
+      }
+
+      if (n * DT < 3)
+        continue;
+
+      for (int i = 0; i < 3; i++) {
+        float err = X[i] - s->true_pos[i];
+        sum += err * err;
+      }
+      count++;
+    }
+
+    return sqrtf(sum / count);
+  }
+
+  struct sensor_sample *flight;
+};
+
+TEST_F(INSGPS14, EachStepMatchesDense) {
+  float Pd[NUMX][NUMX];
+  float worst = 0;
+
+  init_ins();
+
+  for (int n = 0; n < STEPS; n++) {
+    INSStatePrediction(flight[n].gyro, flight[n].accel, DT);
+
+    memcpy(Pd, P, sizeof(Pd));
+    dense_prediction(Pd, DT);
+    INSCovariancePrediction(DT);
+
+    for (int i = 0; i < NUMX; i++)
+      for (int j = 0; j < i; j++)
+        ASSERT_EQ(P[i][j], P[j][i]) << "step " << n;
+
+    float err = covariance_error(P, Pd);
+    ASSERT_LT(err, 1e-5f) << "step " << n;
+
+    if (err > worst)
+      worst = err;
+
+    correct(n);
+  }
+
+  printf("Largest relative difference in one step: %g\n", worst);
+}
+
+TEST_F(INSGPS14, FlightMatchesDense) {
+  float pos[3], vel[3], q[4], gyro_bias[3], accel_bias[3];
+  float Ps[NUMX][NUMX], Xs[NUMX];
+
+  // Once with the filter as built, then with the dense version in its place
+  init_ins();
+
+  for (int n = 0; n < STEPS; n++) {
+    INSStatePrediction(flight[n].gyro, flight[n].accel, DT);
+    INSCovariancePrediction(DT);
+    correct(n);
+  }
+
+  memcpy(Ps, P, sizeof(Ps));
+  memcpy(Xs, X, sizeof(Xs));
+
+  init_ins();
+
+  for (int n = 0; n < STEPS; n++) {
+    INSStatePrediction(flight[n].gyro, flight[n].accel, DT);
+    dense_prediction(P, DT);
+    correct(n);
+  }
+
+  EXPECT_LT(covariance_error(Ps, P), 1e-3f);
+
+  for (int i = 0; i < NUMX; i++)
+    EXPECT_NEAR(X[i], Xs[i], 1e-3f) << "state " << i;
+
+  // And the estimate followed the flight
+  INSGetState(pos, vel, q, gyro_bias, accel_bias);
+
+  struct sensor_sample *last = &flight[STEPS - 1];
+
+  for (int i = 0; i < 3; i++)
+    EXPECT_NEAR(last->pos[i], pos[i], 2) << "axis " << i;
+
+  float dot = 0;
+  for (int i = 0; i < 4; i++)
+    dot += q[i] * last->q[i];
+
+  EXPECT_GT(fabsf(dot), cosf(2 * (float) (M_PI / 180) / 2));
+}
+
+TEST_F(INSGPS14, IgnoresElementsOutsidePattern) {
+  init_ins();
+
+  INSStatePrediction(flight[0].gyro, flight[0].accel, DT);
+
+  // Whatever LinearizeFG doesn't set must never be read
+  for (int i = 0; i < NUMX; i++) {
+    for (int j = 0; j < NUMX; j++)
+      if (F[i][j] == 0)
+        F[i][j] = NAN;
+
+    for (int j = 0; j < NUMW; j++)
+      if (G[i][j] == 0)
+        G[i][j] = NAN;
+  }
+
+  for (int n = 0; n < 1000; n++) {
+    INSStatePrediction(flight[n].gyro, flight[n].accel, DT);
+    INSCovariancePrediction(DT);
+    correct(n);
+  }
+
+  for (int i = 0; i < NUMX; i++)
+    for (int j = 0; j < NUMX; j++)
+      ASSERT_TRUE(isfinite(P[i][j])) << i << "," << j;
+}
+
+TEST_F(INSGPS14, CorrectionStepTakesGroupsInTurn) {
+  const float zeros[3] = { 0, 0, 0 };
+  const float mag[3] = { 400, 0, 200 };
+
+  init_ins();
+
+  INSDeferCorrection(mag, zeros, zeros, 0, FULL_SENSORS);
+
+  EXPECT_EQ(MAG_SENSORS | BARO_SENSOR | HORIZ_VEL_SENSORS | VERT_VEL_SENSORS,
+      INSCorrectionStep());
+  EXPECT_EQ(MAG_SENSORS | BARO_SENSOR, INSCorrectionStep());
+  EXPECT_EQ(BARO_SENSOR, INSCorrectionStep());
+  EXPECT_EQ(0, INSCorrectionStep());
+  EXPECT_EQ(0, INSCorrectionStep());
+
+  INSDeferCorrection(mag, zeros, zeros, 0, HORIZ_POS_SENSORS | BARO_SENSOR);
+  EXPECT_EQ(BARO_SENSOR, INSCorrectionStep());
+
+  // A fresh position waits behind the baro that was already waiting
+  INSDeferCorrection(mag, zeros, zeros, 0, HORIZ_POS_SENSORS);
+  EXPECT_EQ(HORIZ_POS_SENSORS, INSCorrectionStep());
+  EXPECT_EQ(0, INSCorrectionStep());
+}
+
+TEST_F(INSGPS14, SpreadCorrectionsTrackFlight) {
+  float all = fly(false);
+  float spread = fly(true);
+
+  printf("Position RMS error: all at once %.3f m, one group a step %.3f m\n",
+      all, spread);
+
+  EXPECT_LT(spread, 1.2f * all);
+
+  float q[4];
+  INSGetState(NULL, NULL, q, NULL, NULL);
+
+  float dot = 0;
+  for (int i = 0; i < 4; i++)
+    dot += q[i] * flight[STEPS - 1].q[i];
+
+  EXPECT_GT(fabsf(dot), cosf(2 * (float) (M_PI / 180) / 2));
+}
+
+TEST_F(INSGPS14, GPSDelayCompensated) {
+  // GPS 150ms behind
+  record_flight(flight, STEPS, 75);
+
+  float late = fly(false);
+
+  float compensated = fly(false, 0.15f);
+
+  printf("Position RMS error with late GPS: %.3f m, compensated %.3f m\n",
+      late, compensated);
+
+  EXPECT_LT(compensated, 0.8f * late);
+}
+
+TEST_F(INSGPS14, BenchmarkPrediction) {
+  const int n = 20000;
+  float P0[NUMX][NUMX];
+
+  init_ins();
+
+  for (int i = 0; i < 5000; i++) {
+    INSStatePrediction(flight[i].gyro, flight[i].accel, DT);
+    INSCovariancePrediction(DT);
+    correct(i);
+  }
+
+  memcpy(P0, P, sizeof(P0));
+
+  struct timespec start, end;
+  double ns[2], cycles[2] = { 0, 0 };
+
+  for (int pass = 0; pass < 2; pass++) {
+#ifdef HAVE_CYCLE_COUNTER
+    uint64_t start_cycles = __rdtsc();
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < n; i++) {
+      memcpy(P, P0, sizeof(P0));
+
+      if (pass == 0)
+        INSCovariancePrediction(DT);
+      else
+        dense_prediction(P, DT);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns[pass] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / n;
+#ifdef HAVE_CYCLE_COUNTER
+    cycles[pass] = (double) (__rdtsc() - start_cycles) / n;
+#endif
+  }
+
+  printf("Covariance prediction: sparse %.0f ns %.0f cycles, dense %.0f ns %.0f cycles\n",
+      ns[0], cycles[0], ns[1], cycles[1]);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,255 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+
+#include "lpfilter.h"
+
+}
+
+#include <math.h>		/* fabsf */
+#include <time.h>		/* clock_gettime */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>		/* __rdtsc */
+#define HAVE_CYCLE_COUNTER
+#endif
+
+#define DT (1.0f / 8000)
+#define CUTOFF 100.0f
+
+static float noise()
+{
+  return 100 * (rand() / (float) RAND_MAX - 0.5f);
+}
+
+TEST(LPFilter, Bypassed) {
+  lpfilter_state_t filter = NULL;
+  float sample[3] = { 1, 2, 3 };
+
+  lpfilter_run(NULL, sample);
+  EXPECT_EQ(4, lpfilter_run_single(NULL, 0, 4));
+
+  lpfilter_create(&filter, CUTOFF, DT, 0, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  lpfilter_run(filter, sample);
+  EXPECT_EQ(1, sample[0]);
+  EXPECT_EQ(2, sample[1]);
+  EXPECT_EQ(3, sample[2]);
+}
+
+TEST(LPFilter, ThreeAxisMatchesPerAxis) {
+  for (int order = 1; order <= 8; order++) {
+    lpfilter_state_t axes3 = NULL;
+    lpfilter_state_t single[3] = { NULL, NULL, NULL };
+
+    lpfilter_create(&axes3, CUTOFF, DT, order, 3);
+
+    for (int j = 0; j < 3; j++)
+      lpfilter_create(&single[j], CUTOFF, DT, order, 1);
+
+    srand(order);
+
+    for (int t = 0; t < 4000; t++) {
+      float sample[3] = { noise(), noise(), noise() };
+      float expected[3];
+
+      for (int j = 0; j < 3; j++) {
+        expected[j] = sample[j];
+        lpfilter_run(single[j], &expected[j]);
+      }
+
+      lpfilter_run(axes3, sample);
+
+      for (int j = 0; j < 3; j++)
+        ASSERT_NEAR(expected[j], sample[j], 1e-3f) << "order " << order << " t " << t;
+    }
+  }
+}
+
+TEST(LPFilter, RunSingleMatchesRun) {
+  for (int order = 1; order <= 8; order++) {
+    lpfilter_state_t a = NULL, b = NULL;
+
+    lpfilter_create(&a, CUTOFF, DT, order, 3);
+    lpfilter_create(&b, CUTOFF, DT, order, 3);
+
+    srand(order);
+
+    for (int t = 0; t < 1000; t++) {
+      float sample[3] = { noise(), noise(), noise() };
+      float single[3];
+
+      for (int j = 0; j < 3; j++)
+        single[j] = lpfilter_run_single(b, j, sample[j]);
+
+      lpfilter_run(a, sample);
+
+      for (int j = 0; j < 3; j++)
+        ASSERT_NEAR(sample[j], single[j], 1e-4f) << "order " << order << " t " << t;
+    }
+  }
+}
+
+TEST(LPFilter, PassesDCAndResets) {
+  lpfilter_state_t filter = NULL;
+
+  lpfilter_create(&filter, CUTOFF, DT, 4, 3);
+  lpfilter_state_t allocated = filter;
+
+  float sample[3];
+
+  for (int t = 0; t < 2000; t++) {
+    sample[0] = 1;
+    sample[1] = -2;
+    sample[2] = 3;
+    lpfilter_run(filter, sample);
+  }
+
+  EXPECT_NEAR(1, sample[0], 1e-4f);
+  EXPECT_NEAR(-2, sample[1], 1e-4f);
+  EXPECT_NEAR(3, sample[2], 1e-4f);
+
+  // Reconfiguring keeps the memory and starts from rest
+  lpfilter_create(&filter, CUTOFF, DT, 3, 3);
+  EXPECT_EQ(allocated, filter);
+
+  sample[0] = sample[1] = sample[2] = 0;
+  lpfilter_run(filter, sample);
+
+  EXPECT_EQ(0, sample[0]);
+  EXPECT_EQ(0, sample[1]);
+  EXPECT_EQ(0, sample[2]);
+}
+
+TEST(LPFilter, ReconfiguredAcrossKernelOrders) {
+  lpfilter_state_t axes3 = NULL;
+  const int orders[] = { 4, 2, 1, 5, 2 };
+
+  for (unsigned int k = 0; k < sizeof(orders) / sizeof(orders[0]); k++) {
+    int order = orders[k];
+    lpfilter_state_t single[3] = { NULL, NULL, NULL };
+
+    // Low orders run the generic path, higher ones the kernel
+    lpfilter_create(&axes3, CUTOFF, DT, order, 3);
+
+    for (int j = 0; j < 3; j++)
+      lpfilter_create(&single[j], CUTOFF, DT, order, 1);
+
+    srand(order);
+
+    for (int t = 0; t < 1000; t++) {
+      float sample[3] = { noise(), noise(), noise() };
+      float expected[3];
+
+      for (int j = 0; j < 3; j++) {
+        expected[j] = sample[j];
+        lpfilter_run(single[j], &expected[j]);
+      }
+
+      lpfilter_run(axes3, sample);
+
+      for (int j = 0; j < 3; j++)
+        ASSERT_NEAR(expected[j], sample[j], 1e-3f) << "order " << order << " t " << t;
+    }
+  }
+}
+
+// Cost of filtering one 3 axis sample
+struct bench_result {
+  double ns;
+  double cycles;
+};
+
+static struct bench_result bench(lpfilter_state_t *filters, int count, int width)
+{
+  const int n = 200000;
+  float sample[3] = { noise(), noise(), noise() };
+
+  struct timespec start, end;
+#ifdef HAVE_CYCLE_COUNTER
+  uint64_t start_cycles = __rdtsc();
+#endif
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (int t = 0; t < n; t++) {
+    for (int i = 0; i < count; i++)
+      lpfilter_run(filters[i], &sample[i * width]);
+
+    sample[t % 3] += 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  struct bench_result r;
+
+  r.ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / n;
+#ifdef HAVE_CYCLE_COUNTER
+  r.cycles = (double) (__rdtsc() - start_cycles) / n;
+#else
+  r.cycles = 0;
+#endif
+
+  return r;
+}
+
+TEST(LPFilter, Benchmark) {
+  for (int order = 1; order <= 8; order++) {
+    lpfilter_state_t axes3 = NULL;
+    lpfilter_state_t single[3] = { NULL, NULL, NULL };
+
+    lpfilter_create(&axes3, CUTOFF, DT, order, 3);
+
+    for (int j = 0; j < 3; j++)
+      lpfilter_create(&single[j], CUTOFF, DT, order, 1);
+
+    struct bench_result kernel = bench(&axes3, 1, 3);
+    struct bench_result generic = bench(single, 3, 1);
+
+    printf("order %d: 3 axis filter %.1f ns %.0f cycles, "
+        "filter per axis %.1f ns %.0f cycles\n", order,
+        kernel.ns, kernel.cycles, generic.ns, generic.cycles);
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,362 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+
+#include "notchfilter.h"
+
+}
+
+#include <math.h>		/* sin, cos */
+#include <time.h>		/* clock_gettime */
+
+#define GYRO_8K (1.0f / 8000)
+#define GYRO_500 (1.0f / 500)
+
+// Amplitude of a tone in a signal, by correlating with it
+static float tone_amplitude(const float *x, int n, float hz, float dT)
+{
+  double s = 0, c = 0;
+
+  for (int t = 0; t < n; t++) {
+    s += x[t] * sin(2 * M_PI * hz * t * dT);
+    c += x[t] * cos(2 * M_PI * hz * t * dT);
+  }
+
+  return 2 * sqrt(s * s + c * c) / n;
+}
+
+// Phase of a tone in a signal (rad)
+static double tone_phase(const float *x, int n, float hz, float dT)
+{
+  double s = 0, c = 0;
+
+  for (int t = 0; t < n; t++) {
+    s += x[t] * sin(2 * M_PI * hz * t * dT);
+    c += x[t] * cos(2 * M_PI * hz * t * dT);
+  }
+
+  return atan2(c, s);
+}
+
+// Gyro samples: slow motion plus motor tones plus noise
+class NotchFilter : public testing::Test {
+protected:
+  virtual void SetUp() {
+    filter = NULL;
+    srand(1);
+  }
+
+  void make_signal(float dT, int n, const float *tone_hz, int tones) {
+    for (int t = 0; t < n; t++) {
+      for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+        float x = 50 * sinf(2 * M_PI * 10 * t * dT + i);
+
+        for (int j = 0; j < tones; j++)
+          x += 20 * sinf(2 * M_PI * tone_hz[j] * t * dT + i + j);
+
+        x += 2 * (rand() / (float) RAND_MAX - 0.5f);
+
+        in[i][t] = x;
+      }
+    }
+  }
+
+  void run(int n) {
+    for (int t = 0; t < n; t++) {
+      float sample[NOTCHFILTER_AXES];
+
+      for (int i = 0; i < NOTCHFILTER_AXES; i++)
+        sample[i] = in[i][t];
+
+      notchfilter_run(filter, sample);
+
+      for (int i = 0; i < NOTCHFILTER_AXES; i++)
+        out[i][t] = sample[i];
+    }
+  }
+
+  static const int max_samples = 24000;
+
+  notchfilter_state_t filter;
+  float in[NOTCHFILTER_AXES][max_samples];
+  float out[NOTCHFILTER_AXES][max_samples];
+};
+
+TEST_F(NotchFilter, Bypassed) {
+  float sample[NOTCHFILTER_AXES] = { 1, 2, 3 };
+
+  // No filter at all, and no notches
+  notchfilter_run(NULL, sample);
+  EXPECT_EQ(0, notchfilter_get_frequency(NULL, 0, 0));
+
+  notchfilter_create(&filter, GYRO_8K, 0, 80, 400, 3);
+  EXPECT_TRUE(filter == NULL);
+
+  notchfilter_create(&filter, GYRO_8K, 1, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  notchfilter_state_t allocated = filter;
+
+  notchfilter_create(&filter, GYRO_8K, 0, 80, 400, 3);
+  EXPECT_EQ(allocated, filter);
+
+  notchfilter_run(filter, sample);
+  EXPECT_EQ(1, sample[0]);
+  EXPECT_EQ(2, sample[1]);
+  EXPECT_EQ(3, sample[2]);
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, Attenuates8kHz) {
+  const float tone = 180;
+  const int n = 3 * 8000, tail = 8000;
+
+  make_signal(GYRO_8K, n, &tone, 1);
+
+  notchfilter_create(&filter, GYRO_8K, 1, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  run(n);
+
+  for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+    EXPECT_NEAR(tone, notchfilter_get_frequency(filter, i, 0), 5) << "axis " << i;
+
+    float before = tone_amplitude(in[i] + n - tail, tail, tone, GYRO_8K);
+    float after = tone_amplitude(out[i] + n - tail, tail, tone, GYRO_8K);
+
+    EXPECT_NEAR(20, before, 1);
+    EXPECT_LT(after, before * 0.1f) << "axis " << i;
+  }
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, TwoTones500Hz) {
+  const float tones[2] = { 137, 74 };
+  const int n = 10 * 500, tail = 1000;
+
+  make_signal(GYRO_500, n, tones, 2);
+
+  notchfilter_create(&filter, GYRO_500, 2, 40, 240, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  run(n);
+
+  for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+    float a = notchfilter_get_frequency(filter, i, 0);
+    float b = notchfilter_get_frequency(filter, i, 1);
+
+    EXPECT_NEAR(tones[0] + tones[1], a + b, 6) << "axis " << i;
+    EXPECT_NEAR(tones[0] - tones[1], fabsf(a - b), 6) << "axis " << i;
+
+    for (int j = 0; j < 2; j++) {
+      float before = tone_amplitude(in[i] + n - tail, tail, tones[j], GYRO_500);
+      float after = tone_amplitude(out[i] + n - tail, tail, tones[j], GYRO_500);
+
+      EXPECT_LT(after, before * 0.1f) << "axis " << i << " tone " << j;
+    }
+  }
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, QuietSignalLeftAlone) {
+  const int n = 8000;
+
+  make_signal(GYRO_8K, n, NULL, 0);
+
+  notchfilter_create(&filter, GYRO_8K, 2, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  run(n);
+
+  // Noise alone never stands out enough to move a notch
+  for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+    EXPECT_EQ(0, notchfilter_get_frequency(filter, i, 0));
+    EXPECT_EQ(0, notchfilter_get_frequency(filter, i, 1));
+
+    for (int t = 0; t < n; t++)
+      ASSERT_EQ(in[i][t], out[i][t]);
+  }
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, AliasIgnored) {
+  const float tones[2] = { 180, 700 };
+  const int n = 3 * 8000, tail = 8000;
+
+  make_signal(GYRO_8K, n, tones, 0);
+
+  // A weaker tone to follow, and a strong one above the range that
+  // averaged down to 1kHz would fold back to 300Hz
+  for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+    for (int t = 0; t < n; t++) {
+      in[i][t] += 10 * sinf(2 * M_PI * tones[0] * t * GYRO_8K + i);
+      in[i][t] += 40 * sinf(2 * M_PI * tones[1] * t * GYRO_8K + i);
+    }
+  }
+
+  notchfilter_create(&filter, GYRO_8K, 1, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  run(n);
+
+  for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+    EXPECT_NEAR(tones[0], notchfilter_get_frequency(filter, i, 0), 5) << "axis " << i;
+
+    float before = tone_amplitude(in[i] + n - tail, tail, tones[0], GYRO_8K);
+    float after = tone_amplitude(out[i] + n - tail, tail, tones[0], GYRO_8K);
+
+    EXPECT_LT(after, before * 0.1f) << "axis " << i;
+  }
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, ReleasedWhenToneStops) {
+  const float tone = 180;
+  const int n = 3 * 8000, stop = 2 * 8000;
+
+  make_signal(GYRO_8K, n, &tone, 1);
+
+  // Motors off for the last second
+  for (int i = 0; i < NOTCHFILTER_AXES; i++)
+    for (int t = stop; t < n; t++)
+      in[i][t] -= 20 * sinf(2 * M_PI * tone * t * GYRO_8K + i);
+
+  notchfilter_create(&filter, GYRO_8K, 1, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  run(stop);
+
+  for (int i = 0; i < NOTCHFILTER_AXES; i++)
+    EXPECT_NEAR(tone, notchfilter_get_frequency(filter, i, 0), 5) << "axis " << i;
+
+  // A short lull keeps the notch in place
+  for (int t = 0; t < 400; t++) {
+    float sample[NOTCHFILTER_AXES];
+
+    for (int i = 0; i < NOTCHFILTER_AXES; i++)
+      sample[i] = in[i][stop + t];
+
+    notchfilter_run(filter, sample);
+  }
+
+  for (int i = 0; i < NOTCHFILTER_AXES; i++)
+    EXPECT_NEAR(tone, notchfilter_get_frequency(filter, i, 0), 5) << "axis " << i;
+
+  for (int t = stop + 400; t < n; t++) {
+    float sample[NOTCHFILTER_AXES];
+
+    for (int i = 0; i < NOTCHFILTER_AXES; i++)
+      sample[i] = in[i][t];
+
+    notchfilter_run(filter, sample);
+
+    for (int i = 0; i < NOTCHFILTER_AXES; i++)
+      out[i][t] = sample[i];
+  }
+
+  // Let go, and the signal passes untouched again
+  for (int i = 0; i < NOTCHFILTER_AXES; i++) {
+    EXPECT_EQ(0, notchfilter_get_frequency(filter, i, 0)) << "axis " << i;
+    EXPECT_EQ(in[i][n - 1], out[i][n - 1]) << "axis " << i;
+  }
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, SmallDelayBelowNotch) {
+  const float tone = 180;
+  const int n = 3 * 8000, tail = 8000;
+
+  make_signal(GYRO_8K, n, &tone, 1);
+
+  notchfilter_create(&filter, GYRO_8K, 1, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  run(n);
+
+  // The 10Hz motion should come through whole and barely late
+  float before = tone_amplitude(in[0] + n - tail, tail, 10, GYRO_8K);
+  float after = tone_amplitude(out[0] + n - tail, tail, 10, GYRO_8K);
+
+  double lag = tone_phase(in[0] + n - tail, tail, 10, GYRO_8K) -
+    tone_phase(out[0] + n - tail, tail, 10, GYRO_8K);
+  double delay_ms = 1000 * lag / (2 * M_PI * 10);
+
+  printf("Delay at 10Hz: %.3f ms\n", delay_ms);
+
+  EXPECT_NEAR(before, after, 0.01f * before);
+  EXPECT_GT(delay_ms, 0);
+  EXPECT_LT(delay_ms, 0.5);
+
+  free(filter);
+}
+
+TEST_F(NotchFilter, Benchmark8kHz) {
+  const float tones[2] = { 180, 310 };
+  const int n = 3 * 8000;
+
+  make_signal(GYRO_8K, n, tones, 2);
+
+  notchfilter_create(&filter, GYRO_8K, 2, 80, 400, 3);
+  ASSERT_TRUE(filter != NULL);
+
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  run(n);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+  printf("notchfilter_run: %.0f ns per sample, %.2f%% of an 8kHz loop\n",
+      ns / n, 100 * ns / n / 125000);
+
+  free(filter);
+}
+
+/**
+ * @}
+ * @}
+ */
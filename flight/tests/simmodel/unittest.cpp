@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+
+#include "simmodel.h"
+
+}
+
+#include <math.h>		/* fabs() */
+
+#define DT 0.002f
+
+// To use a test fixture, derive a class from testing::Test.
+class SimModel : public testing::Test {
+protected:
+  virtual void SetUp() {
+    batch = new struct simmodel_batch;
+  }
+
+  virtual void TearDown() {
+    delete batch;
+  }
+
+  struct simmodel_batch *batch;
+};
+
+TEST_F(SimModel, RestsOnGround) {
+  simmodel_init(batch, 4);
+
+  for (int n = 0; n < 500; n++)
+    simmodel_step_quadcopter(batch, DT);
+
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(0, batch->pos[2][i]);
+    EXPECT_EQ(0, batch->vel[2][i]);
+    EXPECT_NEAR(1, batch->q[0][i], 1e-6f);
+
+    // Sitting still, the accelerometer reads 1g up
+    EXPECT_NEAR(-9.805f, batch->accel[2][i], 1e-4f);
+  }
+}
+
+TEST_F(SimModel, FullThrottleClimbs) {
+  simmodel_init(batch, 2);
+  batch->thrust[1] = 1;
+
+  for (int n = 0; n < 500; n++)
+    simmodel_step_quadcopter(batch, DT);
+
+  EXPECT_EQ(0, batch->pos[2][0]);
+
+  // Twice hover thrust, climbing against drag towards 1g up
+  EXPECT_LT(batch->pos[2][1], -2);
+  EXPECT_LT(batch->vel[2][1], -5);
+}
+
+TEST_F(SimModel, RateFollowsActuator) {
+  simmodel_init(batch, 1);
+  batch->actuator[0][0] = 0.1f;
+
+  simmodel_step_quadcopter(batch, DT);
+
+  // The actuator is lagged 0.81 per 500Hz step
+  EXPECT_NEAR(SIMMODEL_RATE_SCALE * 0.1f * 0.19f, batch->rate[0][0], 0.5f);
+
+  for (int n = 0; n < 100; n++)
+    simmodel_step_quadcopter(batch, DT);
+
+  EXPECT_NEAR(SIMMODEL_RATE_SCALE * 0.1f, batch->rate[0][0], 0.1f);
+
+  float qmag = sqrtf(batch->q[0][0] * batch->q[0][0] +
+      batch->q[1][0] * batch->q[1][0] +
+      batch->q[2][0] * batch->q[2][0] +
+      batch->q[3][0] * batch->q[3][0]);
+
+  EXPECT_NEAR(1, qmag, 1e-5f);
+}
+
+TEST_F(SimModel, LanesAreIndependent) {
+  struct simmodel_batch *single = new struct simmodel_batch;
+
+  simmodel_init(batch, SIMMODEL_MAX_LANES);
+  simmodel_init(single, 1);
+
+  for (int i = 0; i < SIMMODEL_MAX_LANES; i++) {
+    batch->actuator[0][i] = (i % 7) * 0.01f;
+    batch->actuator[1][i] = (i % 5) * -0.01f;
+    batch->thrust[i] = 0.1f + i * 0.01f;
+  }
+
+  const int lane = 37;
+
+  single->actuator[0][0] = batch->actuator[0][lane];
+  single->actuator[1][0] = batch->actuator[1][lane];
+  single->thrust[0] = batch->thrust[lane];
+
+  for (int n = 0; n < 1000; n++) {
+    simmodel_step_quadcopter(batch, DT);
+    simmodel_step_quadcopter(single, DT);
+  }
+
+  for (int k = 0; k < 3; k++) {
+    EXPECT_FLOAT_EQ(single->pos[k][0], batch->pos[k][lane]);
+    EXPECT_FLOAT_EQ(single->vel[k][0], batch->vel[k][lane]);
+  }
+
+  for (int k = 0; k < 4; k++)
+    EXPECT_FLOAT_EQ(single->q[k][0], batch->q[k][lane]);
+
+  delete single;
+}
+
+TEST_F(SimModel, AirplaneFlies) {
+  simmodel_init(batch, 1);
+  batch->thrust[0] = 0.5f;
+
+  for (int n = 0; n < 5000; n++)
+    simmodel_step_airplane(batch, DT);
+
+  // Past the speed where lift beats gravity, so off the ground
+  EXPECT_GT(batch->vel[0][0], 8);
+  EXPECT_GT(batch->airspeed[0][0], 8);
+  EXPECT_LT(batch->pos[2][0], 0);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,4 @@
+#define PIOS_NO_HW
+#define FLIGHT_POSIX
+
+#define PIOS_INCLUDE_FLASH
@@ -0,0 +1,554 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the UAVObject manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+#include <pthread.h>		/* pthread_create */
+#include <algorithm>		/* std::sort */
+#include <vector>		/* std::vector */
+
+extern "C" {
+#include "openpilot.h"
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"	/* UAVOBJECTS_COUNT */
+}
+
+/* Object IDs are hashes with the low bit clear; the metaobject is id + 1 */
+static uint32_t test_id(int i)
+{
+	return (0x9E3779B9u * (i + 1)) & 0xFFFFFFFE;
+}
+
+struct test_data {
+	uint32_t a;
+	float b;
+	uint8_t c[6];
+};
+
+static double now_s()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjManager : public testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, UAVObjInitialize());
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(UAVObjManager, RegisterAndLookup) {
+  const int num = UAVOBJECTS_COUNT;
+  UAVObjHandle handles[UAVOBJECTS_COUNT];
+
+  for (int i = 0; i < num; i++) {
+    handles[i] = UAVObjRegister(test_id(i), 1, 0,
+        sizeof(struct test_data), NULL);
+    ASSERT_TRUE(handles[i] != NULL);
+  }
+
+  EXPECT_EQ(num, UAVObjCount());
+
+  for (int i = 0; i < num; i++) {
+    EXPECT_EQ(handles[i], UAVObjGetByID(test_id(i)));
+    EXPECT_EQ(test_id(i), UAVObjGetID(handles[i]));
+
+    UAVObjHandle meta = UAVObjGetByID(test_id(i) + 1);
+    ASSERT_TRUE(meta != NULL);
+    EXPECT_TRUE(UAVObjIsMetaobject(meta));
+    EXPECT_EQ(test_id(i) + 1, UAVObjGetID(meta));
+    EXPECT_EQ(handles[i], UAVObjGetLinkedObj(meta));
+  }
+
+  /* Unknown IDs on either side of the range are not found */
+  EXPECT_TRUE(UAVObjGetByID(0) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(0xFFFFFFFE) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(test_id(num)) == NULL);
+
+  /* The index is full; further registrations are refused */
+  EXPECT_TRUE(UAVObjRegister(test_id(num), 1, 0, 4, NULL) == NULL);
+}
+
+TEST_F(UAVObjManager, IndexIsSorted) {
+  for (int i = 0; i < 32; i++) {
+    ASSERT_TRUE(UAVObjRegister(test_id(i), 1, 0, 4, NULL) != NULL);
+  }
+
+  ASSERT_EQ(32, UAVObjCount());
+
+  for (int i = 1; i < 32; i++) {
+    EXPECT_LT(UAVObjIDByIndex(i - 1), UAVObjIDByIndex(i));
+  }
+
+  EXPECT_EQ(0u, UAVObjIDByIndex(32));
+}
+
+TEST_F(UAVObjManager, DuplicateRegistration) {
+  ASSERT_TRUE(UAVObjRegister(test_id(0), 1, 0, 4, NULL) != NULL);
+  EXPECT_TRUE(UAVObjRegister(test_id(0), 1, 0, 4, NULL) == NULL);
+  EXPECT_EQ(1, UAVObjCount());
+}
+
+TEST_F(UAVObjManager, MultiInstance) {
+  UAVObjHandle obj = UAVObjRegister(test_id(0), 0, 0,
+      sizeof(struct test_data), NULL);
+  ASSERT_TRUE(obj != NULL);
+  EXPECT_EQ(1, UAVObjGetNumInstances(obj));
+
+  /* Enough instances to chain several chunks of the instance table */
+  const int num = 40;
+
+  for (int i = 1; i < num; i++) {
+    EXPECT_EQ(i, UAVObjCreateInstance(obj, NULL));
+  }
+
+  EXPECT_EQ(num, UAVObjGetNumInstances(obj));
+
+  for (int i = 0; i < num; i++) {
+    struct test_data d;
+    memset(&d, 0, sizeof(d));
+    d.a = 1000 + i;
+    d.b = i * 0.5f;
+    d.c[5] = i;
+
+    EXPECT_EQ(0, UAVObjSetInstanceData(obj, i, &d));
+  }
+
+  for (int i = 0; i < num; i++) {
+    struct test_data d;
+
+    EXPECT_EQ(0, UAVObjGetInstanceData(obj, i, &d));
+    EXPECT_EQ(1000u + i, d.a);
+    EXPECT_EQ(i * 0.5f, d.b);
+    EXPECT_EQ(i, d.c[5]);
+  }
+
+  struct test_data d;
+  EXPECT_EQ(-1, UAVObjGetInstanceData(obj, num, &d));
+}
+
+struct instance_reader {
+  UAVObjHandle obj;
+  volatile bool started;
+  volatile bool done;
+  uint32_t reads;
+  uint32_t failures;
+};
+
+static void *instance_reader_thread(void *ctx)
+{
+  struct instance_reader *r = (struct instance_reader *) ctx;
+  struct test_data d;
+
+  r->started = true;
+
+  while (!r->done) {
+    uint16_t newest = UAVObjGetNumInstances(r->obj) - 1;
+
+    if (UAVObjGetInstanceData(r->obj, newest, &d) != 0) {
+      r->failures++;
+    }
+
+    r->reads++;
+  }
+
+  return NULL;
+}
+
+TEST_F(UAVObjManager, InstancesReadWhileCreated) {
+  UAVObjHandle obj = UAVObjRegister(test_id(0), 0, 0,
+      sizeof(struct test_data), NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  struct instance_reader r;
+  memset(&r, 0, sizeof(r));
+  r.obj = obj;
+
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, instance_reader_thread, &r));
+
+  while (!r.started) {
+    PIOS_DELAY_WaitmS(1);
+  }
+
+  /* Without the lock, readers race the chunk chain as it grows */
+  for (int i = 1; i < UAVOBJ_MAX_INSTANCES; i++) {
+    EXPECT_EQ(i, UAVObjCreateInstance(obj, NULL));
+  }
+
+  r.done = true;
+  pthread_join(thread, NULL);
+
+  EXPECT_LT(0u, r.reads);
+  EXPECT_EQ(0u, r.failures);
+}
+
+TEST_F(UAVObjManager, LookupThroughput) {
+  const int num = UAVOBJECTS_COUNT;
+
+  for (int i = 0; i < num; i++) {
+    ASSERT_TRUE(UAVObjRegister(test_id(i), 1, 0, 4, NULL) != NULL);
+  }
+
+  const int rounds = 2000;
+  uint32_t found = 0;
+
+  double start = now_s();
+
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < num; i++) {
+      found += UAVObjGetByID(test_id(i)) != NULL;
+    }
+  }
+
+  double elapsed = now_s() - start;
+
+  EXPECT_EQ((uint32_t) rounds * num, found);
+
+  printf("%d objects: %.0f lookups/sec\n", num,
+      rounds * num / elapsed);
+}
+
+static uint32_t fanout_count;
+static UAVObjHandle fanout_objs[5];
+
+static void fanout_leaf_cb(const UAVObjEvent *ev, void *ctx, void *obj, int len)
+{
+  (void) ev; (void) ctx; (void) obj; (void) len;
+
+  fanout_count++;
+}
+
+static void fanout_root_cb(const UAVObjEvent *ev, void *ctx, void *obj, int len)
+{
+  (void) ev; (void) ctx; (void) obj; (void) len;
+
+  uint32_t val = 1;
+
+  for (int i = 0; i < 5; i++) {
+    UAVObjSetData(fanout_objs[i], &val);
+  }
+}
+
+TEST_F(UAVObjManager, NestedEventFanOut) {
+  UAVObjHandle root = UAVObjRegister(test_id(0), 1, 0, 4, NULL);
+  ASSERT_TRUE(root != NULL);
+
+  for (int i = 0; i < 5; i++) {
+    fanout_objs[i] = UAVObjRegister(test_id(i + 1), 1, 0, 4, NULL);
+    ASSERT_TRUE(fanout_objs[i] != NULL);
+    ASSERT_EQ(0, UAVObjConnectCallback(fanout_objs[i], fanout_leaf_cb,
+        NULL, EV_UPDATED));
+  }
+
+  ASSERT_EQ(0, UAVObjConnectCallback(root, fanout_root_cb, NULL, EV_UPDATED));
+
+  UAVObjClearStats();
+  fanout_count = 0;
+
+  uint32_t val = 1;
+  EXPECT_EQ(0, UAVObjSetData(root, &val));
+
+  /* Every nested update is delivered, not just the first few */
+  EXPECT_EQ(5u, fanout_count);
+
+  UAVObjStats stats;
+  UAVObjGetStats(&stats);
+  EXPECT_EQ(0u, stats.eventCallbackErrors);
+  EXPECT_EQ(5, stats.eventBacklogMax);
+}
+
+static uint32_t self_count;
+
+static void self_update_cb(const UAVObjEvent *ev, void *ctx, void *obj, int len)
+{
+  (void) ctx; (void) len;
+
+  self_count++;
+
+  /* Clamp the value, like a settings handler fixing up a bad field */
+  uint32_t val = *(uint32_t *) obj;
+
+  if (val > 2) {
+    val = 2;
+    UAVObjSetData(ev->obj, &val);
+  }
+}
+
+TEST_F(UAVObjManager, NestedSelfUpdateDelivered) {
+  UAVObjHandle obj = UAVObjRegister(test_id(0), 1, 0, 4, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  struct pios_queue *queue = PIOS_Queue_Create(4, sizeof(UAVObjEvent));
+  ASSERT_TRUE(queue != NULL);
+
+  ASSERT_EQ(0, UAVObjConnectCallback(obj, self_update_cb, NULL, EV_UPDATED));
+  ASSERT_EQ(0, UAVObjConnectQueue(obj, queue, EV_UPDATED));
+
+  self_count = 0;
+
+  uint32_t val = 5;
+  EXPECT_EQ(0, UAVObjSetData(obj, &val));
+
+  /* The callback sees its own fix-up once, and stops there */
+  EXPECT_EQ(2u, self_count);
+  EXPECT_EQ(0, UAVObjGetData(obj, &val));
+  EXPECT_EQ(2u, val);
+
+  /* Queue listeners get both the original update and the fix-up */
+  UAVObjEvent ev;
+  int events = 0;
+
+  while (PIOS_Queue_Receive(queue, &ev, 0)) {
+    EXPECT_EQ(obj, ev.obj);
+    events++;
+  }
+
+  EXPECT_EQ(2, events);
+}
+
+struct deferred_ctx {
+  volatile bool called;
+  pthread_t thread;
+  void *obj;
+  int len;
+  uint16_t instId;
+};
+
+static void deferred_cb(const UAVObjEvent *ev, void *ctx, void *obj, int len)
+{
+  struct deferred_ctx *d = (struct deferred_ctx *) ctx;
+
+  d->thread = pthread_self();
+  d->obj = obj;
+  d->len = len;
+  d->instId = ev->instId;
+  __sync_synchronize();
+  d->called = true;
+}
+
+TEST_F(UAVObjManager, DeferredCallback) {
+  UAVObjHandle obj = UAVObjRegister(test_id(0), 1, 0, 4, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  struct deferred_ctx d;
+  memset(&d, 0, sizeof(d));
+
+  ASSERT_EQ(0, UAVObjConnectCallbackDeferred(obj, deferred_cb, &d,
+      EV_UPDATED));
+
+  UAVObjClearStats();
+
+  uint32_t val = 1;
+  EXPECT_EQ(0, UAVObjSetData(obj, &val));
+
+  for (int i = 0; i < 1000 && !d.called; i++) {
+    PIOS_DELAY_WaitmS(1);
+  }
+
+  ASSERT_TRUE(d.called);
+
+  /* Run from the dispatch thread, without the object data */
+  EXPECT_FALSE(pthread_equal(pthread_self(), d.thread));
+  EXPECT_TRUE(d.obj == NULL);
+  EXPECT_EQ(0, d.len);
+  EXPECT_EQ(0, d.instId);
+
+  UAVObjStats stats;
+  UAVObjGetStats(&stats);
+  EXPECT_EQ(0u, stats.eventCallbackErrors);
+  EXPECT_EQ(1, stats.deferredBacklogMax);
+
+  EXPECT_EQ(0, UAVObjDisconnectCallback(obj, deferred_cb, &d));
+}
+
+/*
+ * Contention benchmark: reader threads hammer one object while writer
+ * threads update it and an unrelated object.  Writers fill every byte
+ * with the same value, so a torn read shows up as mixed bytes.
+ */
+
+#define CONTENTION_READERS  4
+#define CONTENTION_WRITERS  2
+#define CONTENTION_OPS      50000
+
+struct contention_data {
+  uint8_t bytes[64];
+};
+
+struct contention_thread {
+  pthread_t thread;
+  pthread_barrier_t *start;
+  UAVObjHandle obj;
+  std::vector<double> latency;
+  uint32_t torn;
+};
+
+static void *contention_reader(void *ctx)
+{
+  struct contention_thread *t = (struct contention_thread *) ctx;
+  struct contention_data d;
+
+  pthread_barrier_wait(t->start);
+
+  for (int i = 0; i < CONTENTION_OPS; i++) {
+    double start = now_s();
+    UAVObjGetData(t->obj, &d);
+    t->latency.push_back(now_s() - start);
+
+    for (unsigned int j = 1; j < sizeof(d.bytes); j++) {
+      if (d.bytes[j] != d.bytes[0]) {
+        t->torn++;
+        break;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+static void *contention_writer(void *ctx)
+{
+  struct contention_thread *t = (struct contention_thread *) ctx;
+  struct contention_data d;
+
+  pthread_barrier_wait(t->start);
+
+  for (int i = 0; i < CONTENTION_OPS; i++) {
+    memset(&d, i, sizeof(d));
+
+    double start = now_s();
+    UAVObjSetData(t->obj, &d);
+    t->latency.push_back(now_s() - start);
+  }
+
+  return NULL;
+}
+
+static void contention_cb(const UAVObjEvent *ev, void *ctx, void *obj, int len)
+{
+  (void) ev; (void) obj; (void) len;
+
+  (*(uint32_t *) ctx)++;
+}
+
+static void print_percentiles(const char *name,
+    struct contention_thread *threads, int num)
+{
+  std::vector<double> all;
+
+  for (int i = 0; i < num; i++) {
+    all.insert(all.end(), threads[i].latency.begin(),
+        threads[i].latency.end());
+  }
+
+  std::sort(all.begin(), all.end());
+
+  printf("%s latency (us): p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f max %.2f\n",
+      name,
+      all[all.size() * 50 / 100] * 1e6,
+      all[all.size() * 90 / 100] * 1e6,
+      all[all.size() * 99 / 100] * 1e6,
+      all[all.size() * 999 / 1000] * 1e6,
+      all.back() * 1e6);
+}
+
+TEST_F(UAVObjManager, Contention) {
+  UAVObjHandle hot = UAVObjRegister(test_id(0), 1, 0,
+      sizeof(struct contention_data), NULL);
+  UAVObjHandle other = UAVObjRegister(test_id(1), 1, 0,
+      sizeof(struct contention_data), NULL);
+  ASSERT_TRUE(hot != NULL);
+  ASSERT_TRUE(other != NULL);
+
+  uint32_t updates = 0;
+  ASSERT_EQ(0, UAVObjConnectCallback(hot, contention_cb, &updates,
+      EV_UPDATED));
+
+  pthread_barrier_t start;
+  pthread_barrier_init(&start, NULL, CONTENTION_READERS + CONTENTION_WRITERS);
+
+  struct contention_thread readers[CONTENTION_READERS];
+  struct contention_thread writers[CONTENTION_WRITERS];
+
+  for (int i = 0; i < CONTENTION_WRITERS; i++) {
+    writers[i].start = &start;
+    writers[i].obj = (i == 0) ? hot : other;
+    writers[i].torn = 0;
+    writers[i].latency.reserve(CONTENTION_OPS);
+    ASSERT_EQ(0, pthread_create(&writers[i].thread, NULL,
+        contention_writer, &writers[i]));
+  }
+
+  for (int i = 0; i < CONTENTION_READERS; i++) {
+    readers[i].start = &start;
+    readers[i].obj = hot;
+    readers[i].torn = 0;
+    readers[i].latency.reserve(CONTENTION_OPS);
+    ASSERT_EQ(0, pthread_create(&readers[i].thread, NULL,
+        contention_reader, &readers[i]));
+  }
+
+  uint32_t torn = 0;
+
+  for (int i = 0; i < CONTENTION_WRITERS; i++) {
+    pthread_join(writers[i].thread, NULL);
+  }
+
+  for (int i = 0; i < CONTENTION_READERS; i++) {
+    pthread_join(readers[i].thread, NULL);
+    torn += readers[i].torn;
+  }
+
+  pthread_barrier_destroy(&start);
+
+  EXPECT_EQ(0u, torn);
+  EXPECT_EQ((uint32_t) CONTENTION_OPS, updates);
+
+  printf("%d readers, %d writers, %d ops each\n",
+      CONTENTION_READERS, CONTENTION_WRITERS, CONTENTION_OPS);
+  print_percentiles("get", readers, CONTENTION_READERS);
+  print_percentiles("set", writers, CONTENTION_WRITERS);
+}
@@ -0,0 +1,364 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for UAVTalk stream parsing
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+#include <vector>		/* std::vector */
+
+extern "C" {
+#include "openpilot.h"
+#include "uavobjectmanager.h"
+#include "uavtalk.h"
+#include "uavtalk_priv.h"	/* UAVTALK_SYNC_VAL */
+#include "circqueue.h"
+}
+
+#define BIG_OBJ_ID	0x12345678
+#define BIG_OBJ_SIZE	200
+#define MULTI_OBJ_ID	0x2468ACE0
+#define MULTI_OBJ_SIZE	40
+
+static double now_s()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t append_output(void *ctx, uint8_t *data, int32_t length)
+{
+	std::vector<uint8_t> *out = (std::vector<uint8_t> *) ctx;
+
+	out->insert(out->end(), data, data + length);
+
+	return length;
+}
+
+static void fill_random(uint8_t *data, int len)
+{
+	for (int i = 0; i < len; i++) {
+		data[i] = rand();
+	}
+}
+
+/* Relay every frame of the stream from one connection to another, the way
+ * the radio bridge does: a byte at a time as before, or in bulk from spans
+ * of the receive fifo. */
+static void relay_stream(const std::vector<uint8_t> &stream,
+		UAVTalkConnection in, UAVTalkConnection out, bool bulk)
+{
+	for (size_t pos = 0; pos < stream.size(); ) {
+		UAVTalkRxState state;
+		int consumed;
+
+		if (bulk) {
+			state = UAVTalkProcessInputFrame(in, &stream[pos],
+					stream.size() - pos, &consumed);
+		} else {
+			state = UAVTalkProcessInputStreamQuiet(in, stream[pos]);
+			consumed = 1;
+		}
+
+		if (state == UAVTALK_STATE_COMPLETE) {
+			EXPECT_EQ(0, UAVTalkRelayPacket(in, out));
+		}
+
+		EXPECT_GT(consumed, 0);
+		pos += consumed;
+	}
+}
+
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVTalkParse : public testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, UAVObjInitialize());
+
+    big = UAVObjRegister(BIG_OBJ_ID, 1, 0, BIG_OBJ_SIZE, NULL);
+    ASSERT_TRUE(big != NULL);
+
+    multi = UAVObjRegister(MULTI_OBJ_ID, 0, 0, MULTI_OBJ_SIZE, NULL);
+    ASSERT_TRUE(multi != NULL);
+    ASSERT_EQ(1, UAVObjCreateInstance(multi, NULL));
+
+    sender = UAVTalkInitialize(&stream, append_output, NULL, NULL, NULL);
+    ASSERT_TRUE(sender != 0);
+
+    receiver = UAVTalkInitialize(&replies, append_output, NULL, NULL, NULL);
+    ASSERT_TRUE(receiver != 0);
+
+    srand(1);
+  }
+
+  virtual void TearDown() {
+  }
+
+  /* Send num updates of each object, with noise between some frames and
+   * a corrupted frame every so often.  Leaves the last data sent in
+   * last_big and last_multi, and the objects cleared.
+   */
+  int build_stream(int num, bool noise, int *corrupted) {
+    int frames = 0;
+
+    *corrupted = 0;
+
+    for (int i = 0; i < num; i++) {
+      fill_random(last_big, sizeof(last_big));
+      UAVObjSetData(big, last_big);
+      EXPECT_EQ(0, UAVTalkSendObject(sender, big, 0, false));
+
+      fill_random(last_multi, sizeof(last_multi));
+      UAVObjSetInstanceData(multi, 1, last_multi);
+      EXPECT_EQ(0, UAVTalkSendObject(sender, multi, 1, false));
+
+      frames += 2;
+
+      if (noise && (i % 17) == 5) {
+        /* Flip a bit in the payload of the frame just sent; keep the
+         * object's data as it was before it */
+        stream[stream.size() - 5] ^= 0x10;
+        UAVObjSetInstanceData(multi, 1, prev_multi);
+        memcpy(last_multi, prev_multi, sizeof(last_multi));
+        (*corrupted)++;
+      }
+
+      if (noise && (i % 3) == 0) {
+        /* Anything but a sync byte, so no frame is lost to a false
+         * start */
+        int len = rand() % 40;
+
+        for (int j = 0; j < len; j++) {
+          uint8_t c = rand();
+
+          stream.push_back((c == UAVTALK_SYNC_VAL) ? 0 : c);
+        }
+      }
+
+      memcpy(prev_multi, last_multi, sizeof(prev_multi));
+    }
+
+    uint8_t zeros[BIG_OBJ_SIZE] = { 0 };
+    UAVObjSetData(big, zeros);
+    UAVObjSetInstanceData(multi, 1, zeros);
+
+    return frames;
+  }
+
+  void expect_received(int frames, int corrupted) {
+    UAVTalkStats stats;
+    UAVTalkGetStats(receiver, &stats);
+
+    EXPECT_EQ((uint32_t) (frames - corrupted), stats.rxObjects);
+    EXPECT_EQ((uint32_t) corrupted, stats.rxCRC);
+    EXPECT_EQ((uint32_t) stream.size(), stats.rxBytes);
+
+    uint8_t data[BIG_OBJ_SIZE];
+
+    UAVObjGetData(big, data);
+    EXPECT_EQ(0, memcmp(data, last_big, sizeof(last_big)));
+
+    UAVObjGetInstanceData(multi, 1, data);
+    EXPECT_EQ(0, memcmp(data, last_multi, sizeof(last_multi)));
+  }
+
+  UAVObjHandle big;
+  UAVObjHandle multi;
+
+  UAVTalkConnection sender;
+  UAVTalkConnection receiver;
+
+  std::vector<uint8_t> stream;
+  std::vector<uint8_t> replies;
+
+  uint8_t last_big[BIG_OBJ_SIZE];
+  uint8_t last_multi[MULTI_OBJ_SIZE];
+  uint8_t prev_multi[MULTI_OBJ_SIZE];
+};
+
+/* However the stream is cut up, every frame is found and checked */
+TEST_F(UAVTalkParse, AnyChunking) {
+  const int chunks[] = { 1, 2, 7, 16, 64, 255, 4096 };
+
+  for (unsigned int c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+    SCOPED_TRACE(chunks[c]);
+
+    stream.clear();
+
+    int corrupted;
+    int frames = build_stream(100, true, &corrupted);
+    ASSERT_GT(corrupted, 0);
+
+    UAVTalkStats stats;
+    UAVTalkGetStats(receiver, &stats);
+
+    for (size_t pos = 0; pos < stream.size(); pos += chunks[c]) {
+      size_t len = stream.size() - pos;
+
+      if (len > (size_t) chunks[c]) {
+        len = chunks[c];
+      }
+
+      UAVTalkProcessInputStream(receiver, &stream[pos], len);
+    }
+
+    expect_received(frames, corrupted);
+  }
+}
+
+/* Bytes parsed where they sit in a receive fifo, as the telemetry task
+ * does, come out the same as bytes handed over one at a time */
+TEST_F(UAVTalkParse, ZeroCopyFromFifo) {
+  int corrupted;
+  int frames = build_stream(100, true, &corrupted);
+
+  circ_queue_t fifo = circ_queue_new(1, 97);
+  ASSERT_TRUE(fifo != NULL);
+
+  size_t written = 0;
+
+  while (written < stream.size()) {
+    size_t len = stream.size() - written;
+
+    if (len > 1024) {
+      len = 1024;
+    }
+
+    written += circ_queue_write_data(fifo, &stream[written], len);
+
+    uint16_t contig;
+    const uint8_t *data;
+
+    while ((data = (const uint8_t *) circ_queue_read_pos(fifo, &contig, NULL))) {
+      UAVTalkProcessInputStream(receiver, data, contig);
+      circ_queue_read_completed_multi(fifo, contig);
+    }
+  }
+
+  expect_received(frames, corrupted);
+}
+
+/* Compare the old path, a byte at a time through the state machine in
+ * 16 byte reads, with spans straight out of a receive fifo. */
+TEST_F(UAVTalkParse, Throughput) {
+  int corrupted;
+  int frames = build_stream(5000, false, &corrupted);
+
+  double start = now_s();
+
+  for (size_t pos = 0; pos < stream.size(); pos++) {
+    if (UAVTalkProcessInputStreamQuiet(receiver, stream[pos]) ==
+        UAVTALK_STATE_COMPLETE) {
+      UAVTalkReceiveObject(receiver);
+    }
+  }
+
+  double bytewise = now_s() - start;
+
+  expect_received(frames, corrupted);
+
+  circ_queue_t fifo = circ_queue_new(1, 1024);
+  ASSERT_TRUE(fifo != NULL);
+
+  start = now_s();
+
+  size_t written = 0;
+
+  while (written < stream.size()) {
+    size_t len = stream.size() - written;
+
+    if (len > 1024) {
+      len = 1024;
+    }
+
+    written += circ_queue_write_data(fifo, &stream[written], len);
+
+    uint16_t contig;
+    const uint8_t *data;
+
+    while ((data = (const uint8_t *) circ_queue_read_pos(fifo, &contig, NULL))) {
+      UAVTalkProcessInputStream(receiver, data, contig);
+      circ_queue_read_completed_multi(fifo, contig);
+    }
+  }
+
+  double bulk = now_s() - start;
+
+  expect_received(frames, corrupted);
+
+  printf("%zu bytes: %.1f MB/s a byte at a time, %.1f MB/s in bulk\n",
+      stream.size(), stream.size() / bytewise / 1e6,
+      stream.size() / bulk / 1e6);
+
+  EXPECT_LT(bulk, bytewise);
+}
+
+/* Frames parsed in bulk relay to the same bytes as frames parsed a byte at
+ * a time */
+TEST_F(UAVTalkParse, Relay) {
+  int corrupted;
+  int frames = build_stream(100, true, &corrupted);
+
+  std::vector<uint8_t> bytewise, bulk;
+
+  UAVTalkConnection in = UAVTalkInitialize(NULL, NULL, NULL, NULL, NULL);
+  UAVTalkConnection outBytewise = UAVTalkInitialize(&bytewise, append_output,
+      NULL, NULL, NULL);
+  UAVTalkConnection outBulk = UAVTalkInitialize(&bulk, append_output,
+      NULL, NULL, NULL);
+
+  relay_stream(stream, in, outBytewise, false);
+  relay_stream(stream, in, outBulk, true);
+
+  EXPECT_TRUE(bytewise == bulk);
+
+  /* Everything but the noise and the corrupted frames gets through */
+  UAVTalkProcessInputStream(receiver, &bulk[0], bulk.size());
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(receiver, &stats);
+
+  EXPECT_EQ((uint32_t) (frames - corrupted), stats.rxObjects);
+  EXPECT_EQ(0u, stats.rxCRC);
+  EXPECT_EQ((uint32_t) bulk.size(), stats.rxBytes);
+
+  UAVTalkGetStats(outBulk, &stats);
+  EXPECT_EQ((uint32_t) bulk.size(), stats.txBytes);
+  EXPECT_EQ(0u, stats.txErrors);
+}
@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ * @file       unittest_mocks.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stubs for the settings filesystem used by the object manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios.h"
+#include "pios_flashfs.h"
+
+uintptr_t pios_uavo_settings_fs_id;
+
+int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id,
+		uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id,
+		uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id,
+		uint16_t obj_inst_id)
+{
+	return -1;
+}
@@ -0,0 +1,621 @@
+/**
+ ******************************************************************************
+ * @addtogroup Tools Tools
+ * @{
+ * @addtogroup INSReplay INS sensor replay
+ * @{
+ *
+ * @file       insreplay.c
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Run recorded sensor data through the INS and time every step
+ *
+ * Sensor data comes from a log exported by python/dronin-insexport, or from
+ * a flight of the simulated quad when no file is given.  Each gyro sample
+ * is one INS step, fed like the attitude module does: prediction, then the
+ * corrections for whatever sensors updated since the last step, either all
+ * at once or one group per step.  Reports how long steps take and how far
+ * the estimate is from the reference, which is the onboard estimate for a
+ * log and the truth for the simulated flight.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "openpilot.h"
+#include "physical_constants.h"
+#include "coordinate_conversions.h"
+#include "insgps.h"
+#include "misc_math.h"
+#include "simmodel.h"
+
+//! Step of the simulated flight, the rate the attitude module runs at
+#define SIM_DT 0.002f
+
+enum replay_kind {
+	REPLAY_IMU,		//!< gyro (rad/s), accel (m/s^2): one INS step
+	REPLAY_MAG,		//!< body field (mGau)
+	REPLAY_BARO,		//!< altitude (m)
+	REPLAY_GPS_POS,		//!< NED (m)
+	REPLAY_GPS_VEL,		//!< NED (m/s)
+	REPLAY_REFERENCE,	//!< position, velocity, attitude quaternion
+};
+
+struct replay_event {
+	enum replay_kind kind;
+	float t;		//!< (s)
+	float v[10];
+};
+
+//! What one step cost and how far off it left the estimate
+struct replay_step {
+	float t;
+	uint32_t step_ns;
+	uint32_t correction_ns;
+	uint16_t sensors;
+	float pos_err;
+	float vel_err;
+	float att_err;		//!< (deg)
+};
+
+static const int event_values[] = {
+	[REPLAY_IMU] = 6,
+	[REPLAY_MAG] = 3,
+	[REPLAY_BARO] = 1,
+	[REPLAY_GPS_POS] = 3,
+	[REPLAY_GPS_VEL] = 3,
+	[REPLAY_REFERENCE] = 10,
+};
+
+static struct replay_event *events;
+static int num_events;
+static int max_events;
+
+static float mag_north[3] = { 400, 0, 200 };
+
+static bool spread;
+static float gps_delay;
+static float sim_time = 60;
+static float sim_lag = 0.1f;
+static float settle = 10;
+static const char *trace_name;
+
+static struct replay_event *add_event(enum replay_kind kind, float t)
+{
+	if (num_events == max_events) {
+		max_events = max_events ? max_events * 2 : 4096;
+		events = realloc(events, max_events * sizeof(*events));
+		PIOS_Assert(events);
+	}
+
+	struct replay_event *ev = &events[num_events++];
+
+	ev->kind = kind;
+	ev->t = t;
+
+	return ev;
+}
+
+/**
+ * Load a replay file: a line per sample, a letter for the kind, the time
+ * in seconds then the values.  A B line sets the earth's field.
+ */
+static bool load_replay(const char *name)
+{
+	static const char kinds[] = "IMAPVR";
+
+	FILE *f = fopen(name, "r");
+
+	if (!f) {
+		perror(name);
+		return false;
+	}
+
+	char line[512];
+	int lineno = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+
+		char kind;
+		float v[11];
+		int n = sscanf(line, " %c %f %f %f %f %f %f %f %f %f %f %f", &kind,
+				&v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+				&v[6], &v[7], &v[8], &v[9], &v[10]);
+
+		if (n < 1 || kind == '#')
+			continue;
+
+		if (kind == 'B' && n == 4) {
+			memcpy(mag_north, v, sizeof(mag_north));
+			continue;
+		}
+
+		const char *k = strchr(kinds, kind);
+
+		if (!k || n != 2 + event_values[k - kinds]) {
+			fprintf(stderr, "%s:%d: bad sample\n", name, lineno);
+			fclose(f);
+			return false;
+		}
+
+		struct replay_event *ev = add_event(k - kinds, v[0]);
+		memcpy(ev->v, &v[1], event_values[ev->kind] * sizeof(float));
+	}
+
+	fclose(f);
+
+	return true;
+}
+
+static float gauss_noise(unsigned int *seed)
+{
+	// Box-Muller; the second value is thrown away for simplicity
+	float u1 = (rand_r(seed) + 1.0f) / (RAND_MAX + 2.0f);
+	float u2 = rand_r(seed) / (RAND_MAX + 1.0f);
+
+	return sqrtf(-2 * logf(u1)) * cosf(2 * PI * u2);
+}
+
+/**
+ * Fly the simulated quad about and record its sensors like the attitude
+ * module sees them: gyro and accel every step, mag and baro at 50Hz and GPS
+ * at 5Hz, sim_lag late.  The truth is the reference.
+ */
+static void record_sim_flight()
+{
+	struct simmodel_batch *batch = malloc(sizeof(*batch));
+	unsigned int seed = 1;
+	int steps = sim_time / SIM_DT;
+	int lag = sim_lag / SIM_DT + 0.5f;
+
+	PIOS_Assert(batch);
+
+	simmodel_init(batch, 1);
+
+	// Truth for the GPS to report late
+	float (*history)[6] = calloc(lag + 1, sizeof(*history));
+	PIOS_Assert(history);
+
+	for (int n = 0; n < steps; n++) {
+		float t = n * SIM_DT;
+
+		// Climb out, then swing about level
+		if (t > 2) {
+			float tf = t - 2;
+
+			batch->thrust[0] = tf < 3 ? 0.6f : 0.52f;
+			batch->actuator[0][0] = 0.003f * cosf(0.7f * tf);
+			batch->actuator[1][0] = 0.003f * cosf(0.5f * tf);
+			batch->actuator[2][0] = 0.003f * cosf(0.3f * tf);
+		}
+
+		simmodel_step_quadcopter(batch, SIM_DT);
+
+		float q[4] = { batch->q[0][0], batch->q[1][0], batch->q[2][0], batch->q[3][0] };
+		float accel_ned[3] = { batch->accel[0][0], batch->accel[1][0], batch->accel[2][0] };
+		float Rbe[3][3], accel[3], mag[3];
+
+		Quaternion2R(q, Rbe);
+		rot_mult(Rbe, accel_ned, accel, false);
+		rot_mult(Rbe, mag_north, mag, false);
+
+		float *truth = history[n % (lag + 1)];
+		for (int i = 0; i < 3; i++) {
+			truth[i] = batch->pos[i][0];
+			truth[i + 3] = batch->vel[i][0];
+		}
+
+		struct replay_event *ev = add_event(REPLAY_REFERENCE, t);
+		memcpy(ev->v, truth, 6 * sizeof(float));
+		memcpy(&ev->v[6], q, sizeof(q));
+
+		if (n % 10 == 0) {
+			ev = add_event(REPLAY_MAG, t);
+			for (int i = 0; i < 3; i++)
+				ev->v[i] = mag[i] + 3 * gauss_noise(&seed);
+
+			ev = add_event(REPLAY_BARO, t);
+			ev->v[0] = -batch->pos[2][0] + 0.2f * gauss_noise(&seed);
+		}
+
+		if (n % 100 == 0 && n >= lag) {
+			const float *late = history[(n - lag) % (lag + 1)];
+
+			ev = add_event(REPLAY_GPS_POS, t);
+			for (int i = 0; i < 3; i++)
+				ev->v[i] = late[i] + 0.3f * gauss_noise(&seed);
+
+			ev = add_event(REPLAY_GPS_VEL, t);
+			for (int i = 0; i < 3; i++)
+				ev->v[i] = late[i + 3] + 0.1f * gauss_noise(&seed);
+		}
+
+		ev = add_event(REPLAY_IMU, t);
+		for (int i = 0; i < 3; i++) {
+			ev->v[i] = batch->rate[i][0] * DEG2RAD + 0.002f * gauss_noise(&seed);
+			ev->v[i + 3] = accel[i] + 0.05f * gauss_noise(&seed);
+		}
+	}
+
+	free(history);
+	free(batch);
+}
+
+static uint32_t elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000000000 + (end->tv_nsec - start->tv_nsec);
+}
+
+static float distance(const float *a, const float *b)
+{
+	float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+//! Angle between two attitudes (deg)
+static float attitude_error(const float *a, const float *b)
+{
+	float dot = fabsf(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+
+	return 2 * acosf(MIN(dot, 1)) * RAD2DEG;
+}
+
+/**
+ * Run every event through the INS.  It starts once the mag and baro have
+ * reported, levelled from the accels and pointed by the mag like the
+ * attitude module does.
+ * @return the number of steps stored in steps
+ */
+static int replay(struct replay_step *steps)
+{
+	const float zeros[3] = { 0, 0, 0 };
+	const float mag_var[3] = { 10, 10, 100 };
+	const float accel_var[3] = { 0.003f, 0.003f, 0.003f };
+	const float gyro_var[3] = { 1e-5f, 1e-5f, 1e-4f };
+
+	float mag[3] = { 0 }, pos[3] = { 0 }, vel[3] = { 0 }, baro = 0;
+	float reference[10];
+	bool have_mag = false, have_baro = false, have_reference = false;
+	bool running = false;
+	float baro_offset = 0, last_t = 0;
+	uint16_t sensors = 0, waiting = 0;
+	int num_steps = 0;
+
+	for (int e = 0; e < num_events; e++) {
+		const struct replay_event *ev = &events[e];
+
+		switch (ev->kind) {
+		case REPLAY_MAG:
+			memcpy(mag, ev->v, sizeof(mag));
+			sensors |= MAG_SENSORS;
+			have_mag = true;
+			continue;
+		case REPLAY_BARO:
+			baro = ev->v[0];
+			sensors |= BARO_SENSOR;
+			have_baro = true;
+			continue;
+		case REPLAY_GPS_POS:
+			memcpy(pos, ev->v, sizeof(pos));
+			sensors |= POS_SENSORS;
+			continue;
+		case REPLAY_GPS_VEL:
+			memcpy(vel, ev->v, sizeof(vel));
+			sensors |= HORIZ_VEL_SENSORS | VERT_VEL_SENSORS;
+			continue;
+		case REPLAY_REFERENCE:
+			memcpy(reference, ev->v, sizeof(reference));
+			have_reference = true;
+			continue;
+		case REPLAY_IMU:
+			break;
+		}
+
+		const float *gyro = ev->v, *accel = &ev->v[3];
+
+		if (!running) {
+			if (!have_mag || !have_baro)
+				continue;
+
+			INSGPSInit();
+			INSSetMagNorth(mag_north);
+			INSSetMagVar(mag_var);
+			INSSetAccelVar(accel_var);
+			INSSetGyroVar(gyro_var);
+			INSSetBaroVar(0.01f);
+			INSSetPosVelVar(0.001f, 0.01f, 0.5f);
+			INSSetGPSDelay(gps_delay);
+
+			float rpy[3], q[4];
+			rpy[0] = atan2f(-accel[1], -accel[2]) * RAD2DEG;
+			rpy[1] = atan2f(accel[0], -accel[2]) * RAD2DEG;
+			rpy[2] = atan2f(-mag[1], mag[0]) * RAD2DEG;
+			RPY2Quaternion(rpy, q);
+
+			baro_offset = -baro;
+			INSSetState((sensors & POS_SENSORS) ? pos : zeros, zeros, q, zeros, zeros);
+
+			running = true;
+			last_t = ev->t;
+			sensors = 0;
+			continue;
+		}
+
+		float dT = ev->t - last_t;
+		last_t = ev->t;
+
+		// Like the attitude module
+		if (dT > 0.01f)
+			dT = 0.01f;
+		else if (dT <= 0.0005f)
+			dT = 0.0005f;
+
+		struct timespec start, predicted, end;
+		uint16_t fused = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		INSStatePrediction(gyro, accel, dT);
+		INSCovariancePrediction(dT);
+
+		clock_gettime(CLOCK_MONOTONIC, &predicted);
+
+		if (spread) {
+			if (sensors)
+				INSDeferCorrection(mag, pos, vel, baro + baro_offset, sensors);
+
+			waiting |= sensors;
+			uint16_t still_waiting = INSCorrectionStep();
+			fused = waiting & ~still_waiting;
+			waiting = still_waiting;
+		} else if (sensors) {
+			INSCorrection(mag, pos, vel, baro + baro_offset, sensors);
+			fused = sensors;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		sensors = 0;
+
+		struct replay_step *s = &steps[num_steps++];
+
+		s->t = ev->t;
+		s->step_ns = elapsed_ns(&start, &end);
+		s->correction_ns = elapsed_ns(&predicted, &end);
+		s->sensors = fused;
+		s->pos_err = s->vel_err = s->att_err = NAN;
+
+		if (have_reference) {
+			float state_pos[3], state_vel[3], state_q[4];
+
+			INSGetState(state_pos, state_vel, state_q, NULL, NULL);
+
+			s->pos_err = distance(state_pos, reference);
+			s->vel_err = distance(state_vel, &reference[3]);
+			s->att_err = attitude_error(state_q, &reference[6]);
+		}
+	}
+
+	return num_steps;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t ua = *(const uint32_t *) a, ub = *(const uint32_t *) b;
+
+	return (ua > ub) - (ua < ub);
+}
+
+//! Print the mean, median, 99th percentile and worst of step times
+static void print_times(const char *name, uint32_t *ns, int count)
+{
+	double sum = 0;
+
+	for (int i = 0; i < count; i++)
+		sum += ns[i];
+
+	qsort(ns, count, sizeof(*ns), compare_u32);
+
+	printf("%-16s %9.2f %9.2f %9.2f %9.2f\n", name, sum / count / 1000,
+			ns[count / 2] / 1000.0, ns[count * 99 / 100] / 1000.0,
+			ns[count - 1] / 1000.0);
+}
+
+static void report(const struct replay_step *steps, int num_steps)
+{
+	uint32_t *step_ns = malloc(num_steps * sizeof(*step_ns));
+	uint32_t *correction_ns = malloc(num_steps * sizeof(*correction_ns));
+	int corrections = 0;
+
+	PIOS_Assert(step_ns && correction_ns);
+
+	for (int i = 0; i < num_steps; i++) {
+		step_ns[i] = steps[i].step_ns;
+
+		if (steps[i].sensors)
+			correction_ns[corrections++] = steps[i].correction_ns;
+	}
+
+	printf("%d steps, %d with corrections, %s\n\n", num_steps, corrections,
+			spread ? "one sensor group a step" : "all sensors at once");
+
+	printf("%-16s %9s %9s %9s %9s\n", "time (us)", "mean", "median", "99%", "worst");
+	print_times("step", step_ns, num_steps);
+	if (corrections)
+		print_times("correction", correction_ns, corrections);
+
+	free(step_ns);
+	free(correction_ns);
+
+	double sum[3] = { 0 };
+	float worst[3] = { 0 };
+	int count = 0;
+
+	for (int i = 0; i < num_steps; i++) {
+		const struct replay_step *s = &steps[i];
+		float err[3] = { s->pos_err, s->vel_err, s->att_err };
+
+		if (s->t - steps[0].t < settle || isnan(s->pos_err))
+			continue;
+
+		for (int j = 0; j < 3; j++) {
+			sum[j] += err[j] * err[j];
+			worst[j] = MAX(worst[j], err[j]);
+		}
+
+		count++;
+	}
+
+	if (!count) {
+		printf("\nNo reference after the first %.0f s to compare against\n",
+				(double) settle);
+		return;
+	}
+
+	printf("\n%-16s %9s %9s\n", "error", "RMS", "worst");
+	printf("%-16s %9.3f %9.3f\n", "position (m)", sqrt(sum[0] / count), (double) worst[0]);
+	printf("%-16s %9.3f %9.3f\n", "velocity (m/s)", sqrt(sum[1] / count), (double) worst[1]);
+	printf("%-16s %9.3f %9.3f\n", "attitude (deg)", sqrt(sum[2] / count), (double) worst[2]);
+}
+
+static bool write_trace(const char *name, const struct replay_step *steps, int num_steps)
+{
+	FILE *f = fopen(name, "w");
+
+	if (!f) {
+		perror(name);
+		return false;
+	}
+
+	fprintf(f, "t,step_ns,correction_ns,sensors,pos_err,vel_err,att_err\n");
+
+	for (int i = 0; i < num_steps; i++) {
+		const struct replay_step *s = &steps[i];
+
+		fprintf(f, "%.4f,%u,%u,0x%03x,%.4f,%.4f,%.3f\n", (double) s->t,
+				s->step_ns, s->correction_ns, s->sensors,
+				(double) s->pos_err, (double) s->vel_err,
+				(double) s->att_err);
+	}
+
+	fclose(f);
+
+	return true;
+}
+
+static void usage(const char *cmdname)
+{
+	fprintf(stderr,
+		"Usage: %s [options] [REPLAY]\n"
+		"Run sensor data from a replay file written by dronin-insexport, or\n"
+		"from a simulated flight, through the INS and report step times and\n"
+		"state error.\n\n"
+		"\t-p, --spread\t\t\tfuse one updated sensor group a step\n"
+		"\t-d, --gps-delay=MS\t\tGPS latency the INS corrects for (0)\n"
+		"\t-l, --sim-lag=MS\t\tGPS latency of the simulated flight (100)\n"
+		"\t-t, --time=S\t\t\tlength of the simulated flight (60)\n"
+		"\t-s, --settle=S\t\t\terror is not counted until then (10)\n"
+		"\t-o, --trace=FILE\t\twrite every step as CSV\n",
+		cmdname);
+
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "spread", no_argument, NULL, 'p' },
+		{ "gps-delay", required_argument, NULL, 'd' },
+		{ "sim-lag", required_argument, NULL, 'l' },
+		{ "time", required_argument, NULL, 't' },
+		{ "settle", required_argument, NULL, 's' },
+		{ "trace", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "pd:l:t:s:o:h", options, NULL)) != -1) {
+		switch (opt) {
+		case 'p':
+			spread = true;
+			break;
+		case 'd':
+			gps_delay = atof(optarg) / 1000;
+			break;
+		case 'l':
+			sim_lag = atof(optarg) / 1000;
+			break;
+		case 't':
+			sim_time = atof(optarg);
+			break;
+		case 's':
+			settle = atof(optarg);
+			break;
+		case 'o':
+			trace_name = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (argc - optind > 1 || sim_time <= 0 || sim_lag < 0)
+		usage(argv[0]);
+
+	if (optind < argc) {
+		if (!load_replay(argv[optind]))
+			return 1;
+	} else {
+		printf("Simulated flight of %.0f s, GPS %.0f ms late\n", (double) sim_time,
+				(double) sim_lag * 1000);
+		record_sim_flight();
+	}
+
+	struct replay_step *steps = malloc(num_events * sizeof(*steps));
+	PIOS_Assert(steps);
+
+	int num_steps = replay(steps);
+
+	if (!num_steps) {
+		fprintf(stderr, "The INS never started: no mag and baro data\n");
+		return 1;
+	}
+
+	report(steps, num_steps);
+
+	if (trace_name && !write_trace(trace_name, steps, num_steps))
+		return 1;
+
+	free(steps);
+	free(events);
+
+	return 0;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,2 @@
+#define PIOS_NO_HW
+#define FLIGHT_POSIX
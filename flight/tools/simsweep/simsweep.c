@@ -0,0 +1,490 @@
+/**
+ ******************************************************************************
+ * @addtogroup Tools Tools
+ * @{
+ * @addtogroup SimSweep Controller tuning sweep
+ * @{
+ *
+ * @file       simsweep.c
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Sweep rate controller gains against the simulated vehicle models
+ *
+ * Every combination of the requested gains flies a roll rate step with the
+ * real PID or LQG rate controller on the same models flightd uses.  The
+ * vehicles are stepped in batches of SIMMODEL_MAX_LANES, with one worker
+ * thread per core taking batches until the sweep is done.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "openpilot.h"
+#include "physical_constants.h"
+#include "coordinate_conversions.h"
+#include "misc_math.h"
+#include "lqg.h"
+#include "pid.h"
+#include "simmodel.h"
+
+//! Model time step, the rate simsensors runs at
+#define SWEEP_DT 0.002f
+
+//! Band around the setpoint the response must stay in to be settled
+#define SETTLE_BAND 0.02f
+
+enum sweep_controller { CONTROLLER_PID, CONTROLLER_LQG };
+enum sweep_model { MODEL_QUADCOPTER, MODEL_AIRPLANE };
+
+//! Values a swept gain takes: count of them from min to max
+struct sweep_range {
+	float min;
+	float max;
+	int count;
+	bool log;
+};
+
+//! One set of gains and how its step response went
+struct sweep_case {
+	float gains[3];		//!< kp, ki, kd or q1, q2, r
+	bool failed;		//!< LQR did not solve
+	float rise;		//!< Until 90% of the step (s)
+	float overshoot;	//!< Past the setpoint (%)
+	float settle;		//!< Until within SETTLE_BAND for good (s)
+	float iae;		//!< Integrated absolute error (deg)
+};
+
+static const char *gain_names[2][3] = {
+	{ "kp", "ki", "kd" },
+	{ "q1", "q2", "r" },
+};
+
+static enum sweep_controller controller = CONTROLLER_PID;
+static enum sweep_model model = MODEL_QUADCOPTER;
+static struct sweep_range ranges[2][3] = {
+	{
+		{ 0.0005f, 0.004f, 8, false },
+		{ 0, 0.004f, 5, false },
+		{ 0, 0.00004f, 5, false },
+	}, {
+		{ 0.0000025f, 0.00025f, 5, true },
+		{ 0.00001f, 0.001f, 5, true },
+		{ 1, 1, 1, false },
+	},
+};
+static float step_size = 200;
+static float duration = 0.5f;
+static float gyro_noise = 1;
+static float rtkf_r = 25;
+static int threads;
+static int top = 10;
+
+static struct sweep_case *cases;
+static int num_cases;
+static int next_case;
+
+static float gauss_noise(unsigned int *seed)
+{
+	// Box-Muller; the second value is thrown away for simplicity
+	float u1 = (rand_r(seed) + 1.0f) / (RAND_MAX + 2.0f);
+	float u2 = rand_r(seed) / (RAND_MAX + 1.0f);
+
+	return sqrtf(-2 * logf(u1)) * cosf(2 * PI * u2);
+}
+
+static float range_value(const struct sweep_range *range, int i)
+{
+	if (range->count < 2)
+		return range->min;
+
+	float frac = (float) i / (range->count - 1);
+
+	if (range->log)
+		return range->min * powf(range->max / range->min, frac);
+
+	return range->min + (range->max - range->min) * frac;
+}
+
+/**
+ * Parse a range as MIN:MAX:COUNT with an optional :log suffix, or a single
+ * value
+ */
+static bool parse_range(const char *arg, struct sweep_range *range)
+{
+	char log[4] = "";
+	int fields = sscanf(arg, "%f:%f:%d:%3s", &range->min, &range->max,
+			&range->count, log);
+
+	if (fields == 1) {
+		range->max = range->min;
+		range->count = 1;
+		range->log = false;
+		return true;
+	}
+
+	range->log = fields == 4 && !strcmp(log, "log");
+
+	if (fields < 3 || (fields == 4 && !range->log) || range->count < 1)
+		return false;
+
+	return !range->log || (range->min > 0 && range->max > 0);
+}
+
+/**
+ * Fly a roll rate step with every case of a batch and score the responses
+ */
+static void run_batch(struct simmodel_batch *batch, struct sweep_case *batch_cases,
+		int lanes, struct pid *pids, lqg_t *lqgs, unsigned int *seed)
+{
+	float peak[SIMMODEL_MAX_LANES];
+	float iae[SIMMODEL_MAX_LANES];
+	int risen[SIMMODEL_MAX_LANES];
+	int unsettled[SIMMODEL_MAX_LANES];
+
+	const int steps = duration / SWEEP_DT;
+	const float setpoint = step_size;
+
+	simmodel_init(batch, lanes);
+
+	for (int i = 0; i < lanes; i++) {
+		const float *gains = batch_cases[i].gains;
+
+		if (controller == CONTROLLER_PID) {
+			pid_configure(&pids[i], gains[0], gains[1], gains[2], 0.3f, SWEEP_DT);
+			pid_zero(&pids[i]);
+		} else {
+			lqr_update(lqg_get_lqr(lqgs[i]), gains[0], gains[1], gains[2]);
+			while (lqg_solver_status(lqgs[i]) == LQG_SOLVER_RUNNING)
+				lqg_run_covariance(lqgs[i], 100);
+			lqg_set_x0(lqgs[i], 0);
+		}
+
+		batch_cases[i].failed = controller == CONTROLLER_LQG &&
+			lqg_solver_status(lqgs[i]) != LQG_SOLVER_DONE;
+
+		// Hover, or thereabouts
+		batch->thrust[i] = 0.5f;
+
+		peak[i] = 0;
+		iae[i] = 0;
+		risen[i] = -1;
+		unsettled[i] = -1;
+	}
+
+	for (int n = 0; n < steps; n++) {
+		for (int i = 0; i < lanes; i++) {
+			float gyro = batch->rate[0][i];
+			float u = 0;
+
+			if (gyro_noise > 0)
+				gyro += gyro_noise * gauss_noise(seed);
+
+			if (controller == CONTROLLER_PID)
+				u = pid_apply_setpoint(&pids[i], NULL, setpoint, gyro);
+			else if (!batch_cases[i].failed)
+				u = lqg_controller(lqgs[i], gyro, setpoint);
+
+			batch->actuator[0][i] = bound_sym(u, 1.0f);
+		}
+
+		if (model == MODEL_AIRPLANE) {
+			for (int i = 0; i < lanes; i++) {
+				float q[4] = { batch->q[0][i], batch->q[1][i],
+					batch->q[2][i], batch->q[3][i] };
+				float rpy[3];
+
+				Quaternion2RPY(q, rpy);
+				batch->attitude[0][i] = rpy[0];
+				batch->attitude[1][i] = rpy[1];
+			}
+
+			simmodel_step_airplane(batch, SWEEP_DT);
+		} else {
+			simmodel_step_quadcopter(batch, SWEEP_DT);
+		}
+
+		for (int i = 0; i < lanes; i++) {
+			float rate = batch->rate[0][i];
+			float err = fabsf(setpoint - rate);
+
+			peak[i] = rate > peak[i] ? rate : peak[i];
+			iae[i] += err * SWEEP_DT;
+
+			if (risen[i] < 0 && rate >= 0.9f * setpoint)
+				risen[i] = n;
+			if (err > SETTLE_BAND * setpoint)
+				unsettled[i] = n;
+		}
+	}
+
+	for (int i = 0; i < lanes; i++) {
+		struct sweep_case *c = &batch_cases[i];
+
+		c->rise = risen[i] < 0 ? INFINITY : (risen[i] + 1) * SWEEP_DT;
+		c->overshoot = peak[i] > setpoint ?
+			(peak[i] / setpoint - 1) * 100 : 0;
+		c->settle = unsettled[i] >= steps - 1 ? INFINITY :
+			(unsettled[i] + 1) * SWEEP_DT;
+		c->iae = c->failed ? INFINITY : iae[i];
+	}
+}
+
+static void *sweep_worker(void *arg)
+{
+	unsigned int seed = (uintptr_t) arg;
+	struct simmodel_batch *batch = malloc(sizeof(*batch));
+	struct pid pids[SIMMODEL_MAX_LANES];
+	lqg_t lqgs[SIMMODEL_MAX_LANES];
+
+	PIOS_Assert(batch);
+
+	if (controller == CONTROLLER_LQG) {
+		/* Autotune's view of the model: the actuator lag as a
+		 * continuous time constant and the log of the rate gain. */
+		float alpha = SIMMODEL_ACTUATOR_TAU / (SIMMODEL_ACTUATOR_TAU + SWEEP_DT);
+		float tau = -SWEEP_DT / logf(alpha);
+		float beta = logf(SIMMODEL_RATE_SCALE / tau);
+
+		// The estimator has the stock LQGSettings noise model
+		for (int i = 0; i < SIMMODEL_MAX_LANES; i++) {
+			rtkf_t rtkf = rtkf_create(beta, tau, SWEEP_DT, rtkf_r,
+					1, 0.000003f, 0.000001f, 0.3f);
+			lqr_t lqr = lqr_create(beta, tau, SWEEP_DT, 1, 1, 1);
+
+			lqgs[i] = lqg_create(rtkf, lqr);
+		}
+	}
+
+	while (true) {
+		int first = __atomic_fetch_add(&next_case, SIMMODEL_MAX_LANES,
+				__ATOMIC_RELAXED);
+
+		if (first >= num_cases)
+			break;
+
+		int lanes = MIN(num_cases - first, SIMMODEL_MAX_LANES);
+
+		run_batch(batch, &cases[first], lanes, pids, lqgs, &seed);
+	}
+
+	free(batch);
+
+	return NULL;
+}
+
+static int compare_cases(const void *a, const void *b)
+{
+	const struct sweep_case *ca = a, *cb = b;
+
+	if (ca->iae < cb->iae)
+		return -1;
+
+	return ca->iae > cb->iae;
+}
+
+static void print_time(float t)
+{
+	if (isinf(t))
+		printf("%9s", "-");
+	else
+		printf("%9.1f", t * 1000);
+}
+
+static void usage(const char *cmdname)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"Fly a roll rate step for every combination of gains and rank the\n"
+		"responses by integrated absolute error.\n\n"
+		"\t-c, --controller=pid|lqg\trate controller (pid)\n"
+		"\t-m, --model=quadcopter|airplane\tvehicle model (quadcopter)\n"
+		"\t    --kp, --ki, --kd=RANGE\tPID gains\n"
+		"\t    --q1, --q2, --r=RANGE\tLQR weights\n"
+		"\t-s, --step=DEG_S\t\tsize of the rate step (200)\n"
+		"\t-t, --time=S\t\t\tlength of each flight (0.5)\n"
+		"\t-n, --noise=DEG_S\t\tgyro noise standard deviation (1)\n"
+		"\t-R, --rtkf-r=R\t\t\tLQG estimator measurement noise (25)\n"
+		"\t-j, --jobs=N\t\t\tworker threads (one per core)\n"
+		"\t-k, --top=N\t\t\tresults to report (10)\n\n"
+		"A RANGE is MIN:MAX:COUNT, spaced evenly or geometrically with a\n"
+		"trailing :log, or a single value.\n",
+		cmdname);
+
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "controller", required_argument, NULL, 'c' },
+		{ "model", required_argument, NULL, 'm' },
+		{ "kp", required_argument, NULL, 0x100 },
+		{ "ki", required_argument, NULL, 0x101 },
+		{ "kd", required_argument, NULL, 0x102 },
+		{ "q1", required_argument, NULL, 0x110 },
+		{ "q2", required_argument, NULL, 0x111 },
+		{ "r", required_argument, NULL, 0x112 },
+		{ "step", required_argument, NULL, 's' },
+		{ "time", required_argument, NULL, 't' },
+		{ "noise", required_argument, NULL, 'n' },
+		{ "rtkf-r", required_argument, NULL, 'R' },
+		{ "jobs", required_argument, NULL, 'j' },
+		{ "top", required_argument, NULL, 'k' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	int opt;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((opt = getopt_long(argc, argv, "c:m:s:t:n:R:j:k:h", options, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			if (!strcmp(optarg, "pid"))
+				controller = CONTROLLER_PID;
+			else if (!strcmp(optarg, "lqg"))
+				controller = CONTROLLER_LQG;
+			else
+				usage(argv[0]);
+			break;
+		case 'm':
+			if (!strcmp(optarg, "quadcopter"))
+				model = MODEL_QUADCOPTER;
+			else if (!strcmp(optarg, "airplane"))
+				model = MODEL_AIRPLANE;
+			else
+				usage(argv[0]);
+			break;
+		case 0x100:
+		case 0x101:
+		case 0x102:
+		case 0x110:
+		case 0x111:
+		case 0x112:
+			if (!parse_range(optarg, &ranges[(opt >> 4) & 1][opt & 0xf]))
+				usage(argv[0]);
+			break;
+		case 's':
+			step_size = atof(optarg);
+			break;
+		case 't':
+			duration = atof(optarg);
+			break;
+		case 'n':
+			gyro_noise = atof(optarg);
+			break;
+		case 'R':
+			rtkf_r = atof(optarg);
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		case 'k':
+			top = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind != argc || step_size <= 0 || duration < SWEEP_DT || threads < 1)
+		usage(argv[0]);
+
+	const struct sweep_range *range = ranges[controller];
+
+	num_cases = range[0].count * range[1].count * range[2].count;
+	cases = calloc(num_cases, sizeof(*cases));
+	PIOS_Assert(cases);
+
+	for (int n = 0; n < num_cases; n++) {
+		int i = n % range[0].count;
+		int j = n / range[0].count % range[1].count;
+		int k = n / range[0].count / range[1].count;
+
+		cases[n].gains[0] = range_value(&range[0], i);
+		cases[n].gains[1] = range_value(&range[1], j);
+		cases[n].gains[2] = range_value(&range[2], k);
+	}
+
+	threads = MIN(threads, (num_cases + SIMMODEL_MAX_LANES - 1) / SIMMODEL_MAX_LANES);
+
+	printf("Sweeping %d %s gain sets on the %s model, %.0f deg/s roll step for %.2f s, %d thread%s\n",
+			num_cases, controller == CONTROLLER_PID ? "PID" : "LQG",
+			model == MODEL_QUADCOPTER ? "quadcopter" : "airplane",
+			(double) step_size, (double) duration, threads, threads == 1 ? "" : "s");
+
+	struct timespec start, end;
+	pthread_t workers[threads];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (int i = 0; i < threads; i++) {
+		if (pthread_create(&workers[i], NULL, sweep_worker, (void *) (uintptr_t) (i + 1))) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+
+	for (int i = 0; i < threads; i++)
+		pthread_join(workers[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("Flew %.0f sim s in %.2f wall s\n\n", (double) num_cases * duration, wall);
+
+	qsort(cases, num_cases, sizeof(*cases), compare_cases);
+
+	printf("%11s %11s %11s %9s %9s %9s %9s\n",
+			gain_names[controller][0], gain_names[controller][1],
+			gain_names[controller][2], "rise ms", "over %", "settle ms", "IAE");
+
+	for (int n = 0; n < MIN(top, num_cases); n++) {
+		const struct sweep_case *c = &cases[n];
+
+		printf("%11.4g %11.4g %11.4g ", (double) c->gains[0],
+				(double) c->gains[1], (double) c->gains[2]);
+
+		if (c->failed) {
+			printf("LQR did not converge\n");
+			continue;
+		}
+
+		print_time(c->rise);
+		printf(" %9.1f ", (double) c->overshoot);
+		print_time(c->settle);
+		printf(" %9.2f\n", (double) c->iae);
+	}
+
+	free(cases);
+
+	return 0;
+}
+
+/**
+ * @}
+ * @}
+ */
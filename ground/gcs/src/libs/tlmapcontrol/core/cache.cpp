@@ -44,7 +44,9 @@ namespace core {
         routeCache = cache + "RouteCache" + QDir::separator();
         geoCache = cache + "GeocoderCache"+ QDir::separator();
         placemarkCache = cache + "PlacemarkCache" + QDir::separator();
+        tilePackCache = cache + "TilePacks" + QDir::separator();
         ImageCache.setGtileCache(value);
+        LoadTilePacks();
     }
     QString Cache::CacheLocation()
     {
@@ -58,6 +60,65 @@ namespace core {
             setCacheLocation(cache);
         }
     }
+    /**
+     * @brief Cache::LoadTilePacks Open every tile pack in the cache location,
+     * closing any that were open before
+     */
+    void Cache::LoadTilePacks()
+    {
+        QWriteLocker locker(&tilePacksLock);
+
+        qDeleteAll(tilePacks);
+        tilePacks.clear();
+
+        QDir dir(tilePackCache);
+        foreach(QString file,dir.entryList(QStringList("*.tilepack"),QDir::Files,QDir::Name))
+        {
+            TilePack *pack=new TilePack;
+            if(pack->Open(dir.filePath(file)))
+                tilePacks.append(pack);
+            else
+                delete pack;
+        }
+    }
+    QByteArray Cache::GetImageFromTilePacks(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QReadLocker locker(&tilePacksLock);
+
+        foreach(TilePack *pack,tilePacks)
+        {
+            if(pack->Type()==type)
+            {
+                QByteArray ret=pack->GetImage(pos,zoom);
+                if(!ret.isEmpty())
+                    return ret;
+            }
+        }
+        return QByteArray();
+    }
+    /**
+     * @brief Cache::ImportTilePack Make a tile pack in the cache location from
+     * an MBTiles file, and start using it
+     * @param type the map type the tiles are served as
+     */
+    bool Cache::ImportTilePack(const QString &mbtiles,const MapType::Types &type)
+    {
+        if(!QDir().mkpath(tilePackCache))
+            return false;
+
+        QString pack=tilePackCache+QFileInfo(mbtiles).completeBaseName()+".tilepack";
+
+        // The pack may be replacing one that is mapped now
+        {
+            QWriteLocker locker(&tilePacksLock);
+            qDeleteAll(tilePacks);
+            tilePacks.clear();
+        }
+
+        bool ok=TilePack::ImportMBTiles(mbtiles,pack,type);
+        LoadTilePacks();
+        return ok;
+    }
     QString Cache::GetGeocoderFromCache(const QString &urlEnd)
     {
 #ifdef DEBUG_GetGeocoderFromCache
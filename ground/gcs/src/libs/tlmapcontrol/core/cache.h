@@ -28,6 +28,8 @@
 #define CACHE_H
 
 #include "pureimagecache.h"
+#include "tilepack.h"
+#include <QReadWriteLock>
 #include "debugheader.h"
 #include "corecommon.h"
 
@@ -47,6 +49,9 @@ namespace core {
         QString GetPlacemarkFromCache(const QString &urlEnd);
         void CacheRoute(const QString &urlEnd,const QString &content);
         QString GetRouteFromCache(const QString &urlEnd);
+        QByteArray GetImageFromTilePacks(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        bool ImportTilePack(const QString &mbtiles,const MapType::Types &type);
+        void LoadTilePacks();
 
     private:
         Cache();
@@ -57,6 +62,9 @@ namespace core {
         QString routeCache;
         QString geoCache;
         QString placemarkCache;
+        QString tilePackCache;
+        QList<TilePack *> tilePacks;
+        QReadWriteLock tilePacksLock;
     };
 
 }
@@ -30,11 +30,12 @@
 #include "maptype.h"
 #include "point.h"
 #include <QByteArray>
+#include "corecommon.h"
 
 
 
 namespace core {
-    class CacheItemQueue
+    class TLMAPWIDGET_EXPORT CacheItemQueue
     {
     public:
         CacheItemQueue(const MapType::Types &Type,const core::Point &Pos,const QByteArray &Img,const int &Zoom);
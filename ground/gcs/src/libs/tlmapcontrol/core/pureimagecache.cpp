@@ -31,11 +31,100 @@
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
+    //! Index for finding a tile by position; older databases were made without it
+    static const char *TileIndexSQL=
+            "CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)";
+
+    /**
+     * A connection to the tile database, only used by the thread that made
+     * it.  The statements are prepared once, when it is opened.
+     */
+    struct PureImageCache::Connection
+    {
+        ~Connection()
+        {
+            // The statements must go before the connection can be removed
+            getTile=QSqlQuery();
+            putTile=QSqlQuery();
+            putTileData=QSqlQuery();
+            deleteTile=QSqlQuery();
+            QSqlDatabase::database(name,false).close();
+            QSqlDatabase::removeDatabase(name);
+        }
+
+        QString name;
+        QString file;
+        QSqlQuery getTile;
+        QSqlQuery putTile;
+        QSqlQuery putTileData;
+        QSqlQuery deleteTile;
+    };
+
     PureImageCache::PureImageCache()
     {
 
     }
 
+    PureImageCache::~PureImageCache()
+    {
+        // Other threads' connections go when those threads finish
+        connections.setLocalData(nullptr);
+    }
+
+    /**
+     * Get this thread's connection to the database, opening it if need be.
+     * Must be called with lock held.
+     * @return the connection, or null if the database can't be opened
+     */
+    PureImageCache::Connection *PureImageCache::connection()
+    {
+        if(gtilecache.isEmpty())
+            return nullptr;
+        QString file=gtilecache+"Data.qmdb";
+        Connection *cn=connections.localData();
+        if(cn && cn->file==file)
+            return cn;
+
+        // Replaces (and closes) any connection to a previous cache location
+        connections.setLocalData(nullptr);
+
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+
+        cn=new Connection;
+        cn->name=QString("PureImageCache%1").arg(id);
+        cn->file=file;
+        {
+            QSqlDatabase db=QSqlDatabase::addDatabase("QSQLITE",cn->name);
+            db.setDatabaseName(file);
+            if(!db.open())
+            {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"PureImageCache: Unable to open"<<file<<db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                delete cn;
+                return nullptr;
+            }
+            QSqlQuery query(db);
+            // Let readers carry on while tiles are written
+            query.exec("PRAGMA journal_mode=WAL");
+            query.exec("PRAGMA synchronous=NORMAL");
+            query.exec(TileIndexSQL);
+
+            cn->getTile=QSqlQuery(db);
+            cn->getTile.prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+            cn->putTile=QSqlQuery(db);
+            cn->putTile.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+            cn->putTileData=QSqlQuery(db);
+            cn->putTileData.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+            cn->deleteTile=QSqlQuery(db);
+            cn->deleteTile.prepare("DELETE FROM Tiles WHERE id = ?");
+        }
+        connections.setLocalData(cn);
+        return cn;
+    }
+
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
@@ -109,6 +198,15 @@ namespace core {
             {
 #ifdef DEBUG_PUREIMAGECACHE
                 qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                db.close();
+                return false;
+            }
+            query.exec(TileIndexSQL);
+            if(query.numRowsAffected()==-1)
+            {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
 #endif //DEBUG_PUREIMAGECACHE
                 db.close();
                 return false;
@@ -173,129 +271,96 @@ namespace core {
     }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
     {
-        if(gtilecache.isEmpty()|gtilecache.isNull())
-            return false;
-        lock.lockForRead();
+        CacheItemQueue item(type,pos,tile,zoom);
+        return PutImagesToCache(QList<CacheItemQueue *>()<<&item);
+    }
+    /**
+     * Write tiles to the database in a single transaction
+     */
+    bool PureImageCache::PutImagesToCache(const QList<CacheItemQueue *> &tiles)
+    {
+        QReadLocker locker(&lock);
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"PutImageToCache Start:";//<<pos;
+        qDebug()<<"PutImagesToCache Start:"<<tiles.count();
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        Connection *cn=connection();
+        if(!cn)
+            return false;
+        QSqlDatabase db=QSqlDatabase::database(cn->name,false);
+        db.transaction();
+        QString date=QDateTime::currentDateTime().toString();
+        foreach(CacheItemQueue *tile,tiles)
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
+            cn->putTile.bindValue(0,tile->GetPosition().X());
+            cn->putTile.bindValue(1,tile->GetPosition().Y());
+            cn->putTile.bindValue(2,tile->GetZoom());
+            cn->putTile.bindValue(3,(int)tile->GetMapType());
+            cn->putTile.bindValue(4,date);
+            if(!cn->putTile.exec())
             {
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
-                }
-                cn.close();
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"PutImagesToCache: "<<cn->putTile.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                continue;
             }
+            cn->putTileData.bindValue(0,tile->GetImg());
+            cn->putTileData.exec();
+        }
+        cn->putTile.finish();
+        cn->putTileData.finish();
+        if(!db.commit())
+        {
+            db.rollback();
+            return false;
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
-        lock.unlock();
         return true;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
+        QReadLocker locker(&lock);
         QByteArray ar;
-        if(gtilecache.isEmpty()|gtilecache.isNull())
-            return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
+        Connection *cn=connection();
+        if(!cn)
+            return ar;
+        cn->getTile.bindValue(0,pos.X());
+        cn->getTile.bindValue(1,pos.Y());
+        cn->getTile.bindValue(2,zoom);
+        cn->getTile.bindValue(3,(int) type);
+        if(cn->getTile.exec() && cn->getTile.next())
         {
-            QString db=dir+"Data.qmdb";
-            {
-                QSqlDatabase cn;
-
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-                        query.next();
-                        if(query.isValid())
-                        {
-                            ar=query.value(0).toByteArray();
-                        }
-                    }
-                    cn.close();
-                }
-            }
+            ar=cn->getTile.value(0).toByteArray();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
-        lock.unlock();
+        cn->getTile.finish();
         return ar;
     }
     void PureImageCache::deleteOlderTiles(int const& days)
     {
-        if(gtilecache.isEmpty()|gtilecache.isNull())
-            return;
+        QReadLocker locker(&lock);
         QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
+        Connection *cn=connection();
+        if(!cn)
+            return;
+        QSqlDatabase db=QSqlDatabase::database(cn->name,false);
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
+            QSqlQuery query(db);
+            query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
+            while(query.next())
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
-                    }
-
-                    cn.close();
-                }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
+                    add.append(query.value(0).toLongLong());
             }
         }
+        db.transaction();
+        foreach(long i,add)
+        {
+            cn->deleteTile.bindValue(0,(qlonglong)i);
+            cn->deleteTile.exec();
+        }
+        cn->deleteTile.finish();
+        db.commit();
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
     bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
@@ -42,23 +42,38 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include "cacheitemqueue.h"
+#include "corecommon.h"
 namespace core {
-    class PureImageCache
+    /**
+     * The tile database.  Each thread that uses it gets its own connection,
+     * kept open with its statements prepared; the database is in WAL mode
+     * so those threads can read while another writes.
+     */
+    class TLMAPWIDGET_EXPORT PureImageCache
     {
 
     public:
         PureImageCache();
+        ~PureImageCache();
         static bool CreateEmptyDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
+        bool PutImagesToCache(const QList<CacheItemQueue *> &tiles);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
     private:
+        struct Connection;
+
+        Connection *connection();
+
         QString gtilecache;
         QMutex Mcounter;
         QReadWriteLock lock;
+        QThreadStorage<Connection *> connections;
         static qlonglong ConnCounter;
 
     };
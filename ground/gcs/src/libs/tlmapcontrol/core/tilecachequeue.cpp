@@ -44,14 +44,14 @@ void TileCacheQueue::EnqueueCacheTask(CacheItemQueue *task)
 #ifdef DEBUG_TILECACHEQUEUE
     qDebug()<<"DB Do I EnqueueCacheTask"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
+    // The map's loaders enqueue from several threads at once
+    QMutexLocker locker(&mutex);
     if(!tileCacheQueue.contains(task))
     {
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug()<<"EnqueueCacheTask"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
-        mutex.lock();
         tileCacheQueue.enqueue(task);
-        mutex.unlock();
         if(this->isRunning())
         {
 #ifdef DEBUG_TILECACHEQUEUE
@@ -79,21 +79,23 @@ void TileCacheQueue::run()
 #endif //DEBUG_TILECACHEQUEUE
     while(true)
     {
-        CacheItemQueue *task;
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug()<<"Cache";
 #endif //DEBUG_TILECACHEQUEUE
         if(tileCacheQueue.count()>0)
         {
+            // Write whatever has queued up in one transaction
+            QList<CacheItemQueue*> tasks;
             mutex.lock();
-            task=tileCacheQueue.dequeue();
+            while(!tileCacheQueue.isEmpty() && tasks.count()<MaxTilesPerTransaction)
+                tasks.append(tileCacheQueue.dequeue());
             mutex.unlock();
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
+            qDebug()<<"Cache engine Put:"<<tasks.count()<<"tiles";
 #endif //DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
+            Cache::Instance()->ImageCache.PutImagesToCache(tasks);
             usleep(44);
-            delete task;
+            qDeleteAll(tasks);
         }
 
         else
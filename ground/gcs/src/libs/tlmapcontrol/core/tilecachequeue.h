@@ -50,6 +50,7 @@ namespace core {
     protected:
         QQueue<CacheItemQueue*> tileCacheQueue;
     private:
+        static const int MaxTilesPerTransaction=64;
         void run();
         QMutex mutex;
         QMutex waitmutex;
@@ -0,0 +1,243 @@
+/**
+******************************************************************************
+*
+* @file       tilepack.cpp
+* @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+* @brief      Read only, memory mapped packs of map tiles for offline use
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, see <http://www.gnu.org/licenses/>
+*/
+#include "tilepack.h"
+#include <QDebug>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <QtEndian>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <QVariant>
+#include <algorithm>
+//#define DEBUG_TILEPACK
+namespace core {
+    static const char Magic[8]={'D','R','T','I','L','E','P','K'};
+    static const quint32 Version=1;
+    static const int HeaderLength=32;
+    static const int EntryLength=24;
+    static const int MaxTileBits=29; // Bits of x and y in a key
+
+    TilePack::TilePack():data(nullptr),index(nullptr),size(0),count(0),type(MapType::None)
+    {
+    }
+    TilePack::~TilePack()
+    {
+        Close();
+    }
+    quint64 TilePack::Key(const qint64 &x, const qint64 &y, const int &zoom)
+    {
+        return (quint64(zoom)<<(2*MaxTileBits)) | (quint64(x)<<MaxTileBits) | quint64(y);
+    }
+    bool TilePack::Open(const QString &file)
+    {
+        Close();
+
+        this->file.setFileName(file);
+        if(!this->file.open(QIODevice::ReadOnly))
+            return false;
+
+        size=this->file.size();
+        if(size>=HeaderLength)
+            data=this->file.map(0,size);
+
+        if(data==nullptr || memcmp(data,Magic,sizeof(Magic))!=0 || qFromLittleEndian<quint32>(data+8)!=Version)
+        {
+            qDebug()<<"TilePack: not a tile pack:"<<file;
+            Close();
+            return false;
+        }
+
+        type=(MapType::Types)qFromLittleEndian<quint32>(data+12);
+        count=qFromLittleEndian<quint32>(data+16);
+        quint64 indexOffset=qFromLittleEndian<quint64>(data+24);
+
+        if(indexOffset<HeaderLength || indexOffset>quint64(size) || quint64(size)-indexOffset<quint64(count)*EntryLength)
+        {
+            qDebug()<<"TilePack: truncated tile pack:"<<file;
+            Close();
+            return false;
+        }
+
+        index=data+indexOffset;
+#ifdef DEBUG_TILEPACK
+        qDebug()<<"TilePack: opened"<<file<<"with"<<count<<"tiles of"<<MapType::StrByType(type);
+#endif //DEBUG_TILEPACK
+        return true;
+    }
+    void TilePack::Close()
+    {
+        if(data!=nullptr)
+            file.unmap(const_cast<uchar *>(data));
+        file.close();
+        data=nullptr;
+        index=nullptr;
+        size=0;
+        count=0;
+        type=MapType::None;
+    }
+    QByteArray TilePack::GetImage(const Point &pos, const int &zoom)const
+    {
+        if(index==nullptr || pos.X()<0 || pos.Y()<0 || pos.X()>>MaxTileBits || pos.Y()>>MaxTileBits)
+            return QByteArray();
+
+        quint64 key=Key(pos.X(),pos.Y(),zoom);
+        int lo=0;
+        int hi=count;
+
+        while(lo<hi)
+        {
+            int mid=lo+(hi-lo)/2;
+            const uchar *entry=index+qint64(mid)*EntryLength;
+            quint64 k=qFromLittleEndian<quint64>(entry);
+
+            if(k<key)
+                lo=mid+1;
+            else if(k>key)
+                hi=mid;
+            else
+            {
+                quint64 offset=qFromLittleEndian<quint64>(entry+8);
+                quint32 length=qFromLittleEndian<quint32>(entry+16);
+
+                if(offset>quint64(size) || quint64(size)-offset<length)
+                    return QByteArray();
+                return QByteArray((const char *)data+offset,length);
+            }
+        }
+        return QByteArray();
+    }
+    /**
+     * @brief TilePack::ImportMBTiles Make a tile pack from an MBTiles file
+     * @param mbtiles the MBTiles file
+     * @param pack the tile pack to write; an existing one is replaced
+     * @param type the map type the tiles are served as
+     */
+    bool TilePack::ImportMBTiles(const QString &mbtiles, const QString &pack, const MapType::Types &type)
+    {
+        struct Entry
+        {
+            quint64 key;
+            quint64 offset;
+            quint32 length;
+            bool operator<(Entry const& rhs)const{return key<rhs.key;}
+        };
+
+        QString connectionName=QString("TilePackImport%1").arg((quintptr)QThread::currentThreadId());
+        QVector<Entry> entries;
+        bool ok=false;
+
+        QSaveFile out(pack);
+        if(!out.open(QIODevice::WriteOnly))
+            return false;
+        {
+            QSqlDatabase db=QSqlDatabase::addDatabase("QSQLITE",connectionName);
+            db.setDatabaseName(mbtiles);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY");
+
+            if(db.open())
+            {
+                // Rows are counted from the bottom unless the file says otherwise
+                bool xyz=false;
+                QSqlQuery query(db);
+                if(query.exec("SELECT value FROM metadata WHERE name='scheme'") && query.next())
+                    xyz=(query.value(0).toString()=="xyz");
+
+                QByteArray header(HeaderLength,0);
+                memcpy(header.data(),Magic,sizeof(Magic));
+                qToLittleEndian<quint32>(Version,(uchar *)header.data()+8);
+                qToLittleEndian<quint32>(type,(uchar *)header.data()+12);
+                out.write(header);
+
+                query.setForwardOnly(true);
+                ok=query.exec("SELECT zoom_level, tile_column, tile_row, tile_data FROM tiles");
+
+                quint64 offset=HeaderLength;
+                while(ok && query.next())
+                {
+                    int zoom=query.value(0).toInt();
+                    qint64 x=query.value(1).toLongLong();
+                    qint64 y=query.value(2).toLongLong();
+                    QByteArray image=query.value(3).toByteArray();
+
+                    // Check the zoom before shifting by it, the file may be bad
+                    if(zoom<0 || zoom>MaxTileBits)
+                        continue;
+
+                    if(!xyz)
+                        y=(qint64(1)<<zoom)-1-y;
+
+                    if(x<0 || y<0 || x>>zoom || y>>zoom || image.isEmpty())
+                        continue;
+
+                    Entry entry={Key(x,y,zoom),offset,quint32(image.size())};
+                    entries.append(entry);
+                    ok=(out.write(image)==image.size());
+                    offset+=image.size();
+                }
+                query.finish();
+            }
+            else
+            {
+                qDebug()<<"TilePack: can't open"<<mbtiles;
+            }
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+
+        if(!ok || entries.isEmpty())
+        {
+            out.cancelWriting();
+            return false;
+        }
+
+        std::sort(entries.begin(),entries.end());
+
+        quint64 indexOffset=out.pos();
+        QByteArray indexData(entries.count()*EntryLength,0);
+        uchar *p=(uchar *)indexData.data();
+        foreach(Entry entry,entries)
+        {
+            qToLittleEndian<quint64>(entry.key,p);
+            qToLittleEndian<quint64>(entry.offset,p+8);
+            qToLittleEndian<quint32>(entry.length,p+16);
+            p+=EntryLength;
+        }
+        out.write(indexData);
+
+        uchar counts[12];
+        qToLittleEndian<quint32>(entries.count(),counts);
+        qToLittleEndian<quint32>(0,counts+4);
+        qToLittleEndian<quint64>(indexOffset,counts+8);
+        out.seek(16);
+        out.write((const char *)counts,sizeof(counts));
+
+#ifdef DEBUG_TILEPACK
+        qDebug()<<"TilePack: imported"<<entries.count()<<"tiles from"<<mbtiles;
+#endif //DEBUG_TILEPACK
+        return out.commit();
+    }
+}
@@ -0,0 +1,77 @@
+/**
+******************************************************************************
+*
+* @file       tilepack.h
+* @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+* @brief      Read only, memory mapped packs of map tiles for offline use
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef TILEPACK_H
+#define TILEPACK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "maptype.h"
+#include "point.h"
+#include "corecommon.h"
+namespace core {
+    /**
+     * A pack of tiles of one map type in a single file, which is memory
+     * mapped so finding and reading a tile is a binary search and a copy.
+     *
+     * The file is a header, the tile images, then an index of one entry
+     * per tile sorted by its key, all little endian:
+     *
+     *   header: magic "DRTILEPK", version, map type, tile count, reserved
+     *           (4 bytes each), index offset (8 bytes)
+     *   entry:  key (8 bytes), offset of the image (8), its length (4),
+     *           reserved (4)
+     *
+     * Packs are made from MBTiles files with ImportMBTiles().
+     */
+    class TLMAPWIDGET_EXPORT TilePack
+    {
+    public:
+        TilePack();
+        ~TilePack();
+        bool Open(const QString &file);
+        void Close();
+        bool IsOpen()const{return index!=nullptr;}
+        MapType::Types Type()const{return type;}
+        int Count()const{return count;}
+        QByteArray GetImage(const core::Point &pos, const int &zoom)const;
+        static bool ImportMBTiles(const QString &mbtiles, const QString &pack, const MapType::Types &type);
+    private:
+        TilePack(TilePack const&);
+        TilePack& operator=(TilePack const&);
+
+        static quint64 Key(const qint64 &x, const qint64 &y, const int &zoom);
+
+        QFile file;
+        const uchar *data;
+        const uchar *index;
+        qint64 size;
+        int count;
+        MapType::Types type;
+    };
+
+}
+#endif // TILEPACK_H
@@ -304,7 +304,6 @@ namespace core {
      */
     QByteArray TLMaps::GetImageFromServer(const MapType::Types &type,const Point &pos,const int &zoom)
     {
-        QMutexLocker locker(&settingsProtect);
 #ifdef DEBUG_TIMINGS
         QTime time;
         time.restart();
@@ -314,6 +313,20 @@ namespace core {
 #endif //DEBUG_GMAPS
         QByteArray ret;
 
+        // Tile packs are mapped into memory already, so they come first and
+        // their tiles are not copied into the memory cache
+        if(accessmode != AccessMode::ServerOnly)
+        {
+            ret=Cache::Instance()->GetImageFromTilePacks(type,pos,zoom);
+            if(!ret.isEmpty())
+            {
+                errorvars.lock();
+                ++diag.tilesFromPack;
+                errorvars.unlock();
+                return ret;
+            }
+        }
+
         if(useMemoryCache)
         {
 #ifdef DEBUG_GMAPS
@@ -380,7 +393,12 @@ namespace core {
     #ifdef DEBUG_TIMINGS
                     qDebug()<<"opmaps before make image url"<<time.elapsed();
     #endif
-                    QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
+                    // Only the settings are locked, so the map's loaders can
+                    // all be waiting on the network at once
+                    settingsProtect.lock();
+                    QString language=LanguageStr;
+                    settingsProtect.unlock();
+                    QString url=MakeImageUrl(type,pos,zoom,language);
     #ifdef DEBUG_TIMINGS
                     qDebug()<<"opmaps after make image url"<<time.elapsed();
     #endif		//url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
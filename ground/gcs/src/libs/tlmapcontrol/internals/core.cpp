@@ -27,6 +27,8 @@
 */
 #include "core.h"
 
+#include <algorithm>
+
 #ifdef DEBUG_CORE
 qlonglong internals::Core::debugcounter=0;
 #endif
@@ -35,12 +37,12 @@ using namespace projections;
 
 namespace internals {
     Core::Core():started(false),MouseWheelZooming(false),currentPosition(0,0),currentPositionPixel(0,0),LastLocationInBounds(-1,-1),sizeOfMapArea(0,0)
-            ,minOfTiles(0,0),maxOfTiles(0,0),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),loaderLimit(5),maxzoom(21),runningThreads(0)
+            ,minOfTiles(0,0),maxOfTiles(0,0),loaderRuns(0),lastBoundsZoom(-1),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),maxzoom(21),runningThreads(0)
     {
         mousewheelzoomtype=MouseWheelZoomType::MousePositionAndCenter;
         SetProjection(new MercatorProjection());
         this->setAutoDelete(false);
-        ProcessLoadTaskCallback.setMaxThreadCount(10);
+        ProcessLoadTaskCallback.setMaxThreadCount(LoaderThreads);
         renderOffset=Point(0,0);
         dragPoint=Point(0,0);
         CanDragMap=true;
@@ -64,164 +66,231 @@ namespace internals {
         Mdebug.unlock();
         qDebug()<<"core:run"<<" ID="<<debug;
 #endif //DEBUG_CORE
-        bool last = false;
-
         LoadTask task;
+        bool prefetch;
+        bool last;
 
-        MtileLoadQueue.lock();
+        // Each loader keeps going until there is nothing left, so a few of
+        // them serve however many tiles are queued
+        while(NextLoadTask(task,prefetch,last))
         {
-            if(tileLoadQueue.count() > 0)
-            {
-                task = tileLoadQueue.dequeue();
-                {
-
-                    last = (tileLoadQueue.count() == 0);
 #ifdef DEBUG_CORE
-                    qDebug()<<"TileLoadQueue: " << tileLoadQueue.count()<<" Point:"<<task.Pos.ToString()<<" ID="<<debug;;
+            qDebug()<<"Core::run task"<<task.ToString()<<" prefetch="<<prefetch<<" ID="<<debug;
 #endif //DEBUG_CORE
-                }
-            }
+            if(prefetch)
+                PrefetchTile(task);
+            else
+                LoadTile(task,last);
+
+            MtileLoadQueue.lock();
+            tilesLoading.removeOne(task);
+            MtileLoadQueue.unlock();
         }
-        MtileLoadQueue.unlock();
 
-        if(task.HasValue())
-            if(loaderLimit.tryAcquire(1,TLMaps::Instance()->Timeout))
-            {
-            MtileToload.lock();
-            --tilesToload;
-            MtileToload.unlock();
-#ifdef DEBUG_CORE
-            qDebug()<<"loadLimit semaphore aquired "<<loaderLimit.available()<<" ID="<<debug<<" TASK="<<task.Pos.ToString()<<" "<<task.Zoom;
-#endif //DEBUG_CORE
+        MrunningThreads.lock();
+        --runningThreads;
+        MrunningThreads.unlock();
+    }
+    /**
+     * @brief Core::NextLoadTask Take the next tile to load, tiles in view
+     * first and prefetches after them
+     * @param last set if this empties the queue of tiles in view
+     * @return false if there is nothing left, and this loader should stop
+     */
+    bool Core::NextLoadTask(LoadTask &task, bool &prefetch, bool &last)
+    {
+        QMutexLocker locker(&MtileLoadQueue);
+
+        if(tileLoadQueue.count() > 0)
+        {
+            task = tileLoadQueue.dequeue();
+            prefetch = false;
+            last = (tileLoadQueue.count() == 0);
+        }
+        else if(tilePrefetchQueue.count() > 0)
+        {
+            task = tilePrefetchQueue.dequeue();
+            prefetch = true;
+            last = false;
+        }
+        else
+        {
+            --loaderRuns;
+            return false;
+        }
+
+        tilesLoading.append(task);
+        return true;
+    }
+    /**
+     * @brief Core::StartLoaders Put more loaders to work if there are tiles
+     * waiting for one.  Call with MtileLoadQueue held.
+     */
+    void Core::StartLoaders()
+    {
+        int waiting = tileLoadQueue.count() + tilePrefetchQueue.count();
 
+        while(loaderRuns < LoaderThreads && loaderRuns < waiting)
+        {
+            ++loaderRuns;
+            ProcessLoadTaskCallback.start(this);
+        }
+    }
+    /**
+     * @brief Core::IsTileWanted Whether a tile is still in view; the view
+     * may have moved or zoomed since it was queued
+     */
+    bool Core::IsTileWanted(const LoadTask &task)
+    {
+        QMutexLocker locker(&MtileDrawingList);
+
+        return task.Zoom == Zoom() && tileDrawingList.contains(task.Pos);
+    }
+    QByteArray Core::GetTileImage(const MapType::Types &type, const LoadTask &task)
+    {
+        QByteArray tileImage;
+        int retry = 0;
+
+        do
+        {
+            // tile number inversion(BottomLeft -> TopLeft) for pergo maps
+            if(type == MapType::PergoTurkeyMap)
+            {
+                tileImage = TLMaps::Instance()->GetImageFromServer(type, Point(task.Pos.X(), Projection()->GetTileMatrixMaxXY(task.Zoom).Height() - task.Pos.Y()), task.Zoom);
+            }
+            else if(type == MapType::UserImage)
+            {
+                tileImage = TLMaps::Instance()->GetImageFromFile(type, task.Pos, task.Zoom, userImageHorizontalScale, userImageVerticalScale, userImageLocation, Projection());
+            }
+            else // ok
             {
+                tileImage = TLMaps::Instance()->GetImageFromServer(type, task.Pos, task.Zoom);
+            }
 
+            if(tileImage.length()!=0)
+                break;
 #ifdef DEBUG_CORE
-                qDebug()<<"task as value, begining get"<<" ID="<<debug;;
+            qDebug()<<"GetTileImage: " << task.ToString()<< " -> empty tile, retry " << retry;
 #endif //DEBUG_CORE
-                {
-                    Tile* m = Matrix.TileAt(task.Pos);
+        }
+        while(++retry < TLMaps::Instance()->RetryLoadTile);
 
-                    if(m==nullptr || m->Overlays.count() == 0)
-                    {
-#ifdef DEBUG_CORE
-                        qDebug()<<"Fill empty TileMatrix: " + task.ToString()<<" ID="<<debug;;
-#endif //DEBUG_CORE
+        return tileImage;
+    }
+    /**
+     * @brief Core::AddOverlay Decode a layer of a tile.  It is decoded once
+     * here, in the format painting is fastest with, instead of on every repaint
+     */
+    void Core::AddOverlay(Tile *t, const QByteArray &tileImage)
+    {
+        if(tileImage.length()==0)
+            return;
 
-                        Tile* t = new Tile(task.Zoom, task.Pos);
-                        QVector<MapType::Types> layers= TLMaps::Instance()->GetAllLayersOfType(GetMapType());
-
-                        foreach(MapType::Types tl,layers)
-                        {
-                            int retry = 0;
-
-                            do
-                            {
-                                QByteArray tileImage;
-
-                                // tile number inversion(BottomLeft -> TopLeft) for pergo maps
-                                if(tl == MapType::PergoTurkeyMap)
-                                {
-                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
-                                }
-                                else if(tl == MapType::UserImage)
-                                {
-                                    tileImage = TLMaps::Instance()->GetImageFromFile(tl, task.Pos, task.Zoom, userImageHorizontalScale, userImageVerticalScale, userImageLocation, Projection());
-                                }
-                                else // ok
-                                {
-#ifdef DEBUG_CORE
-                                    qDebug()<<"start getting image"<<" ID="<<debug;
-#endif //DEBUG_CORE
-                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, task.Pos, task.Zoom);
-#ifdef DEBUG_CORE
-                                    qDebug()<<"Core::run:gotimage size:"<<tileImage.count()<<" ID="<<debug;
-#endif //DEBUG_CORE
-                                }
+        QImage image = QImage::fromData(tileImage);
 
-                                if(tileImage.length()!=0)
-                                {
-                                    Moverlays.lock();
-                                    {
-                                        t->Overlays.append(tileImage);
-#ifdef DEBUG_CORE
-                                        qDebug()<<"Core::run append tileImage:"<<tileImage.length()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
-#endif //DEBUG_CORE
+        if(!image.isNull())
+            t->Overlays.append(image.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    }
+    void Core::LoadTile(const LoadTask &task, bool last)
+    {
+        MtileToload.lock();
+        --tilesToload;
+        MtileToload.unlock();
 
-                                    }
-                                    Moverlays.unlock();
+        Tile* m = Matrix.TileAt(task.Pos);
 
-                                    break;
-                                }
-                                else if(TLMaps::Instance()->RetryLoadTile > 0)
-                                {
+        // Skip tiles that scrolled out of view while they waited
+        if((m==nullptr || m->Overlays.count() == 0) && IsTileWanted(task))
+        {
 #ifdef DEBUG_CORE
-                                    qDebug()<<"ProcessLoadTask: " << task.ToString()<< " -> empty tile, retry " << retry<<" ID="<<debug;;
+            qDebug()<<"Fill empty TileMatrix: " + task.ToString();
 #endif //DEBUG_CORE
-                                }
-                            }
-                            while(++retry < TLMaps::Instance()->RetryLoadTile);
-                        }
+            Tile* t = new Tile(task.Zoom, task.Pos);
+            QVector<MapType::Types> layers= TLMaps::Instance()->GetAllLayersOfType(GetMapType());
 
-                        if(t->Overlays.count() > 0)
-                        {
-                            Matrix.SetTileAt(task.Pos,t);
-                            emit OnNeedInvalidation();
+            foreach(MapType::Types tl,layers)
+            {
+                QByteArray tileImage = GetTileImage(tl, task);
 
+                AddOverlay(t, tileImage);
+            }
+
+            if(t->Overlays.count() > 0 && IsTileWanted(task))
+            {
+                Matrix.SetTileAt(task.Pos,t);
 #ifdef DEBUG_CORE
-                            qDebug()<<"Core::run add tile "<<t->GetPos().ToString()<<" to matrix index "<<task.Pos.ToString()<<" ID="<<debug;
-                            qDebug()<<"Core::run matrix index "<<task.Pos.ToString()<<" as tile with "<<Matrix.TileAt(task.Pos)->Overlays.count()<<" ID="<<debug;
+                qDebug()<<"Core::run add tile "<<t->GetPos().ToString()<<" to matrix index "<<task.Pos.ToString();
 #endif //DEBUG_CORE
-                        }
-                        else
-                        {
-                            // emit OnTilesStillToLoad(tilesToload);
-
-                            delete t;
-                            t = nullptr;
-                            emit OnNeedInvalidation();
-                        }
+            }
+            else
+            {
+                delete t;
+                t = nullptr;
+            }
 
-                        // layers = null;
-                    }
-                }
+            emit OnNeedInvalidation();
+        }
 
+        // last buddy cleans stuff ;}
+        if(last)
+        {
+            TLMaps::Instance()->kiberCacheLock.lockForWrite();
+            TLMaps::Instance()->TilesInMemory.RemoveMemoryOverload();
+            TLMaps::Instance()->kiberCacheLock.unlock();
 
-                {
-                    // last buddy cleans stuff ;}
-                    if(last)
-                    {
-                        TLMaps::Instance()->kiberCacheLock.lockForWrite();
-                        TLMaps::Instance()->TilesInMemory.RemoveMemoryOverload();
-                        TLMaps::Instance()->kiberCacheLock.unlock();
+            MtileDrawingList.lock();
+            {
+                Matrix.ClearPointsNotIn(tileDrawingList);
+            }
+            MtileDrawingList.unlock();
 
-                        MtileDrawingList.lock();
-                        {
-                            Matrix.ClearPointsNotIn(tileDrawingList);
-                        }
-                        MtileDrawingList.unlock();
+            emit OnTileLoadComplete();
 
+            emit OnNeedInvalidation();
+        }
 
-                        emit OnTileLoadComplete();
+        emit OnTilesStillToLoad(tilesToload<0? 0:tilesToload);
+    }
+    /**
+     * @brief Core::PrefetchTile Fetch a tile the view is likely to need next
+     * into the caches.  It is decoded when a loader fetches it into view,
+     * or here if the view moved onto it while it was being prefetched.
+     */
+    void Core::PrefetchTile(const LoadTask &task)
+    {
+        QVector<MapType::Types> layers= TLMaps::Instance()->GetAllLayersOfType(GetMapType());
+        QList<QByteArray> tileImages;
 
+        foreach(MapType::Types tl,layers)
+        {
+            tileImages.append(GetTileImage(tl, task));
+        }
 
-                        emit OnNeedInvalidation();
+        // UpdateBounds doesn't queue tiles that are still being prefetched,
+        // so if the view moved onto this one meanwhile, put it in place now
+        if(!IsTileWanted(task))
+            return;
 
-                    }
-                }
+        Tile* m = Matrix.TileAt(task.Pos);
+        if(m!=nullptr && m->Overlays.count() > 0)
+            return;
 
+        Tile* t = new Tile(task.Zoom, task.Pos);
 
+        foreach(QByteArray const& tileImage,tileImages)
+        {
+            AddOverlay(t, tileImage);
+        }
 
-            }
-#ifdef DEBUG_CORE
-            qDebug()<<"loaderLimit release:"+loaderLimit.available()<<" ID="<<debug;
-#endif
-            emit OnTilesStillToLoad(tilesToload<0? 0:tilesToload);
-            loaderLimit.release();
+        if(t->Overlays.count() > 0 && IsTileWanted(task))
+        {
+            Matrix.SetTileAt(task.Pos,t);
+            emit OnNeedInvalidation();
+        }
+        else
+        {
+            delete t;
         }
-        MrunningThreads.lock();
-        --runningThreads;
-        MrunningThreads.unlock();
     }
     diagnostics Core::GetDiagnostics()
     {
@@ -245,6 +314,7 @@ namespace internals {
             {
                 MtileLoadQueue.lock();
                 tileLoadQueue.clear();
+                tilePrefetchQueue.clear();
                 MtileLoadQueue.unlock();
                 MtileToload.lock();
                 tilesToload=0;
@@ -533,6 +603,7 @@ namespace internals {
             MtileLoadQueue.lock();
             {
                 tileLoadQueue.clear();
+                tilePrefetchQueue.clear();
             }
             MtileLoadQueue.unlock();
             MtileToload.lock();
@@ -637,17 +708,17 @@ namespace internals {
     {
         if(started)
         {
-            ProcessLoadTaskCallback.waitForDone();
+            // Empty the queues first, so only the tiles in flight are waited for
             MtileLoadQueue.lock();
             {
                 tileLoadQueue.clear();
-                //tilesToload=0;
+                tilePrefetchQueue.clear();
             }
             MtileLoadQueue.unlock();
             MtileToload.lock();
             tilesToload=0;
             MtileToload.unlock();
-            //  ProcessLoadTaskCallback.waitForDone();
+            ProcessLoadTaskCallback.waitForDone();
         }
     }
     void Core::UpdateBounds()
@@ -662,29 +733,50 @@ namespace internals {
 
             emit OnTileLoadStart();
 
+            QList<LoadTask> prefetch;
+            FindTilesToPrefetch(tileDrawingList, prefetch);
 
-            foreach(Point p,tileDrawingList)
+            MtileLoadQueue.lock();
             {
-                LoadTask task = LoadTask(p, Zoom());
+                // Forget tiles that went out of view before a loader got to them
+                QQueue<LoadTask> queued;
+                queued.swap(tileLoadQueue);
+                foreach(LoadTask task,queued)
+                {
+                    if(task.Zoom == Zoom() && tileDrawingList.contains(task.Pos))
+                        tileLoadQueue.enqueue(task);
+                }
+
+                foreach(Point p,tileDrawingList)
                 {
-                    MtileLoadQueue.lock();
+                    LoadTask task = LoadTask(p, Zoom());
+                    Tile* t = Matrix.TileAt(p);
+
+                    // Tiles being prefetched are put in place by PrefetchTile
+                    if((t==nullptr || t->Overlays.count() == 0) && !tileLoadQueue.contains(task) && !tilesLoading.contains(task))
                     {
-                        if(!tileLoadQueue.contains(task))
-                        {
-                            MtileToload.lock();
-                            ++tilesToload;
-                            MtileToload.unlock();
-                            tileLoadQueue.enqueue(task);
+                        tileLoadQueue.enqueue(task);
 #ifdef DEBUG_CORE
-                            qDebug()<<"Core::UpdateBounds new Task"<<task.Pos.ToString();
+                        qDebug()<<"Core::UpdateBounds new Task"<<task.Pos.ToString();
 #endif //DEBUG_CORE
-                            ProcessLoadTaskCallback.start(this);
-                        }
                     }
-                    MtileLoadQueue.unlock();
                 }
 
+                // Prefetches are only worth it from where the view is now
+                tilePrefetchQueue.clear();
+                foreach(LoadTask task,prefetch)
+                {
+                    if(!tilesLoading.contains(task))
+                        tilePrefetchQueue.enqueue(task);
+                }
+
+                MtileToload.lock();
+                tilesToload=tileLoadQueue.count();
+                MtileToload.unlock();
+
+                StartLoaders();
             }
+            MtileLoadQueue.unlock();
         }
         MtileDrawingList.unlock();
         UpdateGroundResolution();
@@ -720,7 +812,77 @@ namespace internals {
             }
         }
 
+        // Load from the middle of the view outwards
+        Point center = centerTileXYLocation;
+        std::sort(list.begin(), list.end(), [center](Point const& a, Point const& b) {
+            return qMax(qAbs(a.X() - center.X()), qAbs(a.Y() - center.Y())) <
+                    qMax(qAbs(b.X() - center.X()), qAbs(b.Y() - center.Y()));
+        });
+    }
+    /**
+     * @brief Core::FindTilesToPrefetch Find the tiles the view is likely to
+     * need next: those just past the edge it has been moving towards, as it
+     * does when following the UAV, and the next zoom level under its middle.
+     * @param visible the tiles in view
+     */
+    void Core::FindTilesToPrefetch(QList<Point> const& visible, QList<LoadTask> &list)
+    {
+        list.clear();
+
+        if(GetMapType() == MapType::UserImage)
+            return;
+
+        if(Zoom() != lastBoundsZoom)
+        {
+            travelDirection = Point::Empty;
+        }
+        else if(centerTileXYLocation != lastBoundsCenter)
+        {
+            travelDirection = Point(qBound(qint64(-1), centerTileXYLocation.X() - lastBoundsCenter.X(), qint64(1)),
+                                    qBound(qint64(-1), centerTileXYLocation.Y() - lastBoundsCenter.Y(), qint64(1)));
+        }
+        lastBoundsCenter = centerTileXYLocation;
+        lastBoundsZoom = Zoom();
 
+        if(travelDirection != Point::Empty)
+        {
+            for(int k = 1; k <= PrefetchDepth; k++)
+            {
+                foreach(Point v,visible)
+                {
+                    Point p(v.X() + k*travelDirection.X(), v.Y() + k*travelDirection.Y());
+
+                    if(p.X() >= minOfTiles.Width() && p.Y() >= minOfTiles.Height() && p.X() <= maxOfTiles.Width() && p.Y() <= maxOfTiles.Height()
+                            && !visible.contains(p))
+                    {
+                        LoadTask task = LoadTask(p, Zoom());
+
+                        if(!list.contains(task))
+                            list.append(task);
+                    }
+                }
+            }
+        }
+
+        if(Zoom() < MaxZoom())
+        {
+            Size minZoomIn = Projection()->GetTileMatrixMinXY(Zoom() + 1);
+            Size maxZoomIn = Projection()->GetTileMatrixMaxXY(Zoom() + 1);
+
+            for(int i = -1; i <= 1; i++)
+            {
+                for(int j = -1; j <= 1; j++)
+                {
+                    for(int n = 0; n < 4; n++)
+                    {
+                        Point p((centerTileXYLocation.X() + i)*2 + (n & 1), (centerTileXYLocation.Y() + j)*2 + (n >> 1));
+
+                        if(p.X() >= minZoomIn.Width() && p.Y() >= minZoomIn.Height() && p.X() <= maxZoomIn.Width() && p.Y() <= maxZoomIn.Height())
+                            list.append(LoadTask(p, Zoom() + 1));
+                    }
+                }
+            }
+        }
     }
     void Core::UpdateGroundResolution()
     {
@@ -189,6 +189,8 @@ namespace internals {
 
         void FindTilesAround(QList<core::Point> &list);
 
+        void FindTilesToPrefetch(QList<core::Point> const& visible, QList<LoadTask> &list);
+
         void UpdateGroundResolution();
 
         TileMatrix Matrix;
@@ -212,6 +214,17 @@ namespace internals {
         void OnNeedInvalidation();
 
     private:
+        static const int LoaderThreads=5; // Tiles fetched and decoded at once
+        static const int PrefetchDepth=2; // Tiles ahead of the view to prefetch
+
+        bool NextLoadTask(LoadTask &task, bool &prefetch, bool &last);
+        void StartLoaders();
+        bool IsTileWanted(LoadTask const& task);
+        QByteArray GetTileImage(MapType::Types const& type, LoadTask const& task);
+        void AddOverlay(Tile *t, QByteArray const& tileImage);
+        void LoadTile(LoadTask const& task, bool last);
+        void PrefetchTile(LoadTask const& task);
+
         bool started;
         bool MouseWheelZooming;
         void keepInBounds();
@@ -243,6 +256,13 @@ namespace internals {
         Rectangle CurrentRegion;
 
         QQueue<LoadTask> tileLoadQueue;
+        QQueue<LoadTask> tilePrefetchQueue;
+        QList<LoadTask> tilesLoading;
+        int loaderRuns;
+
+        core::Point lastBoundsCenter;
+        int lastBoundsZoom;
+        core::Point travelDirection;
 
         int zoom;
 
@@ -252,8 +272,6 @@ namespace internals {
 
         QMutex MtileLoadQueue;
 
-        QMutex Moverlays;
-
         QMutex MtileDrawingList;
 #ifdef DEBUG_CORE
         QMutex Mdebug;
@@ -263,8 +281,6 @@ namespace internals {
 
         MapType::Types mapType;
 
-        QSemaphore loaderLimit;
-
         QThreadPool ProcessLoadTaskCallback;
         QMutex MtileToload;
         int tilesToload;
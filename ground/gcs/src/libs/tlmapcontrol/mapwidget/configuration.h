@@ -181,6 +181,16 @@ public:
     * @return
     */
     QString CacheLocation(){return core::Cache::Instance()->CacheLocation();}
+    /**
+    * @brief Makes a tile pack in the cache location from an MBTiles file, which
+    * is then used before any other cache.  Tiles are read straight out of the
+    * pack, so large areas can be seeded for flying without a network.
+    *
+    * @param mbtiles the MBTiles file
+    * @param type the map type its tiles are shown as
+    * @return true if the pack was made
+    */
+    bool ImportTilePack(QString const& mbtiles, core::MapType::Types const& type){return core::Cache::Instance()->ImportTilePack(mbtiles,type);}
 
 
 };
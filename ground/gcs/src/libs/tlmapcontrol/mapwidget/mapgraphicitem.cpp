@@ -377,14 +377,14 @@ namespace mapcontrol
                             //lock(t.Overlays)
                             if(t!=nullptr)
                             {
-                                foreach(QByteArray img,t->Overlays)
+                                foreach(QImage img,t->Overlays)
                                 {
-                                    if(img.count()!=0)
+                                    if(!img.isNull())
                                     {
                                         if(!found)
                                             found = true;
                                         {
-                                            painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),PureImageProxy::FromStream(img));
+                                            painter->drawImage(QRect(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height()),img);
                                         }
                                     }
                                 }
@@ -30,13 +30,41 @@
 #include <QTextStream>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <algorithm>
 
 #include <coreplugin/icore.h>
 #include <coreplugin/coreconstants.h>
 
+//! Each record is a quint32 timestamp and a qint64 size, then the payload
+static const qint64 RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(qint64);
+
+//! Identifies a replay index file, and its layout version
+static const quint32 INDEX_MAGIC = 0x58444c44; // "DLDX"
+static const quint32 INDEX_VERSION = 1;
+
+struct IndexFileHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint64 logSize;
+    qint64 logModified;
+    qint64 bodyStart;
+    qint64 count;
+};
+
 LogFile::LogFile(QObject *parent)
     : QIODevice(parent)
-    , timestampBufferIdx(0)
+    , mapBase(nullptr)
+    , mapSize(0)
+    , readIdx(0)
+    , playIdx(0)
+    , readOffset(0)
+    , pendingBytes(0)
+    , firstTimestamp(0)
 {
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -163,6 +191,18 @@ void LogFile::close()
 
     if (timer.isActive())
         timer.stop();
+
+    mutex.lock();
+    if (mapBase) {
+        file.unmap(const_cast<uchar *>(mapBase));
+        mapBase = nullptr;
+        mapSize = 0;
+    }
+    index.clear();
+    readIdx = playIdx = 0;
+    readOffset = pendingBytes = 0;
+    mutex.unlock();
+
     file.close();
     QIODevice::close();
 }
@@ -187,130 +227,231 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
 qint64 LogFile::readData(char *data, qint64 maxSize)
 {
     QMutexLocker locker(&mutex);
-    qint64 toRead = qMin(maxSize, (qint64)dataBuffer.size());
-    memcpy(data, dataBuffer.data(), toRead);
-    dataBuffer.remove(0, toRead);
-    return toRead;
+    qint64 copied = 0;
+
+    // Copy directly out of the mapping; released records are contiguous
+    // in the index, so there is nothing to shift afterwards.
+    while (copied < maxSize && readIdx < playIdx) {
+        const IndexEntry &rec = index[readIdx];
+        qint64 toCopy = qMin(maxSize - copied, rec.size - readOffset);
+
+        memcpy(data + copied, mapBase + rec.offset + RECORD_HEADER_SIZE + readOffset, toCopy);
+        copied += toCopy;
+        readOffset += toCopy;
+
+        if (readOffset >= rec.size) {
+            readIdx++;
+            readOffset = 0;
+        }
+    }
+
+    pendingBytes -= copied;
+    return copied;
 }
 
 qint64 LogFile::bytesAvailable() const
 {
-    return dataBuffer.size();
+    return pendingBytes;
 }
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
-
-    if (file.bytesAvailable() > 4) {
-
-        int time;
-        time = myTime.elapsed();
-
-        // Read packets
-        while ((lastPlayTime + ((time - lastPlayTimeOffset) * playbackSpeed)
-                > (lastTimeStamp - firstTimestamp))) {
-            lastPlayTime += ((time - lastPlayTimeOffset) * playbackSpeed);
-            if (file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+    int time = myTime.elapsed();
+
+    lastPlayTime += (time - lastPlayTimeOffset) * playbackSpeed;
+    lastPlayTimeOffset = time;
+
+    // Release every record that is due by now
+    const IndexEntry key = { 0, firstTimestamp + lastPlayTime, 0 };
+    int due = std::upper_bound(index.constBegin() + playIdx, index.constEnd(), key,
+                               [](const IndexEntry &a, const IndexEntry &b) {
+                                   return a.timestamp < b.timestamp;
+                               })
+        - index.constBegin();
+
+    if (due > playIdx) {
+        qint64 released = 0;
+        for (int i = playIdx; i < due; i++)
+            released += index[i].size;
+
+        mutex.lock();
+        playIdx = due;
+        pendingBytes += released;
+        mutex.unlock();
+
+        emit readyRead();
+    }
 
-            file.seek(lastTimeStampPos + sizeof(lastTimeStamp));
+    if (playIdx >= index.size())
+        stopReplay();
+}
 
-            file.read(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+/**
+ * Try to use a previously saved index for this log.  It is only used if
+ * it was built from a file of the same size and modification time.
+ * \param bodyStart offset of the first record in the log
+ * \return true if the index was loaded
+ */
+bool LogFile::loadIndex(qint64 bodyStart)
+{
+    QFile idxFile(indexFileName());
+    if (!idxFile.open(QIODevice::ReadOnly))
+        return false;
 
-            if (dataSize < 1 || dataSize > (1024 * 1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if (file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
+    QFileInfo info(file);
+    IndexFileHeader hdr;
 
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
+    if (idxFile.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) != sizeof(hdr))
+        return false;
 
-            if (file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+    if (hdr.magic != INDEX_MAGIC || hdr.version != INDEX_VERSION || hdr.logSize != info.size()
+        || hdr.logModified != info.lastModified().toMSecsSinceEpoch()
+        || hdr.bodyStart != bodyStart || hdr.count <= 0
+        || idxFile.size() != (qint64)(sizeof(hdr) + hdr.count * sizeof(IndexEntry)))
+        return false;
 
-            lastTimeStampPos = timestampPos[timestampBufferIdx];
-            lastTimeStamp = timestampBuffer[timestampBufferIdx];
-            timestampBufferIdx++;
+    index.resize(hdr.count);
+    qint64 bytes = hdr.count * sizeof(IndexEntry);
+    if (idxFile.read(reinterpret_cast<char *>(index.data()), bytes) != bytes) {
+        index.clear();
+        return false;
+    }
 
-            lastPlayTimeOffset = time;
-            time = myTime.elapsed();
-        }
-    } else {
-        stopReplay();
+    // Don't trust entries that point outside the log
+    const IndexEntry &last = index.last();
+    if (last.offset + RECORD_HEADER_SIZE + last.size > mapSize) {
+        index.clear();
+        return false;
     }
+
+    return true;
 }
 
-bool LogFile::startReplay()
+/**
+ * Scan the mapped log and record where each record starts.
+ * \param bodyStart offset of the first record in the log
+ * \return true if at least one record was found
+ */
+bool LogFile::buildIndex(qint64 bodyStart)
 {
-    dataBuffer.clear();
-    myTime.restart();
-    lastPlayTimeOffset = 0;
-    lastPlayTime = 0;
-    playbackSpeed = 1;
+    bool warnedSequence = false;
+    qint64 pos = bodyStart;
 
-    // Read all log timestamps into array
-    timestampBuffer.clear(); // Save beginning of log for later use
-    timestampPos.clear();
-    quint64 logFileStartIdx = file.pos();
-    timestampBufferIdx = 0;
-    lastTimeStamp = 0;
+    index.clear();
 
-    while (!file.atEnd()) {
+    while (pos + RECORD_HEADER_SIZE <= mapSize) {
+        quint32 timeStamp;
         qint64 dataSize;
 
-        // Get time stamp position
-        timestampPos.append(file.pos());
-
-        // Read timestamp and logfile packet size
-        file.read(reinterpret_cast<char *>(&lastTimeStamp), sizeof(lastTimeStamp));
-        file.read(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+        memcpy(&timeStamp, mapBase + pos, sizeof(timeStamp));
+        memcpy(&dataSize, mapBase + pos + sizeof(timeStamp), sizeof(dataSize));
 
         // Check if dataSize sync bytes are correct.
         // TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN
         // THE STRING OF SIX 0x00
-        if ((dataSize & 0xFFFFFFFFFFFF0000) != 0) {
-            qDebug() << "Wrong sync byte. At file location 0x"
-                     << QString("%1").arg(file.pos(), 0, 16) << "Got 0x"
-                     << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000, 0, 16)
+        if ((dataSize & 0xFFFFFFFFFFFF0000) != 0 || dataSize < 1) {
+            qDebug() << "Wrong sync byte. At file location 0x" << QString("%1").arg(pos, 0, 16)
+                     << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000, 0, 16)
                      << ", but expected 0x"
                         "00"
                         ".";
-            file.seek(timestampPos.last() + 1);
-            timestampPos.pop_back();
+            pos++;
             continue;
         }
 
-        // Check if timestamps are sequential.
-        if (!timestampBuffer.isEmpty() && lastTimeStamp < timestampBuffer.last()) {
-            QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
-            msgBox.setText("Corrupted file.");
-            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected "
-                                      "behavior"); //<--TODO: add hyperlink to webpage with better
-                                                   // description.
-            msgBox.exec();
+        if (pos + RECORD_HEADER_SIZE + dataSize > mapSize)
+            break;
+
+        // Check if timestamps are sequential.  Seeking relies on the index
+        // being sorted, so out of order records play with their predecessor.
+        if (!index.isEmpty() && timeStamp < index.last().timestamp) {
+            if (!warnedSequence) {
+                QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
+                msgBox.setText("Corrupted file.");
+                msgBox.setInformativeText("Timestamps are not sequential. Playback may have "
+                                          "unexpected behavior"); //<--TODO: add hyperlink to
+                                                                  // webpage with better
+                                                                  // description.
+                msgBox.exec();
+                warnedSequence = true;
+            }
 
-            qDebug() << "Timestamp: " << timestampBuffer.last() << " " << lastTimeStamp;
+            qDebug() << "Timestamp: " << index.last().timestamp << " " << timeStamp;
+            timeStamp = index.last().timestamp;
         }
 
-        timestampBuffer.append(lastTimeStamp);
+        index.append({ pos, timeStamp, (quint32)dataSize });
+
+        pos += RECORD_HEADER_SIZE + dataSize;
+    }
+
+    index.squeeze();
+
+    return !index.isEmpty();
+}
 
-        file.seek(timestampPos.last() + sizeof(lastTimeStamp) + sizeof(dataSize) + dataSize);
+/**
+ * Save the index next to the log so the next replay can skip the scan.
+ * Failure is harmless; the index is rebuilt next time.
+ * \param bodyStart offset of the first record in the log
+ */
+void LogFile::saveIndex(qint64 bodyStart)
+{
+    QFile idxFile(indexFileName());
+    if (!idxFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+
+    QFileInfo info(file);
+    IndexFileHeader hdr = { INDEX_MAGIC,
+                            INDEX_VERSION,
+                            info.size(),
+                            info.lastModified().toMSecsSinceEpoch(),
+                            bodyStart,
+                            index.size() };
+
+    qint64 bytes = index.size() * sizeof(IndexEntry);
+    if (idxFile.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr)) != sizeof(hdr)
+        || idxFile.write(reinterpret_cast<const char *>(index.constData()), bytes) != bytes) {
+        idxFile.remove();
     }
+}
 
-    // Check if any timestamps were successfully read
-    if (timestampBuffer.size() == 0) {
+bool LogFile::startReplay()
+{
+    myTime.restart();
+    lastPlayTimeOffset = 0;
+    lastPlayTime = 0;
+    playbackSpeed = 1;
+    readIdx = playIdx = 0;
+    readOffset = pendingBytes = 0;
+
+    // The header has already been consumed by open()
+    qint64 bodyStart = file.pos();
+
+    mapSize = file.size();
+    mapBase = file.map(0, mapSize);
+    if (!mapBase) {
+        QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
+        msgBox.setText("Unable to open logfile.");
+        msgBox.setInformativeText(file.errorString());
+        msgBox.exec();
+
+        mapSize = 0;
+        stopReplay();
+        return false;
+    }
+
+    QElapsedTimer indexTime;
+    indexTime.start();
+
+    if (loadIndex(bodyStart)) {
+        qDebug() << "Loaded replay index of" << index.size() << "records in"
+                 << indexTime.elapsed() << "ms";
+    } else if (buildIndex(bodyStart)) {
+        qDebug() << "Indexed" << index.size() << "records in" << indexTime.elapsed() << "ms";
+        saveIndex(bodyStart);
+    } else {
+        // Check if any timestamps were successfully read
         QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
         msgBox.setText("Empty logfile.");
         msgBox.setInformativeText("No log data can be found.");
@@ -320,12 +461,7 @@ bool LogFile::startReplay()
         return false;
     }
 
-    // Reset to log beginning.
-    file.seek(logFileStartIdx + sizeof(lastTimeStamp));
-    lastTimeStampPos = timestampPos[0];
-    lastTimeStamp = timestampBuffer[0];
-    firstTimestamp = timestampBuffer[0];
-    timestampBufferIdx = 1;
+    firstTimestamp = index.first().timestamp;
 
     timer.setInterval(10);
     timer.start();
@@ -353,20 +489,30 @@ void LogFile::resumeReplay()
 
 /**
  * @brief LogFile::setReplayTime, sets the playback time
- * @param val, the time in
+ * @param val, the time in seconds from the start of the log
  */
 void LogFile::setReplayTime(double val)
 {
-    quint32 tmpIdx = 0;
-    while (timestampBuffer[tmpIdx++] <= val * 1000 && tmpIdx <= timestampBufferIdx) {
-    }
-
-    lastTimeStampPos = timestampPos[tmpIdx];
-    lastTimeStamp = timestampBuffer[tmpIdx];
-    timestampBufferIdx = tmpIdx;
+    if (index.isEmpty())
+        return;
+
+    const IndexEntry key = { 0, firstTimestamp + (quint32)qMax(0.0, val * 1000), 0 };
+    int idx = std::lower_bound(index.constBegin(), index.constEnd(), key,
+                               [](const IndexEntry &a, const IndexEntry &b) {
+                                   return a.timestamp < b.timestamp;
+                               })
+        - index.constBegin();
+    idx = qMin(idx, index.size() - 1);
+
+    // Drop anything released but not yet read; it belongs to the old time
+    mutex.lock();
+    readIdx = playIdx = idx;
+    readOffset = 0;
+    pendingBytes = 0;
+    mutex.unlock();
 
     lastPlayTimeOffset = myTime.elapsed();
-    lastPlayTime = lastTimeStamp;
+    lastPlayTime = index[idx].timestamp - firstTimestamp;
 
-    qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << val * 1000;
+    qDebug() << "Replaying at: " << index[idx].timestamp << ", but requestion at" << val * 1000;
 }
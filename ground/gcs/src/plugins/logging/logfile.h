@@ -33,6 +33,7 @@
 #include <QMutexLocker>
 #include <QDebug>
 #include <QBuffer>
+#include <QVector>
 #include "uavobjects/uavobjectmanager.h"
 #include <math.h>
 
@@ -71,11 +72,9 @@ signals:
     void replayFinished();
 
 protected:
-    QByteArray dataBuffer;
     QTimer timer;
     QTime myTime;
     QFile file;
-    quint32 lastTimeStamp;
     quint32 lastPlayTime;
     QMutex mutex;
 
@@ -83,10 +82,29 @@ protected:
     double playbackSpeed;
 
 private:
-    QList<quint32> timestampBuffer;
-    QList<quint32> timestampPos;
-    quint32 timestampBufferIdx;
-    quint32 lastTimeStampPos;
+    //! One log record: timestamp, payload size and where the record starts
+    struct IndexEntry
+    {
+        qint64 offset;
+        quint32 timestamp;
+        quint32 size;
+    };
+
+    bool loadIndex(qint64 bodyStart);
+    bool buildIndex(qint64 bodyStart);
+    void saveIndex(qint64 bodyStart);
+    QString indexFileName() const { return file.fileName() + ".idx"; }
+
+    // Replay reads straight out of the mapped file; records
+    // [readIdx, playIdx) have been released for playback but not yet
+    // consumed by readData(), starting readOffset bytes into readIdx.
+    const uchar *mapBase;
+    qint64 mapSize;
+    QVector<IndexEntry> index;
+    int readIdx;
+    int playIdx;
+    qint64 readOffset;
+    qint64 pendingBytes;
     quint32 firstTimestamp;
 };
 
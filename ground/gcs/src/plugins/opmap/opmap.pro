@@ -35,6 +35,11 @@ SOURCES += opmapplugin.cpp \
     modelmapproxy.cpp \
     homeeditor.cpp
 
+contains(DEFINES, WITH_TESTS) {
+    QT += sql network
+    SOURCES += opmaptests.cpp
+}
+
 OTHER_FILES += OPMapGadget.pluginspec
 
 FORMS += opmapgadgetoptionspage.ui \
@@ -39,6 +39,7 @@
 #include <QVBoxLayout>
 #include <QClipboard>
 #include <QMenu>
+#include <QFileDialog>
 #include <QStringList>
 #include <QDir>
 #include <QFile>
@@ -389,6 +390,7 @@ void OPMapGadgetWidget::contextMenuEvent(QContextMenuEvent *event)
     contextMenu.addAction(reloadAct);
     contextMenu.addSeparator();
     contextMenu.addAction(ripAct);
+    contextMenu.addAction(importTilePackAct);
     contextMenu.addSeparator();
 
     QMenu maxUpdateRateSubMenu(
@@ -1282,6 +1284,11 @@ void OPMapGadgetWidget::createActions()
     ripAct = new QAction(tr("&Rip map"), this);
     ripAct->setStatusTip(tr("Rip the map tiles"));
     connect(ripAct, &QAction::triggered, this, &OPMapGadgetWidget::onRipAct_triggered);
+    importTilePackAct = new QAction(tr("&Import offline tiles..."), this);
+    importTilePackAct->setStatusTip(
+        tr("Import an MBTiles file as offline tiles for the current map type"));
+    connect(importTilePackAct, &QAction::triggered, this,
+            &OPMapGadgetWidget::onImportTilePackAct_triggered);
 
     copyMouseLatLonToClipAct = new QAction(tr("Mouse latitude and longitude"), this);
     copyMouseLatLonToClipAct->setStatusTip(
@@ -1602,6 +1609,29 @@ void OPMapGadgetWidget::onRipAct_triggered()
     m_map->RipMap();
 }
 
+void OPMapGadgetWidget::onImportTilePackAct_triggered()
+{
+    if (!m_widget || !m_map)
+        return;
+
+    QString file = QFileDialog::getOpenFileName(this, tr("Import Offline Tiles"), QString(),
+                                                tr("MBTiles (*.mbtiles);;All files (*)"));
+    if (file.isEmpty())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = m_map->configuration->ImportTilePack(file, m_map->GetMapType());
+    QApplication::restoreOverrideCursor();
+
+    if (!ok) {
+        QMessageBox::warning(this, tr("Import Offline Tiles"),
+                             tr("Could not import tiles from %1.").arg(file));
+        return;
+    }
+
+    m_map->ReloadMap();
+}
+
 void OPMapGadgetWidget::onCopyMouseLatLonToClipAct_triggered()
 {
     QClipboard *clipboard = QApplication::clipboard();
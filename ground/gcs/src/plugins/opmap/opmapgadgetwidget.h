@@ -175,6 +175,7 @@ private slots:
     */
     void onReloadAct_triggered();
     void onRipAct_triggered();
+    void onImportTilePackAct_triggered();
     void onCopyMouseLatLonToClipAct_triggered();
     void onCopyMouseLatToClipAct_triggered();
     void onCopyMouseLonToClipAct_triggered();
@@ -249,6 +250,7 @@ private:
     QAction *closeAct2;
     QAction *reloadAct;
     QAction *ripAct;
+    QAction *importTilePackAct;
     QAction *copyMouseLatLonToClipAct;
     QAction *copyMouseLatToClipAct;
     QAction *copyMouseLonToClipAct;
@@ -44,6 +44,13 @@ public:
     bool initialize(const QStringList &arguments, QString *errorString);
     void shutdown();
 
+#ifdef WITH_TESTS
+private Q_SLOTS:
+    void benchmarkTileCache();
+    void benchmarkTilePack();
+    void followUavTiles();
+#endif
+
 private:
     OPMapGadgetFactory *mf;
 };
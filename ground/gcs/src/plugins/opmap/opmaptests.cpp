@@ -0,0 +1,367 @@
+/**
+ ******************************************************************************
+ * @file       opmaptests.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup OPMapPlugin Tau Labs Map Plugin
+ * @{
+ * @brief Tau Labs map plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "opmapplugin.h"
+
+#include "tlmapcontrol/core/pureimagecache.h"
+#include "tlmapcontrol/core/tilepack.h"
+#include "tlmapcontrol/internals/core.h"
+
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QNetworkProxy>
+#include <QPainter>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+#include <QTimer>
+#include <QtMath>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+#include <functional>
+
+static const int tileColumns = 50;
+static const int tileRows = 40;
+static const int tileZoom = 18;
+static const core::MapType::Types tileType = core::MapType::GoogleSatellite;
+
+/* Stand-in for a tile image, different for every position */
+static QByteArray tileImage(int x, int y)
+{
+    QByteArray image(15000, char(x));
+    image[0] = char(y);
+    return image;
+}
+
+typedef std::function<QByteArray(const core::Point &)> TileGetter;
+
+/* Reads every tile back, as one of the map's loader threads would */
+class TileReader : public QThread
+{
+public:
+    TileReader(TileGetter getTile, QAtomicInt *mismatches)
+        : getTile(getTile)
+        , mismatches(mismatches)
+    {
+    }
+
+protected:
+    void run()
+    {
+        for (int x = 0; x < tileColumns; x++) {
+            for (int y = 0; y < tileRows; y++) {
+                if (getTile(core::Point(x, y)) != tileImage(x, y))
+                    mismatches->ref();
+            }
+        }
+    }
+
+private:
+    TileGetter getTile;
+    QAtomicInt *mismatches;
+};
+
+/* Read every tile with several threads at once, and return tiles/s */
+static qint64 readTiles(TileGetter getTile, QAtomicInt *mismatches)
+{
+    const int numReaders = 4;
+    QList<TileReader *> readers;
+
+    for (int i = 0; i < numReaders; i++)
+        readers.append(new TileReader(getTile, mismatches));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    foreach (TileReader *reader, readers)
+        reader->start();
+    foreach (TileReader *reader, readers)
+        reader->wait();
+
+    qint64 readMs = qMax(timer.elapsed(), qint64(1));
+
+    qDeleteAll(readers);
+
+    return numReaders * tileColumns * tileRows * 1000 / readMs;
+}
+
+/* Fill a fresh tile database as the cache queue does, then read it back
+ * from several threads at once, and report tiles/s each way. */
+void OPMapPlugin::benchmarkTileCache()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    core::PureImageCache cache;
+    cache.setGtileCache(dir.path() + QDir::separator());
+
+    const int numTiles = tileColumns * tileRows;
+    const int batch = 64;
+
+    QList<core::CacheItemQueue *> tiles;
+    for (int x = 0; x < tileColumns; x++)
+        for (int y = 0; y < tileRows; y++)
+            tiles.append(
+                new core::CacheItemQueue(tileType, core::Point(x, y), tileImage(x, y), tileZoom));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < numTiles; i += batch)
+        QVERIFY(cache.PutImagesToCache(tiles.mid(i, batch)));
+
+    qint64 writeMs = qMax(timer.elapsed(), qint64(1));
+
+    qDeleteAll(tiles);
+
+    QAtomicInt mismatches;
+    qint64 readRate = readTiles(
+        [&cache](const core::Point &pos) {
+            return cache.GetImageFromCache(tileType, pos, tileZoom);
+        },
+        &mismatches);
+
+    QCOMPARE(mismatches.load(), 0);
+
+    qDebug() << "Wrote" << numTiles << "tiles at" << numTiles * 1000 / writeMs << "tiles/s;"
+             << "4 threads read them at" << readRate << "tiles/s";
+}
+
+/* Make an MBTiles file of the same tiles as benchmarkTileCache, import it as
+ * a tile pack, and report tiles/s reading the pack from several threads. */
+void OPMapPlugin::benchmarkTilePack()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString mbtiles = dir.path() + QDir::separator() + "tiles.mbtiles";
+    const QString pack = dir.path() + QDir::separator() + "tiles.tilepack";
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "benchmarkTilePack");
+        db.setDatabaseName(mbtiles);
+        QVERIFY(db.open());
+
+        QSqlQuery query(db);
+        QVERIFY(query.exec("CREATE TABLE tiles (zoom_level integer, tile_column integer, "
+                           "tile_row integer, tile_data blob)"));
+
+        db.transaction();
+        QVERIFY(query.prepare("INSERT INTO tiles VALUES (?, ?, ?, ?)"));
+        for (int x = 0; x < tileColumns; x++) {
+            for (int y = 0; y < tileRows; y++) {
+                // MBTiles counts rows from the bottom
+                query.addBindValue(tileZoom);
+                query.addBindValue(x);
+                query.addBindValue((1 << tileZoom) - 1 - y);
+                query.addBindValue(tileImage(x, y));
+                QVERIFY(query.exec());
+            }
+        }
+        QVERIFY(db.commit());
+    }
+    QSqlDatabase::removeDatabase("benchmarkTilePack");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(core::TilePack::ImportMBTiles(mbtiles, pack, tileType));
+
+    qint64 importMs = qMax(timer.elapsed(), qint64(1));
+
+    core::TilePack tilePack;
+    QVERIFY(tilePack.Open(pack));
+    QCOMPARE(tilePack.Type(), tileType);
+    QCOMPARE(tilePack.Count(), tileColumns * tileRows);
+    QVERIFY(tilePack.GetImage(core::Point(tileColumns, 0), tileZoom).isEmpty());
+    QVERIFY(tilePack.GetImage(core::Point(0, 0), tileZoom + 1).isEmpty());
+
+    QAtomicInt mismatches;
+    qint64 readRate = readTiles(
+        [&tilePack](const core::Point &pos) { return tilePack.GetImage(pos, tileZoom); },
+        &mismatches);
+
+    QCOMPARE(mismatches.load(), 0);
+
+    qDebug() << "Imported" << tileColumns * tileRows << "tiles at"
+             << tileColumns * tileRows * 1000 / importMs << "tiles/s;"
+             << "4 threads read them from the pack at" << readRate << "tiles/s";
+}
+
+/* Local stand-in for a tile server.  The map reaches it as its HTTP proxy,
+ * whichever provider a tile is from, and every request is answered with the
+ * same tile after a delay like a real server's. */
+class TileServer : public QTcpServer
+{
+public:
+    TileServer(int latencyMs)
+        : requests(0)
+        , latencyMs(latencyMs)
+    {
+        // Enough detail that decoding it costs about what a real tile does
+        QImage image(256, 256, QImage::Format_RGB32);
+        image.fill(Qt::darkGreen);
+
+        QPainter painter(&image);
+        for (int i = 0; i < 256; i += 4) {
+            painter.setPen(QColor::fromHsv(i, 128, 192));
+            painter.drawLine(0, i, 255 - i, 255);
+            painter.drawEllipse(i / 2, i, 24, 12);
+        }
+        painter.end();
+
+        QBuffer buffer(&tile);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+
+        connect(this, &QTcpServer::newConnection, [this]() {
+            while (hasPendingConnections())
+                serve(nextPendingConnection());
+        });
+    }
+
+    int requests;
+
+private:
+    void serve(QTcpSocket *socket)
+    {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, [this, socket]() {
+            if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n"))
+                return;
+
+            socket->readAll();
+            requests++;
+
+            QTimer::singleShot(latencyMs, socket, [this, socket]() {
+                socket->write("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nContent-Length: "
+                              + QByteArray::number(tile.size())
+                              + "\r\nConnection: close\r\n\r\n");
+                socket->write(tile);
+                socket->disconnectFromHost();
+            });
+        });
+    }
+
+    int latencyMs;
+    QByteArray tile;
+};
+
+/* Whether every tile the map wants to show has been loaded */
+static bool viewComplete(internals::Core &map)
+{
+    foreach (core::Point p, map.tileDrawingList) {
+        internals::Tile *t = map.Matrix.TileAt(p);
+
+        if (t == nullptr || t->Overlays.isEmpty())
+            return false;
+    }
+
+    return true;
+}
+
+/* Follow a UAV across the map at high zoom, as the map gadget does, with
+ * tiles coming from a local server, and report how often part of the view
+ * was still blank. */
+void OPMapPlugin::followUavTiles()
+{
+    const int serverLatencyMs = 40;
+    const int updateMs = 50;
+    const int updates = 200;
+    const int zoom = 18;
+    const double speed = 40; // m/s
+
+    TileServer server(serverLatencyMs);
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    core::TLMaps *maps = core::TLMaps::Instance();
+
+    const QNetworkProxy oldProxy = maps->Proxy;
+    const core::AccessMode::Types oldAccessMode = maps->GetAccessMode();
+    const bool oldUseMemoryCache = maps->UseMemoryCache();
+
+    maps->Proxy = QNetworkProxy(QNetworkProxy::HttpProxy, "127.0.0.1", server.serverPort());
+    maps->setAccessMode(core::AccessMode::ServerOnly);
+    maps->setUseMemoryCache(true);
+
+    internals::PointLatLng uav(-35.36, 149.16);
+    // Degrees of longitude flown per update
+    const double step = speed * updateMs / 1000.0 / (111320 * qCos(qDegreesToRadians(uav.Lat())));
+
+    int incomplete = 0;
+    const diagnostics before = maps->GetDiagnostics();
+
+    {
+        internals::Core map;
+        map.SetMapType(core::MapType::OpenStreetMap);
+        map.SetCurrentRegion(internals::Rectangle(0, 0, 1024, 768));
+        map.OnMapSizeChanged(1024, 768);
+        map.SetZoom(zoom);
+        map.SetCurrentPosition(uav);
+        map.StartSystem();
+
+        QTRY_VERIFY_WITH_TIMEOUT(viewComplete(map), 10000);
+
+        for (int i = 0; i < updates; i++) {
+            uav.SetLng(uav.Lng() + step);
+            map.SetCurrentPosition(uav);
+
+            QTest::qWait(updateMs);
+
+            if (!viewComplete(map))
+                incomplete++;
+        }
+
+        QTRY_VERIFY_WITH_TIMEOUT(viewComplete(map), 10000);
+
+        map.CancelAsyncTasks();
+    }
+
+    const diagnostics after = maps->GetDiagnostics();
+
+    maps->Proxy = oldProxy;
+    maps->setAccessMode(oldAccessMode);
+    maps->setUseMemoryCache(oldUseMemoryCache);
+
+    QVERIFY(server.requests > 0);
+
+    qDebug() << "Followed the UAV for" << updates << "updates;" << incomplete
+             << "had part of the view blank." << server.requests << "tiles requested,"
+             << after.tilesFromMem - before.tilesFromMem << "shown from memory";
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,122 @@
+/**
+ ******************************************************************************
+ *
+ * @file       circularbuffer.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Sample history storage for the scope plots
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#ifndef CIRCULARBUFFER_H
+#define CIRCULARBUFFER_H
+
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief A FIFO of samples kept in a circular buffer.
+ *
+ * Appending at the back and dropping from the front are O(1). Storage is
+ * only reallocated (doubling) when more samples are held than ever before,
+ * so a scrolling window stops allocating once it has filled.
+ */
+template <typename T>
+class CircularBuffer
+{
+public:
+    explicit CircularBuffer(int capacity = 0)
+        : head(0)
+        , count(0)
+    {
+        reserve(capacity);
+    }
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    int capacity() const { return buf.size(); }
+
+    //! Sample i, counting from the oldest
+    const T &at(int i) const { return buf.constData()[(head + i) & (buf.size() - 1)]; }
+    const T &first() const { return at(0); }
+    const T &last() const { return at(count - 1); }
+
+    void append(const T &value)
+    {
+        if (count == buf.size())
+            reserve(count * 2);
+
+        buf[(head + count) & (buf.size() - 1)] = value;
+        count++;
+    }
+
+    //! Drop the n oldest samples
+    void removeFirst(int n = 1)
+    {
+        n = qMin(n, count);
+        if (n <= 0)
+            return;
+
+        head = (head + n) & (buf.size() - 1);
+        count -= n;
+    }
+
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+
+    //! Make room for at least n samples without further allocation
+    void reserve(int n)
+    {
+        int cap = MIN_CAPACITY;
+        while (cap < n)
+            cap *= 2;
+
+        if (cap <= buf.size())
+            return;
+
+        QVector<T> grown(cap);
+        for (int i = 0; i < count; i++)
+            grown[i] = at(i);
+
+        buf.swap(grown);
+        head = 0;
+    }
+
+private:
+    // Capacity is kept a power of two so indices wrap with a mask
+    static const int MIN_CAPACITY = 16;
+
+    QVector<T> buf;
+    int head;
+    int count;
+};
+
+#endif // CIRCULARBUFFER_H
+
+/**
+ * @}
+ * @}
+ */
@@ -40,7 +40,7 @@
  * @param p_uavFieldName The plotted UAVO field name
  */
 Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName)
-    : yDataHistory(nullptr)
+    : yDataExtremes(yData)
     , dataUpdated(false)
 {
     uavObjectName = p_uavObject;
@@ -57,10 +57,6 @@ Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName)
         haveSubField = false;
     }
 
-    xData = new QVector<double>();
-    yData = new QVector<double>();
-    yDataHistory = new QVector<double>();
-
     scalePower = 0;
     meanSamples = 1;
     meanSum = 0.0f;
@@ -94,12 +90,6 @@ Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName)
         haveSubField = false;
     }
 
-    xData = new QVector<double>();
-    yData = new QVector<double>();
-    zData = new QVector<double>();
-    zDataHistory = new QVector<double>();
-    timeDataHistory = new QVector<double>();
-
     scalePower = 0;
     meanSamples = 1;
     meanSum = 0.0f;
@@ -115,48 +105,41 @@ Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName)
 
 Plot2dData::~Plot2dData()
 {
-    if (xData != NULL)
-        delete xData;
-    if (yData != NULL)
-        delete yData;
-    if (yDataHistory != NULL)
-        delete yDataHistory;
 }
 
 Plot3dData::~Plot3dData()
 {
-    if (xData != NULL)
-        delete xData;
-    if (yData != NULL)
-        delete yData;
-    if (zData != NULL)
-        delete zData;
-    if (zDataHistory != NULL)
-        delete zDataHistory;
-    if (timeDataHistory != NULL)
-        delete timeDataHistory;
 }
 
 /**
- * @brief valueAsDouble Fetch the value from the UAVO and return it as a double
+ * @brief valueAsDouble Fetch the plotted value from the UAVO as a double
+ *
+ * The field and element are looked up the first time an object is seen;
+ * later samples from the same object read the element directly.
  * @param obj UAVO
- * @param field UAVO field
- * @param haveSubField TRUE if UAVO has subfield. FALSE if not.
- * @param uavSubFieldName UAVO subfield, if it exists
- * @return
+ * @param value Set to the current value of the plotted element
+ * @return true if obj is the plotted UAVO and has the plotted element
  */
-double PlotData::valueAsDouble(UAVObject *obj, UAVObjectField *field, bool haveSubField,
-                               QString uavSubFieldName)
+bool PlotData::valueAsDouble(UAVObject *obj, double *value)
 {
-    Q_UNUSED(obj);
-    QVariant value;
+    if (obj != resolvedObj) {
+        if (uavObjectName != obj->getName())
+            return false;
+
+        UAVObjectField *field = obj->getField(uavFieldName);
+        if (!field)
+            return false;
+
+        resolvedObj = obj;
+        if (haveSubField)
+            valueHandle = field->getElementHandle(uavSubFieldName);
+        else
+            valueHandle = field->getElementHandle();
+    }
 
-    if (haveSubField) {
-        int indexOfSubField = field->getElementNames().indexOf(
-            QRegExp(uavSubFieldName, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    } else
-        value = field->getValue();
+    if (!valueHandle.isValid())
+        return false;
 
-    return value.toDouble();
+    *value = valueHandle.toDouble();
+    return true;
 }
@@ -32,6 +32,7 @@ class ScopeGadgetWidget;
 class ScopeConfig;
 
 #include "uavobjects/uavobject.h"
+#include "uavobjects/uavobjectfield.h"
 
 #include "qwt/src/qwt_color_map.h"
 #include "qwt/src/qwt_scale_widget.h"
@@ -44,8 +45,12 @@ class PlotData : public QObject
 {
     Q_OBJECT
 public:
-    double valueAsDouble(UAVObject *obj, UAVObjectField *field, bool haveSubField,
-                         QString uavSubFieldName);
+    PlotData()
+        : resolvedObj(nullptr)
+    {
+    }
+
+    bool valueAsDouble(UAVObject *obj, double *value);
 
     // Setter functions
     void setXMinimum(double val) { xMinimum = val; }
@@ -73,9 +78,6 @@ public:
     int getMeanSamples() { return meanSamples; }
     QString getMathFunction() { return mathFunction; }
 
-    QVector<double> *getXData() { return xData; }
-    QVector<double> *getYData() { return yData; }
-
     virtual bool append(UAVObject *obj) = 0;
     virtual void removeStaleData() = 0;
     virtual void setUpdatedFlagToTrue() = 0;
@@ -87,9 +89,6 @@ public:
     QwtScaleWidget *rightAxis;
 
 protected:
-    QVector<double> *xData; // Data vector for plots
-    QVector<double> *yData; // Used vector for plots
-
     double m_xWindowSize;
     double xMinimum;
     double xMaximum;
@@ -110,6 +109,9 @@ protected:
     int correctionCount;
 
 private:
+    // The plotted element, resolved on the first sample from an object
+    UAVObject *resolvedObj;
+    UAVObjectField::ElementHandle valueHandle;
 };
 
 /**
@@ -16,6 +16,7 @@ include(../../plugins/uavtalk/uavtalk.pri)
 HEADERS += scopeplugin.h \
     scopes2d/histogramplotdata.h \
     scopes2d/histogramscopeconfig.h \
+    scopes2d/minmaxpyramid.h \
     scopes2d/scatterplotdata.h \
     scopes2d/scatterplotscopeconfig.h \
     scopes3d/spectrogramplotdata.h \
@@ -26,6 +27,7 @@ HEADERS += scopeplugin.h \
     scopes3d/scopes3dconfig.h \
     scopesconfig.h \
     plotdata.h \
+    circularbuffer.h \
     scope_global.h
 HEADERS += scopegadgetoptionspage.h
 HEADERS += scopegadgetconfiguration.h
@@ -36,6 +38,7 @@ HEADERS += scopegadgetfactory.h
 SOURCES += scopeplugin.cpp \
     scopes2d/histogramplotdata.cpp \
     scopes2d/histogramscopeconfig.cpp \
+    scopes2d/minmaxpyramid.cpp \
     scopes2d/scatterplotdata.cpp \
     scopes2d/scatterplotscopeconfig.cpp \
     scopes3d/spectrogramplotdata.cpp \
@@ -47,6 +50,10 @@ SOURCES += scopegadget.cpp
 SOURCES += scopegadgetfactory.cpp
 SOURCES += scopegadgetwidget.cpp
 
+contains(DEFINES, WITH_TESTS) {
+    SOURCES += scopetests.cpp
+}
+
 OTHER_FILES += ScopeGadget.pluginspec
 
 FORMS += scopegadgetoptionspage.ui
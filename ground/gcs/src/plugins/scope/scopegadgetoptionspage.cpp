@@ -34,6 +34,7 @@
 
 #include "vibrationanalysissettings.h"
 #include "vibrationanalysisoutput.h"
+#include "vibrationanalysisspectrum.h"
 
 #include "scopes2d/histogramscopeconfig.h"
 #include "scopes2d/scatterplotscopeconfig.h"
@@ -269,16 +270,26 @@ void ScopeGadgetOptionsPage::on_cmbSpectrogramSource_currentIndexChanged(QString
         // Load UAVO
         ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
         UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
-        VibrationAnalysisOutput *vibrationAnalysisOutput =
-            VibrationAnalysisOutput::GetInstance(objManager);
         VibrationAnalysisSettings *vibrationAnalysisSettings =
             VibrationAnalysisSettings::GetInstance(objManager);
         VibrationAnalysisSettings::DataFields vibrationAnalysisSettingsData =
             vibrationAnalysisSettings->getData();
 
+        // The flight controller either sends the spectrum or the samples to transform here
+        UAVObject *vibrationAnalysisOutput;
+        if (vibrationAnalysisSettingsData.Output == VibrationAnalysisSettings::OUTPUT_SPECTRUM)
+            vibrationAnalysisOutput = VibrationAnalysisSpectrum::GetInstance(objManager);
+        else
+            vibrationAnalysisOutput = VibrationAnalysisOutput::GetInstance(objManager);
+
         // Set combobox field to UAVO name
         options_page->cmbUAVObjectsSpectrogram->setCurrentIndex(
             options_page->cmbUAVObjectsSpectrogram->findText(vibrationAnalysisOutput->getName()));
+        options_page->cmbMathFunctionSpectrogram->setCurrentIndex(
+            options_page->cmbMathFunctionSpectrogram->findText(
+                vibrationAnalysisSettingsData.Output == VibrationAnalysisSettings::OUTPUT_SPECTRUM
+                    ? "None"
+                    : "FFT"));
         // Get the window size
         int fftWindowSize;
         switch (vibrationAnalysisSettingsData.FFTWindowSize) {
@@ -315,8 +326,7 @@ void ScopeGadgetOptionsPage::on_cmbSpectrogramSource_currentIndexChanged(QString
         QList<UAVObjectField *> fieldList = inst->getFields();
 
         foreach (UAVObjectField *field, fieldList) {
-            if (field->getType() == UAVObjectField::STRING
-                || field->getType() == UAVObjectField::ENUM)
+            if (field->getType() != UAVObjectField::INT16)
                 continue;
 
             if (field->getElementNames().count() > 1) {
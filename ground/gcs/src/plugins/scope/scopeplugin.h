@@ -43,6 +43,11 @@ public:
     bool initialize(const QStringList &arguments, QString *errorString);
     void shutdown();
 
+#ifdef WITH_TESTS
+private Q_SLOTS:
+    void testDecimatedCurve();
+#endif
+
 private:
     ScopeGadgetFactory *mf;
 };
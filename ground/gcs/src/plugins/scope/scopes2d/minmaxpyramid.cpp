@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ *
+ * @file       minmaxpyramid.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Range minimum/maximum queries over a scope sample history
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "scopes2d/minmaxpyramid.h"
+
+MinMaxPyramid::MinMaxPyramid(const CircularBuffer<double> &samples)
+    : samples(samples)
+    , firstSample(0)
+    , endSample(0)
+{
+}
+
+/**
+ * @brief MinMaxPyramid::append Account for the newest sample, closing every
+ * bucket that it completes
+ */
+void MinMaxPyramid::append()
+{
+    const qint64 sample = endSample++;
+
+    Bucket bucket = { sample, sample };
+
+    for (int k = 1; k <= MAX_LEVELS; k++) {
+        const qint64 span = Q_INT64_C(1) << k;
+
+        // The newest sample only completes a bucket at the end of an aligned run
+        if ((sample + 1) % span)
+            break;
+
+        // Buckets reaching back past the oldest sample would include dropped data
+        const qint64 start = sample + 1 - span;
+        if (start < firstSample)
+            break;
+
+        // Combine with the left half of the bucket, which is already complete
+        if (k == 1) {
+            const Bucket left = { start, start };
+            merge(bucket, left);
+        } else {
+            const Level &below = levels.at(k - 2);
+            merge(bucket, below.buckets.at((start >> (k - 1)) - below.firstBucket));
+        }
+
+        if (levels.size() < k)
+            levels.append(Level());
+
+        Level &level = levels[k - 1];
+        if (level.buckets.isEmpty())
+            level.firstBucket = start >> k;
+        level.buckets.append(bucket);
+    }
+}
+
+void MinMaxPyramid::removeFirst(int n)
+{
+    firstSample = qMin(firstSample + n, endSample);
+
+    for (int k = 1; k <= levels.size(); k++) {
+        Level &level = levels[k - 1];
+        while (!level.buckets.isEmpty() && (level.firstBucket << k) < firstSample) {
+            level.buckets.removeFirst();
+            level.firstBucket++;
+        }
+    }
+}
+
+void MinMaxPyramid::clear()
+{
+    firstSample = endSample;
+
+    for (int k = 0; k < levels.size(); k++)
+        levels[k].buckets.clear();
+}
+
+/**
+ * @brief MinMaxPyramid::extremes Find the smallest and largest samples in a range
+ * @param from Index of the first sample in the range
+ * @param to Index one past the last sample in the range, greater than from
+ * @return Indices of the smallest and largest samples
+ */
+MinMaxPyramid::Extremes MinMaxPyramid::extremes(int from, int to) const
+{
+    qint64 sample = firstSample + from;
+    const qint64 end = firstSample + to;
+
+    Bucket result = { sample, sample };
+
+    while (sample < end) {
+        // Take the largest aligned bucket that starts here and fits in the range
+        int k = 0;
+        while (k < levels.size() && !(sample & ((Q_INT64_C(2) << k) - 1))
+               && sample + (Q_INT64_C(2) << k) <= end)
+            k++;
+
+        if (k == 0) {
+            const Bucket single = { sample, sample };
+            merge(result, single);
+        } else {
+            const Level &level = levels.at(k - 1);
+            merge(result, level.buckets.at((sample >> k) - level.firstBucket));
+        }
+
+        sample += Q_INT64_C(1) << k;
+    }
+
+    Extremes ret = { int(result.minSample - firstSample), int(result.maxSample - firstSample) };
+    return ret;
+}
+
+void MinMaxPyramid::merge(Bucket &into, const Bucket &other) const
+{
+    if (value(other.minSample) < value(into.minSample))
+        into.minSample = other.minSample;
+    if (value(other.maxSample) > value(into.maxSample))
+        into.maxSample = other.maxSample;
+}
+
+/**
+ * @}
+ * @}
+ */
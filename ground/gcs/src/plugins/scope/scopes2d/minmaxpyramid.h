@@ -0,0 +1,105 @@
+/**
+ ******************************************************************************
+ *
+ * @file       minmaxpyramid.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Range minimum/maximum queries over a scope sample history
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#ifndef MINMAXPYRAMID_H
+#define MINMAXPYRAMID_H
+
+#include "circularbuffer.h"
+
+#include <QVector>
+
+/**
+ * @brief The MinMaxPyramid class Tracks where the minimum and maximum of a
+ * sample history lie, so a curve can be drawn from a few points per pixel.
+ *
+ * Level k holds one bucket for each aligned run of 2^k samples. Buckets are
+ * added as samples arrive and dropped with the oldest samples, so keeping the
+ * pyramid current is O(1) amortized per sample, and the extremes of any range
+ * are found in O(log n).
+ *
+ * The pyramid does not copy the samples; it must be told about every change
+ * made to the buffer it watches.
+ */
+class MinMaxPyramid
+{
+public:
+    struct Extremes
+    {
+        int minIndex;
+        int maxIndex;
+    };
+
+    explicit MinMaxPyramid(const CircularBuffer<double> &samples);
+
+    //! Call after a sample was appended to the buffer
+    void append();
+    //! Call after the n oldest samples were removed from the buffer
+    void removeFirst(int n = 1);
+    //! Call after the buffer was cleared
+    void clear();
+
+    Extremes extremes(int from, int to) const;
+
+private:
+    struct Bucket
+    {
+        qint64 minSample;
+        qint64 maxSample;
+    };
+
+    struct Level
+    {
+        CircularBuffer<Bucket> buckets;
+        qint64 firstBucket;
+    };
+
+    // Levels above this would rarely be used and only save a few steps
+    static const int MAX_LEVELS = 24;
+
+    double value(qint64 sample) const { return samples.at(sample - firstSample); }
+    void merge(Bucket &into, const Bucket &other) const;
+
+    const CircularBuffer<double> &samples;
+
+    // Samples are numbered from when the pyramid was created, so buckets
+    // stay aligned as the oldest samples are dropped
+    qint64 firstSample;
+    qint64 endSample;
+
+    // levels[k - 1] holds level k; level 0 is the samples themselves
+    QVector<Level> levels;
+};
+
+#endif // MINMAXPYRAMID_H
+
+/**
+ * @}
+ * @}
+ */
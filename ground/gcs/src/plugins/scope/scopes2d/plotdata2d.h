@@ -28,6 +28,8 @@
 #define PLOTDATA2D_H
 
 #include "plotdata.h"
+#include "circularbuffer.h"
+#include "scopes2d/minmaxpyramid.h"
 
 #include <QTimer>
 #include <QTime>
@@ -44,7 +46,7 @@ public:
     Plot2dData(QString uavObject, QString uavField);
     ~Plot2dData();
 
-    QVector<double> *yDataHistory; // Used for scatterplots
+    CircularBuffer<double> yDataHistory; // Used for scatterplots
 
     virtual void setUpdatedFlagToTrue() { dataUpdated = true; }
     virtual bool readAndResetUpdatedFlag()
@@ -54,6 +56,29 @@ public:
         return tmp;
     }
 
+protected:
+    void appendYData(double val)
+    {
+        yData.append(val);
+        yDataExtremes.append();
+    }
+
+    void removeFirstYData()
+    {
+        yData.removeFirst();
+        yDataExtremes.removeFirst();
+    }
+
+    void clearYData()
+    {
+        yData.clear();
+        yDataExtremes.clear();
+    }
+
+    CircularBuffer<double> xData; // Data vector for plots
+    CircularBuffer<double> yData; // Used vector for plots
+    MinMaxPyramid yDataExtremes; // Kept in step with yData, for drawing long histories
+
 private:
     bool dataUpdated;
 };
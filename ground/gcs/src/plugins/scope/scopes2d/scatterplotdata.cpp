@@ -37,6 +37,120 @@
 #include "qwt/src/qwt_plot.h"
 #include "qwt/src/qwt_plot_curve.h"
 
+#include <qmath.h>
+
+/**
+ * @brief ScatterplotSeriesData::boundingRect Bounds of all samples, found
+ * without visiting each of them
+ */
+QRectF ScatterplotSeriesData::boundingRect() const
+{
+    if (d_boundingRect.width() < 0.0) {
+        const int count = sampleCount();
+        if (count == 0)
+            return QRectF(1.0, 1.0, -2.0, -2.0);
+
+        const MinMaxPyramid::Extremes extremes = yExtremes.extremes(0, count);
+        const double minY = yData.at(extremes.minIndex);
+        const double maxY = yData.at(extremes.maxIndex);
+        const double minX = rawX(0);
+        const double maxX = rawX(count - 1);
+
+        d_boundingRect = QRectF(minX, minY, maxX - minX, maxY - minY);
+    }
+
+    return d_boundingRect;
+}
+
+/**
+ * @brief ScatterplotSeriesData::decimate Reduce the samples to those that
+ * decide which pixels the curve covers
+ * @param xMap Map from x values to paint device columns
+ * @param canvasRect Area being drawn
+ */
+void ScatterplotSeriesData::decimate(const QwtScaleMap &xMap, const QRectF &canvasRect) const
+{
+    points.clear();
+    decimated = false;
+
+    // Columns are found by bisection, so they must increase with the sample index
+    if (xMap.isInverting())
+        return;
+
+    decimated = true;
+
+    const int count = sampleCount();
+    if (count == 0)
+        return;
+
+    // Samples are grouped by the column Qwt rounds them to when drawing
+    int first = firstInColumn(xMap, qFloor(canvasRect.left()), 0, count);
+    const int end = firstInColumn(xMap, qCeil(canvasRect.right()) + 1, first, count);
+
+    // Keep the neighbours just outside the canvas, so lines still run off the edges
+    if (first > 0)
+        points.append(rawSample(first - 1));
+
+    while (first < end) {
+        const int next = firstInColumn(xMap, column(xMap, first) + 1, first + 1, end);
+
+        if (next - first <= 4) {
+            for (int i = first; i < next; i++)
+                points.append(rawSample(i));
+        } else {
+            // A line through these, in order, spans the column like the full set does
+            const MinMaxPyramid::Extremes extremes = yExtremes.extremes(first, next);
+            const int keep[4] = { first, qMin(extremes.minIndex, extremes.maxIndex),
+                                  qMax(extremes.minIndex, extremes.maxIndex), next - 1 };
+
+            for (int i = 0; i < 4; i++) {
+                if (i == 0 || keep[i] != keep[i - 1])
+                    points.append(rawSample(keep[i]));
+            }
+        }
+
+        first = next;
+    }
+
+    if (end < count)
+        points.append(rawSample(end));
+}
+
+/**
+ * @brief ScatterplotSeriesData::firstInColumn Find the first sample drawn at or
+ * right of a column
+ * @return Index in [from, to], to if there is none
+ */
+int ScatterplotSeriesData::firstInColumn(const QwtScaleMap &xMap, int col, int from, int to) const
+{
+    while (from < to) {
+        const int mid = from + (to - from) / 2;
+        if (column(xMap, mid) < col)
+            from = mid + 1;
+        else
+            to = mid;
+    }
+
+    return from;
+}
+
+/**
+ * @brief ScatterplotCurve::drawSeries Reduce the samples to the resolution of
+ * the maps, then draw them
+ */
+void ScatterplotCurve::drawSeries(QPainter *painter, const QwtScaleMap &xMap,
+                                  const QwtScaleMap &yMap, const QRectF &canvasRect, int from,
+                                  int to) const
+{
+    const ScatterplotSeriesData *series = dynamic_cast<const ScatterplotSeriesData *>(data());
+
+    // Partial redraws index the samples already handed out
+    if (series && from == 0 && to < 0)
+        series->decimate(xMap, canvasRect);
+
+    QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, from, to);
+}
+
 /**
  * @brief Scatterplot2dScopeConfig::plotNewData Update plot with new data
  * @param scopeGadgetWidget
@@ -50,7 +164,7 @@ void TimeSeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeCon
 
     // Plot new data
     if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+        updateCurve();
 
     QDateTime NOW = QDateTime::currentDateTime();
     double toTime = NOW.toTime_t();
@@ -72,7 +186,7 @@ void SeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeConfig,
 
     // Plot new data
     if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+        updateCurve();
 }
 
 /**
@@ -82,61 +196,53 @@ void SeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeConfig,
  */
 bool SeriesPlotData::append(UAVObject *obj)
 {
-    if (uavObjectName == obj->getName()) {
-
-        // Get the field of interest
-        UAVObjectField *field = obj->getField(uavFieldName);
+    double currentValue;
 
-        if (field) {
+    if (valueAsDouble(obj, &currentValue)) {
+        currentValue *= pow(10, scalePower);
 
-            double currentValue =
-                valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
+        // Perform scope math, if necessary
+        if (mathFunction == "Boxcar average" || mathFunction == "Standard deviation") {
+            // Put the new value at the front
+            yDataHistory.append(currentValue);
 
-            // Perform scope math, if necessary
-            if (mathFunction == "Boxcar average" || mathFunction == "Standard deviation") {
-                // Put the new value at the front
-                yDataHistory->append(currentValue);
+            // calculate average value
+            meanSum += currentValue;
+            if (yDataHistory.size() > (int)meanSamples) {
+                meanSum -= yDataHistory.first();
+                yDataHistory.removeFirst();
+            }
 
-                // calculate average value
-                meanSum += currentValue;
-                if (yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
+            // make sure to correct the sum every meanSamples steps to prevent it
+            // from running away due to floating point rounding errors
+            correctionSum += currentValue;
+            if (++correctionCount >= (int)meanSamples) {
+                meanSum = correctionSum;
+                correctionSum = 0.0f;
+                correctionCount = 0;
+            }
 
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum += currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
+            double boxcarAvg = meanSum / yDataHistory.size();
 
-                double boxcarAvg = meanSum / yDataHistory->size();
-
-                if (mathFunction == "Standard deviation") {
-                    // Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum = 0;
-                    for (int i = 0; i < yDataHistory->size(); i++) {
-                        stdSum += pow(yDataHistory->at(i) - boxcarAvg, 2) / (meanSamples - 1);
-                    }
-                    yData->append(sqrt(stdSum));
-                } else {
-                    yData->append(boxcarAvg);
+            if (mathFunction == "Standard deviation") {
+                // Calculate square of sample standard deviation, with Bessel's correction
+                double stdSum = 0;
+                for (int i = 0; i < yDataHistory.size(); i++) {
+                    stdSum += pow(yDataHistory.at(i) - boxcarAvg, 2) / (meanSamples - 1);
                 }
+                appendYData(sqrt(stdSum));
             } else {
-                yData->append(currentValue);
+                appendYData(boxcarAvg);
             }
+        } else {
+            appendYData(currentValue);
+        }
 
-            if (yData->size()
-                > getXWindowSize()) { // If new data overflows the window, remove old data...
-                yData->pop_front();
-            } else //...otherwise, add a new y point at position xData
-                xData->insert(xData->size(), xData->size());
+        // If new data overflows the window, remove old data. Samples are plotted at their index.
+        if (yData.size() > getXWindowSize())
+            removeFirstYData();
 
-            return true;
-        }
+        return true;
     }
 
     return false;
@@ -149,60 +255,56 @@ bool SeriesPlotData::append(UAVObject *obj)
  */
 bool TimeSeriesPlotData::append(UAVObject *obj)
 {
-    if (uavObjectName == obj->getName()) {
-        // Get the field of interest
-        UAVObjectField *field = obj->getField(uavFieldName);
-
-        if (field) {
-            QDateTime NOW = QDateTime::currentDateTime(); // THINK ABOUT REIMPLEMENTING THIS TO SHOW
-                                                          // UAVO TIME, NOT SYSTEM TIME
-            double currentValue =
-                valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            // Perform scope math, if necessary
-            if (mathFunction == "Boxcar average" || mathFunction == "Standard deviation") {
-                // Put the new value at the back
-                yDataHistory->append(currentValue);
-
-                // calculate average value
-                meanSum += currentValue;
-                if (yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum += currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
+    double currentValue;
+
+    if (valueAsDouble(obj, &currentValue)) {
+        QDateTime NOW = QDateTime::currentDateTime(); // THINK ABOUT REIMPLEMENTING THIS TO SHOW
+                                                      // UAVO TIME, NOT SYSTEM TIME
+        currentValue *= pow(10, scalePower);
+
+        // Perform scope math, if necessary
+        if (mathFunction == "Boxcar average" || mathFunction == "Standard deviation") {
+            // Put the new value at the back
+            yDataHistory.append(currentValue);
+
+            // calculate average value
+            meanSum += currentValue;
+            if (yDataHistory.size() > (int)meanSamples) {
+                meanSum -= yDataHistory.first();
+                yDataHistory.removeFirst();
+            }
+            // make sure to correct the sum every meanSamples steps to prevent it
+            // from running away due to floating point rounding errors
+            correctionSum += currentValue;
+            if (++correctionCount >= (int)meanSamples) {
+                meanSum = correctionSum;
+                correctionSum = 0.0f;
+                correctionCount = 0;
+            }
 
-                double boxcarAvg = meanSum / yDataHistory->size();
-
-                if (mathFunction == "Standard deviation") {
-                    // Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum = 0;
-                    for (int i = 0; i < yDataHistory->size(); i++) {
-                        stdSum += pow(yDataHistory->at(i) - boxcarAvg, 2) / (meanSamples - 1);
-                    }
-                    yData->append(sqrt(stdSum));
-                } else {
-                    yData->append(boxcarAvg);
+            double boxcarAvg = meanSum / yDataHistory.size();
+
+            if (mathFunction == "Standard deviation") {
+                // Calculate square of sample standard deviation, with Bessel's correction
+                double stdSum = 0;
+                for (int i = 0; i < yDataHistory.size(); i++) {
+                    stdSum += pow(yDataHistory.at(i) - boxcarAvg, 2) / (meanSamples - 1);
                 }
+                appendYData(sqrt(stdSum));
             } else {
-                yData->append(currentValue);
+                appendYData(boxcarAvg);
             }
+        } else {
+            appendYData(currentValue);
+        }
 
-            double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
-            xData->append(valueX);
+        double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
+        xData.append(valueX);
 
-            // Remove stale data
-            removeStaleData();
+        // Remove stale data
+        removeStaleData();
 
-            return true;
-        }
+        return true;
     }
 
     return false;
@@ -217,15 +319,15 @@ void TimeSeriesPlotData::removeStaleData()
     double oldestValue;
 
     while (1) {
-        if (xData->size() == 0)
+        if (xData.size() == 0)
             break;
 
-        newestValue = xData->last();
-        oldestValue = xData->first();
+        newestValue = xData.last();
+        oldestValue = xData.first();
 
         if (newestValue - oldestValue > getXWindowSize()) {
-            yData->pop_front();
-            xData->pop_front();
+            removeFirstYData();
+            xData.removeFirst();
         } else
             break;
     }
@@ -240,6 +342,26 @@ void TimeSeriesPlotData::removeStaleDataTimeout()
     removeStaleData();
 }
 
+/**
+ * @brief ScatterplotData::setCurve Set the curve and hand it this plot's sample buffers
+ * @param val Curve, which takes ownership of the series data
+ */
+void ScatterplotData::setCurve(QwtPlotCurve *val)
+{
+    curve = val;
+    seriesData = new ScatterplotSeriesData(curveXData(), yData, yDataExtremes);
+    curve->setData(seriesData);
+}
+
+/**
+ * @brief ScatterplotData::updateCurve Tell the curve its samples have changed
+ */
+void ScatterplotData::updateCurve()
+{
+    seriesData->dataChanged();
+    curve->itemChanged();
+}
+
 /**
  * @brief ScatterplotData::deletePlots Delete all plot data
  */
@@ -256,6 +378,9 @@ void ScatterplotData::deletePlots(PlotData *scatterplotData)
  */
 void ScatterplotData::clearPlots()
 {
-    yData->clear();
-    xData->clear();
+    clearYData();
+    xData.clear();
+
+    if (seriesData)
+        seriesData->dataChanged();
 }
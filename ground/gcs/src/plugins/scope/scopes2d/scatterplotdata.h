@@ -30,11 +30,91 @@
 #include "scopes2d/plotdata2d.h"
 #include "uavobjects/uavobject.h"
 #include "qwt/src/qwt_plot_curve.h"
+#include "qwt/src/qwt_scale_map.h"
+#include "qwt/src/qwt_series_data.h"
 
 #include <QTimer>
 #include <QTime>
 #include <QVector>
 
+/**
+ * @brief The ScatterplotSeriesData class Presents a curve's sample buffers to
+ * Qwt in place, so new samples are not copied into the curve on every redraw.
+ *
+ * Before each redraw the visible samples can be reduced to the first, last,
+ * smallest and largest sample in each pixel column. The line drawn through
+ * these covers the same pixels as the line through every sample, so the cost
+ * of drawing depends on the plot width rather than on the length of the history.
+ * X values must not decrease.
+ */
+class ScatterplotSeriesData : public QwtSeriesData<QPointF>
+{
+public:
+    /**
+     * @param xData X values, or nullptr to plot each sample at its index
+     * @param yData Y values
+     * @param yExtremes Extremes of yData
+     */
+    ScatterplotSeriesData(const CircularBuffer<double> *xData, const CircularBuffer<double> &yData,
+                          const MinMaxPyramid &yExtremes)
+        : xData(xData)
+        , yData(yData)
+        , yExtremes(yExtremes)
+        , decimated(false)
+    {
+    }
+
+    virtual size_t size() const { return decimated ? points.size() : sampleCount(); }
+    virtual QPointF sample(size_t i) const { return decimated ? points.at(i) : rawSample(i); }
+    virtual QRectF boundingRect() const;
+
+    //! Forget the cached bounds and points after the buffers changed
+    void dataChanged()
+    {
+        d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+        decimated = false;
+    }
+
+    void decimate(const QwtScaleMap &xMap, const QRectF &canvasRect) const;
+
+private:
+    int sampleCount() const
+    {
+        if (xData)
+            return qMin(xData->size(), yData.size());
+        return yData.size();
+    }
+
+    double rawX(int i) const { return xData ? xData->at(i) : i; }
+    QPointF rawSample(int i) const { return QPointF(rawX(i), yData.at(i)); }
+    int column(const QwtScaleMap &xMap, int i) const { return qRound(xMap.transform(rawX(i))); }
+    int firstInColumn(const QwtScaleMap &xMap, int col, int from, int to) const;
+
+    const CircularBuffer<double> *xData;
+    const CircularBuffer<double> &yData;
+    const MinMaxPyramid &yExtremes;
+
+    // Reduced samples for the last redraw, valid until the data changes
+    mutable QVector<QPointF> points;
+    mutable bool decimated;
+};
+
+/**
+ * @brief The ScatterplotCurve class A curve that reduces ScatterplotSeriesData to
+ * the resolution of the plot before drawing it
+ */
+class ScatterplotCurve : public QwtPlotCurve
+{
+public:
+    explicit ScatterplotCurve(const QString &title)
+        : QwtPlotCurve(title)
+    {
+    }
+
+    virtual void drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                            const QRectF &canvasRect, int from, int to) const;
+};
+
 /**
  * @brief The Scatterplot2dData class Base class that keeps the data for each curve in the plot.
  */
@@ -46,16 +126,22 @@ public:
         : Plot2dData(uavObject, uavField)
     {
         curve = nullptr;
+        seriesData = nullptr;
     }
     ~ScatterplotData() {}
 
     virtual void deletePlots(PlotData *);
     void clearPlots();
 
-    void setCurve(QwtPlotCurve *val) { curve = val; }
+    void setCurve(QwtPlotCurve *val);
 
 protected:
+    //! The x values handed to the curve, nullptr to use the sample index
+    virtual const CircularBuffer<double> *curveXData() const { return &xData; }
+    void updateCurve();
+
     QwtPlotCurve *curve;
+    ScatterplotSeriesData *seriesData; // Owned by the curve
 };
 
 /**
@@ -82,6 +168,9 @@ public:
       */
     virtual void removeStaleData() {}
     virtual void plotNewData(PlotData *, ScopeConfig *, ScopeGadgetWidget *);
+
+protected:
+    virtual const CircularBuffer<double> *curveXData() const { return nullptr; }
 };
 
 /**
@@ -292,10 +292,9 @@ void Scatterplot2dScopeConfig::loadConfiguration(ScopeGadgetWidget *scopeGadgetW
             curveNameScaledMath = curveNameScaledMath + "*";
 
         // Create the curve plot
-        QwtPlotCurve *plotCurve = new QwtPlotCurve(curveNameScaledMath);
+        QwtPlotCurve *plotCurve = new ScatterplotCurve(curveNameScaledMath);
         plotCurve->setPen(QPen(QBrush(QColor(color), Qt::SolidPattern), (qreal)1, Qt::SolidLine,
                                Qt::SquareCap, Qt::BevelJoin));
-        plotCurve->setSamples(*(scatterplotData->getXData()), *(scatterplotData->getYData()));
         plotCurve->attach(scopeGadgetWidget);
         scatterplotData->setCurve(plotCurve);
 
@@ -28,6 +28,7 @@
 #define PLOTDATA3D_H
 
 #include "plotdata.h"
+#include "circularbuffer.h"
 
 #include <QTimer>
 #include <QTime>
@@ -44,9 +45,8 @@ public:
     Plot3dData(QString uavObject, QString uavField);
     ~Plot3dData();
 
-    QVector<double> *zData;
-    QVector<double> *zDataHistory;
-    QVector<double> *timeDataHistory;
+    CircularBuffer<double> zDataHistory;
+    CircularBuffer<double> timeDataHistory;
 
     void setZMinimum(double val) { zMinimum = val; }
     void setZMaximum(double val) { zMaximum = val; }
@@ -26,6 +26,7 @@
 
 #include <QDebug>
 #include <math.h>
+#include <qnumeric.h>
 
 #include "extensionsystem/pluginmanager.h"
 #include "uavobjects/uavobjectmanager.h"
@@ -35,13 +36,85 @@
 
 #include "qwt/src/qwt.h"
 #include "qwt/src/qwt_color_map.h"
-#include "qwt/src/qwt_matrix_raster_data.h"
 #include "qwt/src/qwt_plot_spectrogram.h"
 #include "qwt/src/qwt_scale_draw.h"
 #include "qwt/src/qwt_scale_widget.h"
 
 #define PI 3.1415926535897932384626433832795
 
+SpectrogramRasterData::SpectrogramRasterData(const CircularBuffer<double> &values)
+    : values(values)
+    , numColumns(0)
+    , numRows(0)
+    , dx(0.0)
+    , dy(0.0)
+{
+}
+
+void SpectrogramRasterData::setNumColumns(int numColumns)
+{
+    this->numColumns = numColumns;
+    update();
+}
+
+/**
+ * @brief SpectrogramRasterData::update Recalculate the raster geometry after the
+ * history or the intervals changed
+ */
+void SpectrogramRasterData::update()
+{
+    numRows = 0;
+    dx = 0.0;
+    dy = 0.0;
+
+    if (numColumns > 0) {
+        numRows = values.size() / numColumns;
+
+        const QwtInterval xInterval = interval(Qt::XAxis);
+        const QwtInterval yInterval = interval(Qt::YAxis);
+        if (xInterval.isValid())
+            dx = xInterval.width() / numColumns;
+        if (yInterval.isValid() && numRows > 0)
+            dy = yInterval.width() / numRows;
+    }
+}
+
+void SpectrogramRasterData::setInterval(Qt::Axis axis, const QwtInterval &interval)
+{
+    QwtRasterData::setInterval(axis, interval);
+    update();
+}
+
+QRectF SpectrogramRasterData::pixelHint(const QRectF &area) const
+{
+    Q_UNUSED(area);
+
+    const QwtInterval xInterval = interval(Qt::XAxis);
+    const QwtInterval yInterval = interval(Qt::YAxis);
+    if (xInterval.isValid() && yInterval.isValid())
+        return QRectF(xInterval.minValue(), yInterval.minValue(), dx, dy);
+
+    return QRectF();
+}
+
+double SpectrogramRasterData::value(double x, double y) const
+{
+    const QwtInterval xInterval = interval(Qt::XAxis);
+    const QwtInterval yInterval = interval(Qt::YAxis);
+
+    if (numRows == 0 || !xInterval.contains(x) || !yInterval.contains(y))
+        return qQNaN();
+
+    int row = int((y - yInterval.minValue()) / dy);
+    int col = int((x - xInterval.minValue()) / dx);
+
+    // The maximum is inside the interval, but past the last row and column
+    row = qMin(row, numRows - 1);
+    col = qMin(col, numColumns - 1);
+
+    return values.at(row * numColumns + col);
+}
+
 /**
  * @brief SpectrogramData
  * @param uavObject
@@ -62,7 +135,7 @@ SpectrogramData::SpectrogramData(QString uavObject, QString uavField, double sam
     autoscaleValueUpdated = 0;
 
     // Create raster data
-    rasterData = new QwtMatrixRasterData();
+    rasterData = new SpectrogramRasterData(zDataHistory);
 
     if (mathFunction == "FFT") {
         fft_object = new ffft::FFTReal<double>(windowWidth);
@@ -71,7 +144,7 @@ SpectrogramData::SpectrogramData(QString uavObject, QString uavField, double sam
 
     this->windowWidth = windowWidth;
 
-    rasterData->setValueMatrix(*zDataHistory, windowWidth);
+    rasterData->setNumColumns(windowWidth);
 
     // Set the ranges for the plot
     resetAxisRanges();
@@ -122,7 +195,7 @@ void SpectrogramData::plotNewData(PlotData *plot3dData, ScopeConfig *scopeConfig
     // Check for new data
     if (readAndResetUpdatedFlag() == true) {
         // Plot new data
-        rasterData->setValueMatrix(*zDataHistory, windowWidth);
+        rasterData->update();
 
         // Check autoscale. (For some reason, QwtSpectrogram doesn't support autoscale)
         if (zMaximum == 0) {
@@ -177,7 +250,7 @@ bool SpectrogramData::append(UAVObject *multiObj)
         QList<UAVObjectField *> fieldList = multiObj->getFields();
         foreach (UAVObjectField *field, fieldList) {
             if (field->getType() == UAVObjectField::INT16 && field->getName() == "samples") {
-                newWindowWidth = field->getValue().toDouble();
+                newWindowWidth = field->getDouble();
                 break;
             }
         }
@@ -201,7 +274,7 @@ bool SpectrogramData::append(UAVObject *multiObj)
             clearPlots();
 
             plotData.clear();
-            rasterData->setValueMatrix(*zDataHistory, windowWidth);
+            rasterData->setNumColumns(windowWidth);
 
             qDebug() << "Spectrogram width adjusted to " << windowWidth;
         }
@@ -221,13 +294,13 @@ bool SpectrogramData::append(UAVObject *multiObj)
                     // Check if the instance has a scale field
                     if (field->getType() == UAVObjectField::FLOAT32
                         && field->getName() == "scale") {
-                        scale = field->getValue().toDouble();
+                        scale = field->getDouble();
                         break;
                     }
 
                     // Check if data is ordered. If not, just discard everything
                     if (field->getType() == UAVObjectField::INT16 && field->getName() == "index") {
-                        int currentIndex = field->getValue().toDouble();
+                        int currentIndex = field->getDouble();
                         if (currentIndex != (lastInstanceIndex + 1)) {
                             fprintf(stderr, "Out of order index. Got %d expected %d\n",
                                     currentIndex, lastInstanceIndex + 1);
@@ -240,9 +313,10 @@ bool SpectrogramData::append(UAVObject *multiObj)
                     }
                 }
 
-                for (int i = 0; i < numElements; i++) {
+                // A short spectrum only fills part of the last instance
+                for (int i = 0; i < numElements && plotData.size() < valuesToProcess; i++) {
                     double currentValue =
-                        field->getValue(i).toDouble() / scale; // Get the value and scale it
+                        field->getDouble(i) / scale; // Get the value and scale it
 
                     // Normally some math would go here, modifying currentValue before appending it
                     // to values
@@ -316,13 +390,14 @@ bool SpectrogramData::append(UAVObject *multiObj)
                 }
             }
 
-            timeDataHistory->append(NOW.toTime_t() + NOW.time().msec() / 1000.0);
-            while (timeDataHistory->back() - timeDataHistory->front() > timeHorizon) {
-                timeDataHistory->pop_front();
-                zDataHistory->remove(0, fminl(windowWidth, zDataHistory->size()));
+            timeDataHistory.append(NOW.toTime_t() + NOW.time().msec() / 1000.0);
+            while (timeDataHistory.last() - timeDataHistory.first() > timeHorizon) {
+                timeDataHistory.removeFirst();
+                zDataHistory.removeFirst(windowWidth);
             }
 
-            *zDataHistory << plotData;
+            for (int i = 0; i < plotData.size(); i++)
+                zDataHistory.append(plotData.at(i));
             plotData.clear();
             lastInstanceIndex = -1; // Next index will be 0
 
@@ -353,8 +428,8 @@ void SpectrogramData::deletePlots(PlotData *spectrogramData)
  */
 void SpectrogramData::clearPlots()
 {
-    timeDataHistory->clear();
-    zDataHistory->clear();
+    timeDataHistory.clear();
+    zDataHistory.clear();
 
     resetAxisRanges();
 }
@@ -30,7 +30,7 @@
 #include "scopes3d/plotdata3d.h"
 #include "uavobjects/uavobject.h"
 #include "qwt/src/qwt_plot_spectrogram.h"
-#include "qwt/src/qwt_matrix_raster_data.h"
+#include "qwt/src/qwt_raster_data.h"
 
 #include <QTimer>
 #include <QTime>
@@ -38,6 +38,31 @@
 
 #include "ffft/FFTReal.h"
 
+/**
+ * @brief The SpectrogramRasterData class Presents the spectrogram history to Qwt
+ * in place. The history holds one row of numColumns values per update, oldest first,
+ * which are drawn nearest-neighbour like QwtMatrixRasterData.
+ */
+class SpectrogramRasterData : public QwtRasterData
+{
+public:
+    SpectrogramRasterData(const CircularBuffer<double> &values);
+
+    void setNumColumns(int numColumns);
+    void update();
+
+    virtual void setInterval(Qt::Axis axis, const QwtInterval &interval);
+    virtual QRectF pixelHint(const QRectF &area) const;
+    virtual double value(double x, double y) const;
+
+private:
+    const CircularBuffer<double> &values;
+    int numColumns;
+    int numRows;
+    double dx;
+    double dy;
+};
+
 /**
  * @brief The SpectrogramData class The spectrogram plot has a fixed size
  * data buffer. All the curves in one plot have the same size buffer.
@@ -78,14 +103,14 @@ public:
     virtual void setZMaximum(double val);
     void clearPlots();
 
-    QwtMatrixRasterData *getRasterData() { return rasterData; }
+    SpectrogramRasterData *getRasterData() { return rasterData; }
     void setSpectrogram(QwtPlotSpectrogram *val) { spectrogram = val; }
 
 private:
     void resetAxisRanges();
 
     QwtPlotSpectrogram *spectrogram;
-    QwtMatrixRasterData *rasterData;
+    SpectrogramRasterData *rasterData; // Owned by the spectrogram
 
     double samplingFrequency;
     double timeHorizon;
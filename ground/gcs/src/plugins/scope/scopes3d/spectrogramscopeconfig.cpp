@@ -277,13 +277,14 @@ void SpectrogramScopeConfig::loadConfiguration(ScopeGadgetWidget *scopeGadgetWid
     QDateTime NOW =
         QDateTime::currentDateTime(); // TODO: Upgrade this to show UAVO time and not system time
     for (uint i = 0; i < timeHorizon; i++) {
-        spectrogramData->timeDataHistory->append(NOW.toTime_t() + NOW.time().msec() / 1000.0 + i);
+        spectrogramData->timeDataHistory.append(NOW.toTime_t() + NOW.time().msec() / 1000.0 + i);
     }
 
     if (((double)windowWidth) * timeHorizon < (double)10000000.0
-            * sizeof(spectrogramData->zDataHistory->front())) { // Don't exceed 10MB for memory
+            * sizeof(double)) { // Don't exceed 10MB for memory
+        spectrogramData->zDataHistory.reserve(windowWidth * timeHorizon);
         for (uint i = 0; i < windowWidth * timeHorizon; i++) {
-            spectrogramData->zDataHistory->append(0);
+            spectrogramData->zDataHistory.append(0);
         }
     } else {
         qDebug() << "For some reason, we're trying to allocate a gigantic spectrogram. This "
@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * @file       scopetests.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief The scope Gadget, graphically plots the states of UAVObjects
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "scopeplugin.h"
+
+#include "scopes2d/scatterplotdata.h"
+
+#include "qwt/src/qwt_scale_map.h"
+
+#include <QImage>
+#include <QPainter>
+#include <QTest>
+#include <qmath.h>
+#include <memory>
+
+static const QSize canvasSize(800, 300);
+
+static QImage drawCurve(const QwtPlotCurve &curve, const QwtScaleMap &xMap,
+                        const QwtScaleMap &yMap)
+{
+    QImage image(canvasSize, QImage::Format_RGB32);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    curve.draw(&painter, xMap, yMap, QRectF(QPointF(0, 0), canvasSize));
+
+    return image;
+}
+
+/* Count the columns where the two drawings disagree by more than a pixel
+ * about which rows the curve covers. */
+static int differingColumns(const QImage &a, const QImage &b)
+{
+    int differing = 0;
+
+    for (int x = 0; x < canvasSize.width(); x++) {
+        int topA = -1, bottomA = -1, topB = -1, bottomB = -1;
+
+        for (int y = 0; y < canvasSize.height(); y++) {
+            if (a.pixel(x, y) != qRgb(255, 255, 255)) {
+                if (topA < 0)
+                    topA = y;
+                bottomA = y;
+            }
+            if (b.pixel(x, y) != qRgb(255, 255, 255)) {
+                if (topB < 0)
+                    topB = y;
+                bottomB = y;
+            }
+        }
+
+        if ((topA < 0) != (topB < 0) || qAbs(topA - topB) > 1 || qAbs(bottomA - bottomB) > 1)
+            differing++;
+    }
+
+    return differing;
+}
+
+/* Draw a long history decimated and at full resolution, and check they look
+ * the same while the decimated curve hands Qwt a few points per column. */
+void ScopePlugin::testDecimatedCurve()
+{
+    CircularBuffer<double> xData;
+    CircularBuffer<double> yData;
+    MinMaxPyramid yExtremes(yData);
+
+    qsrand(42);
+    double t = 0;
+
+    auto appendSamples = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            t += 0.0005 + 0.001 * qrand() / RAND_MAX;
+
+            double y = 10 * qSin(t) + 2.0 * qrand() / RAND_MAX;
+            if (qrand() % 5000 == 0)
+                y += 25;
+
+            xData.append(t);
+            yData.append(y);
+            yExtremes.append();
+        }
+    };
+
+    auto removeSamples = [&](int count) {
+        xData.removeFirst(count);
+        yData.removeFirst(count);
+        yExtremes.removeFirst(count);
+    };
+
+    auto fullCurve = [&](bool indexX) {
+        QVector<double> x, y;
+        for (int i = 0; i < yData.size(); i++) {
+            x.append(indexX ? i : xData.at(i));
+            y.append(yData.at(i));
+        }
+
+        QwtPlotCurve *curve = new QwtPlotCurve();
+        curve->setSamples(x, y);
+        return curve;
+    };
+
+    ScatterplotCurve timeCurve(QStringLiteral("time"));
+    ScatterplotSeriesData *timeSeries = new ScatterplotSeriesData(&xData, yData, yExtremes);
+    timeCurve.setData(timeSeries);
+
+    ScatterplotCurve indexCurve(QStringLiteral("index"));
+    ScatterplotSeriesData *indexSeries = new ScatterplotSeriesData(nullptr, yData, yExtremes);
+    indexCurve.setData(indexSeries);
+
+    QwtScaleMap xMap, yMap;
+    xMap.setPaintInterval(0, canvasSize.width());
+    yMap.setScaleInterval(-15, 40);
+    yMap.setPaintInterval(canvasSize.height(), 0);
+
+    appendSamples(200000);
+
+    // Hundreds of samples per column
+    xMap.setScaleInterval(t - 150, t);
+    std::unique_ptr<QwtPlotCurve> full(fullCurve(false));
+    QCOMPARE(differingColumns(drawCurve(timeCurve, xMap, yMap), drawCurve(*full, xMap, yMap)), 0);
+    QVERIFY(timeSeries->size() <= size_t(4 * canvasSize.width() + 8));
+
+    // Drop the oldest samples so the buffers wrap and the pyramid loses buckets
+    removeSamples(120000);
+    appendSamples(50000);
+    timeSeries->dataChanged();
+    indexSeries->dataChanged();
+
+    xMap.setScaleInterval(xData.first() - 1, t + 1);
+    full.reset(fullCurve(false));
+    QCOMPARE(differingColumns(drawCurve(timeCurve, xMap, yMap), drawCurve(*full, xMap, yMap)), 0);
+    QCOMPARE(timeSeries->boundingRect(), full->boundingRect());
+
+    // Zoomed in to a few samples per column, with samples either side off the canvas
+    xMap.setScaleInterval(t - 3, t - 1);
+    QCOMPARE(differingColumns(drawCurve(timeCurve, xMap, yMap), drawCurve(*full, xMap, yMap)), 0);
+
+    // Samples plotted at their index
+    xMap.setScaleInterval(0, yData.size() - 1);
+    full.reset(fullCurve(true));
+    QCOMPARE(differingColumns(drawCurve(indexCurve, xMap, yMap), drawCurve(*full, xMap, yMap)), 0);
+    QVERIFY(indexSeries->size() <= size_t(4 * canvasSize.width() + 8));
+}
+
+/**
+ * @}
+ * @}
+ */
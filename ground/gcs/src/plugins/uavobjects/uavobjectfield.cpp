@@ -1008,7 +1008,39 @@ void UAVObjectField::setValue(const QVariant &value, int index)
 
 double UAVObjectField::getDouble(int index) const
 {
-    return getValue(index).toDouble();
+    ElementHandle handle = getElementHandle(index);
+
+    return handle.isValid() ? handle.toDouble() : 0;
+}
+
+/**
+ * @brief Resolve an element for repeated reads
+ * @param index Element index
+ * @return handle, invalid if the index is out of range
+ */
+UAVObjectField::ElementHandle UAVObjectField::getElementHandle(int index) const
+{
+    ElementHandle handle;
+
+    if (index < 0 || index >= numElements || !data)
+        return handle;
+
+    handle.field = this;
+    handle.d = &data[offset + elementSize * static_cast<unsigned>(index)];
+    handle.type = type;
+    handle.index = index;
+
+    return handle;
+}
+
+/**
+ * @brief Resolve an element by name for repeated reads
+ * @param elementName Element name
+ * @return handle, invalid if there is no such element
+ */
+UAVObjectField::ElementHandle UAVObjectField::getElementHandle(const QString &elementName) const
+{
+    return getElementHandle(getElementIndex(elementName));
 }
 
 void UAVObjectField::setDouble(double value, int index)
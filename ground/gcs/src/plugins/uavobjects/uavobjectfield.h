@@ -64,6 +64,57 @@ public:
         int board;
     };
 
+    /**
+     * @brief A pre-resolved reference to one element of a field, for code
+     * that reads the same element many times (e.g. plotting). Reading a
+     * numeric element is a type switch and a load; no name lookup or
+     * QVariant is involved. Valid for the lifetime of the field.
+     */
+    class ElementHandle
+    {
+    public:
+        ElementHandle()
+            : field(nullptr)
+            , d(nullptr)
+            , type(INT8)
+            , index(0)
+        {
+        }
+
+        bool isValid() const { return field != nullptr; }
+
+        double toDouble() const
+        {
+            switch (type) {
+            case INT8:
+                return *reinterpret_cast<const qint8 *>(d);
+            case INT16:
+                return *reinterpret_cast<const qint16 *>(d);
+            case INT32:
+                return *reinterpret_cast<const qint32 *>(d);
+            case UINT8:
+                return *reinterpret_cast<const quint8 *>(d);
+            case UINT16:
+                return *reinterpret_cast<const quint16 *>(d);
+            case UINT32:
+                return *reinterpret_cast<const quint32 *>(d);
+            case FLOAT32:
+                return *reinterpret_cast<const float *>(d);
+            default:
+                // Enums, bitfields and strings keep their QVariant conversion
+                return field->getValue(index).toDouble();
+            }
+        }
+
+    private:
+        friend class UAVObjectField;
+
+        const UAVObjectField *field;
+        const quint8 *d;
+        FieldType type;
+        int index;
+    };
+
     UAVObjectField(const QString &name, const QString &units, FieldType type, int numElements,
                    const QStringList &options, const QList<int> &indices,
                    const QString &limits = QString(), const QString &description = QString(),
@@ -98,6 +149,8 @@ public:
     bool checkValue(const QVariant &data, int index = 0) const;
     void setValue(const QVariant &data, int index = 0);
     double getDouble(int index = 0) const;
+    ElementHandle getElementHandle(int index = 0) const;
+    ElementHandle getElementHandle(const QString &elementName) const;
     void setDouble(double value, int index = 0);
     size_t getNumBytes() const;
     bool isNumeric() const;
@@ -49,6 +49,9 @@ public:
 private Q_SLOTS:
     void testEnumFields();
     void testIntFields();
+    void testElementHandles();
+    void benchmarkGetValue();
+    void benchmarkElementHandle();
 #endif
 };
 
@@ -32,6 +32,7 @@
 #include "uavdataobject.h"
 #include "uavobjectfield.h"
 
+#include <QRegExp>
 #include <QTest>
 #include <memory>
 
@@ -64,6 +65,69 @@ void UAVObjectsPlugin::testIntFields()
     QVERIFY(field->isDefaultValue(1));
 }
 
+void UAVObjectsPlugin::testElementHandles()
+{
+    std::unique_ptr<UAVObjectField> field(new UAVObjectField("TestFloat", "photons", UAVObjectField::FLOAT32,
+                                    QStringList({"X", "Y", "Z"}), {}, {}));
+    float testData[3] = { 1.5f, -2.25f, 3.0f };
+
+    field->initialize(reinterpret_cast<quint8 *>(testData), 0, nullptr);
+
+    auto y = field->getElementHandle(QStringLiteral("Y"));
+    QVERIFY(y.isValid());
+    QCOMPARE(y.toDouble(), -2.25);
+
+    // Handles read through to the current data
+    testData[1] = 7.0f;
+    QCOMPARE(y.toDouble(), 7.0);
+    QCOMPARE(field->getDouble(1), 7.0);
+
+    QVERIFY(!field->getElementHandle(QStringLiteral("W")).isValid());
+    QVERIFY(!field->getElementHandle(3).isValid());
+    QCOMPARE(field->getDouble(3), 0.0);
+}
+
+/* Per-sample cost of reading a named element the way the scope used to,
+ * versus through a pre-resolved handle. */
+void UAVObjectsPlugin::benchmarkGetValue()
+{
+    std::unique_ptr<UAVObjectField> field(new UAVObjectField("TestFloat", "photons", UAVObjectField::FLOAT32,
+                                    QStringList({"X", "Y", "Z"}), {}, {}));
+    float testData[3] = { 1.5f, -2.25f, 3.0f };
+    const QString name = QStringLiteral("Z");
+    double sum = 0;
+
+    field->initialize(reinterpret_cast<quint8 *>(testData), 0, nullptr);
+
+    QBENCHMARK {
+        for (int i = 0; i < 10000; i++) {
+            int idx = field->getElementNames().indexOf(
+                QRegExp(name, Qt::CaseSensitive, QRegExp::FixedString));
+            sum += field->getValue(idx).toDouble();
+        }
+    }
+
+    QVERIFY(sum != 0);
+}
+
+void UAVObjectsPlugin::benchmarkElementHandle()
+{
+    std::unique_ptr<UAVObjectField> field(new UAVObjectField("TestFloat", "photons", UAVObjectField::FLOAT32,
+                                    QStringList({"X", "Y", "Z"}), {}, {}));
+    float testData[3] = { 1.5f, -2.25f, 3.0f };
+    double sum = 0;
+
+    field->initialize(reinterpret_cast<quint8 *>(testData), 0, nullptr);
+    auto z = field->getElementHandle(QStringLiteral("Z"));
+
+    QBENCHMARK {
+        for (int i = 0; i < 10000; i++)
+            sum += z.toDouble();
+    }
+
+    QVERIFY(sum != 0);
+}
+
 /**
  * @}
  * @}
@@ -34,6 +34,7 @@
 
 #include "uavtalk.h"
 #include <QtEndian>
+#include <QVector>
 #include <QDebug>
 #include <extensionsystem/pluginmanager.h>
 #include <coreplugin/generalsettings.h>
@@ -66,6 +67,27 @@ const quint8 UAVTalk::crc_table[256] = {
     0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
 };
 
+namespace {
+/* table[k][i] is the CRC of byte i followed by k zero bytes.  The CRC
+ * register is a single byte, so it only mixes with the first byte of a block
+ * and the rest of the block can be folded in with independent lookups. */
+struct CrcSlices
+{
+    static const int COUNT = 8;
+
+    explicit CrcSlices(const quint8 *crcTable)
+    {
+        memcpy(table[0], crcTable, sizeof(table[0]));
+
+        for (int k = 1; k < COUNT; k++)
+            for (int i = 0; i < 256; i++)
+                table[k][i] = crcTable[table[k - 1][i]];
+    }
+
+    quint8 table[COUNT][256];
+};
+}
+
 /**
  * Constructor
  */
@@ -76,11 +98,13 @@ UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr, bool canBlock)
     this->objMngr = objMngr;
     this->canBlock = canBlock;
 
-    startOffset = 0;
-    filledBytes = 0;
-
     memset(&stats, 0, sizeof(ComStats));
 
+    decoder = new UAVTalkDecoder(objMngr, [this]() {
+        QMetaObject::invokeMethod(this, "processReceivedFrames", Qt::QueuedConnection);
+    });
+    decoder->start();
+
     connect(io.data(), &QIODevice::readyRead, this, &UAVTalk::processInputStream);
 }
 
@@ -89,6 +113,9 @@ UAVTalk::~UAVTalk()
     // According to Qt, it is not necessary to disconnect upon
     // object deletion.
     // disconnect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
+
+    // Stops the decoder thread before anything it calls back into goes away
+    delete decoder;
 }
 
 /**
@@ -98,38 +125,71 @@ UAVTalk::ComStats UAVTalk::getStats()
 {
     UAVTalk::ComStats ret = stats;
 
+    ret.rxErrors += decoder->takeErrors();
+
     memset(&stats, 0, sizeof(ComStats));
 
     return ret;
 }
 
 /**
- * Called each time there are data in the input buffer
+ * Called each time there are data in the input buffer. The data is handed to
+ * the decoder thread; the frames it finds come back in processReceivedFrames().
  */
 void UAVTalk::processInputStream()
 {
     while (io && io->isReadable()) {
-        if (startOffset > (sizeof(rxBuffer) - MAX_PACKET_LENGTH)) {
-            /* If we're not sure there's room for a frame, shift things left in
-             * the buffer so that we can do a bigger read.
-             */
-            memmove(rxBuffer, rxBuffer + startOffset, filledBytes - startOffset);
-
-            filledBytes -= startOffset;
-            startOffset = 0;
+        QByteArray bytes = io->readAll();
+
+        if (bytes.isEmpty()) {
+            return;
         }
 
-        int bytes = io->read(reinterpret_cast<char *>(rxBuffer + filledBytes),
-                             sizeof(rxBuffer) - filledBytes);
+        stats.rxBytes += bytes.size();
+        decoder->feed(bytes);
+    }
+}
 
-        if (bytes <= 0) {
-            return;
+/**
+ * Apply the frames the decoder has checked so far.
+ *
+ * When updates arrive faster than they are applied, only the newest
+ * update of each object instance in the backlog is unpacked, along with any
+ * deltas that follow it. Everything else (acks, nacks, requests, file data)
+ * is handled in order.
+ */
+void UAVTalk::processReceivedFrames()
+{
+    // Frames decoded from here on get a new notification
+    decoder->clearNotify();
+
+    const quint32 end = decoder->endFrame();
+
+    latestFrames.clear();
+    for (quint32 i = decoder->firstFrame(); i != end; i++) {
+        const UAVTalkDecoder::Frame &frame = decoder->frame(i);
+
+        if (frame.type == TYPE_OBJ && frame.knownObject) {
+            latestFrames.insert((quint64(frame.objId) << 16) | frame.instId, i);
         }
+    }
 
-        filledBytes += bytes;
-        stats.rxBytes += bytes;
+    /* Slots run from here can re-enter the event loop, and with it this
+     * function, so the position is re-read from the decoder each time.
+     */
+    for (quint32 i = decoder->firstFrame(); qint32(end - i) > 0; i = decoder->firstFrame()) {
+        UAVTalkDecoder::Frame frame = decoder->frame(i);
+        decoder->releaseFrame(i);
+
+        if ((frame.type == TYPE_OBJ || frame.type == TYPE_DELTA) && frame.knownObject
+            && qint32(latestFrames.value((quint64(frame.objId) << 16) | frame.instId, i) - i) > 0) {
+            // Superseded by a newer whole update later in the batch
+            stats.rxObjectBytes += frame.length;
+            stats.rxObjects++;
+            continue;
+        }
 
-        while (processInput());
+        processFrame(frame);
     }
 }
 
@@ -207,143 +267,39 @@ bool UAVTalk::receiveFileChunk(quint32 fileId, quint8 *data, quint32 length)
 }
 
 /**
- * Process a frame from input, if available.
- * \return False if there was insufficient data for a frame, true if trying
- * again is worthwhile.
+ * Process a frame that passed the decoder's framing and size checks.
+ * \param frame The frame; its data may be handed out by signals
  */
-bool UAVTalk::processInput()
+void UAVTalk::processFrame(UAVTalkDecoder::Frame &frame)
 {
-    unsigned int bytesAvail = filledBytes - startOffset;
-
-    if (bytesAvail < sizeof(UAVTalkHeader)) {
-        return false;
+    if (frame.type == TYPE_FILEDATA) {
+        receiveFileChunk(frame.objId, frame.data, frame.length);
+        return;
     }
 
-    UAVTalkHeader *hdr = reinterpret_cast<UAVTalkHeader *>(rxBuffer + startOffset);
-
-    /* Basic framing checks.  If these fail, skip forward one byte and retry
-     * to capture stream sync.
-     */
-    if (hdr->sync != SYNC_VAL) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    if ((hdr->type & VER_MASK) != TYPE_VER) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    if (hdr->size < sizeof(UAVTalkHeader)) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    /* OK, let's ensure we have enough bytes for the whole frame.
-     * Size doesn't include CRC, so add one.
-     */
-
-    if ((hdr->size + 1u) > bytesAvail) {
-        return false;
-    }
-
-    quint8 ourCrc = updateCRC(0, rxBuffer + startOffset, hdr->size);
-    quint8 *theirCrc = rxBuffer + startOffset + hdr->size;
-
-    if (ourCrc != *theirCrc) {
-        /* Since we can't trust hdr->size for sure, we should just skip
-         * forward one byte.
-         */
-
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    quint8 *payload = rxBuffer + startOffset + sizeof(*hdr);
-    unsigned int payloadBytes = hdr->size - sizeof(*hdr);
-
-    /* At this point, we'll advance startOffset for the entire length of
-     * frame, and not touch startOffset again this function!
-     */
-    startOffset += hdr->size + 1;
-
-    /* OK, we have a complete frame as encoded on the wire.  Time to do things
-     * with it.
-     */
-    quint8 rxType = hdr->type & TYPE_MASK;
-
-    quint32 rxObjId = qFromLittleEndian(hdr->objId);
-
-    if (rxType == TYPE_FILEDATA) {
-        return receiveFileChunk(rxObjId, payload, payloadBytes);
-    }
-
-    UAVObject *rxObj = objMngr->getObject(rxObjId);
-
-    if (rxObj == nullptr) {
+    if (!frame.knownObject || objMngr->getObject(frame.objId) == nullptr) {
         stats.rxErrors++;
         UAVTALK_QXTLOG_DEBUG("UAVTalk: unknown object");
 
-        if (rxType == TYPE_OBJ_REQ || rxType == TYPE_OBJ_ACK) {
+        if (frame.type == TYPE_OBJ_REQ || frame.type == TYPE_OBJ_ACK) {
             UAVTALK_QXTLOG_DEBUG("UAVTalk: (transmitting NACK)");
-            transmitNack(rxObjId);
+            transmitNack(frame.objId);
         }
 
-        return true;
-    }
-
-    quint16 rxInstId = 0;
-
-    if (!rxObj->isSingleInstance()) {
-        if ((rxType != TYPE_NACK) || (payloadBytes == 2)) {
-            /* Receiving the instid is optional on an nack-- can just mean
-             * "nack everything" */
-            rxInstId = *(payload++);
-            rxInstId |= *(payload++) << 8;
-
-            payloadBytes -= 2;
-        }
+        return;
     }
 
     /* XXX timestamps */
 
-    // Check data length
-    if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
-        if (payloadBytes != 0) {
-            UAVTALK_QXTLOG_DEBUG("UAVTalk: Unexpected data in req/ack/nack");
-            stats.rxErrors++;
-
-            return true;
-        }
-    } else {
-        if (payloadBytes != rxObj->getNumBytes()) {
-            UAVTALK_QXTLOG_DEBUG("UAVTalk: Unexpected payload size for obj");
-            stats.rxErrors++;
-
-            return true;
-        }
-    }
-
-    receiveObject(rxType, rxObjId, rxInstId, payload, payloadBytes);
-    stats.rxObjectBytes += payloadBytes;
+    receiveObject(frame.type, frame.objId, frame.instId, frame.data, frame.length);
+    stats.rxObjectBytes += frame.length;
     stats.rxObjects++;
-
-    // Done
-    return true;
 }
 
 /**
  * Receive an object. This function process objects received through the telemetry stream.
  * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK,
- * TYPE_NACK)
+ * TYPE_NACK, TYPE_DELTA)
  * \param[in] obj Handle of the received object
  * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
  * \param[in] data Data buffer
@@ -377,6 +333,27 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             error = true;
         }
         break;
+    case TYPE_DELTA: // We have received the parts of an object that changed
+        if (!allInstances) {
+            obj = objMngr->getObject(objId, instId);
+            if (obj == nullptr || !applyDelta(obj, data)) {
+                // Our copy isn't the one the delta is against; start over
+                UAVTALK_QXTLOG_DEBUG(QString("[uavtalk.cpp  ] Could not apply delta for OBJID:%0 "
+                                             "INSTID:%1, requesting it")
+                                         .arg(QString(QString("0x") + QString::number(objId, 16).toUpper()))
+                                         .arg(instId));
+                if (obj != nullptr) {
+                    sendObjectRequest(obj, false);
+                } else if ((obj = objMngr->getObject(objId)) != nullptr) {
+                    sendObjectRequest(obj, true);
+                }
+                stats.rxErrors++;
+                error = true;
+            }
+        } else {
+            error = true;
+        }
+        break;
     case TYPE_OBJ_ACK: // We have received an object and are asked for an ACK
         // All instances, not allowed for OBJ_ACK messages
         if (!allInstances) {
@@ -502,6 +479,89 @@ UAVObject *UAVTalk::updateObject(quint32 objId, quint16 instId, quint8 *data)
     }
 }
 
+/**
+ * Apply a delta frame to an object. The frame starts with the CRC-32 of the
+ * object data it was taken against (little endian), then a bitmap with one bit per
+ * DELTA_BLOCK bytes of data (bit 0 of the first byte is the first block),
+ * then the new data of each block whose bit is set. The decoder has already
+ * checked the length against the bitmap.
+ * \param[in] obj Object instance to update
+ * \param[in] delta The delta payload
+ * \return False if our copy of the object is not the one the delta was
+ * taken against
+ */
+bool UAVTalk::applyDelta(UAVObject *obj, const quint8 *delta)
+{
+    const quint32 numBytes = obj->getNumBytes();
+
+    QVector<quint8> data(numBytes);
+    obj->pack(data.data());
+
+    if (qFromLittleEndian<quint32>(delta) != deltaCRC(data.constData(), numBytes)) {
+        return false;
+    }
+
+    const quint8 *map = delta + DELTA_CHECK_LENGTH;
+    const quint8 *changed = map + deltaMapLength(numBytes);
+
+    for (quint32 offs = 0, block = 0; offs < numBytes; offs += DELTA_BLOCK, block++) {
+        if (map[block / 8] & (1 << (block % 8))) {
+            quint32 n = qMin(quint32(DELTA_BLOCK), numBytes - offs);
+
+            memcpy(data.data() + offs, changed, n);
+            changed += n;
+        }
+    }
+
+    obj->unpack(data.constData());
+
+    return true;
+}
+
+/**
+ * Length of the changed block bitmap in a delta frame for an object.
+ */
+quint32 UAVTalk::deltaMapLength(quint32 numBytes)
+{
+    return (numBytes + DELTA_BLOCK * 8 - 1) / (DELTA_BLOCK * 8);
+}
+
+/**
+ * CRC-32 of the object data a delta frame was taken against, the same as
+ * PIOS_CRC32_updateCRC() from 0 on the flight side (polynomial 0x04C11DB7,
+ * not reflected, no final xor). Objects are small, so bitwise will do.
+ */
+quint32 UAVTalk::deltaCRC(const quint8 *data, quint32 length)
+{
+    quint32 crc = 0;
+
+    while (length-- > 0) {
+        crc ^= quint32(*data++) << 24;
+
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+
+    return crc;
+}
+
+/**
+ * Length of the delta payload the bitmap describes, including the CRC and
+ * the bitmap itself.
+ */
+quint32 UAVTalk::deltaLength(const quint8 *map, quint32 numBytes)
+{
+    quint32 length = DELTA_CHECK_LENGTH + deltaMapLength(numBytes);
+
+    for (quint32 offs = 0, block = 0; offs < numBytes; offs += DELTA_BLOCK, block++) {
+        if (map[block / 8] & (1 << (block % 8))) {
+            length += qMin(quint32(DELTA_BLOCK), numBytes - offs);
+        }
+    }
+
+    return length;
+}
+
 /**
  * Send an object through the telemetry link.
  * \param[in] obj Object to send
@@ -688,7 +748,7 @@ bool UAVTalk::transmitSingleObject(UAVObject *obj, quint8 type, bool allInstance
  *    ReflectIn    = False
  *    XorOut       = 0x00
  *    ReflectOut   = False
- *    Algorithm    = table-driven
+ *    Algorithm    = table-driven, sliced by 8
  *
  * \param crc      The current crc value.
  * \param data     Pointer to a buffer of \a data_len bytes.
@@ -698,7 +758,22 @@ bool UAVTalk::transmitSingleObject(UAVObject *obj, quint8 type, bool allInstance
 
 quint8 UAVTalk::updateCRC(quint8 crc, const quint8 *data, qint32 length)
 {
-    while (length--)
-        crc = crc_table[crc ^ *data++];
+    static const CrcSlices slices(crc_table);
+    const quint8(*t)[256] = slices.table;
+
+    // Eight bytes at a time, least significant byte first in the block
+    while (length >= CrcSlices::COUNT) {
+        quint64 block = qFromLittleEndian<quint64>(data);
+
+        crc = t[7][(crc ^ block) & 0xff] ^ t[6][(block >> 8) & 0xff] ^ t[5][(block >> 16) & 0xff]
+            ^ t[4][(block >> 24) & 0xff] ^ t[3][(block >> 32) & 0xff] ^ t[2][(block >> 40) & 0xff]
+            ^ t[1][(block >> 48) & 0xff] ^ t[0][block >> 56];
+
+        data += CrcSlices::COUNT;
+        length -= CrcSlices::COUNT;
+    }
+
+    while (length-- > 0)
+        crc = t[0][crc ^ *data++];
     return crc;
 }
@@ -41,6 +41,7 @@
 #include <QSemaphore>
 #include "uavobjects/uavobjectmanager.h"
 #include "uavtalk_global.h"
+#include "uavtalkdecoder.h"
 #include <QtNetwork/QUdpSocket>
 
 class UAVTALK_EXPORT UAVTalk : public QObject
@@ -68,8 +69,6 @@ public:
 
     ComStats getStats();
 
-    bool processInput();
-
 signals:
     // The only signals we send to the upper level are when we
     // either receive an ACK or a NACK for a request.
@@ -82,8 +81,11 @@ signals:
 
 private slots:
     void processInputStream(void);
+    void processReceivedFrames(void);
 
 protected:
+    friend class UAVTalkDecoder;
+
     // Constants
     static const int VER_MASK = 0x70;
     static const int TYPE_MASK = 0x0f;
@@ -94,6 +96,8 @@ protected:
     static const int TYPE_OBJ_ACK = 0x02;
     static const int TYPE_ACK = 0x03;
     static const int TYPE_NACK = 0x04;
+    static const int TYPE_MULTI = 0x05; // Several object updates, see UAVTalkDecoder
+    static const int TYPE_DELTA = 0x06; // Changed parts of an object, see applyDelta()
     static const int TYPE_FILEREQ = 0x08;
     static const int TYPE_FILEDATA = 0x09;
 
@@ -109,6 +113,11 @@ protected:
     static const quint16 ALL_INSTANCES = 0xFFFF;
     static const quint16 OBJID_NOTFOUND = 0x0000;
 
+    // Bytes of object data covered by each bit of a delta frame's bitmap
+    static const quint32 DELTA_BLOCK = 4;
+    // Bytes of the CRC-32 of the copy a delta frame was taken against
+    static const quint32 DELTA_CHECK_LENGTH = 4;
+
     static const int TX_BACKLOG_SIZE = 2 * 1024;
     static const quint8 crc_table[256];
 
@@ -131,33 +140,40 @@ protected:
     static const quint8 FILEDATA_FLAG_LAST = 0x02;
 #pragma pack(pop)
 
+#ifdef WITH_TESTS
+    friend class UAVTalkPlugin;
+#endif
+
     // Variables
     QPointer<QIODevice> io;
     UAVObjectManager *objMngr;
     bool canBlock;
 
-    // This is a tradeoff between the frequency of the need to
-    // compact/copy left and buffer size.
-    quint8 rxBuffer[MAX_PACKET_LENGTH * 12];
     quint8 txBuffer[MAX_PACKET_LENGTH];
 
-    // Variables used by the receive state machine
+    // Frames and checks received data on its own thread
+    UAVTalkDecoder *decoder;
 
-    quint32 startOffset;
-    quint32 filledBytes;
+    // Latest frame of each object instance in a batch, so stale updates are skipped
+    QHash<quint64, quint32> latestFrames;
 
     ComStats stats;
 
     // Methods
     bool objectTransaction(UAVObject *obj, quint8 type, bool allInstances);
+    void processFrame(UAVTalkDecoder::Frame &frame);
     bool receiveObject(quint8 type, quint32 objId, quint16 instId,
             quint8 *data, quint32 length);
     bool receiveFileChunk(quint32 fileId, quint8 *data, quint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
+    bool applyDelta(UAVObject *obj, const quint8 *delta);
+    static quint32 deltaMapLength(quint32 numBytes);
+    static quint32 deltaLength(const quint8 *map, quint32 numBytes);
+    static quint32 deltaCRC(const quint8 *data, quint32 length);
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject *obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+    static quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
     bool transmitFrame(quint32 length, bool incrTxObj = true);
 };
 
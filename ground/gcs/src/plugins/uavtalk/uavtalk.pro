@@ -12,6 +12,7 @@ include(../../plugins/coreplugin/coreplugin.pri)
 include(../../plugins/uavobjects/uavobjects.pri)
 
 HEADERS += uavtalk.h \
+    uavtalkdecoder.h \
     uavtalkplugin.h \
     telemetrymonitor.h \
     telemetrymanager.h \
@@ -19,9 +20,14 @@ HEADERS += uavtalk.h \
     telemetry.h
 
 SOURCES += uavtalk.cpp \
+    uavtalkdecoder.cpp \
     uavtalkplugin.cpp \
     telemetrymonitor.cpp \
     telemetrymanager.cpp \
     telemetry.cpp
 
+contains(DEFINES, WITH_TESTS) {
+    SOURCES += uavtalktests.cpp
+}
+
 OTHER_FILES += UAVTalk.pluginspec
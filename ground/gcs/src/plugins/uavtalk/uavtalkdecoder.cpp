@@ -0,0 +1,366 @@
+/**
+ ******************************************************************************
+ * @file       uavtalkdecoder.cpp
+ *
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ *
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Frames and checks the received UAVTalk stream off the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "uavtalkdecoder.h"
+#include "uavtalk.h"
+
+#include <QtEndian>
+
+#define SYNC_VAL 0x3C
+
+/**
+ * Constructor
+ * \param[in] objMngr Object manager, whose objects must all be registered already
+ * \param[in] framesReady Called from the decoder thread when frames are waiting
+ */
+UAVTalkDecoder::UAVTalkDecoder(UAVObjectManager *objMngr, std::function<void()> framesReady)
+    : framesReady(framesReady)
+    , stopping(0)
+    , startOffset(0)
+    , filledBytes(0)
+    , published(false)
+    , frames(new Frame[RING_SIZE])
+    , head(0)
+    , tail(0)
+    , notifyPending(0)
+    , rxErrors(0)
+{
+    // Instances created later share the layout of the first, so a snapshot
+    // taken now can be read by the decoder thread without locking
+    foreach (QVector<UAVObject *> instances, objMngr->getObjectsVector()) {
+        UAVObject *obj = instances.first();
+
+        ObjectInfo info = { obj->getNumBytes(), obj->isSingleInstance() };
+        objects.insert(obj->getObjID(), info);
+    }
+}
+
+UAVTalkDecoder::~UAVTalkDecoder()
+{
+    stop();
+    wait();
+
+    delete[] frames;
+}
+
+/**
+ * Queue received bytes for decoding
+ */
+void UAVTalkDecoder::feed(const QByteArray &bytes)
+{
+    QMutexLocker locker(&inputLock);
+
+    input.append(bytes);
+    inputReady.wakeOne();
+}
+
+void UAVTalkDecoder::stop()
+{
+    QMutexLocker locker(&inputLock);
+
+    stopping.storeRelease(1);
+    inputReady.wakeOne();
+}
+
+void UAVTalkDecoder::run()
+{
+    QByteArray pending;
+
+    while (true) {
+        {
+            QMutexLocker locker(&inputLock);
+
+            while (input.isEmpty() && !stopping.loadAcquire())
+                inputReady.wait(&inputLock);
+
+            if (stopping.loadAcquire())
+                return;
+
+            pending.swap(input);
+        }
+
+        int consumed = 0;
+
+        while (consumed < pending.size()) {
+            if (startOffset > (sizeof(rxBuffer) - MAX_FRAME_DATA)) {
+                /* If we're not sure there's room for a frame, shift things left in
+                 * the buffer so that we can do a bigger copy.
+                 */
+                memmove(rxBuffer, rxBuffer + startOffset, filledBytes - startOffset);
+
+                filledBytes -= startOffset;
+                startOffset = 0;
+            }
+
+            int bytes = qMin<int>(pending.size() - consumed, sizeof(rxBuffer) - filledBytes);
+
+            memcpy(rxBuffer + filledBytes, pending.constData() + consumed, bytes);
+            filledBytes += bytes;
+            consumed += bytes;
+
+            while (decodeFrame())
+                ;
+
+            if (stopping.loadAcquire())
+                return;
+        }
+
+        pending.clear();
+
+        // Everything received so far is decoded; let the consumer at it
+        if (published) {
+            notify();
+            published = false;
+        }
+    }
+}
+
+/**
+ * Decode a frame from the buffered input, if available.
+ * \return False if there was insufficient data for a frame, true if trying
+ * again is worthwhile.
+ */
+bool UAVTalkDecoder::decodeFrame()
+{
+    unsigned int bytesAvail = filledBytes - startOffset;
+
+    if (bytesAvail < sizeof(UAVTalk::UAVTalkHeader)) {
+        return false;
+    }
+
+    UAVTalk::UAVTalkHeader *hdr =
+        reinterpret_cast<UAVTalk::UAVTalkHeader *>(rxBuffer + startOffset);
+
+    /* Basic framing checks.  If these fail, skip forward one byte and retry
+     * to capture stream sync.
+     */
+    if (hdr->sync != SYNC_VAL || (hdr->type & UAVTalk::VER_MASK) != UAVTalk::TYPE_VER
+        || hdr->size < sizeof(UAVTalk::UAVTalkHeader)) {
+        startOffset++;
+        rxErrors++;
+
+        return true;
+    }
+
+    /* OK, let's ensure we have enough bytes for the whole frame.
+     * Size doesn't include CRC, so add one.
+     */
+    if ((hdr->size + 1u) > bytesAvail) {
+        return false;
+    }
+
+    quint8 ourCrc = UAVTalk::updateCRC(0, rxBuffer + startOffset, hdr->size);
+    quint8 *theirCrc = rxBuffer + startOffset + hdr->size;
+
+    if (ourCrc != *theirCrc) {
+        /* Since we can't trust hdr->size for sure, we should just skip
+         * forward one byte.
+         */
+        startOffset++;
+        rxErrors++;
+
+        return true;
+    }
+
+    quint8 *payload = rxBuffer + startOffset + sizeof(*hdr);
+    unsigned int payloadBytes = hdr->size - sizeof(*hdr);
+
+    /* At this point, we'll advance startOffset for the entire length of
+     * frame.  The frame stays in the buffer until the next decodeFrame().
+     */
+    startOffset += hdr->size + 1;
+
+    quint8 rxType = hdr->type & UAVTalk::TYPE_MASK;
+    quint32 rxObjId = qFromLittleEndian(hdr->objId);
+
+    if (rxType == UAVTalk::TYPE_FILEDATA) {
+        return publishFrame(rxType, rxObjId, 0, false, payload, payloadBytes);
+    }
+
+    if (rxType == UAVTalk::TYPE_MULTI) {
+        return decodeMultiFrame(payload, payloadBytes);
+    }
+
+    QHash<quint32, ObjectInfo>::const_iterator info = objects.constFind(rxObjId);
+
+    if (info == objects.constEnd()) {
+        // Let the consumer count the error and NACK it if needed
+        return publishFrame(rxType, rxObjId, 0, false, nullptr, 0);
+    }
+
+    quint16 rxInstId = 0;
+
+    if (!info->singleInstance) {
+        if ((rxType != UAVTalk::TYPE_NACK) || (payloadBytes == 2)) {
+            /* Receiving the instid is optional on an nack-- can just mean
+             * "nack everything" */
+            if (payloadBytes < 2) {
+                rxErrors++;
+                return true;
+            }
+
+            rxInstId = *(payload++);
+            rxInstId |= *(payload++) << 8;
+
+            payloadBytes -= 2;
+        }
+    }
+
+    // Check data length
+    if (rxType == UAVTalk::TYPE_OBJ_REQ || rxType == UAVTalk::TYPE_ACK
+        || rxType == UAVTalk::TYPE_NACK) {
+        if (payloadBytes != 0) {
+            rxErrors++;
+            return true;
+        }
+    } else if (rxType == UAVTalk::TYPE_DELTA) {
+        if (payloadBytes < UAVTalk::DELTA_CHECK_LENGTH + UAVTalk::deltaMapLength(info->numBytes)
+            || payloadBytes
+                != UAVTalk::deltaLength(payload + UAVTalk::DELTA_CHECK_LENGTH, info->numBytes)) {
+            rxErrors++;
+            return true;
+        }
+    } else if (payloadBytes != info->numBytes) {
+        rxErrors++;
+        return true;
+    }
+
+    return publishFrame(rxType, rxObjId, rxInstId, true, payload, payloadBytes);
+}
+
+/**
+ * Split an aggregate frame into the object updates it carries.  Each record
+ * is the object ID, the length of the rest of the record, then the instance
+ * ID for multi-instance objects and the object data.
+ * \return False if the decoder is stopping
+ */
+bool UAVTalkDecoder::decodeMultiFrame(const quint8 *payload, quint32 payloadBytes)
+{
+    const quint8 *end = payload + payloadBytes;
+
+    while (payload < end) {
+        if (end - payload < MULTI_RECORD_HEADER_LENGTH) {
+            rxErrors++;
+            break;
+        }
+
+        quint32 objId = qFromLittleEndian<quint32>(payload);
+        quint32 length = payload[4];
+        payload += MULTI_RECORD_HEADER_LENGTH;
+
+        if (length > quint32(end - payload)) {
+            rxErrors++;
+            break;
+        }
+
+        const quint8 *data = payload;
+        payload += length;
+
+        QHash<quint32, ObjectInfo>::const_iterator info = objects.constFind(objId);
+
+        if (info == objects.constEnd()) {
+            // The length lets us step over it; the consumer counts the error
+            if (!publishFrame(UAVTalk::TYPE_OBJ, objId, 0, false, nullptr, 0))
+                return false;
+            continue;
+        }
+
+        quint16 instId = 0;
+
+        if (!info->singleInstance) {
+            if (length < 2) {
+                rxErrors++;
+                continue;
+            }
+
+            instId = data[0] | (data[1] << 8);
+            data += 2;
+            length -= 2;
+        }
+
+        if (length != info->numBytes) {
+            rxErrors++;
+            continue;
+        }
+
+        if (!publishFrame(UAVTalk::TYPE_OBJ, objId, instId, true, data, length))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Copy a checked frame into the ring, waiting for room if the consumer is behind.
+ * \return False if the decoder is stopping
+ */
+bool UAVTalkDecoder::publishFrame(quint8 type, quint32 objId, quint16 instId, bool knownObject,
+                                  const quint8 *data, quint32 length)
+{
+    const quint32 index = head.load();
+
+    while (index - tail.loadAcquire() >= (quint32)RING_SIZE) {
+        // Full; make sure the consumer knows, and give it time to catch up
+        notify();
+
+        if (stopping.loadAcquire())
+            return false;
+
+        QThread::usleep(500);
+    }
+
+    Frame &frame = frames[index & RING_MASK];
+
+    frame.objId = objId;
+    frame.instId = instId;
+    frame.type = type;
+    frame.knownObject = knownObject;
+    frame.length = length;
+    if (length > 0)
+        memcpy(frame.data, data, length);
+
+    head.storeRelease(index + 1);
+    published = true;
+
+    return true;
+}
+
+void UAVTalkDecoder::notify()
+{
+    // One wakeup at a time; the consumer clears this before draining the ring
+    if (notifyPending.testAndSetOrdered(0, 1))
+        framesReady();
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file       uavtalkdecoder.h
+ *
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ *
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Frames and checks the received UAVTalk stream off the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#ifndef UAVTALKDECODER_H
+#define UAVTALKDECODER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <functional>
+
+class UAVObjectManager;
+
+/**
+ * @brief The UAVTalkDecoder class Finds frames in the received byte stream,
+ * checks their CRC and header against the known objects, and queues them for
+ * the thread that owns the UAVObjects.
+ *
+ * Bytes are handed in with feed(). Checked frames are passed back through a
+ * single-producer, single-consumer ring without locking; framesReady is
+ * called from the decoder thread when the ring goes from drained to
+ * holding frames.
+ */
+class UAVTalkDecoder : public QThread
+{
+public:
+    static const int MAX_FRAME_DATA = 256;
+
+    struct Frame
+    {
+        quint32 objId;
+        quint16 instId;
+        quint8 type;
+        bool knownObject; // False if objId is not a registered object
+        quint16 length;
+        quint8 data[MAX_FRAME_DATA];
+    };
+
+    UAVTalkDecoder(UAVObjectManager *objMngr, std::function<void()> framesReady);
+    ~UAVTalkDecoder();
+
+    // Producer side, called from the thread that reads the device
+    void feed(const QByteArray &bytes);
+    void stop();
+
+    // Consumer side, called from one other thread
+    quint32 firstFrame() const { return tail.loadAcquire(); }
+    quint32 endFrame() const { return head.loadAcquire(); }
+    const Frame &frame(quint32 index) const { return frames[index & RING_MASK]; }
+    void releaseFrame(quint32 index) { tail.storeRelease(index + 1); }
+    void clearNotify() { notifyPending.storeRelease(0); }
+
+    quint32 takeErrors() { return rxErrors.fetchAndStoreRelaxed(0); }
+
+protected:
+    void run();
+
+private:
+    static const int RING_SIZE = 512;
+    static const int RING_MASK = RING_SIZE - 1;
+
+    // Object ID and length of the rest of each record in an aggregate frame
+    static const int MULTI_RECORD_HEADER_LENGTH = 5;
+
+    struct ObjectInfo
+    {
+        quint32 numBytes;
+        bool singleInstance;
+    };
+
+    bool decodeFrame();
+    bool decodeMultiFrame(const quint8 *payload, quint32 payloadBytes);
+    bool publishFrame(quint8 type, quint32 objId, quint16 instId, bool knownObject,
+                      const quint8 *data, quint32 length);
+    void notify();
+
+    // Layout of every registered object, fixed once the decoder exists
+    QHash<quint32, ObjectInfo> objects;
+
+    std::function<void()> framesReady;
+
+    QMutex inputLock;
+    QWaitCondition inputReady;
+    QByteArray input;
+    QAtomicInt stopping;
+
+    // Only touched by the decoder thread
+    quint8 rxBuffer[MAX_FRAME_DATA * 12];
+    quint32 startOffset;
+    quint32 filledBytes;
+    bool published;
+
+    Frame *frames;
+    QAtomicInteger<quint32> head;
+    QAtomicInteger<quint32> tail;
+    QAtomicInt notifyPending;
+
+    QAtomicInteger<quint32> rxErrors;
+};
+
+#endif // UAVTALKDECODER_H
+
+/**
+ * @}
+ * @}
+ */
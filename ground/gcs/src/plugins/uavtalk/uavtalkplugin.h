@@ -52,6 +52,15 @@ protected slots:
     void onDeviceConnect(QIODevice *dev);
     void onDeviceDisconnect();
 
+#ifdef WITH_TESTS
+private Q_SLOTS:
+    void testReceiveStress();
+    void testDeltaFrames();
+    void testCrc();
+    void benchmarkCrc_data();
+    void benchmarkCrc();
+#endif
+
 private:
     UAVObjectManager *objMngr;
     TelemetryManager *telMngr;
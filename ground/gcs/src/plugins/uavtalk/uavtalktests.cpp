@@ -0,0 +1,357 @@
+/**
+ ******************************************************************************
+ * @file       uavtalktests.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "uavtalkplugin.h"
+
+#include "crc8_test_vectors.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QTest>
+
+/* A device that hands out whatever the test pushes into it, like a serial
+ * port would. */
+class ReplayDevice : public QIODevice
+{
+public:
+    void push(const QByteArray &bytes)
+    {
+        buffer.append(bytes);
+        emit readyRead();
+    }
+
+    bool isSequential() const { return true; }
+    qint64 bytesAvailable() const { return buffer.size() + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        qint64 bytes = qMin<qint64>(maxSize, buffer.size());
+
+        memcpy(data, buffer.constData(), bytes);
+        buffer.remove(0, bytes);
+
+        return bytes;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize)
+    {
+        written.append(data, maxSize);
+        return maxSize;
+    }
+
+    QByteArray written;
+
+private:
+    QByteArray buffer;
+};
+
+/* Replay 20 s of a busy telemetry stream at 50x real time, and report how
+ * fast it was decoded and how long the GUI thread spent on it. Every update
+ * must be accounted for, and each object must end with its last update. */
+void UAVTalkPlugin::testReceiveStress()
+{
+    const int simSeconds = 20;
+    const int framesPerSecond = 2000;
+    const int chunksPerSecond = 100;
+    const int speedup = 50;
+
+    const int framesPerChunk = framesPerSecond / chunksPerSecond;
+    const qint64 chunkNsecs = Q_INT64_C(1000000000) / chunksPerSecond / speedup;
+
+    QVector<UAVObject *> objs;
+    foreach (QVector<UAVDataObject *> instances, objMngr->getDataObjectsVector()) {
+        UAVDataObject *obj = instances.first();
+        if (obj->isSingleInstance() && !obj->isSettings())
+            objs.append(obj);
+    }
+    QVERIFY(!objs.isEmpty());
+
+    // Record the stream the flight side would send
+    QBuffer log;
+    log.open(QIODevice::WriteOnly);
+
+    QHash<UAVObject *, QByteArray> lastData;
+    QVector<int> chunkEnds;
+    int totalFrames = 0;
+
+    {
+        UAVTalk writer(&log, objMngr, false);
+
+        qsrand(42);
+        for (int chunk = 0; chunk < simSeconds * chunksPerSecond; chunk++) {
+            for (int i = 0; i < framesPerChunk; i++) {
+                UAVObject *obj = objs.at(qrand() % objs.size());
+
+                QByteArray data(obj->getNumBytes(), 0);
+                for (int j = 0; j < data.size(); j++)
+                    data[j] = qrand();
+
+                obj->unpack(reinterpret_cast<const quint8 *>(data.constData()));
+                QVERIFY(writer.sendObject(obj, false, false));
+
+                lastData.insert(obj, data);
+                totalFrames++;
+            }
+
+            chunkEnds.append(log.data().size());
+        }
+    }
+
+    // Forget what was sent, so the replay has to restore it
+    foreach (UAVObject *obj, lastData.keys()) {
+        QByteArray zeros(obj->getNumBytes(), 0);
+        obj->unpack(reinterpret_cast<const quint8 *>(zeros.constData()));
+    }
+
+    const QByteArray stream = log.data();
+
+    ReplayDevice device;
+    device.open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+    UAVTalk talk(&device, objMngr, false);
+
+    quint32 rxObjects = 0;
+    quint32 rxErrors = 0;
+    qint64 guiNsecs = 0;
+
+    auto runGuiThread = [&]() {
+        QElapsedTimer busy;
+        busy.start();
+
+        QCoreApplication::processEvents();
+
+        guiNsecs += busy.nsecsElapsed();
+
+        UAVTalk::ComStats stats = talk.getStats();
+        rxObjects += stats.rxObjects;
+        rxErrors += stats.rxErrors;
+    };
+
+    QElapsedTimer wall;
+    wall.start();
+
+    int start = 0;
+    for (int chunk = 0; chunk < chunkEnds.size(); chunk++) {
+        // Arrive at the replay rate; the GUI thread is idle in between
+        while (wall.nsecsElapsed() < chunk * chunkNsecs)
+            QThread::usleep(50);
+
+        QElapsedTimer busy;
+        busy.start();
+        device.push(stream.mid(start, chunkEnds.at(chunk) - start));
+        guiNsecs += busy.nsecsElapsed();
+
+        start = chunkEnds.at(chunk);
+
+        runGuiThread();
+    }
+
+    while (rxObjects + rxErrors < quint32(totalFrames) && wall.elapsed() < 60000) {
+        QThread::usleep(100);
+        runGuiThread();
+    }
+
+    const qint64 wallNsecs = wall.nsecsElapsed();
+
+    qDebug() << "Replayed" << totalFrames << "frames," << stream.size() << "bytes in"
+             << wallNsecs / 1000000 << "ms:" << (stream.size() * 1e9 / wallNsecs / 1024)
+             << "KiB/s; GUI thread busy" << guiNsecs / 1000000 << "ms ("
+             << (100.0 * guiNsecs / wallNsecs) << "%)";
+
+    QCOMPARE(rxErrors, 0u);
+    QCOMPARE(rxObjects, quint32(totalFrames));
+
+    foreach (UAVObject *obj, lastData.keys()) {
+        QByteArray data(obj->getNumBytes(), 0);
+        obj->pack(reinterpret_cast<quint8 *>(data.data()));
+        QCOMPARE(data, lastData.value(obj));
+    }
+}
+
+/* Apply deltas on top of a whole update, and check that a delta taken
+ * against some other copy is dropped and the object requested instead. */
+void UAVTalkPlugin::testDeltaFrames()
+{
+    UAVObject *obj = nullptr;
+    foreach (QVector<UAVDataObject *> instances, objMngr->getDataObjectsVector()) {
+        UAVDataObject *candidate = instances.first();
+        if (candidate->isSingleInstance() && !candidate->isSettings()
+            && candidate->getNumBytes() >= 3 * UAVTalk::DELTA_BLOCK) {
+            obj = candidate;
+            break;
+        }
+    }
+    QVERIFY(obj != nullptr);
+
+    // Build a frame the way the flight side does
+    auto makeFrame = [obj](quint8 type, const QByteArray &payload) {
+        QByteArray frame;
+        const int size = UAVTalk::MIN_HEADER_LENGTH + payload.size();
+        const quint32 objId = obj->getObjID();
+
+        frame.append(char(0x3C));
+        frame.append(char(UAVTalk::TYPE_VER | type));
+        frame.append(char(size & 0xff));
+        frame.append(char(size >> 8));
+        for (int i = 0; i < 4; i++)
+            frame.append(char(objId >> (8 * i)));
+        frame.append(payload);
+        frame.append(char(UAVTalk::updateCRC(
+            0, reinterpret_cast<const quint8 *>(frame.constData()), frame.size())));
+
+        return frame;
+    };
+
+    // The base check, little endian; must match PIOS_CRC32_updateCRC()
+    QCOMPARE(UAVTalk::deltaCRC(reinterpret_cast<const quint8 *>("123456789"), 9), 0x89A1897Fu);
+
+    auto dataCrc = [](const QByteArray &data) {
+        const quint32 crc = UAVTalk::deltaCRC(
+            reinterpret_cast<const quint8 *>(data.constData()), data.size());
+        QByteArray check;
+        for (quint32 i = 0; i < UAVTalk::DELTA_CHECK_LENGTH; i++)
+            check.append(char(crc >> (8 * i)));
+        return check;
+    };
+
+    const int numBytes = obj->getNumBytes();
+    const int mapLength = UAVTalk::deltaMapLength(numBytes);
+
+    auto packed = [obj, numBytes]() {
+        QByteArray data(numBytes, 0);
+        obj->pack(reinterpret_cast<quint8 *>(data.data()));
+        return data;
+    };
+
+    ReplayDevice device;
+    device.open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+    UAVTalk talk(&device, objMngr, false);
+
+    quint32 rxErrors = 0;
+    auto errors = [&]() {
+        rxErrors += talk.getStats().rxErrors;
+        return rxErrors;
+    };
+
+    QByteArray base(numBytes, 0);
+    for (int i = 0; i < numBytes; i++)
+        base[i] = i + 1;
+
+    device.push(makeFrame(UAVTalk::TYPE_OBJ, base));
+    QTRY_COMPARE(packed(), base);
+
+    // Change the second block and the last byte
+    QByteArray changed = base;
+    changed[UAVTalk::DELTA_BLOCK] = 0x55;
+    changed[numBytes - 1] = 0x66;
+
+    const int lastBlock = (numBytes - 1) / UAVTalk::DELTA_BLOCK;
+    const int lastOffs = lastBlock * UAVTalk::DELTA_BLOCK;
+
+    const int map = UAVTalk::DELTA_CHECK_LENGTH;
+    QByteArray delta(map + mapLength, 0);
+    delta.replace(0, map, dataCrc(base));
+    delta[map] = 1 << 1;
+    delta[map + lastBlock / 8] = delta[map + lastBlock / 8] | (1 << (lastBlock % 8));
+    delta.append(changed.mid(UAVTalk::DELTA_BLOCK, UAVTalk::DELTA_BLOCK));
+    delta.append(changed.mid(lastOffs));
+
+    device.push(makeFrame(UAVTalk::TYPE_DELTA, delta));
+    QTRY_COMPARE(packed(), changed);
+    QCOMPARE(errors(), 0u);
+
+    // The same delta again is against a copy we no longer hold
+    device.written.clear();
+    device.push(makeFrame(UAVTalk::TYPE_DELTA, delta));
+    QTRY_COMPARE(errors(), 1u);
+    QCOMPARE(packed(), changed);
+    QTRY_VERIFY(device.written.contains(makeFrame(UAVTalk::TYPE_OBJ_REQ, QByteArray())));
+
+    // A payload that disagrees with its bitmap never gets past the decoder
+    QByteArray truncated = delta;
+    truncated.replace(0, map, dataCrc(changed));
+    truncated.chop(1);
+    device.push(makeFrame(UAVTalk::TYPE_DELTA, truncated));
+    QTRY_COMPARE(errors(), 2u);
+    QCOMPARE(packed(), changed);
+}
+
+/* The same vectors as the flight CRC test, started at every offset within a
+ * block so the sliced path sees every alignment and tail length. */
+void UAVTalkPlugin::testCrc()
+{
+    const QByteArray check(CRC8_TEST_CHECK_STRING);
+    QCOMPARE(UAVTalk::updateCRC(0, reinterpret_cast<const quint8 *>(check.constData()),
+                                check.size()),
+             quint8(CRC8_TEST_CHECK_VALUE));
+
+    QVector<quint8> buf(CRC8_TEST_MAX_LENGTH + 8);
+
+    for (uint i = 0; i < CRC8_TEST_NUM_VECTORS; i++) {
+        const crc8_test_vector &v = crc8_test_vectors[i];
+
+        for (int offset = 0; offset < 8; offset++) {
+            crc8_test_fill(buf.data() + offset, v.length, v.seed);
+
+            QCOMPARE(UAVTalk::updateCRC(v.crc_in, buf.constData() + offset, v.length), v.crc_out);
+        }
+    }
+}
+
+void UAVTalkPlugin::benchmarkCrc_data()
+{
+    QTest::addColumn<int>("length");
+
+    // From a bare ack to a full frame
+    QTest::newRow("8") << 8;
+    QTest::newRow("64") << 64;
+    QTest::newRow("255") << 255;
+}
+
+void UAVTalkPlugin::benchmarkCrc()
+{
+    QFETCH(int, length);
+
+    QVector<quint8> frame(length);
+    crc8_test_fill(frame.data(), length, 1);
+
+    quint8 crc = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; i++)
+            crc = UAVTalk::updateCRC(crc, frame.constData(), length);
+    }
+    Q_UNUSED(crc);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -89,6 +89,8 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser *parser, QString templat
 
     // Write the flight object initialization header
     flightInitIncludeTemplate.replace(QString("$(SIZECALCULATION)"), QString().setNum(sizeCalc));
+    flightInitIncludeTemplate.replace(QString("$(NUMOBJECTS)"),
+                                      QString().setNum(parser->getNumObjects()));
     res = writeFileIfDiffrent(flightOutputPath.absolutePath() + "/uavobjectsinit.h",
                               flightInitIncludeTemplate);
     if (!res) {
@@ -68,7 +68,8 @@ class TelemetryBase(metaclass=ABCMeta):
             ack_callback=self.gotack_callback,
             nack_callback=self.gotnack_callback,
             reqack_callback=self.reqack_callback,
-            filedata_callback=self.filedata_callback)
+            filedata_callback=self.filedata_callback,
+            delta_miss_callback=self.delta_miss_callback)
 
         self.uavtalk_generator = iter(self.uavtalk)
 
@@ -105,6 +106,10 @@ class TelemetryBase(metaclass=ABCMeta):
         if self.do_handshaking:
             self._send(uavtalk.acknowledge_object(obj))
 
+    def delta_miss_callback(self, obj, inst_id):
+        if self.do_handshaking:
+            self._send(uavtalk.request_object(obj, inst_id))
+
     def gotack_callback(self, obj):
         with self.ack_cond:
             self.acks.add(obj)
@@ -204,6 +209,9 @@ class TelemetryBase(metaclass=ABCMeta):
         if not self.do_handshaking:
             raise ValueError("Can only send on handshaking/bidir sessions")
 
+        # Later deltas from the other end will be taken against this
+        self.uavtalk.remember_sent(send_obj)
+
         # It seems OK / desirable to do these synchronously.  Can always support
         # a future async API.
         if req_ack:
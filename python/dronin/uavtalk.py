@@ -27,7 +27,7 @@ __all__ = [ "send_object", "process_stream" ]
 (SYNC_VAL) = (0x3C)
 (TYPE_MASK, TYPE_VER) = (0x70, 0x20)
 (TIMESTAMPED) = (0x80)
-(TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK, TYPE_FILEREQ, TYPE_FILEDATA, TYPE_OBJ_TS, TYPE_OBJ_ACK_TS, ) = (0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x09, 0x80, 0x82)
+(TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK, TYPE_MULTI, TYPE_DELTA, TYPE_FILEREQ, TYPE_FILEDATA, TYPE_OBJ_TS, TYPE_OBJ_ACK_TS, ) = (0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08, 0x09, 0x80, 0x82)
 (FILEDATA_EOF, FILEDATA_LAST) = (0x01, 0x02)
 
 # Serialization of header elements
@@ -39,6 +39,13 @@ timestamp_fmt = Struct("<H")
 instance_fmt = Struct("<H")
 filereq_fmt = Struct("<LH")
 fileresp_fmt = Struct("<LB")
+# Each record in an aggregate frame: objid(4) + length of the rest(1)
+multi_record_fmt = Struct("<LB")
+
+# A delta frame holds the CRC-32 of the copy it was taken against, a bitmap
+# with a bit for each block of object data, then the blocks that changed
+DELTA_BLOCK = 4
+delta_check_fmt = Struct("<L")
 
 # CRC lookup table
 crc_table = [
@@ -63,7 +70,8 @@ crc_table = [
 class process_stream:
     def __init__(self, uavo_defs, use_walltime=False, gcs_timestamps=None,
             progress_callback=None, ack_callback=None, reqack_callback=None,
-            nack_callback=None, filedata_callback=None):
+            nack_callback=None, filedata_callback=None,
+            delta_miss_callback=None):
         self.uavo_defs = uavo_defs
         self.use_walltime = use_walltime
         self.gcs_timestamps = gcs_timestamps
@@ -72,6 +80,9 @@ class process_stream:
         self.reqack_callback = reqack_callback
         self.nack_callback = nack_callback
         self.filedata_callback = filedata_callback
+        self.delta_miss_callback = delta_miss_callback
+        # Last data of each (object id, instance), for applying deltas to
+        self.delta_bases = {}
         self.buf = b''
         self.pending_pieces = []
         self.buf_offset = 0
@@ -117,6 +128,15 @@ class process_stream:
 
         return False
 
+    def remember_sent(self, obj, inst_id=0):
+        """Notes an object sent to the other end, which it will take
+        later deltas against."""
+        self.delta_bases[(obj._id, inst_id)] = obj.to_bytes()
+
+    def consumed_bytes(self):
+        """Returns how many bytes of the stream have been parsed so far."""
+        return self.past_bytes + self.buf_offset
+
     def available_bytes(self):
         return len(self.buf) - self.buf_offset
 
@@ -207,6 +227,154 @@ class process_stream:
                 self.buf_offset += 1
                 continue
 
+            if pack_type == TYPE_MULTI:
+                # Several object updates, each with its own small header
+                while self.ensure_available(pack_len + 1):
+                    if self.eof:
+                        return
+
+                    yield None
+
+                buf = self.buf
+                frame_start = self.buf_offset
+                frame_end = frame_start + pack_len
+
+                cs = calcCRC(buf[frame_start:frame_end])
+                recv_cs = buf[frame_end]
+
+                if recv_cs != cs:
+                    logger.warning("Bad crc. Got %d but wanted %d"%(recv_cs, cs))
+
+                    self.buf_offset += 1
+
+                    continue
+
+                self.buf_offset = frame_end + 1
+
+                if self.use_walltime:
+                    timestamp = int(time.time()*1000.0)
+                elif self.gcs_timestamps:
+                    timestamp = overrideTimestamp
+                else:
+                    timestamp = last_timestamp
+
+                pos = frame_start + header_fmt.size
+
+                while pos + multi_record_fmt.size <= frame_end:
+                    (rec_id, rec_len) = multi_record_fmt.unpack_from(buf, pos)
+                    pos += multi_record_fmt.size
+
+                    if pos + rec_len > frame_end:
+                        logger.warning("aggregate record overruns frame")
+                        break
+
+                    obj = self.uavo_defs.get('{0:08x}'.format(rec_id))
+                    data_offset = pos
+                    pos += rec_len
+
+                    if obj is None:
+                        logger.debug("Unknown object 0x%08x in aggregate"%(rec_id))
+                        continue
+
+                    instance_len = 0 if obj._single else instance_fmt.size
+
+                    if rec_len != instance_len + obj.get_size_of_data():
+                        logger.warning("mismatched size id=%08x %d in aggregate"%(rec_id, rec_len))
+                        continue
+
+                    if instance_len:
+                        instance_id = instance_fmt.unpack_from(buf, data_offset)[0]
+                    else:
+                        instance_id = 0
+
+                    data_offset += instance_len
+
+                    self.delta_bases[(rec_id, instance_id)] = \
+                            buf[data_offset:data_offset + obj.get_size_of_data()]
+
+                    objInstance = obj.from_bytes(buf, timestamp,
+                            offset=data_offset)
+                    received += 1
+
+                    yield objInstance
+
+                continue
+
+            if pack_type == TYPE_DELTA:
+                # Only the parts of an object that changed since the last
+                # copy we have
+                while self.ensure_available(pack_len + 1):
+                    if self.eof:
+                        return
+
+                    yield None
+
+                buf = self.buf
+                frame_start = self.buf_offset
+                frame_end = frame_start + pack_len
+
+                cs = calcCRC(buf[frame_start:frame_end])
+                recv_cs = buf[frame_end]
+
+                if recv_cs != cs:
+                    logger.warning("Bad crc. Got %d but wanted %d"%(recv_cs, cs))
+
+                    self.buf_offset += 1
+
+                    continue
+
+                self.buf_offset = frame_end + 1
+
+                if self.use_walltime:
+                    timestamp = int(time.time()*1000.0)
+                elif self.gcs_timestamps:
+                    timestamp = overrideTimestamp
+                else:
+                    timestamp = last_timestamp
+
+                obj = self.uavo_defs.get('{0:08x}'.format(objId))
+
+                if obj is None:
+                    logger.debug("Unknown object 0x%08x in delta"%(objId))
+                    continue
+
+                pos = frame_start + header_fmt.size
+                instance_id = 0
+
+                if not obj._single:
+                    if pos + instance_fmt.size > frame_end:
+                        logger.warning("short delta id=%08x"%(objId))
+                        continue
+
+                    instance_id = instance_fmt.unpack_from(buf, pos)[0]
+                    pos += instance_fmt.size
+
+                key = (objId, instance_id)
+                base = self.delta_bases.get(key)
+                data = None
+
+                if base is not None:
+                    data = apply_delta(base, buf[pos:frame_end])
+
+                if data is None:
+                    # Can't be applied; all we can do is ask for the lot
+                    logger.debug("unusable delta id=%08x"%(objId))
+                    self.delta_bases.pop(key, None)
+
+                    if self.delta_miss_callback is not None:
+                        self.delta_miss_callback(obj, instance_id)
+
+                    continue
+
+                self.delta_bases[key] = data
+
+                objInstance = obj.from_bytes(data, timestamp)
+                received += 1
+
+                yield objInstance
+
+                continue
+
             # Search for object.
             uavo_key = '{0:08x}'.format(objId)
             if not uavo_key in self.uavo_defs:
@@ -282,9 +450,9 @@ class process_stream:
                 continue
 
             if instance_len:
-                instance_id = instance_fmt.unpack_from(buf, header_fmt.size + buf_offset)[0]
+                instance_id = instance_fmt.unpack_from(self.buf, header_fmt.size + self.buf_offset)[0]
             else:
-                instance_id = None
+                instance_id = 0
 
             if timestamp_len:
                 # pull the timestamp from the packet
@@ -309,6 +477,9 @@ class process_stream:
             self.buf_offset += calc_size + 1
 
             if (obj_len > 0) and (obj is not None):
+                self.delta_bases[(objId, instance_id)] = \
+                        self.buf[data_offset:data_offset + obj_len]
+
                 objInstance = obj.from_bytes(self.buf, timestamp, offset=data_offset)
                 received += 1
                 if not (received % 10000):
@@ -402,6 +573,70 @@ def acknowledge_object(obj):
 
     return packet
 
+def delta_map_length(length):
+    """Returns the length of the changed block bitmap for an object"""
+    return (length + DELTA_BLOCK * 8 - 1) // (DELTA_BLOCK * 8)
+
+def encode_delta(base, data):
+    """Makes the payload of a delta frame turning base, the copy the
+    receiver holds, into data.  Returns None if that is no smaller than
+    sending data whole."""
+
+    length = len(data)
+    bitmap = bytearray(delta_map_length(length))
+    blocks = []
+
+    for offs in range(0, length, DELTA_BLOCK):
+        block = data[offs:offs + DELTA_BLOCK]
+
+        if block != base[offs:offs + DELTA_BLOCK]:
+            idx = offs // DELTA_BLOCK
+            bitmap[idx // 8] |= 1 << (idx % 8)
+            blocks.append(block)
+
+    payload = delta_check_fmt.pack(calcDeltaCRC(base)) + bytes(bitmap) + b''.join(blocks)
+
+    if len(payload) >= length:
+        return None
+
+    return payload
+
+def apply_delta(base, payload):
+    """Rebuilds object data from a delta frame payload and the copy it was
+    taken against.  Returns None if base is not that copy or the payload
+    is malformed."""
+
+    length = len(base)
+    map_len = delta_map_length(length)
+
+    check_len = delta_check_fmt.size
+
+    if len(payload) < check_len + map_len:
+        return None
+
+    if delta_check_fmt.unpack_from(payload, 0)[0] != calcDeltaCRC(base):
+        return None
+
+    data = bytearray(base)
+    pos = check_len + map_len
+
+    for offs in range(0, length, DELTA_BLOCK):
+        idx = offs // DELTA_BLOCK
+
+        if payload[check_len + idx // 8] & (1 << (idx % 8)):
+            n = min(DELTA_BLOCK, length - offs)
+
+            if pos + n > len(payload):
+                return None
+
+            data[offs:offs + n] = payload[pos:pos + n]
+            pos += n
+
+    if pos != len(payload):
+        return None
+
+    return bytes(data)
+
 def calcCRC(s):
     """
     Calculate a CRC consistently with how they are computed on the firmware side
@@ -413,3 +648,22 @@ def calcCRC(s):
         cs = crc_table[cs ^ c]
 
     return cs
+
+def calcDeltaCRC(s):
+    """
+    Calculate the CRC-32 a delta frame is checked against, the same as
+    PIOS_CRC32_updateCRC() from 0 on the firmware side
+    """
+
+    cs = 0
+
+    for c in s:
+        cs ^= c << 24
+
+        for i in range(8):
+            if cs & 0x80000000:
+                cs = ((cs << 1) ^ 0x04C11DB7) & 0xffffffff
+            else:
+                cs = (cs << 1) & 0xffffffff
+
+    return cs
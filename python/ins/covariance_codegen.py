@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+"""
+Generates the covariance prediction of the 14 state INS as straight line C.
+
+  Pnew = (I + F*T) * P * (I + F*T)' + T^2 * G * Q * G'
+
+The code only touches the elements of F and G that LinearizeFG() sets and
+only computes the upper triangle of the symmetric P.  It is written in two
+passes: A = (I + F*T) * P for the elements that are needed, then
+Pnew = A * (I + F*T)' + T^2 * G*Q*G'.  Elements that are always one are
+folded in rather than multiplied.
+
+If LinearizeFG() changes, update the patterns below and run
+
+   python3 covariance_codegen.py ../../flight/Libraries/insgps14state_covariance.h
+"""
+
+import sys
+
+NUMX = 14
+NUMW = 10
+
+ONE = 'one'
+VAR = 'var'
+
+def f_pattern():
+    f = {}
+
+    # Pdot = V
+    for i in range(3):
+        f[(i, i + 3)] = ONE
+
+    # dVdot/dq and dVdot/dabias
+    for i in range(3, 6):
+        for k in (6, 7, 8, 9, 13):
+            f[(i, k)] = VAR
+
+    # dqdot/dq (zero diagonal) and dqdot/dwbias
+    for i in range(6, 10):
+        for k in range(6, 13):
+            if k != i:
+                f[(i, k)] = VAR
+
+    return f
+
+def g_pattern():
+    g = {}
+
+    # dVdot/dna
+    for i in range(3, 6):
+        for w in range(3, 6):
+            g[(i, w)] = VAR
+
+    # dqdot/dnw
+    for i in range(6, 10):
+        for w in range(0, 3):
+            g[(i, w)] = VAR
+
+    # Bias random walks
+    for i in range(4):
+        g[(10 + i, 6 + i)] = ONE
+
+    return g
+
+class Generator:
+    def __init__(self, f, g):
+        self.f = f
+        self.g = g
+        self.f_row = [sorted(k for (r, k) in f if r == i) for i in range(NUMX)]
+        self.g_row = [sorted(w for (r, w) in g if r == i) for i in range(NUMX)]
+
+        self.lines = []
+        self.mults = 0
+        self.written = set()
+
+    def p(self, i, j):
+        """ Reads an element of the prior P """
+        if (i, j) in self.written:
+            raise ValueError("P[%d][%d] read after it was updated" % (i, j))
+
+        return 'P[%d][%d]' % (i, j)
+
+    def a(self, i, j):
+        """ An element of A = (I + F*T) * P """
+        if not self.f_row[i]:
+            return self.p(i, j)
+
+        return 'A[%d][%d]' % (i, j)
+
+    def product(self, coeffs, terms):
+        """ Sum of coeff * term, where a coeff of None is one """
+        out = []
+
+        for c, t in zip(coeffs, terms):
+            if c is None:
+                out.append(t)
+            else:
+                out.append('%s*%s' % (c, t))
+                self.mults += 1
+
+        return ' + '.join(out)
+
+    def f_coeff(self, i, k):
+        return None if self.f[(i, k)] == ONE else 'F[%d][%d]' % (i, k)
+
+    def generate(self):
+        # Elements of A the second pass needs: the upper triangle and the
+        # columns F mixes into it
+        needed = set()
+
+        for i in range(NUMX):
+            for j in range(i, NUMX):
+                needed.add((i, j))
+
+                for k in self.f_row[j]:
+                    needed.add((i, k))
+
+        self.lines.append('\t// A = (I + F*T) * P')
+
+        for i in range(NUMX):
+            if not self.f_row[i]:
+                continue
+
+            for j in range(NUMX):
+                if (i, j) not in needed:
+                    continue
+
+                sum_fp = self.product([self.f_coeff(i, k) for k in self.f_row[i]],
+                        [self.p(k, j) for k in self.f_row[i]])
+                self.mults += 1
+
+                self.lines.append('\tA[%d][%d] = %s + T*(%s);' %
+                        (i, j, self.p(i, j), sum_fp))
+
+        self.lines.append('')
+        self.lines.append('\t// Pnew = A * (I + F*T)\' + T^2 * G*Q*G\', upper triangle mirrored')
+
+        for i in range(NUMX):
+            for j in range(i, NUMX):
+                expr = self.a(i, j)
+
+                if self.f_row[j]:
+                    sum_af = self.product([self.f_coeff(j, k) for k in self.f_row[j]],
+                            [self.a(i, k) for k in self.f_row[j]])
+                    self.mults += 1
+                    expr += ' + T*(%s)' % sum_af
+
+                noise = []
+                for w in sorted(set(self.g_row[i]) & set(self.g_row[j])):
+                    gi, gj = self.g[(i, w)], self.g[(j, w)]
+                    factors = ['Q[%d]' % w]
+
+                    if gi == VAR:
+                        factors.append('G[%d][%d]' % (i, w))
+                    if gj == VAR:
+                        factors.append('G[%d][%d]' % (j, w))
+
+                    self.mults += len(factors) - 1
+                    noise.append('*'.join(factors))
+
+                if noise:
+                    self.mults += 1
+                    expr += ' + Tsq*(%s)' % ' + '.join(noise)
+
+                if i == j:
+                    self.lines.append('\tP[%d][%d] = %s;' % (i, j, expr))
+                else:
+                    self.lines.append('\tP[%d][%d] = P[%d][%d] = %s;' % (i, j, j, i, expr))
+
+                self.written.add((i, j))
+                self.written.add((j, i))
+
+    def dense_mults(self):
+        # The general version: F*P, then Dummy*F' and G*Q*G' on the upper
+        # triangle
+        upper = NUMX * (NUMX + 1) // 2
+        return NUMX * NUMX * (NUMX + 1) + upper * (NUMX + 2 * NUMW + 2)
+
+HEADER = """/**
+ ******************************************************************************
+ * @addtogroup Math
+ * @{
+ * @addtogroup INSGPS
+ * @{
+ *
+ * @file       insgps14state_covariance.h
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @brief      Sparse covariance prediction for the 14 state INS
+ *
+ * Generated by python/ins/covariance_codegen.py from the sparsity of F and
+ * G in LinearizeFG().  Do not edit by hand.
+ *
+ * %d multiplies, against %d for the dense version.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef INSGPS14STATE_COVARIANCE_H
+#define INSGPS14STATE_COVARIANCE_H
+
+/**
+ * Pnew = (I+F*T)*P*(I+F*T)' + T^2*G*Q*G', in place.  Elements of F and G
+ * outside the pattern of LinearizeFG() are never read, and the bias random
+ * walks are taken to enter G with a gain of one.
+ */
+void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
+			  float Q[NUMW], float dT, float P[NUMX][NUMX])
+{
+	const float T = dT;
+	const float Tsq = dT * dT;
+	float A[NUMX][NUMX];
+
+"""
+
+FOOTER = """}
+
+#endif /* INSGPS14STATE_COVARIANCE_H */
+
+/**
+ * @}
+ * @}
+ */
+"""
+
+def main():
+    gen = Generator(f_pattern(), g_pattern())
+    gen.generate()
+
+    out = HEADER % (gen.mults, gen.dense_mults())
+    out += '\n'.join(gen.lines) + '\n'
+    out += FOOTER
+
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], 'w') as f:
+            f.write(out)
+    else:
+        sys.stdout.write(out)
+
+if __name__ == '__main__':
+    main()
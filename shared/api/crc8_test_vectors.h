@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file       crc8_test_vectors.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup Shared
+ * @{
+ * @addtogroup
+ * @{
+ * @brief Test vectors for the UAVTalk CRC-8, shared by the flight and GCS tests
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef CRC8_TEST_VECTORS_H_
+#define CRC8_TEST_VECTORS_H_
+
+#include <stdint.h>
+
+/* CRC-8, polynomial 0x07, no reflection or final xor, as used by UAVTalk.
+ * The standard check value is the CRC of the ASCII string "123456789".
+ */
+#define CRC8_TEST_CHECK_STRING "123456789"
+#define CRC8_TEST_CHECK_VALUE 0xf4
+
+/* Each vector is the CRC of length pseudorandom bytes from
+ * crc8_test_fill(seed), starting from crc_in.  Lengths straddle the word
+ * and block sizes the implementations fold at once.
+ */
+struct crc8_test_vector {
+	uint32_t seed;
+	uint32_t length;
+	uint8_t crc_in;
+	uint8_t crc_out;
+};
+
+static const struct crc8_test_vector crc8_test_vectors[] = {
+	{ 0x00001234,    0, 0x00, 0x00 },
+	{ 0x00003123,    1, 0x25, 0xaf },
+	{ 0x00005012,    2, 0x4a, 0x3a },
+	{ 0x00006f01,    3, 0x00, 0x59 },
+	{ 0x00008df0,    4, 0x94, 0xae },
+	{ 0x0000acdf,    5, 0xb9, 0x73 },
+	{ 0x0000cbce,    7, 0x00, 0xd8 },
+	{ 0x0000eabd,    8, 0x03, 0xe9 },
+	{ 0x000109ac,    9, 0x28, 0xe0 },
+	{ 0x0001289b,   15, 0x00, 0x89 },
+	{ 0x0001478a,   16, 0x72, 0x88 },
+	{ 0x00016679,   17, 0x97, 0x32 },
+	{ 0x00018568,   31, 0x00, 0x9c },
+	{ 0x0001a457,   32, 0xe1, 0xee },
+	{ 0x0001c346,   33, 0x06, 0xb6 },
+	{ 0x0001e235,   63, 0x00, 0xf8 },
+	{ 0x00020124,   64, 0x50, 0x0f },
+	{ 0x00022013,   65, 0x75, 0x98 },
+	{ 0x00023f02,  255, 0x00, 0xd4 },
+	{ 0x00025df1,  256, 0xbf, 0x95 },
+	{ 0x00027ce0,  257, 0xe4, 0x01 },
+	{ 0x00029bcf, 1000, 0x00, 0xae },
+	{ 0x0002babe, 4096, 0x2e, 0xab },
+};
+
+#define CRC8_TEST_NUM_VECTORS (sizeof(crc8_test_vectors) / sizeof(crc8_test_vectors[0]))
+
+/* Longest vector, for sizing buffers */
+#define CRC8_TEST_MAX_LENGTH 4096
+
+static inline void crc8_test_fill(uint8_t *buf, uint32_t length, uint32_t seed)
+{
+	for (uint32_t i = 0; i < length; i++) {
+		seed = seed * 1664525 + 1013904223;
+		buf[i] = seed >> 24;
+	}
+}
+
+#endif /* CRC8_TEST_VECTORS_H_ */
+
+/**
+ * @}
+ * @}
+ */